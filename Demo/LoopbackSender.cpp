@@ -0,0 +1,74 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <GopScheduler.hpp>
+#include <UdpInputStream.hpp>
+using namespace std;
+
+// Replays synthetic video traffic to a StreamDemo listening on a loopback UDP port.
+// usage: LoopbackSender [port] [bitrate kbps] [fps] [seconds] [streams]
+int main(int argc, char** argv) {
+    const uint16_t port = argc > 1 ? static_cast<uint16_t>(atoi(argv[1])) : StreamSim::Net::DEFAULT_UDP_PORT;
+    const uint64_t bitrateKbps = argc > 2 ? strtoull(argv[2], nullptr, 10) : 8000;
+    const uint32_t fps = argc > 3 ? static_cast<uint32_t>(atoi(argv[3])) : 60;
+    const uint32_t seconds = argc > 4 ? static_cast<uint32_t>(atoi(argv[4])) : 5;
+    const uint32_t numStreams = argc > 5 ? static_cast<uint32_t>(atoi(argv[5])) : 1;
+
+    if (fps == 0 || numStreams == 0) {
+        cout << "fps and streams must be at least 1" << endl;
+        return 1;
+    }
+
+    StreamSim::Net::UdpFrameSender sender(port);
+    if (!sender.IsOpen()) {
+        cout << "Could not open a socket to port " << port << endl;
+        return 1;
+    }
+
+    // Every stream gets the full bitrate, split evenly over its frames.
+    const std::size_t frameSize = static_cast<std::size_t>(bitrateKbps * 1000 / 8 / fps);
+    cout << "Sending " << numStreams << " stream(s) of " << bitrateKbps << " kbps at " << fps << " fps ("
+         << frameSize << " bytes per frame) to port " << port << " for " << seconds << " s" << endl;
+
+    std::mt19937 generator(12345);
+    const auto frameInterval = std::chrono::microseconds(1000000 / fps);
+    const auto start = std::chrono::steady_clock::now();
+    auto nextFrameTime = start;
+    uint64_t numFramesFailed = 0;
+
+    for (uint64_t sequence = 0; sequence < static_cast<uint64_t>(fps) * seconds; ++sequence) {
+        std::this_thread::sleep_until(nextFrameTime);
+        nextFrameTime += frameInterval;
+
+        for (uint32_t streamId = 0; streamId < numStreams; ++streamId) {
+            StreamSim::Core::ByteUndecodedFrame frame;
+            frame.data = static_cast<uint8_t>(generator() & 0xFF);
+            frame.meta.streamId = streamId;
+            frame.meta.sequence = sequence;
+            frame.meta.timestampUs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count());
+            StreamSim::Core::DescribeGopFrame(frame.meta);
+
+            frame.payload = StreamSim::Core::FrameBufferPool::Default().Acquire(frameSize);
+            if (!frame.payload) {
+                cout << "Frames of " << frameSize << " bytes are too big" << endl;
+                return 1;
+            }
+            for (std::size_t i = 0; i + sizeof(uint32_t) <= frame.payload.Size(); i += sizeof(uint32_t)) {
+                const uint32_t word = generator();
+                std::memcpy(frame.payload.Data() + i, &word, sizeof(word));
+            }
+
+            if (!sender.SendFrame(frame)) {
+                ++numFramesFailed;
+            }
+        }
+    }
+
+    cout << "Sent " << sender.NumPacketsSent() << " packets, " << sender.NumBytesSent() << " bytes, "
+         << numFramesFailed << " frame(s) failed" << endl;
+    return 0;
+}
@@ -1,23 +1,117 @@
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <string>
 #include <ProtocolService.hpp>
 using namespace std;
 
 int main(int argc, char** argv) {
-    
+    // --key=value options (and --config=<file>) size the pipeline, see PipelineConfig.hpp.
+    // They are taken out of argv, so the mode and its arguments work the same with or without them.
+    StreamSim::Core::PipelineConfig config;
+    std::string configError;
+    if (!StreamSim::Core::ParsePipelineArgs(argc, argv, config, configError)) {
+        cout << "Bad pipeline config: " << configError << endl;
+        return 1;
+    }
+
     cout << "Started demo protocol service" << endl;
+    cout << "Host: " << StreamSim::Core::FormatCpuTopology(StreamSim::Core::CpuTopology::Host()) << endl;
+    cout << StreamSim::Core::FormatPipelineConfig(config);
     
     std::unique_ptr<StreamSim::Net::ProtocolService> service;
+    StreamSim::Net::DemoProtocolServiceQueued* queuedService = nullptr;
 
-    if (argv[1] == 0) {
+    if (argc < 2) {
         cout << "Running Pooled Service" << endl;
-        service = std::make_unique<StreamSim::Net::DemoProtocolServicePooled>(4, 6);
+        service = std::make_unique<StreamSim::Net::DemoProtocolServicePooled>(config);
+    } else if (std::strcmp(argv[1], "udp") == 0) {
+        // Frames come from LoopbackSender instead of the simulated ingest.
+        uint16_t port = argc > 2 ? static_cast<uint16_t>(atoi(argv[2])) : StreamSim::Net::DEFAULT_UDP_PORT;
+        cout << "Running Queued Service on UDP port " << port << endl;
+        auto queued = std::make_unique<StreamSim::Net::DemoProtocolServiceQueued>(
+            config, StreamSim::Net::IngestSource::Udp, port);
+        queuedService = queued.get();
+        service = std::move(queued);
+    } else if (std::strcmp(argv[1], "replay") == 0 && argc > 2) {
+        // Sends the frames of a capture file at their recorded times.
+        auto capture = std::make_shared<StreamSim::Net::FrameCaptureReader>(argv[2]);
+        if (!capture->IsOpen()) {
+            cout << "Could not read capture " << argv[2] << endl;
+            return 1;
+        }
+        cout << "Replaying " << capture->NumFrames() << " frames from " << argv[2] << endl;
+        StreamSim::Net::LoadProfile profile;
+        profile.arrival = StreamSim::Net::ArrivalProcess::Replay;
+        profile.capture = capture;
+        auto queued = std::make_unique<StreamSim::Net::DemoProtocolServiceQueued>(config);
+        queued->SetLoadProfile(profile);
+        queuedService = queued.get();
+        service = std::move(queued);
+    } else if (std::strcmp(argv[1], "record") == 0 && argc > 2) {
+        // Simulated ingest, everything it sends also goes into a capture file to replay later.
+        cout << "Running Queued Service, recording to " << argv[2] << endl;
+        auto queued = std::make_unique<StreamSim::Net::DemoProtocolServiceQueued>(config);
+        if (!queued->RecordCapture(argv[2])) {
+            cout << "Could not create capture " << argv[2] << endl;
+            return 1;
+        }
+        queuedService = queued.get();
+        service = std::move(queued);
+    } else if (std::strcmp(argv[1], "coroutine") == 0) {
+        // ingest.threads streams, all of them on executor.threads threads.
+        cout << "Running Coroutine Service with " << config.numIngestThreads << " streams on "
+             << config.numExecutorThreads << " threads" << endl;
+        service = std::make_unique<StreamSim::Net::DemoProtocolServiceCoroutine>(config);
     } else {
         cout << "Running Queued Service" << endl;
-        service = std::make_unique<StreamSim::Net::DemoProtocolServiceQueued>(4, 6);
+        auto queued = std::make_unique<StreamSim::Net::DemoProtocolServiceQueued>(config);
+        queuedService = queued.get();
+        service = std::move(queued);
     }
     
-    service->Run();
+    if (!service->Run()) {
+        cout << "Could not start the protocol service" << endl;
+        return 1;
+    }
     service->Shutdown();
+
+    auto stats = service->GetStats();
+    auto printLatency = [](const char* stage, const StreamSim::Core::LatencySummary& latency) {
+        cout << stage << ": " << latency.count << " frames, p50 " << latency.p50Ns / 1000 << " us, p99 "
+             << latency.p99Ns / 1000 << " us, max " << latency.maxNs / 1000 << " us" << endl;
+    };
+    printLatency("Queue wait", stats.queueWait);
+    printLatency("Decode", stats.decode);
+    printLatency("Render wait", stats.renderWait);
+    printLatency("End to end", stats.endToEnd);
+    cout << "Decode queue: max depth " << stats.decodeQueue.maxDepth << ", dropped " << stats.decodeQueue.dropped
+         << "; render queue: max depth " << stats.renderQueue.maxDepth << ", dropped " << stats.renderQueue.dropped
+         << "; decode pool dropped " << stats.decodePool.droppedOldest << endl;
+    cout << "Dropped frames: " << stats.drops.Total() << " (decode queue " << stats.drops.decodeQueue
+         << ", decode pool " << stats.drops.decodePool << ", expired before decode " << stats.drops.decodeExpired
+         << ", render queue " << stats.drops.renderQueue << ", expired before render " << stats.drops.renderExpired
+         << ", superseded " << stats.drops.renderSuperseded << ")" << endl;
+    if (config.decodeAutoscale.enabled) {
+        cout << "Decode autoscaling: " << stats.decodeAutoscale.activeWorkers << " of " << stats.decodeAutoscale.maxWorkers
+             << " workers active, scaled up " << stats.decodeAutoscale.scaleUps << " times, down "
+             << stats.decodeAutoscale.scaleDowns << " times" << endl;
+    }
+
+    if (queuedService != nullptr) {
+        auto stats = queuedService->GetJitterBufferStats();
+        cout << "Jitter buffer: " << stats.framesReleased << " frames played out, " << stats.framesLate
+             << " late, jitter " << stats.jitterUs << " us, delay " << stats.currentDelayUs << " us" << endl;
+    }
+
+    if (queuedService != nullptr && queuedService->GetUdpInputStream() != nullptr) {
+        auto stats = queuedService->GetUdpInputStream()->GetStats();
+        cout << "UDP ingest: " << stats.packets << " packets in " << stats.recvCalls << " recvmmsg calls, "
+             << stats.bytes << " bytes, " << stats.reassembly.framesCompleted << " frames, "
+             << stats.reassembly.framesDropped << " dropped" << endl;
+        cout << "UDP ingest time: recv " << stats.recvNs / 1000 << " us, reassembly "
+             << stats.reassemblyNs / 1000 << " us" << endl;
+    }
     cout << "Ended demo protocol service" << endl;
 
     return 0;
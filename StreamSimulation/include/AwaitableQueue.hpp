@@ -0,0 +1,215 @@
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+#include <coroutine>
+#include <deque>
+#include <mutex>
+
+#include "ConcurrentData.hpp"
+#include "CoroutineExecutor.hpp"
+
+namespace StreamSim::Core {
+
+// Bounded FIFO between coroutines on a CoroutineExecutor.  co_await queue.Read(data) / queue.Write(data)
+// suspend the calling coroutine while the queue is empty / full, instead of parking its thread the way the
+// BufferQueue implementations do, and the executor resumes it once the other side got to it.
+// A value written while a reader is waiting goes straight to that reader, and a read that frees a slot
+// takes the value of the first waiting writer along, so whoever is resumed already has what it waited for.
+// Both sides check and queue themselves up under one lock in await_suspend, so no wakeup can be missed.
+// Close wakes every waiter, reads still get what was written before it and then fail, writes fail at once.
+// Elements live in a deque that only grows as far as the queue gets filled, so a service with thousands of
+// streams doesn't reserve every stream's full capacity up front.
+template <typename T>
+class AwaitableQueue {
+private:
+    struct Waiter {
+        std::coroutine_handle<> handle;
+        bool isDone = false;
+    };
+
+    struct ReadWaiter : Waiter {
+        T* data = nullptr;
+    };
+
+    struct WriteWaiter : Waiter {
+        const T* data = nullptr;
+    };
+
+public:
+    class ReadAwaitable {
+    private:
+        AwaitableQueue& m_queue;
+        ReadWaiter m_waiter;
+
+    public:
+        ReadAwaitable(AwaitableQueue& queue, T& data)
+        : m_queue(queue) {
+            m_waiter.data = &data;
+        }
+
+        bool await_ready() const {
+            return false;
+        }
+        bool await_suspend(std::coroutine_handle<> handle) {
+            m_waiter.handle = handle;
+            return m_queue.SuspendRead(m_waiter);
+        }
+        // False if the queue was closed and is empty.
+        bool await_resume() const {
+            return m_waiter.isDone;
+        }
+    };
+
+    class WriteAwaitable {
+    private:
+        AwaitableQueue& m_queue;
+        WriteWaiter m_waiter;
+
+    public:
+        WriteAwaitable(AwaitableQueue& queue, const T& data)
+        : m_queue(queue) {
+            m_waiter.data = &data;
+        }
+
+        bool await_ready() const {
+            return false;
+        }
+        bool await_suspend(std::coroutine_handle<> handle) {
+            m_waiter.handle = handle;
+            return m_queue.SuspendWrite(m_waiter);
+        }
+        // False if the queue was closed, data wasn't written then.
+        bool await_resume() const {
+            return m_waiter.isDone;
+        }
+    };
+
+private:
+    CoroutineExecutor& m_executor;
+    std::deque<T> m_dataBuffer;
+    const std::size_t m_capacity;
+    std::size_t m_maxCount = 0;
+    bool m_isClosed = false;
+    std::deque<ReadWaiter*> m_readers;
+    std::deque<WriteWaiter*> m_writers;
+    std::mutex m_mutex;
+
+    void PushLocked(const T& data) {
+        m_dataBuffer.push_back(data);
+        m_maxCount = std::max(m_maxCount, m_dataBuffer.size());
+    }
+
+    // True if the waiter has to suspend, false if it is done (or failed) and carries on right away.
+    bool SuspendRead(ReadWaiter& waiter) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_dataBuffer.empty()) {
+            *waiter.data = std::move(m_dataBuffer.front());
+            m_dataBuffer.pop_front();
+            waiter.isDone = true;
+
+            if (m_writers.empty()) {
+                return false;
+            }
+            WriteWaiter* writer = m_writers.front();
+            m_writers.pop_front();
+            PushLocked(*writer->data);
+            writer->isDone = true;
+            lock.unlock();
+            m_executor.Schedule(writer->handle);
+            return false;
+        }
+        if (m_isClosed) {
+            waiter.isDone = false;
+            return false;
+        }
+        m_readers.push_back(&waiter);
+        return true;
+    }
+
+    bool SuspendWrite(WriteWaiter& waiter) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_isClosed) {
+            waiter.isDone = false;
+            return false;
+        }
+        if (!m_readers.empty()) {
+            // Readers only wait on an empty queue, so nothing is overtaken.
+            ReadWaiter* reader = m_readers.front();
+            m_readers.pop_front();
+            *reader->data = *waiter.data;
+            reader->isDone = true;
+            waiter.isDone = true;
+            lock.unlock();
+            m_executor.Schedule(reader->handle);
+            return false;
+        }
+        if (m_dataBuffer.size() < m_capacity) {
+            PushLocked(*waiter.data);
+            waiter.isDone = true;
+            return false;
+        }
+        m_writers.push_back(&waiter);
+        return true;
+    }
+
+public:
+    AwaitableQueue(CoroutineExecutor& executor, std::size_t capacity)
+    : m_executor(executor)
+    , m_capacity(std::max<std::size_t>(capacity, 1)) {}
+
+    AwaitableQueue(const AwaitableQueue&) = delete;
+    AwaitableQueue& operator=(const AwaitableQueue&) = delete;
+
+    // data has to stay alive until the co_await is over, which a local of the coroutine always does.
+    ReadAwaitable Read(T& data) {
+        return ReadAwaitable(*this, data);
+    }
+
+    WriteAwaitable Write(const T& data) {
+        return WriteAwaitable(*this, data);
+    }
+
+    void Close() {
+        std::deque<ReadWaiter*> readers;
+        std::deque<WriteWaiter*> writers;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_isClosed = true;
+            readers.swap(m_readers);
+            writers.swap(m_writers);
+        }
+        for (ReadWaiter* reader : readers) {
+            reader->isDone = false;
+            m_executor.Schedule(reader->handle);
+        }
+        for (WriteWaiter* writer : writers) {
+            writer->isDone = false;
+            m_executor.Schedule(writer->handle);
+        }
+    }
+
+    bool IsClosed() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_isClosed;
+    }
+
+    std::size_t NumElements() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_dataBuffer.size();
+    }
+
+    std::size_t Capacity() const {
+        return m_capacity;
+    }
+
+    QueueStats GetQueueStats() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        QueueStats stats;
+        stats.depth = m_dataBuffer.size();
+        stats.maxDepth = m_maxCount;
+        return stats;
+    }
+};
+
+}
@@ -3,19 +3,102 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <condition_variable>
 #include <shared_mutex>
 #include <cassert>
 #include <chrono>
+#include <bit>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "EventCount.hpp"
 
 namespace StreamSim::Core {
 
+// Gauges of one queue.  Queues that don't keep track of the high-water mark or of dropped elements
+// leave them at 0.
+struct QueueStats {
+    std::size_t depth = 0;
+    std::size_t maxDepth = 0;
+    uint64_t dropped = 0;
+};
+
+// How the blocking calls of a queue wait.  A read or write that can't go ahead gives up after timeout,
+// zero waits until it can or the queue is closed.  The lock-free queues first retry spinCount times
+// before parking, the locked ones go straight to their condition variable.
+struct QueueWaitPolicy {
+    std::chrono::milliseconds timeout{std::chrono::seconds(2)};
+    uint32_t spinCount = 64;
+};
+
+// Condition variable wait of the locked queues, false if it timed out with predicate still false.
+template <typename Predicate>
+bool WaitOnCondition(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, const QueueWaitPolicy& wait,
+                     Predicate predicate) {
+    if (wait.timeout.count() == 0) {
+        cv.wait(lock, predicate);
+        return true;
+    }
+    return cv.wait_for(lock, wait.timeout, predicate);
+}
+
+// Common surface of every frame queue, so a pipeline stage can be handed whichever queue
+// implementation matches the number of threads writing into and reading from it.
+template <typename T>
+class BufferQueue {
+public:
+    virtual ~BufferQueue() = default;
+
+    virtual bool WriteSync(const T& data) = 0;
+    virtual bool ReadAsync(T& data) = 0;
+    virtual bool ReadSync(T& data) = 0;
+
+    // Batched versions move as many elements as they can (up to the span size, or max for reads)
+    // with a single synchronization and a single wakeup, and return how many were moved.
+    // WriteBatch and ReadBatch wait like WriteSync/ReadSync until at least one element fits or is
+    // available, and return 0 on timeout or when the queue is closed.
+    virtual std::size_t WriteBatch(std::span<const T> data) = 0;
+    virtual std::size_t ReadBatchAsync(std::span<T> data, std::size_t max) = 0;
+    virtual std::size_t ReadBatch(std::span<T> data, std::size_t max) = 0;
+
+    virtual std::size_t NumElements() = 0;
+    // Elements a reader could take right now.  Only differs from NumElements for queues that hold
+    // elements back until they are due.
+    virtual std::size_t NumReadyElements() {
+        return NumElements();
+    }
+    // Elements the queue holds when full, fixed at construction.
+    virtual std::size_t Capacity() const = 0;
+    virtual bool IsFull() = 0;
+    virtual bool IsEmpty() = 0;
+
+    // Closing is permanent: writes fail from then on, readers drain whatever is left and then
+    // ReadSync returns false right away instead of waiting, which is how parked readers get woken
+    // up on shutdown.
+    virtual void Close() = 0;
+    virtual bool IsClosed() = 0;
+
+    virtual QueueStats GetQueueStats() {
+        QueueStats stats;
+        stats.depth = NumElements();
+        return stats;
+    }
+};
+
 // Buffer queue that has fixed size buffer which holds elements.
+// N and DefaultWaitSec are only the defaults, the size and wait are picked at construction.
 template <typename T, std::size_t N, uint32_t DefaultWaitSec = 2>
-class ConcurrentBufferQueue {
+class ConcurrentBufferQueue : public BufferQueue<T> {
 private:
-    std::array<T, N> m_dataBuffer;
+    std::vector<T> m_dataBuffer;
+    const std::size_t m_capacity;
+    const QueueWaitPolicy m_wait;
 
     std::mutex m_mutex;
     std::condition_variable m_fullCv;
@@ -24,74 +107,130 @@ private:
     std::size_t m_count = 0;
     std::size_t m_head = 0;
     std::size_t m_tail = 0;
+    bool m_closed = false;
+
+    // Gauges, updated under m_mutex.
+    std::size_t m_maxCount = 0;
+    uint64_t m_numDropped = 0;
+
+    // Caller must hold m_mutex.
+    std::size_t PopBatch(std::span<T> data, std::size_t max) {
+        const std::size_t numToRead = std::min({ m_count, max, data.size() });
+        if (numToRead == 0) {
+            return 0;
+        }
+
+        for (std::size_t i = 0; i < numToRead; ++i) {
+            data[i] = std::move(m_dataBuffer[m_head++]);
+            m_head = m_head % m_capacity;
+        }
+        m_count -= numToRead;
+
+        m_fullCv.notify_all();
+        return numToRead;
+    }
 
 public:
     
-    ConcurrentBufferQueue() = default;
+    explicit ConcurrentBufferQueue(std::size_t capacity = N, QueueWaitPolicy wait = { std::chrono::seconds(DefaultWaitSec) })
+    : m_dataBuffer(std::max<std::size_t>(capacity, 1))
+    , m_capacity(m_dataBuffer.size())
+    , m_wait(wait) {}
 
-    bool WriteSync(const T& data) {
+    bool WriteSync(const T& data) override {
         std::unique_lock<std::mutex> lock(m_mutex);
-        if constexpr (DefaultWaitSec == 0) {
-            m_fullCv.wait(lock, [this] {
-                return m_count < N;
-            });
-        } else {
-            m_fullCv.wait_for(lock, std::chrono::seconds(DefaultWaitSec), [this] {
-                return m_count < N;
-            });
-        }
+        WaitOnCondition(m_fullCv, lock, m_wait, [this] {
+            return m_count < m_capacity || m_closed;
+        });
 
-        if (m_count >= N) {
+        if (m_closed || m_count >= m_capacity) {
+            ++m_numDropped;
             return false;
         }
 
         m_dataBuffer[m_tail++] = data;
-        m_tail = m_tail % N;
+        m_tail = m_tail % m_capacity;
         m_count++;
+        m_maxCount = std::max(m_maxCount, m_count);
         
         m_emptyCv.notify_all();
 
         return true;
     }
 
-    bool ReadAsync(T& data) {
+    bool ReadAsync(T& data) override {
         std::lock_guard<std::mutex> lock(m_mutex);
         if (m_count == 0) {
             return false;
         }
 
-        data = m_dataBuffer[m_head++];
-        m_head = m_head % N;
+        data = std::move(m_dataBuffer[m_head++]);
+        m_head = m_head % m_capacity;
         m_count--;
 
         m_fullCv.notify_all();
         return true;
     }
 
-    bool ReadSync(T& data) {
+    bool ReadSync(T& data) override {
         std::unique_lock<std::mutex> lock(m_mutex);
-        if constexpr (DefaultWaitSec == 0) {
-            m_emptyCv.wait(lock, [this] {
-                return m_count > 0;
-            });
-        } else {
-            m_emptyCv.wait_for(lock, std::chrono::seconds(DefaultWaitSec), [this] {
-                return m_count > 0;
-            });
-        }
+        WaitOnCondition(m_emptyCv, lock, m_wait, [this] {
+            return m_count > 0 || m_closed;
+        });
 
         if (m_count == 0) {
             return false;
         }
 
-        data = m_dataBuffer[m_head++];
-        m_head = m_head % N;
+        data = std::move(m_dataBuffer[m_head++]);
+        m_head = m_head % m_capacity;
         m_count--;
 
         m_fullCv.notify_all();
         return true;
     }
 
+    std::size_t WriteBatch(std::span<const T> data) override {
+        if (data.empty()) {
+            return 0;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        WaitOnCondition(m_fullCv, lock, m_wait, [this] {
+            return m_count < m_capacity || m_closed;
+        });
+
+        if (m_closed || m_count >= m_capacity) {
+            m_numDropped += data.size();
+            return 0;
+        }
+
+        const std::size_t numToWrite = std::min(m_capacity - m_count, data.size());
+        for (std::size_t i = 0; i < numToWrite; ++i) {
+            m_dataBuffer[m_tail++] = data[i];
+            m_tail = m_tail % m_capacity;
+        }
+        m_count += numToWrite;
+        m_maxCount = std::max(m_maxCount, m_count);
+
+        m_emptyCv.notify_all();
+        return numToWrite;
+    }
+
+    std::size_t ReadBatchAsync(std::span<T> data, std::size_t max) override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return PopBatch(data, max);
+    }
+
+    std::size_t ReadBatch(std::span<T> data, std::size_t max) override {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        WaitOnCondition(m_emptyCv, lock, m_wait, [this] {
+            return m_count > 0 || m_closed;
+        });
+
+        return PopBatch(data, max);
+    }
+
     std::size_t GetHeadIndex() {
         std::lock_guard<std::mutex> lock(m_mutex);
         return m_head;
@@ -102,20 +241,462 @@ public:
         return m_tail;
     }
 
-    std::size_t NumElements() {
+    std::size_t NumElements() override {
         std::lock_guard<std::mutex> lock(m_mutex);
         return m_count;
     }
 
-    bool IsFull() {
+    std::size_t Capacity() const override {
+        return m_capacity;
+    }
+
+    bool IsFull() override {
         std::lock_guard<std::mutex> lock(m_mutex);
-        return m_count >= N;
+        return m_count >= m_capacity;
     }
 
-    bool IsEmpty() {
+    // dropped counts writes that gave up on a full or closed queue.
+    QueueStats GetQueueStats() override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        QueueStats stats;
+        stats.depth = m_count;
+        stats.maxDepth = m_maxCount;
+        stats.dropped = m_numDropped;
+        return stats;
+    }
+
+    bool IsEmpty() override {
         std::lock_guard<std::mutex> lock(m_mutex);
         return m_count == 0;
     }
+
+    void Close() override {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_fullCv.notify_all();
+        m_emptyCv.notify_all();
+    }
+
+    bool IsClosed() override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_closed;
+    }
+};
+
+// Blocking helper shared by the lock-free queues.  Retries the non-blocking operation for a short
+// spin, then parks on the event until it is notified, the queue is closed or the wait times out.
+template <typename TryOp>
+bool SpinThenWait(EventCount& event, const std::atomic_bool& closed, const QueueWaitPolicy& wait, TryOp tryOp) {
+    for (uint32_t i = 0; i < wait.spinCount; ++i) {
+        if (tryOp()) {
+            return true;
+        }
+        if (closed.load(std::memory_order_acquire)) {
+            return false;
+        }
+        CpuRelax();
+    }
+
+    const auto deadline = EventCount::Clock::now() + wait.timeout;
+    while (true) {
+        const uint32_t key = event.PrepareWait();
+        if (tryOp()) {
+            event.CancelWait();
+            return true;
+        }
+        if (closed.load(std::memory_order_acquire)) {
+            event.CancelWait();
+            return false;
+        }
+        if (wait.timeout.count() == 0) {
+            event.Wait(key);
+        } else if (!event.Wait(key, deadline)) {
+            return tryOp();
+        }
+    }
+}
+
+// Wait-free ring buffer for exactly one writer thread and one reader thread.
+// Head and tail are free running counters on their own cache lines, and each side keeps a cached
+// copy of the other side's counter so the common case touches no shared cache line at all.
+// Blocking calls spin briefly and then park on an EventCount, so there is no lock and a write
+// only costs a syscall when the reader is actually asleep.
+// The capacity is rounded up to a power of two so a position maps to its slot with a mask.
+template <typename T, std::size_t N, uint32_t DefaultWaitSec = 2>
+class SpscRingBufferQueue : public BufferQueue<T> {
+private:
+    const std::size_t m_capacity;
+    const std::size_t m_indexMask;
+    const QueueWaitPolicy m_wait;
+    // Reader side.
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> m_head{0};
+    std::size_t m_cachedTail = 0;
+
+    // Writer side.
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> m_tail{0};
+    std::size_t m_cachedHead = 0;
+
+    alignas(CACHE_LINE_SIZE) EventCount m_notEmpty;
+    EventCount m_notFull;
+    std::atomic_bool m_closed{false};
+
+    std::vector<T> m_dataBuffer;
+
+    bool TryWrite(const T& data) {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cachedHead >= m_capacity) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_cachedHead >= m_capacity) {
+                return false;
+            }
+        }
+
+        m_dataBuffer[tail & m_indexMask] = data;
+        m_tail.store(tail + 1, std::memory_order_release);
+        m_notEmpty.NotifyOne();
+        return true;
+    }
+
+    bool TryRead(T& data) {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cachedTail) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cachedTail) {
+                return false;
+            }
+        }
+
+        data = std::move(m_dataBuffer[head & m_indexMask]);
+        m_head.store(head + 1, std::memory_order_release);
+        m_notFull.NotifyOne();
+        return true;
+    }
+
+    std::size_t TryWriteBatch(std::span<const T> data) {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cachedHead + data.size() > m_capacity) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+        }
+
+        const std::size_t numToWrite = std::min(m_capacity - (tail - m_cachedHead), data.size());
+        if (numToWrite == 0) {
+            return 0;
+        }
+
+        for (std::size_t i = 0; i < numToWrite; ++i) {
+            m_dataBuffer[(tail + i) & m_indexMask] = data[i];
+        }
+        m_tail.store(tail + numToWrite, std::memory_order_release);
+        m_notEmpty.NotifyOne();
+        return numToWrite;
+    }
+
+    std::size_t TryReadBatch(std::span<T> data, std::size_t max) {
+        const std::size_t limit = std::min(max, data.size());
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (m_cachedTail - head < limit) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+        }
+
+        const std::size_t numToRead = std::min(m_cachedTail - head, limit);
+        if (numToRead == 0) {
+            return 0;
+        }
+
+        for (std::size_t i = 0; i < numToRead; ++i) {
+            data[i] = std::move(m_dataBuffer[(head + i) & m_indexMask]);
+        }
+        m_head.store(head + numToRead, std::memory_order_release);
+        m_notFull.NotifyOne();
+        return numToRead;
+    }
+
+public:
+    explicit SpscRingBufferQueue(std::size_t capacity = N, QueueWaitPolicy wait = { std::chrono::seconds(DefaultWaitSec) })
+    : m_capacity(std::bit_ceil(std::max<std::size_t>(capacity, 1)))
+    , m_indexMask(m_capacity - 1)
+    , m_wait(wait)
+    , m_dataBuffer(m_capacity) {}
+
+    // Must only be called from the single writer thread.
+    bool WriteSync(const T& data) override {
+        if (m_closed.load(std::memory_order_acquire)) {
+            return false;
+        }
+        return SpinThenWait(m_notFull, m_closed, m_wait, [&] { return TryWrite(data); });
+    }
+
+    // Must only be called from the single reader thread.
+    bool ReadAsync(T& data) override {
+        return TryRead(data);
+    }
+
+    // Must only be called from the single reader thread.
+    bool ReadSync(T& data) override {
+        // One last attempt picks up anything written just before the queue was closed.
+        return SpinThenWait(m_notEmpty, m_closed, m_wait, [&] { return TryRead(data); }) || TryRead(data);
+    }
+
+    // Must only be called from the single writer thread.
+    std::size_t WriteBatch(std::span<const T> data) override {
+        std::size_t written = 0;
+        if (data.empty() || m_closed.load(std::memory_order_acquire)) {
+            return 0;
+        }
+        SpinThenWait(m_notFull, m_closed, m_wait, [&] {
+            written = TryWriteBatch(data);
+            return written > 0;
+        });
+        return written;
+    }
+
+    // Must only be called from the single reader thread.
+    std::size_t ReadBatchAsync(std::span<T> data, std::size_t max) override {
+        return TryReadBatch(data, max);
+    }
+
+    // Must only be called from the single reader thread.
+    std::size_t ReadBatch(std::span<T> data, std::size_t max) override {
+        std::size_t read = 0;
+        if (SpinThenWait(m_notEmpty, m_closed, m_wait, [&] {
+                read = TryReadBatch(data, max);
+                return read > 0;
+            })) {
+            return read;
+        }
+        return TryReadBatch(data, max);
+    }
+
+    // The size queries below are snapshots and may be stale by the time they return.
+    std::size_t NumElements() override {
+        const std::size_t head = m_head.load(std::memory_order_acquire);
+        const std::size_t tail = m_tail.load(std::memory_order_acquire);
+        return tail - head;
+    }
+
+    std::size_t Capacity() const override {
+        return m_capacity;
+    }
+
+    bool IsFull() override {
+        return NumElements() >= m_capacity;
+    }
+
+    bool IsEmpty() override {
+        return NumElements() == 0;
+    }
+
+    void Close() override {
+        m_closed.store(true, std::memory_order_release);
+        m_notEmpty.NotifyAll();
+        m_notFull.NotifyAll();
+    }
+
+    bool IsClosed() override {
+        return m_closed.load(std::memory_order_acquire);
+    }
+};
+
+// Bounded lock-free queue for any number of writer and reader threads (Dmitry Vyukov's design).
+// Every slot carries a sequence number that tells a writer whether the slot is free for its lap
+// and a reader whether the slot holds data for its lap, so the only contended operation is one
+// CAS on the enqueue or dequeue position.  Blocking calls park on an EventCount like the SPSC ring.
+// The capacity is rounded up to a power of two of at least 2.
+template <typename T, std::size_t N, uint32_t DefaultWaitSec = 2>
+class MpmcBufferQueue : public BufferQueue<T> {
+private:
+    struct Slot {
+        std::atomic<std::size_t> sequence;
+        T data;
+    };
+
+    const std::size_t m_capacity;
+    const std::size_t m_indexMask;
+    const QueueWaitPolicy m_wait;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> m_enqueuePos{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> m_dequeuePos{0};
+
+    alignas(CACHE_LINE_SIZE) EventCount m_notEmpty;
+    EventCount m_notFull;
+    std::atomic_bool m_closed{false};
+
+    std::unique_ptr<Slot[]> m_slots;
+
+    bool TryWriteSlot(const T& data) {
+        std::size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &m_slots[pos & m_indexMask];
+            const std::size_t seq = slot->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->data = data;
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryWrite(const T& data) {
+        if (!TryWriteSlot(data)) {
+            return false;
+        }
+        m_notEmpty.NotifyOne();
+        return true;
+    }
+
+    bool TryReadSlot(T& data) {
+        std::size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &m_slots[pos & m_indexMask];
+            const std::size_t seq = slot->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        data = std::move(slot->data);
+        slot->sequence.store(pos + m_capacity, std::memory_order_release);
+        return true;
+    }
+
+    bool TryRead(T& data) {
+        if (!TryReadSlot(data)) {
+            return false;
+        }
+        m_notFull.NotifyOne();
+        return true;
+    }
+
+    // Slots are still claimed one CAS at a time, but waiters are only woken once per batch.
+    std::size_t TryWriteBatch(std::span<const T> data) {
+        std::size_t numWritten = 0;
+        while (numWritten < data.size() && TryWriteSlot(data[numWritten])) {
+            ++numWritten;
+        }
+        if (numWritten == 1) {
+            m_notEmpty.NotifyOne();
+        } else if (numWritten > 1) {
+            m_notEmpty.NotifyAll();
+        }
+        return numWritten;
+    }
+
+    std::size_t TryReadBatch(std::span<T> data, std::size_t max) {
+        const std::size_t limit = std::min(max, data.size());
+        std::size_t numRead = 0;
+        while (numRead < limit && TryReadSlot(data[numRead])) {
+            ++numRead;
+        }
+        if (numRead == 1) {
+            m_notFull.NotifyOne();
+        } else if (numRead > 1) {
+            m_notFull.NotifyAll();
+        }
+        return numRead;
+    }
+
+public:
+    explicit MpmcBufferQueue(std::size_t capacity = N, QueueWaitPolicy wait = { std::chrono::seconds(DefaultWaitSec) })
+    : m_capacity(std::bit_ceil(std::max<std::size_t>(capacity, 2)))
+    , m_indexMask(m_capacity - 1)
+    , m_wait(wait)
+    , m_slots(std::make_unique<Slot[]>(m_capacity)) {
+        for (std::size_t i = 0; i < m_capacity; ++i) {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool WriteSync(const T& data) override {
+        if (m_closed.load(std::memory_order_acquire)) {
+            return false;
+        }
+        return SpinThenWait(m_notFull, m_closed, m_wait, [&] { return TryWrite(data); });
+    }
+
+    bool ReadAsync(T& data) override {
+        return TryRead(data);
+    }
+
+    bool ReadSync(T& data) override {
+        // One last attempt picks up anything written just before the queue was closed.
+        return SpinThenWait(m_notEmpty, m_closed, m_wait, [&] { return TryRead(data); }) || TryRead(data);
+    }
+
+    std::size_t WriteBatch(std::span<const T> data) override {
+        std::size_t written = 0;
+        if (data.empty() || m_closed.load(std::memory_order_acquire)) {
+            return 0;
+        }
+        SpinThenWait(m_notFull, m_closed, m_wait, [&] {
+            written = TryWriteBatch(data);
+            return written > 0;
+        });
+        return written;
+    }
+
+    std::size_t ReadBatchAsync(std::span<T> data, std::size_t max) override {
+        return TryReadBatch(data, max);
+    }
+
+    std::size_t ReadBatch(std::span<T> data, std::size_t max) override {
+        std::size_t read = 0;
+        if (SpinThenWait(m_notEmpty, m_closed, m_wait, [&] {
+                read = TryReadBatch(data, max);
+                return read > 0;
+            })) {
+            return read;
+        }
+        return TryReadBatch(data, max);
+    }
+
+    // The size queries below are snapshots and may be stale by the time they return.
+    std::size_t NumElements() override {
+        const std::size_t head = m_dequeuePos.load(std::memory_order_acquire);
+        const std::size_t tail = m_enqueuePos.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+
+    std::size_t Capacity() const override {
+        return m_capacity;
+    }
+
+    bool IsFull() override {
+        return NumElements() >= m_capacity;
+    }
+
+    bool IsEmpty() override {
+        return NumElements() == 0;
+    }
+
+    void Close() override {
+        m_closed.store(true, std::memory_order_release);
+        m_notEmpty.NotifyAll();
+        m_notFull.NotifyAll();
+    }
+
+    bool IsClosed() override {
+        return m_closed.load(std::memory_order_acquire);
+    }
 };
 
 }
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace StreamSim::Core {
+
+constexpr std::size_t DEFAULT_NUM_EXECUTOR_THREADS = 2;
+
+class CoroutineExecutor;
+
+// A coroutine the executor runs to completion on its own, nobody waits for its result.  It starts
+// suspended and only runs once handed to CoroutineExecutor::Spawn, and its frame frees itself when
+// it's done.  Exceptions aren't used anywhere in the pipeline, one escaping a task terminates.
+class CoTask {
+public:
+    struct promise_type {
+        CoroutineExecutor* executor = nullptr;
+
+        // Runs after the coroutine's locals are gone, so the executor only hears about it once
+        // nothing of the task is left.
+        struct FinalAwaiter {
+            bool await_ready() noexcept {
+                return false;
+            }
+            void await_suspend(std::coroutine_handle<promise_type> handle) noexcept;
+            void await_resume() noexcept {}
+        };
+
+        CoTask get_return_object() {
+            return CoTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+        FinalAwaiter final_suspend() noexcept {
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception() {
+            std::terminate();
+        }
+    };
+
+private:
+    std::coroutine_handle<promise_type> m_handle;
+
+    explicit CoTask(std::coroutine_handle<promise_type> handle)
+    : m_handle(handle) {}
+
+    friend class CoroutineExecutor;
+
+public:
+    CoTask(CoTask&& other) noexcept
+    : m_handle(std::exchange(other.m_handle, nullptr)) {}
+
+    CoTask& operator=(CoTask&& other) noexcept {
+        if (this != &other) {
+            if (m_handle) {
+                m_handle.destroy();
+            }
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+
+    CoTask(const CoTask&) = delete;
+    CoTask& operator=(const CoTask&) = delete;
+
+    // A task that was never spawned never ran, it's just thrown away.
+    ~CoTask() {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+};
+
+struct ExecutorStats {
+    uint64_t resumes = 0;           // times a coroutine was picked up by a thread
+    std::size_t tasks = 0;          // spawned and not done yet
+};
+
+// Runs coroutines on a small fixed set of threads, so a pipeline stage costs a coroutine frame instead of a
+// thread and waiting on a queue or a timer is a suspension instead of a parked thread.
+// Coroutines that can run go in one FIFO shared by all threads, coroutines sleeping until a point in
+// time sit in a heap of timers that the threads move over to the FIFO once they're due.  A thread with
+// nothing to run waits on a condition variable until the next timer or until something is scheduled.
+// A coroutine may be resumed on a different thread each time, but never on two at once.
+class CoroutineExecutor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct SleepAwaitable {
+        CoroutineExecutor& executor;
+        Clock::time_point due;
+
+        bool await_ready() const {
+            return due <= Clock::now();
+        }
+        void await_suspend(std::coroutine_handle<> handle) {
+            executor.ScheduleAt(due, handle);
+        }
+        void await_resume() const {}
+    };
+
+    struct YieldAwaitable {
+        CoroutineExecutor& executor;
+
+        bool await_ready() const {
+            return false;
+        }
+        void await_suspend(std::coroutine_handle<> handle) {
+            executor.Schedule(handle);
+        }
+        void await_resume() const {}
+    };
+
+private:
+    struct Timer {
+        Clock::time_point due;
+        uint64_t order;
+        std::coroutine_handle<> handle;
+    };
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::condition_variable m_idleCv;
+    std::deque<std::coroutine_handle<>> m_ready;
+    // Heap, the earliest due on top and timers due at the same time in the order they were set.
+    std::vector<Timer> m_timers;
+    uint64_t m_nextTimerOrder = 0;
+    std::size_t m_numTasks = 0;
+    bool m_isRunning = true;
+    std::atomic<uint64_t> m_numResumes{0};
+
+    static bool DueLater(const Timer& a, const Timer& b) {
+        if (a.due != b.due) {
+            return a.due > b.due;
+        }
+        return a.order > b.order;
+    }
+
+    void WorkerLoop();
+    void TaskDone();
+
+    friend class CoTask;
+
+public:
+    explicit CoroutineExecutor(std::size_t numThreads = DEFAULT_NUM_EXECUTOR_THREADS);
+    ~CoroutineExecutor();
+
+    CoroutineExecutor(const CoroutineExecutor&) = delete;
+    CoroutineExecutor& operator=(const CoroutineExecutor&) = delete;
+
+    // Threads are started in the constructor, this gets at them afterwards to place them on CPUs.
+    template <typename Visitor>
+    void ForEachWorker(Visitor visitor) {
+        std::for_each(m_threads.begin(), m_threads.end(), visitor);
+    }
+
+    std::size_t NumThreads() const {
+        return m_threads.size();
+    }
+
+    // Starts running the task.  False once the executor is stopped, the task is thrown away then.
+    bool Spawn(CoTask task);
+
+    // Resumes the coroutine on one of the threads, right away or once due has passed.
+    void Schedule(std::coroutine_handle<> handle);
+    void ScheduleAt(Clock::time_point due, std::coroutine_handle<> handle);
+
+    // co_await executor.SleepUntil(due) suspends instead of blocking the thread.
+    SleepAwaitable SleepUntil(Clock::time_point due) {
+        return SleepAwaitable{*this, due};
+    }
+
+    // Lets the other coroutines waiting to run go first.
+    YieldAwaitable Yield() {
+        return YieldAwaitable{*this};
+    }
+
+    // Waits until every spawned task is done.
+    void Join();
+
+    // Lets the threads finish what can run right now and stops them.  Coroutines still sleeping are
+    // destroyed without running again, so Join first for everything to finish.
+    void Stop();
+
+    ExecutorStats GetStats();
+};
+
+inline void CoTask::promise_type::FinalAwaiter::await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+    CoroutineExecutor* executor = handle.promise().executor;
+    handle.destroy();
+    if (executor != nullptr) {
+        executor->TaskDone();
+    }
+}
+
+}
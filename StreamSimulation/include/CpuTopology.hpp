@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace StreamSim::Core {
+
+constexpr const char* DEFAULT_SYSFS_SYSTEM_DIR = "/sys/devices/system";
+
+// CPUs the threads of a stage may run on.  Empty leaves placement to the OS.
+using CpuSet = std::vector<uint32_t>;
+
+// One logical CPU (hardware thread) of the host.
+struct CpuInfo {
+    uint32_t id = 0;
+    uint32_t core = 0;        // physical core, numbered over the whole host so cores of different sockets differ
+    uint32_t package = 0;     // socket
+    uint32_t node = 0;        // NUMA node
+    uint32_t smtIndex = 0;    // 0 for the first hardware thread of its core, 1 for its SMT sibling and so on
+};
+
+// Which CPUs the host has, which of them share a core and which NUMA node each one is on, read from sysfs
+// (cpu/online, cpu/cpuN/topology and node/nodeN/cpulist).  Where sysfs doesn't tell, every CPU is its own
+// core on node 0, so a host without NUMA support looks like a single socket.
+class CpuTopology {
+private:
+    std::vector<CpuInfo> m_cpus;
+    // Indexed by CPU id, -1 for ids that aren't online.
+    std::vector<int32_t> m_cpuIndex;
+    // Node ids in ascending order and the CPUs of each.
+    std::vector<uint32_t> m_nodes;
+    std::vector<CpuSet> m_nodeCpus;
+    std::size_t m_numCores = 0;
+
+public:
+    // Reads the topology under systemDir, a directory laid out like /sys/devices/system.
+    static CpuTopology Discover(const std::string& systemDir = DEFAULT_SYSFS_SYSTEM_DIR);
+
+    // This host, discovered on first use.
+    static const CpuTopology& Host();
+
+    // Online CPUs in ascending id order.
+    const std::vector<CpuInfo>& Cpus() const {
+        return m_cpus;
+    }
+
+    const std::vector<uint32_t>& Nodes() const {
+        return m_nodes;
+    }
+
+    std::size_t NumNodes() const {
+        return m_nodes.size();
+    }
+
+    std::size_t NumCores() const {
+        return m_numCores;
+    }
+
+    // Null for a CPU that isn't online.
+    const CpuInfo* FindCpu(uint32_t cpu) const;
+
+    // Empty for a node that doesn't exist.
+    CpuSet CpusOfNode(uint32_t node) const;
+
+    // Node all of cpus are on, nothing if they are spread over several nodes or cpus is empty.
+    std::optional<uint32_t> NodeOf(const CpuSet& cpus) const;
+};
+
+// Like "8 CPUs, 4 cores, 2 NUMA nodes (node 0: 0-3, node 1: 4-7)", for logging what a run was placed on.
+std::string FormatCpuTopology(const CpuTopology& topology);
+
+// How the threads of one stage are placed on the CPUs the stage is allowed to use.
+enum class PinningPolicy {
+    Shared,     // every thread may run on any of them, the OS moves them around inside that set
+    Compact,    // a CPU per thread, physical cores of the first node, then their SMT siblings, then the next node
+    Spread      // a CPU per thread, taking turns between the nodes, SMT siblings only once every core has a thread
+};
+
+// Where the threads of one stage run.  cpus and node both narrow the CPUs the stage may use,
+// nothing set means every online CPU.
+struct StagePlacement {
+    PinningPolicy policy = PinningPolicy::Shared;
+    CpuSet cpus;
+    std::optional<uint32_t> node;
+};
+
+// CPUs the thread with that index in the stage goes on.  Empty when it shouldn't be pinned at all, which is
+// a Shared stage that isn't narrowed down, or a stage whose cpus and node have no CPU in common.
+// With more threads than CPUs the per-thread policies wrap around.
+CpuSet PlaceStageThread(const CpuTopology& topology, const StagePlacement& placement, std::size_t index);
+
+// Node the threads of the stage all run on, if they do.  That's where the stage's queues go.
+std::optional<uint32_t> StageNode(const CpuTopology& topology, const StagePlacement& placement);
+
+// A list of CPUs and ranges, like "0-3,8".  The empty string is the empty set.
+bool ParseCpuSet(const std::string& text, CpuSet& cpus);
+std::string FormatCpuSet(const CpuSet& cpus);
+
+// Restricts an already running thread to the CPUs.  Nothing to do for an empty set, otherwise false
+// if a CPU doesn't exist or threads can't be pinned on this platform (only Linux is supported).
+bool SetThreadAffinity(std::thread& thread, const CpuSet& cpus);
+bool SetCurrentThreadAffinity(const CpuSet& cpus);
+
+// CPU the calling thread is running on right now, 0 where that can't be asked.
+uint32_t CurrentCpu();
+
+// Asks the kernel to keep the pages of data on the node, moving the ones already touched.  The range is
+// widened to whole pages.  False where that isn't supported, the memory is still usable then.
+bool BindMemoryToNode(void* data, std::size_t bytes, uint32_t node);
+
+// Runs make on a thread pinned to the node and returns what it made.  Linux puts a page on the node of
+// the thread that touches it first, so what make allocates and initializes ends up on that node, which is
+// how a stage's queues are put next to its threads.  Without a node, or on a host with a single node, make
+// just runs on the calling thread.
+template <typename Make>
+auto ConstructOnNode(const CpuTopology& topology, std::optional<uint32_t> node, Make make) -> decltype(make()) {
+    if (!node.has_value() || topology.NumNodes() < 2) {
+        return make();
+    }
+
+    decltype(make()) result;
+    std::thread thread([&] {
+        SetCurrentThreadAffinity(topology.CpusOfNode(*node));
+        result = make();
+    });
+    thread.join();
+    return result;
+}
+
+}
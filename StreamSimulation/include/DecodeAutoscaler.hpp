@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace StreamSim::Core {
+
+constexpr uint32_t DEFAULT_SCALE_INTERVAL_IN_MILISEC = 100;
+constexpr std::size_t DEFAULT_SCALE_UP_DEPTH = 8;
+// Above the most a jitter buffer holds a frame back (MAX_JITTER_DELAY_IN_MILISEC), so frames that are only
+// waiting for their playout time never look like the decoders falling behind.
+constexpr uint32_t DEFAULT_SCALE_UP_WAIT_IN_MILISEC = 250;
+
+// When a decode stage runs more or fewer of its workers.  The stage always has its full thread count,
+// the workers that aren't needed are parked.
+struct AutoscaleConfig {
+    bool enabled = false;
+    // The most is the stage's thread count.
+    std::size_t minWorkers = 1;
+    std::chrono::milliseconds interval{DEFAULT_SCALE_INTERVAL_IN_MILISEC};
+    // Frames ready to decode per active worker that count as falling behind.
+    std::size_t scaleUpDepth = DEFAULT_SCALE_UP_DEPTH;
+    // p99 wait since ingest, over the frames decoded since the last sample, that counts as falling behind.
+    // Zero leaves latency out of it.
+    std::chrono::milliseconds scaleUpWait{DEFAULT_SCALE_UP_WAIT_IN_MILISEC};
+    // Samples in a row it takes to scale.  Up is quick so a burst doesn't pile up, down is slow so a
+    // short lull doesn't give away workers that are needed again right after.
+    uint32_t scaleUpSamples = 2;
+    uint32_t scaleDownSamples = 10;
+};
+
+// What the decode stage looked like at one sample.
+struct AutoscaleSample {
+    std::size_t queueDepth = 0;       // frames ready to be decoded
+    bool isQueueFull = false;         // frames are being dropped or ingest is blocked
+    uint64_t queueWaitP99Ns = 0;      // since the previous sample
+};
+
+struct AutoscaleStats {
+    std::size_t activeWorkers = 0;
+    std::size_t maxWorkers = 0;
+    uint64_t scaleUps = 0;
+    uint64_t scaleDowns = 0;
+};
+
+// Picks how many decode workers should be active from samples of the decode queue.
+// Falling behind (queue full, deeper than scaleUpDepth per worker, or waits past scaleUpWait) for
+// scaleUpSamples samples in a row adds half again as many workers.  Being idle (fewer frames queued than
+// workers and waits under half of scaleUpWait) for scaleDownSamples in a row takes one away.  Load
+// between the two changes nothing, and both counts start over after every change, which is what keeps
+// it from flapping around the threshold.
+class DecodeAutoscaler {
+private:
+    const AutoscaleConfig m_config;
+    const std::size_t m_maxWorkers;
+    std::atomic<std::size_t> m_activeWorkers;
+    uint32_t m_numBehind = 0;
+    uint32_t m_numIdle = 0;
+    std::atomic<uint64_t> m_scaleUps{0};
+    std::atomic<uint64_t> m_scaleDowns{0};
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_isRunning = false;
+
+public:
+    // Starts out with minWorkers active.
+    DecodeAutoscaler(const AutoscaleConfig& config, std::size_t maxWorkers);
+    ~DecodeAutoscaler();
+
+    DecodeAutoscaler(const DecodeAutoscaler&) = delete;
+    DecodeAutoscaler& operator=(const DecodeAutoscaler&) = delete;
+
+    // Takes one sample and returns how many workers should be active now.
+    std::size_t Update(const AutoscaleSample& sample);
+
+    std::size_t ActiveWorkers() const {
+        return m_activeWorkers.load(std::memory_order_acquire);
+    }
+
+    AutoscaleStats GetStats() const;
+
+    // Calls sample every interval on a thread of its own, and apply with the new worker count whenever it changes.
+    void Start(std::function<AutoscaleSample()> sample, std::function<void(std::size_t)> apply);
+    void Stop();
+};
+
+}
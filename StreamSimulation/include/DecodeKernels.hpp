@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace StreamSim::Core {
+
+// The pixel work DemoDecoder does on a payload, standing in for a real video decoder.
+// A payload is read as a row of 8x8 pixel tiles in 4:4:4, each tile 3 blocks (Y, U, V) of 64 signed
+// 8-bit quantized coefficients.  Every block is dequantized, put through the H.264 8x8 integer
+// inverse transform (columns, then rows) and offset to 8-bit samples, then the tile is converted
+// from BT.601 YUV to planar RGB (64 bytes R, 64 G, 64 B).  A tile decodes into exactly as many bytes
+// as it came in, and bytes past the last whole tile are copied over as they are.
+// Everything is 32-bit integer math with the same rounding in every implementation, so the SIMD
+// kernels produce the exact same bytes as the scalar one.
+constexpr std::size_t DECODE_BLOCK_SIZE = 64;
+constexpr std::size_t DECODE_TILE_SIZE = 3 * DECODE_BLOCK_SIZE;
+
+enum class DecodeKernelType {
+    Scalar,
+    Sse42,
+    Avx2
+};
+
+const char* DecodeKernelName(DecodeKernelType type);
+
+// Whether this build and this CPU can run the kernel.  The SIMD kernels are only built for x86 with
+// GCC or Clang, where they are compiled with target attributes and checked with CPUID at runtime.
+bool IsDecodeKernelSupported(DecodeKernelType type);
+
+// Fastest supported kernel, worked out once.
+DecodeKernelType GetBestDecodeKernel();
+
+// input and output are size bytes and must not overlap.  An unsupported type falls back to Scalar.
+void DecodePayload(DecodeKernelType type, const uint8_t* input, uint8_t* output, std::size_t size);
+
+inline void DecodePayload(const uint8_t* input, uint8_t* output, std::size_t size) {
+    DecodePayload(GetBestDecodeKernel(), input, output, size);
+}
+
+}
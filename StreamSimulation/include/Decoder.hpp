@@ -2,15 +2,21 @@
 
 #include <thread>
 #include <atomic>
+#include <vector>
 #include "ConcurrentData.hpp"
+#include "DecodeAutoscaler.hpp"
+#include "DecodeKernels.hpp"
+#include "EventCount.hpp"
 #include "FrameData.hpp"
+#include "GopScheduler.hpp"
+#include "InplaceTask.hpp"
 #include "ThreadPool.hpp"
+#include "WorkStealingThreadPool.hpp"
 #include "NetInputStream.hpp"
+#include "PipelineConfig.hpp"
 
 namespace StreamSim::Core {
 
-constexpr size_t MAX_NUM_DECODER_THREADS = 4;
-
 class Decoder {
 public:
     Decoder() = default;
@@ -19,69 +25,249 @@ public:
     virtual void DecodeFrameData(const Core::ByteUndecodedFrame& frame, Core::ByteFrameElement& decoded) = 0;
 };
 
+// Move-only so the decode pool can never fall back to copying a task on its way to a worker.
+// Stamps the frame's decode start and end, and records them into latency when given (non-owning).
+// A B-frame that is past its deadline by the time a worker gets to it isn't decoded, it's passed on marked
+// as expired and counted in numExpired when given (non-owning).
 class DecoderTask {
 private:
     Core::ByteUndecodedFrame m_frame;
     Decoder* m_decoder;
-    Core::AsyncByteFrameQueue* m_renderBufferQueue;
+    Core::ByteFrameQueue* m_renderBufferQueue;
+    DecodeLatencyHistograms* m_latency;
+    std::atomic<uint64_t>* m_numExpired;
 
 public:
-    DecoderTask(const Core::ByteUndecodedFrame& frame,
+    DecoderTask(Core::ByteUndecodedFrame frame,
                 Decoder* decoder,
-                Core::AsyncByteFrameQueue* renderBufferQueue);
+                Core::ByteFrameQueue* renderBufferQueue,
+                DecodeLatencyHistograms* latency = nullptr,
+                std::atomic<uint64_t>* numExpired = nullptr);
     ~DecoderTask();
 
+    DecoderTask(DecoderTask&&) noexcept = default;
+    DecoderTask& operator=(DecoderTask&&) noexcept = default;
+    DecoderTask(const DecoderTask&) = delete;
+    DecoderTask& operator=(const DecoderTask&) = delete;
+
     void operator()();
+
+    // The pool threw the task away.  The frame still goes on, without its picture and marked expired,
+    // so the stages after decode don't wait for it.
+    void Discard();
+
+    // The pool runs the task with the earliest deadline first.
+    uint64_t DeadlineNs() const {
+        return m_frame.meta.deadlineNs;
+    }
 };
 
 // Upon doing some research, when it comes to decoding streaming video, there is an I, P, and B frame types
-// And you need to use these frame types to decode most recent frame.  (Although B frame requires future frame
-// according to my research?)  
-// Well... This demo decoder doesn't know that there is such frame types exists and doesn't really do any decoding
+// And you need to use these frame types to decode most recent frame.  (B frame also needs the anchor frame that
+// is displayed after it, which is why it is sent after that anchor.)
+// This demo decoder doesn't parse a real bitstream, but it does the pixel work of one on the payload (see
+// DecodeKernels.hpp) with the kernel picked at construction, the fastest one this CPU runs by default.  Making sure
+// a frame's references are decoded before it is the job of GopScheduler, see FrameElementQueueDecodeService.
 // Again, this code is just to demonstrate how I would go about setting up the architecture and how efficently use
 // the thread to ensure fastest decoding and fastest rendering of decoded data.
 class DemoDecoder : public Decoder {
+private:
+    DecodeKernelType m_kernel;
+
 public:
-    DemoDecoder();
+    explicit DemoDecoder(DecodeKernelType kernel = GetBestDecodeKernel());
     ~DemoDecoder() override;
 
     void DecodeFrameData(const Core::ByteUndecodedFrame& frame, Core::ByteFrameElement& decoded) override;
 };
 
+// Snapshot of what the decode workers have been doing, summed over all workers.
+// blockingReads are the times a worker's spin came up empty and it went into the queue's blocking read,
+// where it sleeps unless frames showed up in the meantime.  readTimeouts are the blocking reads that came
+// back without a frame because the queue's wait timed out (every 2 s by default).  On an idle stream both
+// go up by one per worker per timeout at most, instead of with every spin like the old polling loop did.
+// parks are the times the autoscaler put a worker to sleep.
+// framesExpired are B-frames that were past their deadline and passed on without being decoded.
+struct DecodeWorkerStats {
+    uint64_t framesDecoded = 0;
+    uint64_t framesExpired = 0;
+    uint64_t spinHits = 0;
+    uint64_t blockingReads = 0;
+    uint64_t readTimeouts = 0;
+    uint64_t parks = 0;
+};
+
 // All decoding tasks will be handled by this service class.
 // There will be multiple threads that are available and performs the task
 // In a real world scenario, there should be a thread pool that can be used for
 // decoding task, but for this task, multiple thread that are already created will be used.
+// Workers spin on the queue for a short, adaptive number of polls and otherwise park inside
+// ReadBatch, so an idle stream costs no CPU.  Frames are taken in batches so a burst pays for one queue
+// synchronization instead of one per frame, and each is handed on as soon as it's decoded.  The decode queue isn't the service's to close: its owner
+// closes it, which wakes every parked worker immediately, and they drain the remaining frames and exit.  Shutdown
+// without that lets the workers go once the queue comes up empty, which takes up to the queue's read timeout.
+// Frames go through a GopScheduler between the queue and the decoder: a worker submits what it read, then
+// decodes whatever is ready, including P/B-frames released by the anchors it just finished.  So independent
+// GOPs decode in parallel while frames of one GOP never decode before their references.
+// A B-frame already past its deadline when it's ready is skipped: nothing references it, so the decode time
+// is better spent on frames that can still make it.  I and P-frames are always decoded, later frames need them.
+// How many workers there are and where they run comes from the PipelineConfig (decode.threads and the decode placement).
+// With decode.autoscale on, a DecodeAutoscaler watches the frames ready in the decode queue and the wait before decoding,
+// and only the first ActiveWorkers threads read the queue.  The others are parked on an EventCount, so a quiet stream
+// keeps a single thread busy instead of all of them.
 class FrameElementQueueDecodeService {
 private:
-    std::array<std::thread, MAX_NUM_DECODER_THREADS> m_decodeThreads;
+    static constexpr uint32_t MIN_SPIN_POLLS = 16;
+    static constexpr uint32_t MAX_SPIN_POLLS = 1024;
+    static constexpr std::size_t DECODE_BATCH_SIZE = 8;
+
+    // Each worker only ever writes its own counters and histograms, GetLatencySnapshot merges them.
+    struct alignas(CACHE_LINE_SIZE) WorkerCounters {
+        std::atomic<uint64_t> framesDecoded{0};
+        std::atomic<uint64_t> framesExpired{0};
+        std::atomic<uint64_t> spinHits{0};
+        std::atomic<uint64_t> blockingReads{0};
+        std::atomic<uint64_t> readTimeouts{0};
+        std::atomic<uint64_t> parks{0};
+        DecodeLatencyHistograms latency;
+    };
+
+    const std::size_t m_numThreads;
+    const StagePlacement m_placement;
+    std::vector<std::thread> m_decodeThreads;
+    std::unique_ptr<WorkerCounters[]> m_workerCounters;
 
     // This is non-owning raw pointer.
-    Core::AsyncByteFrameQueue* m_decodeBufferQueue;
-    Core::AsyncByteFrameQueue* m_renderBufferQueue;
+    Core::ByteFrameQueue* m_decodeBufferQueue;
+    Core::ByteFrameQueue* m_renderBufferQueue;
+    // Non-owning as well.  When set, decoded frames go to the queue of their stream instead.
+    std::vector<Core::ByteFrameQueue*> m_streamRenderQueues;
     std::atomic_bool m_isRunning;
 
+    // Workers with an index below this read the queue, the rest wait on m_workerWake.
+    std::atomic<std::size_t> m_numActiveWorkers;
+    EventCount m_workerWake;
+    // Null unless decode.autoscale is on.  m_lastQueueWait is only used by its thread.
+    std::unique_ptr<DecodeAutoscaler> m_autoscaler;
+    HistogramSnapshot m_lastQueueWait;
+
     DemoDecoder m_mainDecoder;
+    GopScheduler m_scheduler;
+
+    void DecodeWorker(std::size_t index);
+    AutoscaleSample SampleLoad();
+    void SetActiveWorkers(std::size_t numActive);
+    Core::ByteFrameQueue* RenderQueueFor(uint32_t streamId) const;
+    void WriteDecoded(const Core::ByteFrameElement& frame);
+    // The queue got closed or Shutdown was called, parked workers come back either way.
+    bool IsStopping() const {
+        return !m_isRunning.load(std::memory_order_acquire) || m_decodeBufferQueue->IsClosed();
+    }
 
 public:
-    FrameElementQueueDecodeService(Core::AsyncByteFrameQueue* decodeQueue, Core::AsyncByteFrameQueue* renderQueue);
+    FrameElementQueueDecodeService(Core::ByteFrameQueue* decodeQueue, Core::ByteFrameQueue* renderQueue,
+                                   const PipelineConfig& config = PipelineConfig());
+
+    // One shared set of workers for many streams, streamRenderQueues[streamId] receives that stream's frames.
+    FrameElementQueueDecodeService(Core::ByteFrameQueue* decodeQueue, std::vector<Core::ByteFrameQueue*> streamRenderQueues,
+                                   const PipelineConfig& config = PipelineConfig());
     ~FrameElementQueueDecodeService();
 
     void Run();
     void Shutdown();
+
+    std::size_t NumThreads() const {
+        return m_numThreads;
+    }
+
+    // Workers reading the queue right now, all of them unless autoscaling.
+    std::size_t NumActiveWorkers() const {
+        return m_numActiveWorkers.load(std::memory_order_acquire);
+    }
+
+    DecodeWorkerStats GetWorkerStats() const;
+
+    // Time from ingest to decode start and decode time of every frame so far, over all workers.
+    DecodeLatencySnapshot GetLatencySnapshot() const;
+
+    // All zero unless autoscaling.
+    AutoscaleStats GetAutoscaleStats() const;
+
+    GopSchedulerStats GetSchedulerStats() {
+        return m_scheduler.GetStats();
+    }
+};
+
+// Which thread pool FrameElementPoolDecoder hands its decode tasks to.
+enum class DecodePoolType {
+    Simple,
+    WorkStealing
+};
+
+// What FrameElementPoolDecoder needs from the pool it hands decode tasks to, whichever DecodePoolType it is.
+// Both pools hold their tasks as an InplaceTask sized for a DecoderTask, so queueing one never allocates.
+class DecodePool {
+public:
+    virtual ~DecodePool() = default;
+
+    virtual void Enqueue(DecoderTask task) = 0;
+    // Finishes every queued task and stops the workers.
+    virtual void Stop() = 0;
+
+    virtual std::size_t NumThreads() const = 0;
+    // Pools that can't park workers ignore this.
+    virtual void SetNumActiveThreads(std::size_t numActive) = 0;
+    // Empty for pools without an admission policy.
+    virtual Core::AdmissionStats GetAdmissionStats() const = 0;
+    // Tasks that can wait before the admission policy kicks in, 0 when there is no limit.
+    virtual std::size_t Capacity() const = 0;
 };
 
 class FrameElementPoolDecoder : public Net::NetInputStreamHandler {
 private:
-    Core::SimpleThreadPool<DecoderTask, MAX_NUM_DECODER_THREADS> m_decodePool;
-    Core::AsyncByteFrameQueue* m_renderBufferQueue;
+    Core::ByteFrameQueue* m_renderBufferQueue;
     DemoDecoder m_mainDecoder;
+    const std::chrono::milliseconds m_frameDeadline;
+    // Shared by the pool workers, which the pool doesn't tell apart.
+    DecodeLatencyHistograms m_latency;
+    std::atomic<uint64_t> m_framesExpired{0};
+
+    // Declared after the decoder so the workers are stopped before the decoder they call into is destroyed.
+    // What the simple pool does once it falls behind is decode.pool_policy.  Block by default, so a burst holds
+    // up ingest instead of losing frames.
+    std::unique_ptr<DecodePool> m_decodePool;
+
+    // Only for the simple pool with decode.autoscale on, it sizes the pool with SetNumActiveThreads.  After the
+    // pool so it's stopped before it.  m_lastQueueWait is only used by its thread.
+    std::unique_ptr<DecodeAutoscaler> m_autoscaler;
+    HistogramSnapshot m_lastQueueWait;
 
 public:
-    FrameElementPoolDecoder(Core::AsyncByteFrameQueue* renderQueue);
+    // The pool gets decode.threads workers placed like the decode stage says, the simple pool holds decode.pool_capacity waiting tasks.
+    // Frames get a deadline of frame_deadline_ms from when they come in, the simple pool decodes the earliest deadline first.
+    FrameElementPoolDecoder(Core::ByteFrameQueue* renderQueue, DecodePoolType poolType = DecodePoolType::Simple,
+                            const PipelineConfig& config = PipelineConfig());
     ~FrameElementPoolDecoder();
 
+    using Net::NetInputStreamHandler::OnInputStreamData;
+
     void OnInputStreamData(const Core::ByteUndecodedFrame& data) override;
+
+    // Finishes every queued decode task and stops the pool.
+    void Shutdown();
+
+    // Frames shed by the simple pool's admission policy.  Always empty for the work-stealing pool.
+    Core::AdmissionStats GetAdmissionStats() const;
+
+    DecodeLatencySnapshot GetLatencySnapshot() const;
+
+    // B-frames passed on without decoding because they were past their deadline.
+    uint64_t GetExpiredFrames() const {
+        return m_framesExpired.load(std::memory_order_relaxed);
+    }
+
+    // All zero unless autoscaling.  The work-stealing pool is never scaled.
+    AutoscaleStats GetAutoscaleStats() const;
 };
 
 }
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#endif
+
+namespace StreamSim::Core {
+
+// Size used to pad atomics that are written by different threads so they don't share a cache line.
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+// Spin hint used while busy waiting for a short time before parking.
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// Lets lock-free data structures park threads without a mutex/condition variable pair.
+// Waiter:   auto key = ev.PrepareWait(); if (condition) { ev.CancelWait(); } else { ev.Wait(key, deadline); }
+// Notifier: make condition true, then ev.NotifyOne() / ev.NotifyAll().
+// Notify is only a fence and a load when nobody is parked, so the fast path never makes a syscall.
+class EventCount {
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    std::atomic<uint32_t> m_epoch{0};
+    std::atomic<uint32_t> m_waiters{0};
+
+    void Wake(int count) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_waiters.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+        m_epoch.fetch_add(1, std::memory_order_release);
+#if defined(__linux__)
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_epoch), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+#else
+        (void)count;
+        m_epoch.notify_all();
+#endif
+    }
+
+public:
+    EventCount() = default;
+    EventCount(const EventCount&) = delete;
+    EventCount& operator=(const EventCount&) = delete;
+
+    uint32_t PrepareWait() {
+        m_waiters.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return m_epoch.load(std::memory_order_acquire);
+    }
+
+    void CancelWait() {
+        m_waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Parks until notified or until the deadline has passed.  Returns false on timeout.
+    // Spurious wakeups are possible, so callers always re-check their condition.
+    bool Wait(uint32_t key, Clock::time_point deadline) {
+        bool notified = true;
+        while (m_epoch.load(std::memory_order_acquire) == key) {
+            auto now = Clock::now();
+            if (now >= deadline) {
+                notified = false;
+                break;
+            }
+#if defined(__linux__)
+            auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now);
+            timespec ts;
+            ts.tv_sec = static_cast<time_t>(remaining.count() / 1000000000);
+            ts.tv_nsec = static_cast<long>(remaining.count() % 1000000000);
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_epoch), FUTEX_WAIT_PRIVATE, key, &ts, nullptr, 0);
+#else
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+#endif
+        }
+        m_waiters.fetch_sub(1, std::memory_order_relaxed);
+        return notified;
+    }
+
+    // Parks until notified.
+    void Wait(uint32_t key) {
+        while (m_epoch.load(std::memory_order_acquire) == key) {
+#if defined(__linux__)
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_epoch), FUTEX_WAIT_PRIVATE, key, nullptr, nullptr, 0);
+#else
+            m_epoch.wait(key, std::memory_order_acquire);
+#endif
+        }
+        m_waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void NotifyOne() {
+        Wake(1);
+    }
+
+    void NotifyAll() {
+        Wake(INT_MAX);
+    }
+};
+
+}
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "ConcurrentData.hpp"
+
+namespace StreamSim::Core {
+
+// One queue in front of a shared set of decode workers, holding frames of many streams (meta.streamId).
+// Every stream gets its own ring of up to N frames, so a stream that sends more than it can get decoded only
+// fills and blocks its own ring.  Readers take frames with deficit round robin: each stream with queued
+// frames gets a turn in order, and a turn is worth `weight` frames, so under load every stream gets
+// decode slots in proportion to its weight no matter how much it sends.  Decoding costs about the
+// same per frame here, so the cost of a frame is simply 1.
+// Streams show up on their first write with weight 1, SetStreamWeight changes that.
+// The ring size defaults to N and is set per queue at construction.  A ring starts out small and doubles when
+// it runs out of room, so a stream only pays for the frames it actually has queued at its busiest.
+template <typename T, std::size_t N, uint32_t DefaultWaitSec = 2>
+class FairShareQueue : public BufferQueue<T> {
+private:
+    static constexpr std::size_t MIN_RING_SIZE = 16;
+
+    struct Stream {
+        std::vector<T> ring;
+        std::size_t head = 0;
+        std::size_t count = 0;
+        uint32_t weight = 1;
+        uint32_t deficit = 0;
+        bool inTurn = false;
+        bool isActive = false;
+    };
+
+    const std::size_t m_capacity;
+    const QueueWaitPolicy m_wait;
+
+    std::mutex m_mutex;
+    std::condition_variable m_notFull;
+    std::condition_variable m_notEmpty;
+
+    std::unordered_map<uint32_t, std::unique_ptr<Stream>> m_streams;
+    // Streams that have frames queued, in the order they get their turn.
+    std::deque<Stream*> m_active;
+    std::size_t m_count = 0;
+    bool m_closed = false;
+
+    // Caller must hold m_mutex.
+    Stream& GetStream(uint32_t streamId) {
+        auto& stream = m_streams[streamId];
+        if (!stream) {
+            stream = std::make_unique<Stream>();
+        }
+        return *stream;
+    }
+
+    // Caller must hold m_mutex.  Moves the queued frames, oldest first, into a ring twice the size.
+    void Grow(Stream& stream) {
+        std::vector<T> ring(std::min(std::max(stream.ring.size() * 2, MIN_RING_SIZE), m_capacity));
+        for (std::size_t i = 0; i < stream.count; ++i) {
+            ring[i] = std::move(stream.ring[(stream.head + i) % stream.ring.size()]);
+        }
+        stream.ring = std::move(ring);
+        stream.head = 0;
+    }
+
+    // Caller must hold m_mutex.
+    bool TryPush(const T& data) {
+        Stream& stream = GetStream(data.meta.streamId);
+        if (stream.count >= m_capacity) {
+            return false;
+        }
+
+        if (stream.count == stream.ring.size()) {
+            Grow(stream);
+        }
+        stream.ring[(stream.head + stream.count) % stream.ring.size()] = data;
+        ++stream.count;
+        ++m_count;
+        if (!stream.isActive) {
+            stream.isActive = true;
+            m_active.push_back(&stream);
+        }
+        return true;
+    }
+
+    // Caller must hold m_mutex.
+    bool TryPop(T& data) {
+        while (!m_active.empty()) {
+            Stream* stream = m_active.front();
+            if (!stream->inTurn) {
+                stream->inTurn = true;
+                stream->deficit += stream->weight;
+            }
+
+            if (stream->deficit > 0) {
+                data = std::move(stream->ring[stream->head]);
+                stream->head = (stream->head + 1) % stream->ring.size();
+                --stream->count;
+                --stream->deficit;
+                --m_count;
+
+                // A stream that runs dry leaves the rotation and doesn't keep its unused credit.
+                if (stream->count == 0) {
+                    stream->deficit = 0;
+                    stream->inTurn = false;
+                    stream->isActive = false;
+                    m_active.pop_front();
+                }
+                return true;
+            }
+
+            // Turn used up, go to the back of the line.
+            stream->inTurn = false;
+            m_active.pop_front();
+            m_active.push_back(stream);
+        }
+        return false;
+    }
+
+    // Caller must hold m_mutex.
+    std::size_t PopBatch(std::span<T> data, std::size_t max) {
+        const std::size_t limit = std::min(max, data.size());
+        std::size_t numRead = 0;
+        while (numRead < limit && TryPop(data[numRead])) {
+            ++numRead;
+        }
+        if (numRead > 0) {
+            m_notFull.notify_all();
+        }
+        return numRead;
+    }
+
+    bool HasSpaceFor(const T& data) {
+        return GetStream(data.meta.streamId).count < m_capacity;
+    }
+
+public:
+    // capacity is the ring size of each stream.
+    explicit FairShareQueue(std::size_t capacity = N, QueueWaitPolicy wait = { std::chrono::seconds(DefaultWaitSec) })
+    : m_capacity(std::max<std::size_t>(capacity, 1))
+    , m_wait(wait) {}
+
+    // Share of decode slots a stream gets relative to the others, at least 1.
+    void SetStreamWeight(uint32_t streamId, uint32_t weight) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        GetStream(streamId).weight = std::max<uint32_t>(weight, 1);
+    }
+
+    std::size_t NumStreamElements(uint32_t streamId) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_streams.find(streamId);
+        return it != m_streams.end() ? it->second->count : 0;
+    }
+
+    // Waits only for room in the frame's own stream.
+    bool WriteSync(const T& data) override {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        WaitOnCondition(m_notFull, lock, m_wait, [&] {
+            return HasSpaceFor(data) || m_closed;
+        });
+
+        if (m_closed || !TryPush(data)) {
+            return false;
+        }
+
+        m_notEmpty.notify_all();
+        return true;
+    }
+
+    bool ReadAsync(T& data) override {
+        return ReadBatchAsync(std::span<T>(&data, 1), 1) == 1;
+    }
+
+    bool ReadSync(T& data) override {
+        return ReadBatch(std::span<T>(&data, 1), 1) == 1;
+    }
+
+    // Frames can belong to different streams, so the batch stops at the first frame whose stream is full.
+    std::size_t WriteBatch(std::span<const T> data) override {
+        if (data.empty()) {
+            return 0;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        WaitOnCondition(m_notFull, lock, m_wait, [&] {
+            return HasSpaceFor(data[0]) || m_closed;
+        });
+
+        if (m_closed) {
+            return 0;
+        }
+
+        std::size_t written = 0;
+        while (written < data.size() && TryPush(data[written])) {
+            ++written;
+        }
+        if (written > 0) {
+            m_notEmpty.notify_all();
+        }
+        return written;
+    }
+
+    std::size_t ReadBatchAsync(std::span<T> data, std::size_t max) override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return PopBatch(data, max);
+    }
+
+    std::size_t ReadBatch(std::span<T> data, std::size_t max) override {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        WaitOnCondition(m_notEmpty, lock, m_wait, [this] {
+            return m_count > 0 || m_closed;
+        });
+        return PopBatch(data, max);
+    }
+
+    std::size_t NumElements() override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_count;
+    }
+
+    // Per stream.
+    std::size_t Capacity() const override {
+        return m_capacity;
+    }
+
+    // Full when no stream that has been seen can take another frame.
+    bool IsFull() override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return !m_streams.empty() && m_count >= m_capacity * m_streams.size();
+    }
+
+    bool IsEmpty() override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_count == 0;
+    }
+
+    void Close() override {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_notFull.notify_all();
+        m_notEmpty.notify_all();
+    }
+
+    bool IsClosed() override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_closed;
+    }
+};
+
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace StreamSim::Core {
+
+class FrameBufferPool;
+
+// Header of one pooled payload buffer.  The bytes live in a slab owned by the pool and the
+// header is shared by every FrameBufferRef that points at it (intrusive reference count).
+// Every header comes from a pool and goes back to it.  FrameBufferPool::Wrap makes headers for bytes
+// some other owner keeps alive, like a mapped capture file; those are flagged isWrapped and only the
+// header is reused, never the bytes.
+struct FrameBuffer {
+    std::atomic<uint32_t> refCount{0};
+    uint32_t sizeClass = 0;
+    std::size_t capacity = 0;
+    std::size_t size = 0;
+    uint8_t* bytes = nullptr;
+    FrameBufferPool* pool = nullptr;
+    FrameBuffer* nextFree = nullptr;
+    // Made by FrameBufferPool::Wrap, the bytes aren't the pool's.
+    bool isWrapped = false;
+};
+
+// Reference counted handle to a pooled buffer.  Copying a frame only bumps the count, and the
+// buffer goes back to its pool when the last reference is dropped, so a payload travels through
+// the pipeline without being copied or freed.
+class FrameBufferRef {
+private:
+    FrameBuffer* m_buffer = nullptr;
+
+    void Release();
+
+public:
+    FrameBufferRef() = default;
+
+    // Takes over a buffer whose count was already set by the pool.
+    explicit FrameBufferRef(FrameBuffer* buffer)
+    : m_buffer(buffer) {}
+
+    FrameBufferRef(const FrameBufferRef& other)
+    : m_buffer(other.m_buffer) {
+        if (m_buffer != nullptr) {
+            m_buffer->refCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    FrameBufferRef(FrameBufferRef&& other) noexcept
+    : m_buffer(std::exchange(other.m_buffer, nullptr)) {}
+
+    FrameBufferRef& operator=(const FrameBufferRef& other) {
+        if (m_buffer != other.m_buffer) {
+            FrameBufferRef copy(other);
+            std::swap(m_buffer, copy.m_buffer);
+        }
+        return *this;
+    }
+
+    FrameBufferRef& operator=(FrameBufferRef&& other) noexcept {
+        if (this != &other) {
+            Release();
+            m_buffer = std::exchange(other.m_buffer, nullptr);
+        }
+        return *this;
+    }
+
+    ~FrameBufferRef() {
+        Release();
+    }
+
+    explicit operator bool() const {
+        return m_buffer != nullptr;
+    }
+
+    uint8_t* Data() const {
+        return m_buffer != nullptr ? m_buffer->bytes : nullptr;
+    }
+
+    std::size_t Size() const {
+        return m_buffer != nullptr ? m_buffer->size : 0;
+    }
+
+    std::size_t Capacity() const {
+        return m_buffer != nullptr ? m_buffer->capacity : 0;
+    }
+
+    // Number of bytes in use, must not exceed Capacity().
+    void Resize(std::size_t size);
+
+    std::span<uint8_t> Bytes() const {
+        return { Data(), Size() };
+    }
+
+    // Memory the pool only wraps, see FrameBufferPool::Wrap.  Nothing else should be taken from its pool.
+    bool IsWrapped() const {
+        return m_buffer != nullptr && m_buffer->isWrapped;
+    }
+
+    uint32_t UseCount() const {
+        return m_buffer != nullptr ? m_buffer->refCount.load(std::memory_order_relaxed) : 0;
+    }
+
+    FrameBufferPool* Pool() const {
+        return m_buffer != nullptr ? m_buffer->pool : nullptr;
+    }
+};
+
+// Size-class slab allocator for frame payloads.
+// Each class (256 bytes, 1 KB, 4 KB, ... 4 MB) carves buffers out of large slabs and keeps
+// released buffers on a free list, so after warm-up acquiring a payload is a pop from a free list
+// under that class's own lock and never reaches malloc.  Slabs are only freed with the pool, so
+// the pool has to outlive every buffer it handed out.
+// A pool made for a NUMA node keeps its slabs on that node, see ForNode and Local.
+// Wrap hands out buffers over memory the pool doesn't own, only their headers are pooled.
+class FrameBufferPool {
+public:
+    static constexpr std::size_t NUM_SIZE_CLASSES = 8;
+    static constexpr std::size_t MIN_BUFFER_SIZE = 256;
+    static constexpr std::size_t MAX_BUFFER_SIZE = MIN_BUFFER_SIZE << (2 * (NUM_SIZE_CLASSES - 1));
+
+private:
+    static constexpr std::size_t SLAB_SIZE = 256 * 1024;
+    // Headers of wrapped buffers are made this many at a time.
+    static constexpr std::size_t WRAPPED_HEADERS_PER_GROW = 256;
+
+    // Slabs are page aligned so they can be bound to a node page by page.
+    struct SlabDeleter {
+        void operator()(uint8_t* slab) const;
+    };
+    using Slab = std::unique_ptr<uint8_t[], SlabDeleter>;
+
+    struct SizeClass {
+        std::mutex mutex;
+        FrameBuffer* freeList = nullptr;
+        std::vector<Slab> slabs;
+        std::vector<std::unique_ptr<FrameBuffer[]>> headers;
+        std::size_t numAllocated = 0;
+    };
+
+    std::array<SizeClass, NUM_SIZE_CLASSES> m_sizeClasses;
+    SizeClass m_wrapped;
+    std::atomic<std::size_t> m_numInUse{0};
+    const std::optional<uint32_t> m_node;
+
+    static std::size_t ClassBufferSize(std::size_t sizeClass) {
+        return MIN_BUFFER_SIZE << (2 * sizeClass);
+    }
+
+    void Grow(SizeClass& sizeClass, uint32_t index);
+    void GrowWrapped();
+
+public:
+    // Without a node the slabs go wherever the thread growing the pool touches them first.
+    explicit FrameBufferPool(std::optional<uint32_t> node = std::nullopt)
+    : m_node(node) {}
+    ~FrameBufferPool() = default;
+
+    FrameBufferPool(const FrameBufferPool&) = delete;
+    FrameBufferPool& operator=(const FrameBufferPool&) = delete;
+
+    // Shared pool used by the demo pipeline.
+    static FrameBufferPool& Default();
+
+    // Shared pool whose slabs are on that NUMA node.
+    static FrameBufferPool& ForNode(uint32_t node);
+
+    // Pool of the node the calling thread runs on right now, so a frame is written into memory of the socket
+    // producing it.  Default() on a host with a single node.
+    static FrameBufferPool& Local();
+
+    std::optional<uint32_t> Node() const {
+        return m_node;
+    }
+
+    // Returns a buffer with Size() == size, or an empty reference if size is above MAX_BUFFER_SIZE.
+    FrameBufferRef Acquire(std::size_t size);
+
+    // A buffer over size bytes at bytes, for payloads that already sit in memory of their own (a mapped capture).
+    // The memory has to outlive every reference, the header goes back to the pool with the last one.
+    FrameBufferRef Wrap(uint8_t* bytes, std::size_t size);
+
+    // Called by FrameBufferRef when the last reference goes away.
+    void Release(FrameBuffer* buffer);
+
+    std::size_t NumBuffersInUse() const {
+        return m_numInUse.load(std::memory_order_relaxed);
+    }
+
+    std::size_t NumBuffersAllocated();
+};
+
+inline void FrameBufferRef::Release() {
+    if (m_buffer != nullptr) {
+        if (m_buffer->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            m_buffer->pool->Release(m_buffer);
+        }
+        m_buffer = nullptr;
+    }
+}
+
+}
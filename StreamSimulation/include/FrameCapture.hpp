@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ConcurrentData.hpp"
+#include "FrameBufferPool.hpp"
+#include "FrameData.hpp"
+#include "NetInputStream.hpp"
+
+namespace StreamSim::Net {
+
+constexpr uint32_t FRAME_CAPTURE_MAGIC = 0x50414353;   // "SCAP"
+constexpr uint32_t FRAME_CAPTURE_VERSION = 2;
+
+// A capture file is a FrameCaptureFileHeader, the frame records in the order the frames arrived and
+// then the index, one FrameCaptureIndexEntry per frame.  A record is a FrameCaptureRecord followed by
+// payloadSize payload bytes padded to 8 bytes, so every record and payload is 8 byte aligned in the
+// file and can be used straight from a mapping of it.  The index goes last because it is only known
+// once recording stops; a file whose writer never closed has no index and reads as invalid.
+// Fields are written in host byte order, the magic tells a file from the wrong endianness.
+struct FrameCaptureFileHeader {
+    uint32_t magic = FRAME_CAPTURE_MAGIC;
+    uint32_t version = FRAME_CAPTURE_VERSION;
+    uint64_t numFrames = 0;
+    uint64_t indexOffset = 0;
+};
+
+struct FrameCaptureRecord {
+    uint64_t sequence = 0;
+    uint64_t displayOrder = 0;
+    uint64_t timestampUs = 0;
+    uint64_t references[Core::MAX_FRAME_REFERENCES] = {};
+    uint32_t streamId = 0;
+    uint32_t payloadSize = 0;
+    uint8_t type = 0;
+    uint8_t numReferences = 0;
+    uint8_t data = 0;
+    uint8_t reserved[5] = {};
+};
+
+// Where a record is and how big its payload is, so a reader can find any frame's payload without
+// touching the records around it.
+struct FrameCaptureIndexEntry {
+    uint64_t recordOffset = 0;
+    uint64_t payloadSize = 0;
+};
+
+static_assert(sizeof(FrameCaptureFileHeader) == 24);
+static_assert(sizeof(FrameCaptureRecord) == 56);
+static_assert(sizeof(FrameCaptureIndexEntry) == 16);
+
+constexpr std::size_t CapturePaddedSize(std::size_t size) {
+    return (size + 7) & ~std::size_t(7);
+}
+
+// Appends frames to a capture file, through a large stdio buffer.  Several threads can write.
+class FrameCaptureWriter {
+public:
+    static constexpr std::size_t FILE_BUFFER_SIZE = 1 << 20;
+
+private:
+    std::mutex m_mutex;
+    std::FILE* m_file = nullptr;
+    uint64_t m_offset = 0;
+    std::vector<FrameCaptureIndexEntry> m_index;
+
+public:
+    explicit FrameCaptureWriter(const std::string& path);
+    ~FrameCaptureWriter();
+
+    FrameCaptureWriter(const FrameCaptureWriter&) = delete;
+    FrameCaptureWriter& operator=(const FrameCaptureWriter&) = delete;
+
+    bool IsOpen() const {
+        return m_file != nullptr;
+    }
+
+    bool Write(const Core::ByteUndecodedFrame& frame);
+
+    // Writes the index, finishes the header and closes the file.
+    void Close();
+
+    uint64_t NumFrames() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_index.size();
+    }
+};
+
+// Maps a capture file and hands out its frames without copying: a frame's payload is a
+// FrameBufferRef pointing into the mapping, so replaying a capture costs page faults, not reads.
+// Opening only reads the header and the index.  The mapping is private and copy-on-write, so
+// nothing in the pipeline can change the file.
+// A frame's FrameBuffer header is taken from the reader's own pool when the frame is read and goes back
+// when the frame is gone, so memory follows the frames in flight rather than the length of the capture.
+// Index entries are checked as their frames are read, not up front.  Frames must be gone before the
+// reader is, since their payloads live in its mapping.
+class FrameCaptureReader {
+private:
+    uint8_t* m_data = nullptr;
+    std::size_t m_size = 0;
+#if defined(_WIN32)
+    // No mmap here, the file is read into memory instead.
+    std::unique_ptr<uint8_t[]> m_contents;
+#endif
+
+    std::size_t m_numFrames = 0;
+    uint64_t m_indexOffset = 0;
+    const FrameCaptureIndexEntry* m_index = nullptr;
+    // Only ever wraps the mapping, ReadFrame is const but takes headers from it.
+    mutable Core::FrameBufferPool m_headers;
+
+    bool MapFile(const std::string& path);
+    void UnmapFile();
+    bool ReadIndex();
+
+public:
+    explicit FrameCaptureReader(const std::string& path);
+    ~FrameCaptureReader();
+
+    FrameCaptureReader(const FrameCaptureReader&) = delete;
+    FrameCaptureReader& operator=(const FrameCaptureReader&) = delete;
+
+    bool IsOpen() const {
+        return m_index != nullptr;
+    }
+
+    std::size_t NumFrames() const {
+        return m_numFrames;
+    }
+
+    // Fills in frame number index, false if its record is damaged.  Safe to call from several threads.
+    bool ReadFrame(std::size_t index, Core::ByteUndecodedFrame& frame) const;
+
+    // Frames read that still hold their payload.
+    std::size_t NumFramesInUse() const {
+        return m_headers.NumBuffersInUse();
+    }
+};
+
+// Records what an ingest handler receives into a capture file.  Frames are passed on to the wrapped
+// handler first and then queued for a background writer, which only costs a payload reference
+// count, so recording doesn't slow ingest down unless the disk falls a whole queue behind.
+class CaptureRecorder : public NetInputStreamHandler {
+public:
+    static constexpr std::size_t QUEUE_SIZE = 4096;
+    static constexpr std::size_t WRITE_BATCH_SIZE = 64;
+
+private:
+    NetInputStreamHandler* m_next;
+    FrameCaptureWriter m_writer;
+    Core::MpmcBufferQueue<Core::ByteUndecodedFrame, QUEUE_SIZE, 0> m_pending;
+    std::thread m_writerThread;
+    std::atomic<uint64_t> m_numRecorded{0};
+
+    void WriterLoop();
+
+public:
+    // next is non-owning.
+    CaptureRecorder(const std::string& path, NetInputStreamHandler* next);
+    ~CaptureRecorder() override;
+
+    CaptureRecorder(const CaptureRecorder&) = delete;
+    CaptureRecorder& operator=(const CaptureRecorder&) = delete;
+
+    bool IsOpen() const {
+        return m_writer.IsOpen();
+    }
+
+    using NetInputStreamHandler::OnInputStreamData;
+    void OnInputStreamData(const Core::ByteUndecodedFrame& data) override;
+
+    // Writes what is still queued and finishes the file, frames handed in afterwards are only passed on.
+    void Close();
+
+    uint64_t NumFramesRecorded() const {
+        return m_numRecorded.load(std::memory_order_relaxed);
+    }
+};
+
+}
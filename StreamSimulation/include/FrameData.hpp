@@ -3,22 +3,128 @@
 #include <cstddef>
 #include <cstdint>
 #include <array>
+#include <bit>
+#include <chrono>
+#include <memory>
 
 #include "ConcurrentData.hpp"
+#include "FairShareQueue.hpp"
+#include "FrameBufferPool.hpp"
+#include "JitterBufferQueue.hpp"
+#include "PipelineMetrics.hpp"
+#include "SequenceReorderQueue.hpp"
 
 namespace StreamSim::Core {
 
 constexpr uint32_t DEFULT_FRAME_BUFFER_SIZE = 1000;
 
+enum class FrameType : uint8_t {
+    Unknown,
+    I,
+    P,
+    B
+};
+
+constexpr std::size_t MAX_FRAME_REFERENCES = 2;
+
+// sequence is the decode (transmission) order of the frame within its stream.  With B-frames the
+// display order differs, so it is carried separately.  references are the sequences of the frames
+// that have to be decoded before this one: the previous anchor for a P-frame, both surrounding
+// anchors for a B-frame, none for an I-frame.
+// The Ns fields are stamped with PipelineNowNs as the frame passes each stage, 0 means not there yet.
+// deadlineNs is when showing the frame stops being worth it, set at ingest (0 for no deadline).  A frame the
+// decoder gave up on keeps going without a picture and with isExpired set, so the queues that put frames back
+// in order don't wait for it, and the renderer lets it go.
+struct FrameMetadata {
+    uint32_t streamId = 0;
+    uint64_t sequence = 0;
+    uint64_t displayOrder = 0;
+    uint64_t timestampUs = 0;
+    FrameType type = FrameType::Unknown;
+    uint8_t numReferences = 0;
+    std::array<uint64_t, MAX_FRAME_REFERENCES> references{};
+    uint64_t ingestNs = 0;
+    uint64_t decodeStartNs = 0;
+    uint64_t decodeEndNs = 0;
+    uint64_t deadlineNs = 0;
+    bool isExpired = false;
+};
+
+// Whether other frames may reference this one.  Only B-frames are never referenced, a frame without type
+// information might be.
+inline bool IsReferenceFrame(const FrameMetadata& meta) {
+    return meta.type != FrameType::B;
+}
+
+inline bool IsPastDeadline(const FrameMetadata& meta, uint64_t nowNs) {
+    return meta.deadlineNs != 0 && nowNs > meta.deadlineNs;
+}
+
+// Stamps a frame entering the pipeline now, with a deadline budget from now (zero for none).
+inline void StampIngest(FrameMetadata& meta, std::chrono::nanoseconds deadline) {
+    meta.ingestNs = PipelineNowNs();
+    meta.deadlineNs = deadline.count() > 0 ? meta.ingestNs + static_cast<uint64_t>(deadline.count()) : 0;
+}
+
+// data is the single value the demo stages work on.  The payload is the actual frame bytes, a
+// reference to a pooled buffer, so copying a frame from one queue to the next never copies them.
 template <typename T>
 struct FrameElement {
     T data;
+    FrameMetadata meta;
+    FrameBufferRef payload;
 };
 
 // In real-world scenario this will never be a byte but we're just assuming data contained in this
 // has all necessary data to decode into an image.
 using ByteUndecodedFrame = FrameElement<uint8_t>;
 using ByteFrameElement = FrameElement<uint8_t>;
+using ByteFrameQueue = BufferQueue<ByteFrameElement>;
 using AsyncByteFrameQueue = ConcurrentBufferQueue<ByteFrameElement, DEFULT_FRAME_BUFFER_SIZE>;
+using SpscByteFrameQueue = SpscRingBufferQueue<ByteFrameElement, std::bit_ceil(DEFULT_FRAME_BUFFER_SIZE)>;
+using MpmcByteFrameQueue = MpmcBufferQueue<ByteFrameElement, std::bit_ceil(DEFULT_FRAME_BUFFER_SIZE)>;
+using ReorderByteFrameQueue = SequenceReorderQueue<ByteFrameElement, std::bit_ceil(DEFULT_FRAME_BUFFER_SIZE)>;
+using FairShareByteFrameQueue = FairShareQueue<ByteFrameElement, DEFULT_FRAME_BUFFER_SIZE>;
+using JitterByteFrameQueue = JitterBufferQueue<ByteFrameElement, DEFULT_FRAME_BUFFER_SIZE>;
+
+// The frame without its picture, for the stages after decode to let go of.
+inline void MarkExpired(const ByteUndecodedFrame& frame, ByteFrameElement& expired) {
+    expired.data = 0;
+    expired.meta = frame.meta;
+    expired.meta.isExpired = true;
+    expired.payload = FrameBufferRef();
+}
+
+// Picks the queue implementation for one hand-off between two pipeline stages.
+// SingleProducerSingleConsumer is only valid when exactly one thread writes and one thread reads.  None of the
+// services has such a hand-off between frame stages (several decode workers write, or frames need putting back in
+// order), so it's the ring behind AsyncFileRenderSink, between the render thread and the writer thread.
+// Reordering takes any number of writers and hands frames of a single stream to one reader in display order.
+// Jitter holds frames back until their playout time to smooth out uneven arrival.
+enum class FrameQueueType {
+    Locked,
+    SingleProducerSingleConsumer,
+    MultiProducerMultiConsumer,
+    Reordering,
+    Jitter
+};
+
+// capacity is rounded up to a power of two for the queues that need one.
+inline std::unique_ptr<ByteFrameQueue> MakeByteFrameQueue(FrameQueueType type, std::size_t capacity = DEFULT_FRAME_BUFFER_SIZE,
+                                                          QueueWaitPolicy wait = QueueWaitPolicy()) {
+    switch (type) {
+    case FrameQueueType::SingleProducerSingleConsumer:
+        return std::make_unique<SpscByteFrameQueue>(capacity, wait);
+    case FrameQueueType::MultiProducerMultiConsumer:
+        return std::make_unique<MpmcByteFrameQueue>(capacity, wait);
+    case FrameQueueType::Reordering:
+        return std::make_unique<ReorderByteFrameQueue>(capacity, wait);
+    case FrameQueueType::Jitter:
+        return std::make_unique<JitterByteFrameQueue>(capacity, wait);
+    case FrameQueueType::Locked:
+    default:
+        return std::make_unique<AsyncByteFrameQueue>(capacity, wait);
+    }
+}
 
 }
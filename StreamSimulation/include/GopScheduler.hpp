@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include "FrameData.hpp"
+
+namespace StreamSim::Core {
+
+constexpr uint32_t DEFAULT_GOP_NUM_ANCHORS = 4;
+constexpr uint32_t DEFAULT_GOP_NUM_B_FRAMES = 2;
+constexpr uint32_t DEFAULT_STREAM_IDLE_TIMEOUT_IN_MILISEC = 5000;
+
+// Fills in type, references and display order for the frame at meta.sequence, for a closed GOP made of
+// one I-frame and numAnchors - 1 P-frames where every P-frame is followed (in decode order) by
+// numBFrames B-frames that are displayed before it.  With 4 anchors and 2 B-frames:
+//   decode order   I0 P3 B1 B2 P6 B4 B5 P9 B7 B8 | I10 ...
+//   display order  I0 B1 B2 P3 B4 B5 P6 B7 B8 P9 | I10 ...
+void DescribeGopFrame(FrameMetadata& meta,
+                      uint32_t numAnchors = DEFAULT_GOP_NUM_ANCHORS,
+                      uint32_t numBFrames = DEFAULT_GOP_NUM_B_FRAMES);
+
+struct GopSchedulerStats {
+    uint64_t framesReady = 0;       // could be decoded as soon as they were submitted
+    uint64_t framesDeferred = 0;    // had to wait for a reference frame
+    uint64_t framesOrphaned = 0;    // dropped because a reference frame never got decoded
+};
+
+// Decides when a frame may be decoded.
+// Frames without references (I-frames, or frames without type information) are ready as soon as
+// they're submitted, so the I-frames of different GOPs decode in parallel on different workers.
+// P and B-frames are held until every frame they reference has been completed and are then handed
+// to whichever worker asks next.  Because a B-frame references the anchor that follows it in display
+// order, it always decodes after that anchor, no matter which order the workers took them in.
+// Completion is tracked per stream over the last COMPLETED_WINDOW sequences, references are always
+// close to the frame using them.  A held frame whose reference still hasn't been completed
+// MAX_PENDING_DISTANCE frames later was lost upstream and is dropped instead of waiting forever, and so
+// is every frame that references a dropped one, right away.  Only the oldest held frame of a stream is
+// checked against the distance, the others can't be further behind.
+// A dropped frame still comes out of TakeReady, without its payload and with isExpired set, so the stages
+// after decode know not to wait for it.  A frame submitted with isExpired set (dropped upstream) is passed
+// on the same way, and its dependents are dropped with it.
+// Ready frames are kept per stream and TakeReady hands them out one stream at a time in turn, so an anchor
+// releasing a whole GOP of one stream doesn't push the other streams' frames to the back.  The order the
+// fair share decode queue read them in survives the scheduler.
+// A stream nobody submitted to or completed a frame of for the idle timeout is forgotten, frames it was
+// still holding included, so streams that come and go don't pile up.
+class GopScheduler {
+public:
+    static constexpr std::size_t COMPLETED_WINDOW = 1024;
+    static constexpr uint64_t MAX_PENDING_DISTANCE = 256;
+
+private:
+    struct StreamState {
+        // What became of the frames, at sequence % COMPLETED_WINDOW: (sequence + 1) * 2 once completed and
+        // one more than that once dropped, 0 means neither.
+        std::array<uint64_t, COMPLETED_WINDOW> outcomes{};
+        uint64_t highestSequence = 0;
+        // Lowest sequence in pending, only meaningful while pending isn't empty.
+        uint64_t oldestPending = 0;
+        uint64_t lastActiveNs = 0;
+        std::vector<ByteUndecodedFrame> pending;
+    };
+
+    const uint64_t m_idleTimeoutNs;
+    std::mutex m_mutex;
+    std::unordered_map<uint32_t, StreamState> m_streams;
+    // Apart from StreamState so a forgotten stream's last frames still come out.
+    std::unordered_map<uint32_t, std::deque<ByteUndecodedFrame>> m_ready;
+    // Streams with ready frames, in the order they get their turn.
+    std::deque<uint32_t> m_readyTurns;
+    uint64_t m_nextEvictionNs = 0;
+    GopSchedulerStats m_stats;
+
+    static bool IsCompleted(const StreamState& stream, uint64_t sequence);
+    static bool IsDropped(const StreamState& stream, uint64_t sequence);
+    static bool IsDecodable(const StreamState& stream, const FrameMetadata& meta);
+    static bool HasDroppedReference(const StreamState& stream, const FrameMetadata& meta);
+    void MakeReady(ByteUndecodedFrame&& frame);
+    void Drop(StreamState& stream, ByteUndecodedFrame&& frame);
+    void DropOrphans(StreamState& stream);
+    void EvictIdleStreams(uint64_t nowNs);
+
+public:
+    explicit GopScheduler(std::chrono::milliseconds streamIdleTimeout = std::chrono::milliseconds(DEFAULT_STREAM_IDLE_TIMEOUT_IN_MILISEC));
+    ~GopScheduler() = default;
+
+    GopScheduler(const GopScheduler&) = delete;
+    GopScheduler& operator=(const GopScheduler&) = delete;
+
+    // Hands a received frame to the scheduler.  It becomes available from TakeReady once its
+    // references are complete, which may be right away.
+    void Submit(ByteUndecodedFrame&& frame);
+
+    // Marks a frame as decoded and releases the frames that were waiting on it.
+    void Complete(const FrameMetadata& meta);
+
+    // Moves up to frames.size() decodable frames into frames and returns how many.
+    std::size_t TakeReady(std::span<ByteUndecodedFrame> frames);
+
+    // Frames still waiting on a reference.
+    std::size_t NumPending();
+
+    // Streams the scheduler keeps track of right now.
+    std::size_t NumStreams();
+
+    GopSchedulerStats GetStats();
+};
+
+}
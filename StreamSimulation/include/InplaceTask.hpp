@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <concepts>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace StreamSim::Core {
+
+// Move-only "void()" callable that keeps its target inside the object instead of on the heap.
+// Anything that doesn't fit in Size bytes is a compile error rather than a silent allocation,
+// which is the whole point compared to std::function for per-frame tasks.
+// A target with a DeadlineNs() keeps it, so a pool running earliest deadline first still can, and one with a
+// Discard() still gets told when a pool throws it away.
+template <std::size_t Size = 64>
+class InplaceTask {
+private:
+    struct Ops {
+        void (*invoke)(void* target);
+        void (*moveTo)(void* target, void* destination);
+        void (*destroy)(void* target);
+        void (*discard)(void* target);
+    };
+
+    template <typename F>
+    static constexpr Ops OPS_FOR = {
+        [](void* target) { (*static_cast<F*>(target))(); },
+        [](void* target, void* destination) {
+            ::new (destination) F(std::move(*static_cast<F*>(target)));
+            static_cast<F*>(target)->~F();
+        },
+        [](void* target) { static_cast<F*>(target)->~F(); },
+        [](void* target) {
+            if constexpr (requires(F& f) { f.Discard(); }) {
+                static_cast<F*>(target)->Discard();
+            }
+        }
+    };
+
+    alignas(std::max_align_t) std::byte m_storage[Size];
+    const Ops* m_ops = nullptr;
+    uint64_t m_deadlineNs = 0;
+
+    void Reset() {
+        if (m_ops != nullptr) {
+            m_ops->destroy(m_storage);
+            m_ops = nullptr;
+        }
+    }
+
+public:
+    InplaceTask() = default;
+
+    template <typename F, typename Target = std::decay_t<F>>
+        requires (!std::is_same_v<Target, InplaceTask> && std::is_invocable_r_v<void, Target&>)
+    InplaceTask(F&& function) {
+        static_assert(sizeof(Target) <= Size, "Callable is too big for this InplaceTask, raise Size");
+        static_assert(alignof(Target) <= alignof(std::max_align_t), "Callable is over-aligned for InplaceTask");
+        static_assert(std::is_nothrow_move_constructible_v<Target>, "InplaceTask needs a nothrow movable callable");
+
+        Target* target = ::new (static_cast<void*>(m_storage)) Target(std::forward<F>(function));
+        m_ops = &OPS_FOR<Target>;
+        if constexpr (requires { { target->DeadlineNs() } -> std::convertible_to<uint64_t>; }) {
+            m_deadlineNs = target->DeadlineNs();
+        }
+    }
+
+    InplaceTask(InplaceTask&& other) noexcept
+    : m_deadlineNs(other.m_deadlineNs) {
+        if (other.m_ops != nullptr) {
+            other.m_ops->moveTo(other.m_storage, m_storage);
+            m_ops = std::exchange(other.m_ops, nullptr);
+        }
+    }
+
+    InplaceTask& operator=(InplaceTask&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            m_deadlineNs = other.m_deadlineNs;
+            if (other.m_ops != nullptr) {
+                other.m_ops->moveTo(other.m_storage, m_storage);
+                m_ops = std::exchange(other.m_ops, nullptr);
+            }
+        }
+        return *this;
+    }
+
+    InplaceTask(const InplaceTask&) = delete;
+    InplaceTask& operator=(const InplaceTask&) = delete;
+
+    ~InplaceTask() {
+        Reset();
+    }
+
+    explicit operator bool() const {
+        return m_ops != nullptr;
+    }
+
+    // The target's deadline, 0 when it has none.
+    uint64_t DeadlineNs() const {
+        return m_deadlineNs;
+    }
+
+    void operator()() {
+        m_ops->invoke(m_storage);
+    }
+
+    // Passes on to the target's Discard, does nothing if it has none.
+    void Discard() {
+        if (m_ops != nullptr) {
+            m_ops->discard(m_storage);
+        }
+    }
+};
+
+}
@@ -0,0 +1,357 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "ConcurrentData.hpp"
+
+namespace StreamSim::Core {
+
+constexpr uint32_t MIN_JITTER_DELAY_IN_MILISEC = 5;
+constexpr uint32_t MAX_JITTER_DELAY_IN_MILISEC = 200;
+
+struct JitterBufferStats {
+    uint64_t framesReleased = 0;
+    uint64_t framesLate = 0;        // discarded because they showed up after their playout time
+    uint64_t jitterUs = 0;          // smoothed inter-arrival jitter
+    uint64_t currentDelayUs = 0;    // delay frames are held for on top of the fastest transit seen
+};
+
+// Holds frames until their playout time, so frames arriving in uneven bursts leave at the even pace
+// they were sent at.  A frame is due at timestampUs + fastest transit seen for its stream + target delay,
+// which means a frame that made it through the network quickly waits the longest.
+// The target delay adapts per stream to the measured jitter (the RFC 3550 estimate of how much the
+// transit time changes from one frame to the next): it jumps up as soon as the jitter grows and creeps
+// back down when it settles, so the buffer only adds as much latency as the network needs.
+// Lateness goes by each stream's playout clock: a frame arriving after its playout time, or with a timestamp
+// the stream already played out past, is discarded and counted as late; it still feeds the jitter estimate
+// so the next ones are held longer.  Sequence numbers don't come into it, a frame sent with a later timestamp
+// than a higher sequence (several senders sharing a stream) is simply played after it.
+// What's left of it, without the payload and with isExpired set, is released right away so the stages that
+// put frames back in order don't wait for it.
+// Timestamps only have to be in the same units per stream, the clock offset to the sender drops out.
+// Once closed, everything left is released right away.
+// Holds up to N frames unless another capacity is given at construction.
+template <typename T, std::size_t N, uint32_t DefaultWaitSec = 2>
+class JitterBufferQueue : public BufferQueue<T> {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // How many frames the jitter estimate averages over, and the target delay decays over.
+    static constexpr int64_t JITTER_SMOOTHING = 16;
+    static constexpr int64_t DELAY_DECAY = 64;
+    // Target delay in multiples of the jitter, enough to cover nearly all of the spread.
+    static constexpr int64_t JITTER_DELAY_MULTIPLIER = 4;
+
+    struct StreamClock {
+        bool hasTransit = false;
+        int64_t minTransitUs = 0;
+        int64_t lastTransitUs = 0;
+        int64_t jitterUs = 0;
+        int64_t targetDelayUs = MIN_JITTER_DELAY_IN_MILISEC * 1000;
+        // Timestamp of the last frame played out, the stream's playout clock.
+        bool hasReleased = false;
+        uint64_t playedOutUs = 0;
+    };
+
+    struct Entry {
+        int64_t playoutUs;
+        StreamClock* stream;
+        T data;
+    };
+
+    const std::size_t m_capacity;
+    const QueueWaitPolicy m_wait;
+
+    std::mutex m_mutex;
+    std::condition_variable m_notFull;
+    std::condition_variable m_notEmpty;
+
+    std::unordered_map<uint32_t, std::unique_ptr<StreamClock>> m_streams;
+    // Min-heap on playout time, ties in sequence order.
+    std::vector<Entry> m_heap;
+    bool m_closed = false;
+
+    uint64_t m_framesReleased = 0;
+    uint64_t m_framesLate = 0;
+    std::size_t m_maxDepth = 0;
+
+    static int64_t NowUs() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    static bool Later(const Entry& a, const Entry& b) {
+        if (a.playoutUs != b.playoutUs) {
+            return a.playoutUs > b.playoutUs;
+        }
+        return a.data.meta.sequence > b.data.meta.sequence;
+    }
+
+    // Caller must hold m_mutex.
+    StreamClock& GetStream(uint32_t streamId) {
+        auto& stream = m_streams[streamId];
+        if (!stream) {
+            stream = std::make_unique<StreamClock>();
+        }
+        return *stream;
+    }
+
+    // Updates the stream's jitter estimate and target delay with a frame that arrived now.
+    // Returns the frame's playout time, or -1 when it's already too late to play it.
+    // Caller must hold m_mutex.
+    int64_t Arrive(StreamClock& stream, const T& data) {
+        const int64_t transitUs = NowUs() - static_cast<int64_t>(data.meta.timestampUs);
+        if (!stream.hasTransit) {
+            stream.hasTransit = true;
+            stream.minTransitUs = transitUs;
+            stream.lastTransitUs = transitUs;
+        }
+
+        // Judged by the delay in effect when it arrived, before this frame raises it.
+        const bool isLate = transitUs > stream.minTransitUs + stream.targetDelayUs ||
+                            (stream.hasReleased && data.meta.timestampUs < stream.playedOutUs);
+
+        stream.jitterUs += (std::abs(transitUs - stream.lastTransitUs) - stream.jitterUs) / JITTER_SMOOTHING;
+        stream.lastTransitUs = transitUs;
+        stream.minTransitUs = std::min(stream.minTransitUs, transitUs);
+
+        const int64_t wantedDelayUs = std::clamp<int64_t>(JITTER_DELAY_MULTIPLIER * stream.jitterUs,
+                                                          MIN_JITTER_DELAY_IN_MILISEC * 1000,
+                                                          MAX_JITTER_DELAY_IN_MILISEC * 1000);
+        if (wantedDelayUs > stream.targetDelayUs) {
+            stream.targetDelayUs = wantedDelayUs;
+        } else {
+            stream.targetDelayUs -= (stream.targetDelayUs - wantedDelayUs) / DELAY_DECAY;
+        }
+
+        if (isLate) {
+            return -1;
+        }
+        return static_cast<int64_t>(data.meta.timestampUs) + stream.minTransitUs + stream.targetDelayUs;
+    }
+
+    // Caller must hold m_mutex.
+    bool IsHeadDue() const {
+        return !m_heap.empty() && (m_closed || m_heap.front().playoutUs <= NowUs());
+    }
+
+    // Caller must hold m_mutex.
+    std::size_t PopDue(std::span<T> data, std::size_t max) {
+        const std::size_t limit = std::min(max, data.size());
+        std::size_t numRead = 0;
+        while (numRead < limit && IsHeadDue()) {
+            std::pop_heap(m_heap.begin(), m_heap.end(), Later);
+            Entry& entry = m_heap.back();
+
+            StreamClock& stream = *entry.stream;
+            if (!entry.data.meta.isExpired && (!stream.hasReleased || entry.data.meta.timestampUs > stream.playedOutUs)) {
+                stream.hasReleased = true;
+                stream.playedOutUs = entry.data.meta.timestampUs;
+            }
+
+            data[numRead++] = std::move(entry.data);
+            m_heap.pop_back();
+        }
+
+        if (numRead > 0) {
+            m_framesReleased += numRead;
+            m_notFull.notify_all();
+        }
+        return numRead;
+    }
+
+    // Caller must hold m_mutex.
+    bool Push(const T& data) {
+        StreamClock& stream = GetStream(data.meta.streamId);
+        const int64_t playoutUs = Arrive(stream, data);
+        if (playoutUs < 0) {
+            ++m_framesLate;
+            T expired = data;
+            expired.meta.isExpired = true;
+            expired.payload = {};
+            m_heap.push_back(Entry{NowUs(), &stream, std::move(expired)});
+            std::push_heap(m_heap.begin(), m_heap.end(), Later);
+            return false;
+        }
+
+        m_heap.push_back(Entry{playoutUs, &stream, data});
+        std::push_heap(m_heap.begin(), m_heap.end(), Later);
+        m_maxDepth = std::max(m_maxDepth, m_heap.size());
+        return true;
+    }
+
+public:
+    explicit JitterBufferQueue(std::size_t capacity = N, QueueWaitPolicy wait = { std::chrono::seconds(DefaultWaitSec) })
+    : m_capacity(std::max<std::size_t>(capacity, 1))
+    , m_wait(wait) {
+        m_heap.reserve(m_capacity);
+    }
+
+    // A late frame is discarded and reported as not written.
+    bool WriteSync(const T& data) override {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        WaitOnCondition(m_notFull, lock, m_wait, [this] {
+            return m_heap.size() < m_capacity || m_closed;
+        });
+
+        if (m_closed || m_heap.size() >= m_capacity) {
+            return false;
+        }
+
+        // A late frame isn't written, but what's left of it is there to read.
+        const bool isWritten = Push(data);
+        m_notEmpty.notify_all();
+        return isWritten;
+    }
+
+    bool ReadAsync(T& data) override {
+        return ReadBatchAsync(std::span<T>(&data, 1), 1) == 1;
+    }
+
+    bool ReadSync(T& data) override {
+        return ReadBatch(std::span<T>(&data, 1), 1) == 1;
+    }
+
+    // Late frames are skipped, the count only includes the frames that were buffered.
+    std::size_t WriteBatch(std::span<const T> data) override {
+        if (data.empty()) {
+            return 0;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        WaitOnCondition(m_notFull, lock, m_wait, [this] {
+            return m_heap.size() < m_capacity || m_closed;
+        });
+
+        if (m_closed) {
+            return 0;
+        }
+
+        std::size_t written = 0;
+        std::size_t numPushed = 0;
+        for (; numPushed < data.size() && m_heap.size() < m_capacity; ++numPushed) {
+            if (Push(data[numPushed])) {
+                ++written;
+            }
+        }
+        if (numPushed > 0) {
+            m_notEmpty.notify_all();
+        }
+        return written;
+    }
+
+    // Only returns frames whose playout time has come.
+    std::size_t ReadBatchAsync(std::span<T> data, std::size_t max) override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return PopDue(data, max);
+    }
+
+    // Sleeps until the earliest frame is due, or the wait times out.
+    std::size_t ReadBatch(std::span<T> data, std::size_t max) override {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        const auto deadline = Clock::now() + m_wait.timeout;
+        while (!IsHeadDue() && !(m_closed && m_heap.empty())) {
+            // New frames can be due earlier than the one being waited on, writers wake us up for those.
+            auto wakeup = m_heap.empty() ? Clock::time_point::max()
+                                         : Clock::time_point(std::chrono::microseconds(m_heap.front().playoutUs));
+            if (m_wait.timeout.count() != 0) {
+                if (Clock::now() >= deadline) {
+                    return 0;
+                }
+                wakeup = std::min(wakeup, deadline);
+            }
+
+            if (wakeup == Clock::time_point::max()) {
+                m_notEmpty.wait(lock);
+            } else {
+                m_notEmpty.wait_until(lock, wakeup);
+            }
+        }
+        return PopDue(data, max);
+    }
+
+    std::size_t NumElements() override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_heap.size();
+    }
+
+    // Frames past their playout time, the ones still held back aren't waiting on the reader.
+    std::size_t NumReadyElements() override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_closed) {
+            return m_heap.size();
+        }
+        const int64_t nowUs = NowUs();
+        return static_cast<std::size_t>(std::count_if(m_heap.begin(), m_heap.end(),
+            [nowUs](const Entry& entry) { return entry.playoutUs <= nowUs; }));
+    }
+
+    std::size_t Capacity() const override {
+        return m_capacity;
+    }
+
+    bool IsFull() override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_heap.size() >= m_capacity;
+    }
+
+    bool IsEmpty() override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_heap.empty();
+    }
+
+    void Close() override {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_notFull.notify_all();
+        m_notEmpty.notify_all();
+    }
+
+    bool IsClosed() override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_closed;
+    }
+
+    // Late frames are the ones this queue drops.
+    QueueStats GetQueueStats() override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        QueueStats stats;
+        stats.depth = m_heap.size();
+        stats.maxDepth = m_maxDepth;
+        stats.dropped = m_framesLate;
+        return stats;
+    }
+
+    // Counts over all streams, jitter and delay of the stream with the largest delay.
+    JitterBufferStats GetStats() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        JitterBufferStats stats;
+        stats.framesReleased = m_framesReleased;
+        stats.framesLate = m_framesLate;
+        stats.currentDelayUs = MIN_JITTER_DELAY_IN_MILISEC * 1000;
+        for (const auto& [streamId, stream] : m_streams) {
+            if (static_cast<uint64_t>(stream->targetDelayUs) >= stats.currentDelayUs) {
+                stats.currentDelayUs = static_cast<uint64_t>(stream->targetDelayUs);
+                stats.jitterUs = static_cast<uint64_t>(stream->jitterUs);
+            }
+        }
+        return stats;
+    }
+
+    std::chrono::microseconds GetCurrentDelay() {
+        return std::chrono::microseconds(GetStats().currentDelayUs);
+    }
+};
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "FrameCapture.hpp"
+#include "FrameData.hpp"
+#include "NetInputStream.hpp"
+
+namespace StreamSim::Net {
+
+constexpr uint64_t DEFAULT_LOAD_SEED = 0x5EED;
+constexpr double DEFAULT_LOAD_FRAMES_PER_SEC = 1000.0;
+constexpr std::size_t DEFAULT_FRAME_PAYLOAD_SIZE = 4096;
+
+// When frames arrive.
+enum class ArrivalProcess {
+    ConstantRate,   // evenly spaced at framesPerSec
+    Poisson,        // exponentially distributed gaps averaging framesPerSec
+    OnOff,          // framesPerSec for onTimeUs, then nothing for offTimeUs, repeating
+    Replay          // at recorded times, see LoadProfile::capture and replayTimestampsUs
+};
+
+// What one ingest thread sends.  Everything a generator does follows from the profile, so two runs
+// with the same profile send the same frames at the same points in time.
+struct LoadProfile {
+    ArrivalProcess arrival = ArrivalProcess::ConstantRate;
+    // Per generator, for OnOff it's the rate while on.
+    double framesPerSec = DEFAULT_LOAD_FRAMES_PER_SEC;
+    uint64_t seed = DEFAULT_LOAD_SEED;
+    uint64_t onTimeUs = 50000;
+    uint64_t offTimeUs = 50000;
+    std::size_t payloadSize = DEFAULT_FRAME_PAYLOAD_SIZE;
+    // Stream the generated frames are tagged with.
+    uint32_t streamId = 0;
+
+    // Replay: arrival times in microseconds from the start, the frames themselves are generated.
+    std::vector<uint64_t> replayTimestampsUs;
+    // Replay: frames sent exactly as recorded, at their recorded timestamps relative to the first
+    // one, with payloads straight from the capture's mapping.  Takes precedence over replayTimestampsUs.
+    std::shared_ptr<const FrameCaptureReader> capture;
+};
+
+struct LoadGeneratorStats {
+    uint64_t framesSent = 0;
+    // How far behind its schedule a frame went out, from oversleeping or a slow handler.
+    uint64_t maxLagUs = 0;
+    uint64_t meanLagUs = 0;
+};
+
+// Seeded, open-loop frame source for the simulated ingest.
+// Several generators can share one profile to drive one stream from several threads: generator
+// index of numGenerators sends every numGenerators-th frame starting at index, so together they
+// send sequences 0, 1, 2, ... with interleaved arrival times, and each one seeds its own RNG from
+// the profile seed and its index.  Random arrivals are drawn once for the whole stream: every generator
+// draws the same Poisson schedule from the profile seed and sends every numGenerators-th arrival of it,
+// so timestamps go up with the sequence no matter how many generators share the stream.
+// Open loop means the schedule never waits for the pipeline: a frame that is due goes out even if
+// the previous ones were late, so a slow consumer shows up as queueing instead of a lower rate.
+class LoadGenerator {
+private:
+    LoadProfile m_profile;
+    std::size_t m_index;
+    std::size_t m_numGenerators;
+    std::mt19937_64 m_generator;
+    // The stream's arrival schedule, seeded the same in every generator of the profile.
+    std::mt19937_64 m_schedule;
+
+    // Position of the next frame, counted over all generators of the profile.
+    uint64_t m_position;
+    double m_nextArrivalUs = 0.0;
+    uint64_t m_replayBaseUs = 0;
+
+    // Uniform in [0, 1).
+    static double NextUniform(std::mt19937_64& generator);
+    double NextStreamInterval();
+    double NextInterval();
+    void MakeFrame(Core::ByteUndecodedFrame& frame, uint64_t sequence, uint64_t timestampUs);
+
+public:
+    LoadGenerator(const LoadProfile& profile, std::size_t index = 0, std::size_t numGenerators = 1);
+
+    // Next frame and its arrival time in microseconds from the start, false once a replay is exhausted.
+    bool Next(Core::ByteUndecodedFrame& frame, uint64_t& arrivalUs);
+
+    // Hands frames to handler at their arrival times, counted from start, until duration is up.
+    LoadGeneratorStats Run(NetInputStreamHandler& handler, std::chrono::steady_clock::time_point start,
+                           std::chrono::microseconds duration);
+};
+
+}
@@ -10,17 +10,29 @@ class NetInputStreamHandler {
 public:
     virtual ~NetInputStreamHandler() = default;
     virtual void OnInputStreamData(const Core::ByteUndecodedFrame& data) = 0;
+
+    // Same, for a transport that carries several streams (one per user in a call) over one connection.
+    // The frame is tagged with the stream it came in on and handled like any other frame.
+    virtual void OnInputStreamData(uint32_t streamId, const Core::ByteUndecodedFrame& data) {
+        Core::ByteUndecodedFrame frame = data;
+        frame.meta.streamId = streamId;
+        OnInputStreamData(frame);
+    }
 };
 
 class DemoNetInputStreamHandler : public NetInputStreamHandler {
 private:
     // This is non-owning raw pointer.
-    Core::AsyncByteFrameQueue* m_buffer;
+    Core::ByteFrameQueue* m_buffer;
+    std::chrono::milliseconds m_deadline;
 
 public:
-    DemoNetInputStreamHandler(Core::AsyncByteFrameQueue* buffer);
+    // Every frame gets a deadline of deadline from now, none when it's zero.
+    DemoNetInputStreamHandler(Core::ByteFrameQueue* buffer, std::chrono::milliseconds deadline = std::chrono::milliseconds(0));
     ~DemoNetInputStreamHandler() override;
 
+    using NetInputStreamHandler::OnInputStreamData;
+
     // Note: This function will be used as a callback function when the data is received from
     //       the network.  
     void OnInputStreamData(const Core::ByteUndecodedFrame& data) override;
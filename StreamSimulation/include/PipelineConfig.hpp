@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "ConcurrentData.hpp"
+#include "CoroutineExecutor.hpp"
+#include "CpuTopology.hpp"
+#include "DecodeAutoscaler.hpp"
+#include "FrameData.hpp"
+#include "RenderSink.hpp"
+#include "ThreadPool.hpp"
+
+namespace StreamSim::Core {
+
+constexpr uint32_t DEFAULT_RUN_TIME_SEC = 6;
+constexpr std::size_t DEFAULT_NUM_INGEST_THREADS = 4;
+constexpr std::size_t DEFAULT_NUM_DECODER_THREADS = 4;
+// Past the longest a jitter buffer holds a frame plus the reorder hold, so only a backed up pipeline misses it.
+constexpr uint32_t DEFAULT_FRAME_DEADLINE_IN_MILISEC = 400;
+
+// Size and wait of one hand-off queue between two stages.
+struct QueueConfig {
+    std::size_t capacity = DEFULT_FRAME_BUFFER_SIZE;
+    QueueWaitPolicy wait;
+};
+
+// How big the pipeline is and where it runs, decided at startup so one build can be tuned for every
+// host it is deployed on.  The defaults are what the services used to have compiled in.
+// It can be loaded from a file and/or the command line, both use the same keys:
+//
+//   run_time_sec          = 6
+//   frame_deadline_ms     = 400      from ingest, late frames are dropped instead of decoded or shown, 0 never drops
+//   ingest.threads        = 4        simulated ingest threads (streams for the multi stream service)
+//   ingest.cpus           = 0-1
+//   decode.threads        = 4        the most that decode at once when autoscaling
+//   decode.pool_capacity  = 4        decode tasks waiting for a thread pool worker
+//   decode.pool_policy    = block    what a full pool does with the next frame: block, reject, drop_oldest or drop_newest
+//   decode.autoscale      = off      on parks the decode threads that aren't needed, see DecodeAutoscaler
+//   decode.min_threads    = 1        and never goes below this many
+//   decode.scale_interval_ms = 100
+//   decode.scale_up_depth = 8        ready frames per decoding thread that count as falling behind
+//   decode.scale_up_wait_ms = 250    p99 wait for a decoder that does, 0 looks at the depth alone
+//   decode.cpus           = 2-5,8
+//   decode.node           = 0        NUMA node, or any
+//   decode.pinning        = compact  shared, compact or spread, see PinningPolicy
+//   render.mode           = immediate  or paced, see RenderMode.  The coroutine service always renders immediately
+//   render.refresh_hz     = 60       vsync rate of paced rendering
+//   render.cpus           = 6
+//   executor.threads      = 2        threads every stage of the coroutine service shares
+//   executor.cpus         = 0-1
+//   decode_queue.capacity = 1000     in front of the decoders (per stream for the multi stream service)
+//   decode_queue.wait_ms  = 2000     how long a blocked read or write waits, 0 waits until closed
+//   decode_queue.spin     = 64       retries before a lock-free queue parks
+//   render_queue.capacity = 1024     and the same three for the queue between decoders and renderer
+//
+// Every stage (ingest, decode, render) and the executor take cpus, node and pinning.  A queue is allocated on the node of the
+// stage reading from it when that stage runs on a single node.
+// In a file every option is a `key = value` line and # starts a comment, on the command line it is --key=value.
+struct PipelineConfig {
+    uint32_t runTimeSec = DEFAULT_RUN_TIME_SEC;
+    std::chrono::milliseconds frameDeadline{DEFAULT_FRAME_DEADLINE_IN_MILISEC};
+
+    std::size_t numIngestThreads = DEFAULT_NUM_INGEST_THREADS;
+    StagePlacement ingestPlacement;
+
+    std::size_t numDecoderThreads = DEFAULT_NUM_DECODER_THREADS;
+    std::size_t decodePoolCapacity = DEFAULT_NUM_DECODER_THREADS;
+    // Block holds up ingest instead of losing frames, a live source that can't wait wants drop_oldest.
+    AdmissionPolicy decodePoolPolicy = AdmissionPolicy::Block;
+    AutoscaleConfig decodeAutoscale;
+    StagePlacement decodePlacement;
+
+    Render::RenderMode renderMode = Render::RenderMode::Immediate;
+    uint32_t renderRefreshRateHz = Render::DEFAULT_REFRESH_RATE_HZ;
+    StagePlacement renderPlacement;
+
+    std::size_t numExecutorThreads = DEFAULT_NUM_EXECUTOR_THREADS;
+    StagePlacement executorPlacement;
+
+    QueueConfig decodeQueue;
+    QueueConfig renderQueue;
+};
+
+// Sets one option, false with a message in error if the key is unknown or the value doesn't fit it.
+bool ApplyPipelineOption(PipelineConfig& config, const std::string& key, const std::string& value, std::string& error);
+
+// Options from a file on top of what config already holds.  Stops at the first bad line.
+bool LoadPipelineConfig(const std::string& path, PipelineConfig& config, std::string& error);
+
+// Takes the --key=value options out of argv and applies them in order, --config=<file> loads a file
+// at that point.  Everything else stays in argv in its order, and argc is updated.
+bool ParsePipelineArgs(int& argc, char** argv, PipelineConfig& config, std::string& error);
+
+// Every option as a file would have it, for logging what a run used.
+std::string FormatPipelineConfig(const PipelineConfig& config);
+
+}
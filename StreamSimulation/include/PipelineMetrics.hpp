@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <chrono>
+
+namespace StreamSim::Core {
+
+// Clock every pipeline timestamp (FrameMetadata::ingestNs and friends) is taken from.
+inline uint64_t PipelineNowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Percentiles of one pipeline stage, all in nanoseconds.
+struct LatencySummary {
+    uint64_t count = 0;
+    uint64_t minNs = 0;
+    uint64_t meanNs = 0;
+    uint64_t p50Ns = 0;
+    uint64_t p90Ns = 0;
+    uint64_t p99Ns = 0;
+    uint64_t p999Ns = 0;
+    uint64_t maxNs = 0;
+};
+
+// HDR-style histogram: values below 16 get a bucket each, above that every power of two is split into
+// 16 linear sub-buckets, so any value is off by at most 1/16 (6.25%) from its bucket's upper bound, at
+// a fixed 592 counters covering up to about 18 minutes in nanoseconds.
+// Recording is a single relaxed add, so it is wait-free, but it's meant to have one writer thread
+// (each decode worker and each renderer has its own) and be merged into a snapshot when someone asks.
+class LatencyHistogram {
+public:
+    static constexpr uint32_t SUB_BUCKET_BITS = 4;
+    static constexpr uint32_t SUB_BUCKET_COUNT = 1u << SUB_BUCKET_BITS;
+    static constexpr uint32_t MAX_VALUE_BITS = 40;
+    static constexpr std::size_t NUM_BUCKETS = SUB_BUCKET_COUNT + (MAX_VALUE_BITS - SUB_BUCKET_BITS) * SUB_BUCKET_COUNT;
+
+    static std::size_t BucketIndex(uint64_t value);
+    // Largest value that lands in the bucket.
+    static uint64_t BucketUpperBound(std::size_t index);
+
+private:
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> m_counts{};
+    std::atomic<uint64_t> m_sum{0};
+    std::atomic<uint64_t> m_max{0};
+    std::atomic<uint64_t> m_min{UINT64_MAX};
+
+    friend class HistogramSnapshot;
+
+public:
+    void Record(uint64_t valueNs);
+
+    // Records end - start when both stamps are set and in order.
+    void RecordInterval(uint64_t startNs, uint64_t endNs) {
+        if (startNs != 0 && endNs >= startNs) {
+            Record(endNs - startNs);
+        }
+    }
+};
+
+// Plain copy of one or more histograms, taken without stopping the writers.
+class HistogramSnapshot {
+private:
+    std::array<uint64_t, LatencyHistogram::NUM_BUCKETS> m_counts{};
+    uint64_t m_count = 0;
+    uint64_t m_sum = 0;
+    uint64_t m_max = 0;
+    uint64_t m_min = UINT64_MAX;
+
+public:
+    void Add(const LatencyHistogram& histogram);
+    void Merge(const HistogramSnapshot& other);
+
+    // What was recorded between an earlier snapshot of the same histograms and this one.  Min and max
+    // are only as exact as the buckets they fall in.
+    HistogramSnapshot Since(const HistogramSnapshot& earlier) const;
+
+    uint64_t Count() const {
+        return m_count;
+    }
+
+    // Upper bound of the bucket holding the given percentile (0 - 100), never more than the max seen.
+    uint64_t Percentile(double percentile) const;
+    LatencySummary Summarize() const;
+};
+
+// What a decode stage records per frame: time waiting to be decoded since ingest, and decoding itself.
+struct DecodeLatencyHistograms {
+    LatencyHistogram queueWait;
+    LatencyHistogram decode;
+};
+
+struct DecodeLatencySnapshot {
+    HistogramSnapshot queueWait;
+    HistogramSnapshot decode;
+};
+
+// What a renderer records per frame: time from decoded to presented, and from ingest to presented.
+struct RenderLatencyHistograms {
+    LatencyHistogram renderWait;
+    LatencyHistogram endToEnd;
+};
+
+struct RenderLatencySnapshot {
+    HistogramSnapshot renderWait;
+    HistogramSnapshot endToEnd;
+};
+
+}
@@ -1,13 +1,63 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <string>
 #include <vector>
+#include "AwaitableQueue.hpp"
+#include "CoroutineExecutor.hpp"
 #include "NetInputStream.hpp"
 #include "Decoder.hpp"
+#include "FrameCapture.hpp"
+#include "LoadGenerator.hpp"
+#include "PipelineConfig.hpp"
 #include "StreamRenderer.hpp"
+#include "UdpInputStream.hpp"
 
 namespace StreamSim::Net {
 
+// Where DemoProtocolServiceQueued gets its frames from: threads generating them, or real packets sent
+// to a loopback UDP port (see the LoopbackSender tool).  Udp is only available on POSIX systems.
+enum class IngestSource {
+    Simulated,
+    Udp
+};
+
+// Frames that came in but were never shown, by why they were let go.
+struct FrameDropStats {
+    uint64_t decodeQueue = 0;       // decode queue full, or late for the jitter buffer
+    uint64_t decodePool = 0;        // shed by the decode pool's admission policy
+    uint64_t decodeExpired = 0;     // B-frames past their deadline, never decoded
+    uint64_t renderQueue = 0;       // render queue full, or late for the reorder window
+    uint64_t renderExpired = 0;     // decoded, but past their deadline when they got to the renderer
+    uint64_t renderSuperseded = 0;  // a newer frame was due at the same vsync
+
+    uint64_t Total() const {
+        return decodeQueue + decodePool + decodeExpired + renderQueue + renderExpired + renderSuperseded;
+    }
+};
+
+// Where frames spent their time and where they got stuck or dropped, at the moment of the call.
+// Latencies: queueWait is ingest to decode start, decode is the decode itself, renderWait is decode end
+// to present and endToEnd is ingest to present.  Queue stats of services with one queue per stream are
+// summed over the streams (maxDepth is the largest), the same goes for render stats.
+struct PipelineStats {
+    Core::LatencySummary queueWait;
+    Core::LatencySummary decode;
+    Core::LatencySummary renderWait;
+    Core::LatencySummary endToEnd;
+
+    Core::QueueStats decodeQueue;
+    Core::QueueStats renderQueue;
+    // Only filled in by services decoding on a SimpleThreadPool.
+    Core::AdmissionStats decodePool;
+    // All zero unless decode.autoscale is on.
+    Core::AutoscaleStats decodeAutoscale;
+    Render::RenderStats render;
+    FrameDropStats drops;
+};
+
 class ProtocolService {
 public:
     ProtocolService() = default;
@@ -16,23 +66,46 @@ public:
     // Simulate the service to run.
     virtual bool Run() = 0;
 
-    // Shutdown the service.
+    // Shutdown the service.  Services are single-use: Shutdown closes the queues between the stages for good,
+    // so running the pipeline again takes a new service.
     virtual bool Shutdown() = 0;
+
+    // Merges the per-thread histograms and reads the gauges, can be called while running.
+    virtual PipelineStats GetStats() const = 0;
 };
 
 class DemoProtocolServiceQueued : public ProtocolService {
 private:
+    // Declared ahead of the queues: a replayed capture's reader lives in here, and frames still sitting in the
+    // queues point into its mapping.
+    LoadProfile m_loadProfile;
+
     // This buffer data is created once and will be reused throughout the lifetime of the application
-    std::unique_ptr<Core::AsyncByteFrameQueue> m_decodableBuffer;
-    std::unique_ptr<Core::AsyncByteFrameQueue> m_decodedBuffer;
+    // Incoming frames wait in the jitter buffer until their playout time, so uneven arrival doesn't
+    // turn into uneven decode and render.
+    // Every decode thread writes into the decoded buffer and only the renderer reads it, so it is the
+    // reordering window that hands frames to the renderer in display order.
+    std::unique_ptr<Core::JitterByteFrameQueue> m_decodableBuffer;
+    std::unique_ptr<Core::ByteFrameQueue> m_decodedBuffer;
 
     // Simulated thread with incoming streaming data which gets pushed into decodable buffer.
     std::size_t m_numIncomingDataThreads;
     uint32_t m_threadRunTime;
     std::vector<std::thread> m_incomingDataThreads;
+    Core::StagePlacement m_ingestPlacement;
+    std::chrono::steady_clock::time_point m_startTime;
 
     // Incoming data handler.
     DemoNetInputStreamHandler m_inputStreamHandler;
+    IngestSource m_ingestSource;
+    uint16_t m_udpPort;
+    std::unique_ptr<UdpInputStream> m_udpInputStream;
+    // Sits in front of the handler while recording.
+    std::unique_ptr<CaptureRecorder> m_captureRecorder;
+
+    NetInputStreamHandler& IngestHandler() {
+        return m_captureRecorder ? static_cast<NetInputStreamHandler&>(*m_captureRecorder) : m_inputStreamHandler;
+    }
     
     // Decode service.
     Core::FrameElementQueueDecodeService m_decodeService;
@@ -41,11 +114,31 @@ private:
     Render::FrameElementRenderHandler m_renderer;
     
 public:
-    DemoProtocolServiceQueued(std::size_t numThreads, uint32_t runTimeSec);
+    // config.numIngestThreads is the number of simulated ingest threads, it is ignored for Udp ingest.
+    // Rendered frames go to renderSink if given (non-owning), to the console otherwise.
+    explicit DemoProtocolServiceQueued(const Core::PipelineConfig& config,
+                                       IngestSource ingestSource = IngestSource::Simulated, uint16_t udpPort = DEFAULT_UDP_PORT,
+                                       Render::RenderSink* renderSink = nullptr);
+
+    // Default config apart from the ingest thread count and run time.
+    DemoProtocolServiceQueued(std::size_t numThreads, uint32_t runTimeSec,
+                              IngestSource ingestSource = IngestSource::Simulated, uint16_t udpPort = DEFAULT_UDP_PORT,
+                              Render::RenderSink* renderSink = nullptr);
     ~DemoProtocolServiceQueued() override;
 
     bool Run() override;
     bool Shutdown() override;
+    PipelineStats GetStats() const override;
+
+    // What the simulated ingest sends, takes effect on the next Run.  Each ingest thread runs a
+    // LoadGenerator with this profile, see there for how they split the stream.
+    void SetLoadProfile(const LoadProfile& profile) {
+        m_loadProfile = profile;
+    }
+
+    // Records every frame the ingest hands in into a capture file until Shutdown, call before Run.
+    // False if the file can't be created.
+    bool RecordCapture(const std::string& path);
 
     std::size_t GetNumDecodeBufferElements() const {
         return m_decodableBuffer->NumElements();
@@ -55,30 +148,68 @@ public:
         return m_decodedBuffer->NumElements();
     }
 
+    // Late frames and the delay the jitter buffer currently adds.
+    Core::JitterBufferStats GetJitterBufferStats() const {
+        return m_decodableBuffer->GetStats();
+    }
+
+    // Null unless the service was created with IngestSource::Udp.
+    const UdpInputStream* GetUdpInputStream() const {
+        return m_udpInputStream.get();
+    }
+
     DemoProtocolServiceQueued(const DemoProtocolServiceQueued&) = delete;
 };
 
 class DemoProtocolServicePooled : public ProtocolService {
 private:
+    // Ahead of the queues, like in DemoProtocolServiceQueued.
+    LoadProfile m_loadProfile;
+
     // This buffer data is created once and will be reused throughout the lifetime of the application
-    std::unique_ptr<Core::AsyncByteFrameQueue> m_decodedBuffer;
+    std::unique_ptr<Core::ByteFrameQueue> m_decodedBuffer;
 
     // Simulated thread with incoming streaming data which gets pushed into decodable buffer.
     std::size_t m_numIncomingDataThreads;
     uint32_t m_threadRunTime;
     std::vector<std::thread> m_incomingDataThreads;
+    Core::StagePlacement m_ingestPlacement;
+    std::chrono::steady_clock::time_point m_startTime;
 
     Core::FrameElementPoolDecoder m_poolDecoder;
+    std::unique_ptr<CaptureRecorder> m_captureRecorder;
 
     // Rendering service.
     Render::FrameElementRenderHandler m_renderer;
 
+    NetInputStreamHandler& IngestHandler() {
+        return m_captureRecorder ? static_cast<NetInputStreamHandler&>(*m_captureRecorder) : m_poolDecoder;
+    }
+
 public:
-    DemoProtocolServicePooled(std::size_t numThreads, uint32_t runTimeSec);
+    explicit DemoProtocolServicePooled(const Core::PipelineConfig& config,
+                                       Core::DecodePoolType poolType = Core::DecodePoolType::Simple,
+                                       Render::RenderSink* renderSink = nullptr);
+
+    // Default config apart from the ingest thread count and run time.
+    DemoProtocolServicePooled(std::size_t numThreads, uint32_t runTimeSec,
+                              Core::DecodePoolType poolType = Core::DecodePoolType::Simple,
+                              Render::RenderSink* renderSink = nullptr);
     ~DemoProtocolServicePooled() override;
 
     bool Run() override;
     bool Shutdown() override;
+    PipelineStats GetStats() const override;
+
+    // What the simulated ingest sends, takes effect on the next Run.  Each ingest thread runs a
+    // LoadGenerator with this profile, see there for how they split the stream.
+    void SetLoadProfile(const LoadProfile& profile) {
+        m_loadProfile = profile;
+    }
+
+    // Records every frame the ingest hands in into a capture file until Shutdown, call before Run.
+    // False if the file can't be created.
+    bool RecordCapture(const std::string& path);
 
     std::size_t GetNumDecodedBufferElements() const {
         return m_decodedBuffer->NumElements();
@@ -87,4 +218,145 @@ public:
     DemoProtocolServicePooled(const DemoProtocolServicePooled&) = delete;
 };
 
+// Several users in one call, each sending their own stream.  Every stream has its own sequence numbers,
+// reorder queue and renderer, while the decode workers are shared: they take frames from a
+// FairShareQueue, so a heavy stream gets at most its weighted share of the decoders and can't starve
+// the others.  In this demo stream 0 is the heavy one and sends HEAVY_STREAM_RATE times as many frames.
+class DemoProtocolServiceMultiStream : public ProtocolService {
+private:
+    static constexpr std::size_t HEAVY_STREAM_RATE = 4;
+
+    // Ahead of the queues, like in DemoProtocolServiceQueued.
+    LoadProfile m_loadProfile;
+
+    std::unique_ptr<Core::FairShareByteFrameQueue> m_decodableBuffer;
+    std::vector<std::unique_ptr<Core::ByteFrameQueue>> m_decodedBuffers;
+
+    // Simulated thread per stream with incoming streaming data.
+    std::size_t m_numStreams;
+    uint32_t m_threadRunTime;
+    std::vector<std::thread> m_incomingDataThreads;
+    Core::StagePlacement m_ingestPlacement;
+    std::chrono::steady_clock::time_point m_startTime;
+
+    DemoNetInputStreamHandler m_inputStreamHandler;
+
+    // Shared decode service.
+    Core::FrameElementQueueDecodeService m_decodeService;
+
+    // One rendering service per stream.
+    std::vector<std::unique_ptr<Render::FrameElementRenderHandler>> m_renderers;
+
+public:
+    // There are config.numIngestThreads streams, decode_queue.capacity is the ring size of each of them.
+    // weights[streamId] is that stream's share of the decoders, streams without an entry get 1.
+    explicit DemoProtocolServiceMultiStream(const Core::PipelineConfig& config, const std::vector<uint32_t>& weights = {});
+
+    // Default config apart from the number of streams and run time.
+    DemoProtocolServiceMultiStream(std::size_t numStreams, uint32_t runTimeSec, const std::vector<uint32_t>& weights = {});
+    ~DemoProtocolServiceMultiStream() override;
+
+    bool Run() override;
+    bool Shutdown() override;
+    PipelineStats GetStats() const override;
+
+    // Profile of every stream, with its own stream id and seed.  Stream 0 sends HEAVY_STREAM_RATE times the rate.
+    void SetLoadProfile(const LoadProfile& profile) {
+        m_loadProfile = profile;
+    }
+
+    std::size_t GetNumDecodeBufferElements() const {
+        return m_decodableBuffer->NumElements();
+    }
+
+    std::size_t GetNumDecodedBufferElements(uint32_t streamId) const {
+        return m_decodedBuffers[streamId]->NumElements();
+    }
+
+    DemoProtocolServiceMultiStream(const DemoProtocolServiceMultiStream&) = delete;
+};
+
+// The whole pipeline as coroutines on one small CoroutineExecutor instead of threads per stage, for many light
+// streams.  Every stream is an ingest, a decode and a render coroutine with an AwaitableQueue between each two,
+// so a stage waiting for frames or for room is a suspended coroutine rather than a parked thread, and the thread
+// count stays at executor.threads however many streams there are.
+// A stream decodes its frames one at a time in decode order, so references are always decoded first, and its
+// render coroutine puts them back in display order with a ReorderWindow, skipping a missing frame the same way a
+// SequenceReorderQueue does.  Sinks aren't made for several renderers at once, so the render coroutines hand
+// their frames to one present coroutine, the only one that touches the sink.  A slow sink holds up that one
+// coroutine and its thread, the other streams carry on until the present queue is full.
+class DemoProtocolServiceCoroutine : public ProtocolService {
+private:
+    using FrameQueue = Core::AwaitableQueue<Core::ByteFrameElement>;
+
+    struct StreamQueues {
+        std::unique_ptr<FrameQueue> decodeQueue;
+        std::unique_ptr<FrameQueue> renderQueue;
+    };
+
+    std::size_t m_numStreams;
+    uint32_t m_threadRunTime;
+    std::chrono::milliseconds m_frameDeadline;
+    std::size_t m_reorderWindow;
+    LoadProfile m_loadProfile;
+    std::chrono::steady_clock::time_point m_startTime;
+
+    Core::CoroutineExecutor m_executor;
+    std::vector<StreamQueues> m_streams;
+    Core::DemoDecoder m_decoder;
+
+    std::unique_ptr<Render::RenderSink> m_defaultSink;
+    Render::RenderSink* m_sink;
+    // Every stream's frames on their way to the sink, in display order per stream.  The last render coroutine
+    // to finish closes it.
+    std::unique_ptr<FrameQueue> m_presentQueue;
+    std::atomic<std::size_t> m_numRendering{0};
+
+    // Shared by every stream, the executor only has a few threads to write them.
+    Core::DecodeLatencyHistograms m_decodeLatency;
+    Core::RenderLatencyHistograms m_renderLatency;
+    std::atomic<uint64_t> m_framesDecodeExpired{0};
+    std::atomic<uint64_t> m_framesPresented{0};
+    std::atomic<uint64_t> m_framesRenderExpired{0};
+    std::atomic<uint64_t> m_framesReorderDropped{0};
+
+    Core::CoTask IngestStream(StreamQueues& stream, LoadProfile profile);
+    Core::CoTask DecodeStream(StreamQueues& stream);
+    Core::CoTask RenderStream(StreamQueues& stream);
+    Core::CoTask PresentFrames();
+    void Present(const Core::ByteFrameElement& frame);
+
+public:
+    // There are config.numIngestThreads streams, decode_queue.capacity and render_queue.capacity are the sizes of
+    // each stream's queues.  Rendered frames go to renderSink if given (non-owning), to the console otherwise.
+    explicit DemoProtocolServiceCoroutine(const Core::PipelineConfig& config, Render::RenderSink* renderSink = nullptr);
+
+    // Default config apart from the number of streams and run time.
+    DemoProtocolServiceCoroutine(std::size_t numStreams, uint32_t runTimeSec, Render::RenderSink* renderSink = nullptr);
+    ~DemoProtocolServiceCoroutine() override;
+
+    bool Run() override;
+    bool Shutdown() override;
+    PipelineStats GetStats() const override;
+
+    // Profile of every stream, with its own stream id and seed.
+    void SetLoadProfile(const LoadProfile& profile) {
+        m_loadProfile = profile;
+    }
+
+    Core::ExecutorStats GetExecutorStats() {
+        return m_executor.GetStats();
+    }
+
+    std::size_t GetNumDecodeBufferElements(uint32_t streamId) const {
+        return m_streams[streamId].decodeQueue->NumElements();
+    }
+
+    std::size_t GetNumDecodedBufferElements(uint32_t streamId) const {
+        return m_streams[streamId].renderQueue->NumElements();
+    }
+
+    DemoProtocolServiceCoroutine(const DemoProtocolServiceCoroutine&) = delete;
+};
+
 }
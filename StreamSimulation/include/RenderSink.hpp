@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "ConcurrentData.hpp"
+#include "FrameData.hpp"
+
+namespace StreamSim::Render {
+
+constexpr uint32_t DEFAULT_REFRESH_RATE_HZ = 60;
+
+// Immediate renders every frame as soon as it is decoded.  Paced presents on a simulated vsync tick:
+// at every tick the newest frame whose timestamp is due is shown, older due frames are dropped unseen,
+// and when nothing new is due the previous frame stays on screen for another refresh.
+// Either way a frame past its deadline (FrameMetadata::deadlineNs) is discarded instead of shown late.
+enum class RenderMode {
+    Immediate,
+    Paced
+};
+
+// Where FrameElementRenderHandler puts the frames it presents.  Present is called from the render
+// thread only, so a sink used by one renderer doesn't need to be thread safe.  Flush is called once
+// the renderer has presented its last frame.
+class RenderSink {
+public:
+    virtual ~RenderSink() = default;
+    virtual void Present(const Core::ByteFrameElement& frame) = 0;
+    virtual void Flush() {}
+};
+
+// Prints the frame value, one line per frame, like the demo always did.  Lines are not flushed one by
+// one, only on Flush.  All console sinks share one lock so several renderers don't interleave lines.
+class ConsoleRenderSink : public RenderSink {
+public:
+    void Present(const Core::ByteFrameElement& frame) override;
+    void Flush() override;
+};
+
+// Throws frames away, for measuring the pipeline without any output cost.
+class NullRenderSink : public RenderSink {
+private:
+    std::atomic<uint64_t> m_numFrames{0};
+
+public:
+    void Present(const Core::ByteFrameElement&) override {
+        m_numFrames.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t NumFrames() const {
+        return m_numFrames.load(std::memory_order_relaxed);
+    }
+};
+
+// FNV-1a over what identifies a decoded frame: stream, display position, value and payload bytes.
+uint64_t ChecksumFrame(const Core::ByteFrameElement& frame);
+
+// Writes one line per frame ("stream displayOrder sequence value checksum") to a file without ever
+// blocking the render thread on I/O: Present only pushes a small record into a lock-free SPSC ring and
+// a background thread formats and writes them through a large stdio buffer.  If the writer falls a
+// whole ring behind, Present waits for it rather than losing frames.
+class AsyncFileRenderSink : public RenderSink {
+public:
+    static constexpr std::size_t RING_SIZE = 4096;
+    static constexpr std::size_t WRITE_BATCH_SIZE = 256;
+    static constexpr std::size_t FILE_BUFFER_SIZE = 1 << 16;
+
+private:
+    struct Record {
+        uint32_t streamId = 0;
+        uint64_t displayOrder = 0;
+        uint64_t sequence = 0;
+        uint8_t data = 0;
+        uint64_t checksum = 0;
+    };
+
+    std::FILE* m_file = nullptr;
+    Core::SpscRingBufferQueue<Record, RING_SIZE, 0> m_ring;
+    std::thread m_writerThread;
+    uint64_t m_numPresented = 0;
+    std::atomic<uint64_t> m_numWritten{0};
+
+    void WriterLoop();
+
+public:
+    explicit AsyncFileRenderSink(const std::string& path);
+    ~AsyncFileRenderSink() override;
+
+    AsyncFileRenderSink(const AsyncFileRenderSink&) = delete;
+    AsyncFileRenderSink& operator=(const AsyncFileRenderSink&) = delete;
+
+    bool IsOpen() const {
+        return m_file != nullptr;
+    }
+
+    void Present(const Core::ByteFrameElement& frame) override;
+
+    // Waits until every frame presented so far is in the file.
+    void Flush() override;
+
+    uint64_t NumFramesWritten() const {
+        return m_numWritten.load(std::memory_order_acquire);
+    }
+};
+
+// Checks what comes out of the pipeline instead of showing it.  Every frame is folded into an order
+// sensitive digest, so two runs that rendered the same frames in the same order end with the same
+// digest, and frames that come out of display order or carry an empty payload are counted.
+class ChecksumRenderSink : public RenderSink {
+private:
+    struct StreamState {
+        bool hasFrame = false;
+        uint64_t lastDisplayOrder = 0;
+    };
+
+    uint64_t m_digest = 14695981039346656037ull;
+    uint64_t m_numFrames = 0;
+    uint64_t m_numOutOfOrder = 0;
+    uint64_t m_numEmptyPayloads = 0;
+    std::unordered_map<uint32_t, StreamState> m_streams;
+
+public:
+    void Present(const Core::ByteFrameElement& frame) override;
+
+    uint64_t GetDigest() const {
+        return m_digest;
+    }
+
+    uint64_t NumFrames() const {
+        return m_numFrames;
+    }
+
+    uint64_t NumOutOfOrder() const {
+        return m_numOutOfOrder;
+    }
+
+    uint64_t NumEmptyPayloads() const {
+        return m_numEmptyPayloads;
+    }
+};
+
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <memory>
+
+namespace StreamSim::Core {
+
+constexpr uint32_t DEFAULT_REORDER_HOLD_TIME_IN_MILISEC = 50;
+
+// Frames given up on by a SequenceReorderQueue or a ReorderWindow.
+struct ReorderStats {
+    uint64_t skipped = 0;       // positions passed over because the frame never showed up in time
+    uint64_t late = 0;          // frames that showed up after their position was skipped
+    uint64_t duplicates = 0;    // frames written twice
+};
+
+// Number of display positions a reorder window covers, window rounded up to a power of two of at least 2.
+inline std::size_t ReorderWindowSize(std::size_t window) {
+    return std::bit_ceil(std::max<std::size_t>(window, 2));
+}
+
+// When to give up on the next frame in display order while later ones are already there: after holdTime
+// of waiting on it, or right away once nothing more is coming.  The timer keeps running over gaps that
+// follow each other, it only starts over once a frame is taken.  Reader side only.
+class ReorderGapHold {
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    bool m_isWaiting = false;
+    Clock::time_point m_start;
+    std::chrono::microseconds m_holdTime;
+
+public:
+    explicit ReorderGapHold(std::chrono::microseconds holdTime)
+    : m_holdTime(holdTime) {}
+
+    // Called each time the reader finds itself stuck on a gap, true once it should skip it.
+    bool IsOver(Clock::time_point now, bool isClosed) {
+        if (!m_isWaiting) {
+            m_isWaiting = true;
+            m_start = now;
+        }
+        return isClosed || now - m_start >= m_holdTime;
+    }
+
+    // The reader got a frame, or there's no gap since nothing after it has arrived.
+    void Reset() {
+        m_isWaiting = false;
+    }
+
+    bool IsWaiting() const {
+        return m_isWaiting;
+    }
+
+    // When the gap being waited on gets skipped.
+    Clock::time_point Deadline() const {
+        return m_start + m_holdTime;
+    }
+};
+
+// SequenceReorderQueue without the queue, for a reader that adds the frames itself, like a coroutine reading
+// them off another queue.  Frames go in the slot for their display position (meta.displayOrder) within the
+// window, and come out in order with gaps skipped the same way (see ReorderGapHold).  Nothing waits here, a
+// frame ahead of the window is handed back and the caller decides whether to skip ahead for it.
+// Not thread safe.
+template <typename T>
+class ReorderWindow {
+public:
+    enum class AddResult {
+        Stored,
+        Late,           // its position was already shown or skipped, the frame is dropped
+        Duplicate,      // its position already holds a frame, the frame is dropped
+        AheadOfWindow   // not stored, Take(data, true) until it fits
+    };
+
+private:
+    struct Slot {
+        bool isFull = false;
+        T data;
+    };
+
+    const std::size_t m_capacity;
+    const std::size_t m_indexMask;
+    std::unique_ptr<Slot[]> m_slots;
+
+    uint64_t m_next = 0;
+    uint64_t m_highestSeen = 0;     // highest position added, plus one
+    std::size_t m_numElements = 0;
+    ReorderGapHold m_gap;
+    ReorderStats m_stats;
+
+public:
+    explicit ReorderWindow(std::size_t window,
+                           std::chrono::microseconds holdTime = std::chrono::milliseconds(DEFAULT_REORDER_HOLD_TIME_IN_MILISEC))
+    : m_capacity(ReorderWindowSize(window))
+    , m_indexMask(m_capacity - 1)
+    , m_slots(std::make_unique<Slot[]>(m_capacity))
+    , m_gap(holdTime) {}
+
+    AddResult Add(const T& data) {
+        const uint64_t position = data.meta.displayOrder;
+        m_highestSeen = std::max(m_highestSeen, position + 1);
+
+        if (position < m_next) {
+            ++m_stats.late;
+            return AddResult::Late;
+        }
+        if (position - m_next >= m_capacity) {
+            return AddResult::AheadOfWindow;
+        }
+
+        Slot& slot = m_slots[position & m_indexMask];
+        if (slot.isFull) {
+            ++m_stats.duplicates;
+            return AddResult::Duplicate;
+        }
+        slot.data = data;
+        slot.isFull = true;
+        ++m_numElements;
+        return AddResult::Stored;
+    }
+
+    // Next frame in display order, if it's there or the gap in front of it has been held long enough.
+    // isClosed skips gaps right away, for draining the window or making room for a frame ahead of it.
+    bool Take(T& data, bool isClosed = false) {
+        while (true) {
+            Slot& slot = m_slots[m_next & m_indexMask];
+            if (slot.isFull) {
+                data = std::move(slot.data);
+                slot.isFull = false;
+                ++m_next;
+                --m_numElements;
+                m_gap.Reset();
+                return true;
+            }
+
+            if (m_highestSeen <= m_next + 1) {
+                m_gap.Reset();
+                return false;
+            }
+            if (!m_gap.IsOver(ReorderGapHold::Clock::now(), isClosed)) {
+                return false;
+            }
+
+            // With nothing in the window, every position up to the highest one seen is a gap.
+            const uint64_t skipTo = m_numElements == 0 ? m_highestSeen - 1 : m_next + 1;
+            m_stats.skipped += skipTo - m_next;
+            m_next = skipTo;
+        }
+    }
+
+    // Next display position the reader is waiting for.
+    uint64_t NextPosition() const {
+        return m_next;
+    }
+
+    std::size_t NumElements() const {
+        return m_numElements;
+    }
+
+    std::size_t Capacity() const {
+        return m_capacity;
+    }
+
+    bool IsEmpty() const {
+        return m_numElements == 0;
+    }
+
+    const ReorderStats& GetStats() const {
+        return m_stats;
+    }
+};
+
+}
@@ -0,0 +1,280 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <memory>
+#include <span>
+
+#include "ConcurrentData.hpp"
+#include "ReorderWindow.hpp"
+
+namespace StreamSim::Core {
+
+// Puts frames of one stream back in display order (meta.displayOrder) after several threads decoded them.
+// Writers drop each frame straight into the slot for its position in a window of N positions that starts
+// at the next position the reader expects, so any number of writers can fill the window with a single
+// CAS per frame and no lock.  The one reader takes the slots in order.
+// When the next frame is missing but later ones are already there, the reader holds them for up to
+// holdTime and then skips the gap (see ReorderGapHold), so a frame lost upstream costs one hold time
+// instead of stalling the stream.  A frame showing up after its position was skipped is dropped and counted as late.
+// Writes beyond the window wait for the reader like a full queue.  Once closed, gaps are skipped right
+// away so the reader can drain everything that's left.
+// The window defaults to N and is rounded up to a power of two of at least 2.
+template <typename T, std::size_t N, uint32_t DefaultWaitSec = 2>
+class SequenceReorderQueue : public BufferQueue<T> {
+private:
+    // A slot's state is 0 when empty, position + 1 when it holds that frame, WRITING while a writer fills
+    // it, and position + 1 with SKIPPED_BIT when the reader gave up on that position.  Claiming a position
+    // is a CAS on the state, which is how a writer and a reader skipping that same position agree on who won.
+    static constexpr uint64_t WRITING = ~0ull;
+    static constexpr uint64_t SKIPPED_BIT = 1ull << 63;
+
+    struct Slot {
+        std::atomic<uint64_t> state{0};
+        T data;
+    };
+
+    // Reader side.
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> m_next{0};
+    ReorderGapHold m_gap;
+    std::atomic<uint64_t> m_skipped{0};
+
+    // Writer side.
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> m_highestSeen{0};
+    std::atomic<std::size_t> m_numElements{0};
+    std::atomic<uint64_t> m_late{0};
+    std::atomic<uint64_t> m_duplicates{0};
+
+    alignas(CACHE_LINE_SIZE) EventCount m_notEmpty;
+    EventCount m_notFull;
+    std::atomic_bool m_closed{false};
+
+    const std::size_t m_capacity;
+    const std::size_t m_indexMask;
+    const QueueWaitPolicy m_wait;
+
+    std::unique_ptr<Slot[]> m_slots;
+
+    // Returns false only when the frame is too far ahead of the reader, every other frame is either
+    // stored or dropped as late / duplicate.
+    bool TryWrite(const T& data) {
+        const uint64_t position = data.meta.displayOrder;
+
+        uint64_t highest = m_highestSeen.load(std::memory_order_relaxed);
+        while (highest < position + 1 &&
+               !m_highestSeen.compare_exchange_weak(highest, position + 1, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+
+        const uint64_t next = m_next.load(std::memory_order_acquire);
+        if (position < next) {
+            m_late.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        if (position - next >= m_capacity) {
+            return false;
+        }
+
+        Slot& slot = m_slots[position & m_indexMask];
+        uint64_t state = slot.state.load(std::memory_order_acquire);
+        while (true) {
+            // Skip markers left by earlier laps don't count, the slot is free for this lap.
+            const bool isFree = state == 0 ||
+                                (state != WRITING && (state & SKIPPED_BIT) != 0 && (state & ~SKIPPED_BIT) < position + 1);
+            if (!isFree) {
+                if (state == ((position + 1) | SKIPPED_BIT)) {
+                    m_late.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    m_duplicates.fetch_add(1, std::memory_order_relaxed);
+                }
+                return true;
+            }
+            if (slot.state.compare_exchange_weak(state, WRITING, std::memory_order_acquire, std::memory_order_acquire)) {
+                break;
+            }
+        }
+
+        slot.data = data;
+        slot.state.store(position + 1, std::memory_order_release);
+        m_numElements.fetch_add(1, std::memory_order_relaxed);
+        m_notEmpty.NotifyOne();
+        return true;
+    }
+
+    // Reader only.
+    bool TryRead(T& data) {
+        while (true) {
+            const uint64_t next = m_next.load(std::memory_order_relaxed);
+            Slot& slot = m_slots[next & m_indexMask];
+            uint64_t state = slot.state.load(std::memory_order_acquire);
+
+            if (state == next + 1) {
+                data = std::move(slot.data);
+                slot.state.store(0, std::memory_order_release);
+                m_next.store(next + 1, std::memory_order_release);
+                m_numElements.fetch_sub(1, std::memory_order_relaxed);
+                m_gap.Reset();
+                m_notFull.NotifyAll();
+                return true;
+            }
+
+            // Either being written right now, or nothing after it has arrived, so there is no gap yet.
+            if (state == WRITING || m_highestSeen.load(std::memory_order_acquire) <= next + 1) {
+                m_gap.Reset();
+                return false;
+            }
+            if (!m_gap.IsOver(EventCount::Clock::now(), m_closed.load(std::memory_order_acquire))) {
+                return false;
+            }
+
+            // Give up on this position, unless a writer claimed it in the meantime.
+            if (slot.state.compare_exchange_strong(state, (next + 1) | SKIPPED_BIT, std::memory_order_acq_rel)) {
+                m_next.store(next + 1, std::memory_order_release);
+                m_skipped.fetch_add(1, std::memory_order_relaxed);
+                m_notFull.NotifyAll();
+            }
+        }
+    }
+
+    std::size_t TryReadBatch(std::span<T> data, std::size_t max) {
+        const std::size_t limit = std::min(max, data.size());
+        std::size_t numRead = 0;
+        while (numRead < limit && TryRead(data[numRead])) {
+            ++numRead;
+        }
+        return numRead;
+    }
+
+    // Like SpinThenWait, but also wakes up when the hold time of the gap the reader is stuck on runs out.
+    template <typename TryOp>
+    bool WaitToRead(TryOp tryOp) {
+        const auto deadline = m_wait.timeout.count() == 0 ? EventCount::Clock::time_point::max()
+                                                          : EventCount::Clock::now() + m_wait.timeout;
+        while (true) {
+            const uint32_t key = m_notEmpty.PrepareWait();
+            if (tryOp()) {
+                m_notEmpty.CancelWait();
+                return true;
+            }
+            if (m_closed.load(std::memory_order_acquire)) {
+                m_notEmpty.CancelWait();
+                return tryOp();
+            }
+
+            auto wakeUp = deadline;
+            if (m_gap.IsWaiting()) {
+                wakeUp = std::min(wakeUp, m_gap.Deadline());
+            }
+            if (!m_notEmpty.Wait(key, wakeUp) && EventCount::Clock::now() >= deadline) {
+                return tryOp();
+            }
+        }
+    }
+
+public:
+    explicit SequenceReorderQueue(std::chrono::microseconds holdTime = std::chrono::milliseconds(DEFAULT_REORDER_HOLD_TIME_IN_MILISEC))
+    : SequenceReorderQueue(N, { std::chrono::seconds(DefaultWaitSec) }, holdTime) {}
+
+    SequenceReorderQueue(std::size_t window, QueueWaitPolicy wait = { std::chrono::seconds(DefaultWaitSec) },
+                         std::chrono::microseconds holdTime = std::chrono::milliseconds(DEFAULT_REORDER_HOLD_TIME_IN_MILISEC))
+    : m_gap(holdTime)
+    , m_capacity(ReorderWindowSize(window))
+    , m_indexMask(m_capacity - 1)
+    , m_wait(wait)
+    , m_slots(std::make_unique<Slot[]>(m_capacity)) {}
+
+    bool WriteSync(const T& data) override {
+        if (m_closed.load(std::memory_order_acquire)) {
+            return false;
+        }
+        return SpinThenWait(m_notFull, m_closed, m_wait, [&] { return TryWrite(data); });
+    }
+
+    // Must only be called from the single reader thread.
+    bool ReadAsync(T& data) override {
+        return TryRead(data);
+    }
+
+    // Must only be called from the single reader thread.
+    bool ReadSync(T& data) override {
+        return WaitToRead([&] { return TryRead(data); });
+    }
+
+    // Frames can land anywhere in the window, so a batch is just one write per frame.
+    std::size_t WriteBatch(std::span<const T> data) override {
+        std::size_t written = 0;
+        while (written < data.size() && WriteSync(data[written])) {
+            ++written;
+        }
+        return written;
+    }
+
+    // Must only be called from the single reader thread.
+    std::size_t ReadBatchAsync(std::span<T> data, std::size_t max) override {
+        return TryReadBatch(data, max);
+    }
+
+    // Must only be called from the single reader thread.
+    std::size_t ReadBatch(std::span<T> data, std::size_t max) override {
+        std::size_t read = 0;
+        WaitToRead([&] {
+            read = TryReadBatch(data, max);
+            return read > 0;
+        });
+        return read;
+    }
+
+    // Frames that arrived and haven't been read yet, in order or not.  A snapshot like the other queues.
+    std::size_t NumElements() override {
+        return m_numElements.load(std::memory_order_acquire);
+    }
+
+    std::size_t Capacity() const override {
+        return m_capacity;
+    }
+
+    bool IsFull() override {
+        return NumElements() >= m_capacity;
+    }
+
+    bool IsEmpty() override {
+        return NumElements() == 0;
+    }
+
+    void Close() override {
+        m_closed.store(true, std::memory_order_release);
+        m_notEmpty.NotifyAll();
+        m_notFull.NotifyAll();
+    }
+
+    bool IsClosed() override {
+        return m_closed.load(std::memory_order_acquire);
+    }
+
+    // Next display position the reader is waiting for.
+    uint64_t NextPosition() const {
+        return m_next.load(std::memory_order_acquire);
+    }
+
+    // Late and duplicate frames are the ones this queue drops, skipped positions never held a frame.
+    QueueStats GetQueueStats() override {
+        QueueStats stats;
+        stats.depth = NumElements();
+        stats.dropped = m_late.load(std::memory_order_relaxed) + m_duplicates.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    ReorderStats GetStats() const {
+        ReorderStats stats;
+        stats.skipped = m_skipped.load(std::memory_order_relaxed);
+        stats.late = m_late.load(std::memory_order_relaxed);
+        stats.duplicates = m_duplicates.load(std::memory_order_relaxed);
+        return stats;
+    }
+};
+
+}
@@ -1,10 +1,27 @@
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
 #include "FrameData.hpp"
+#include "PipelineConfig.hpp"
+#include "RenderSink.hpp"
 
 namespace StreamSim::Render {
 
+struct RenderStats {
+    uint64_t framesPresented = 0;
+    uint64_t framesDropped = 0;         // superseded by a newer due frame before their vsync came
+    uint64_t framesExpired = 0;         // decoded, but past their deadline by the time they could be shown
+    uint64_t framesDuplicated = 0;      // vsyncs that showed the previous frame again
+    uint64_t vsyncs = 0;
+    uint64_t meanPresentJitterUs = 0;   // average distance of present-to-present intervals from the refresh period
+    uint64_t maxPresentJitterUs = 0;
+};
+
 // This class demonstrates how the decoded frame element data gets read and passed into
 // imaginary renderer which handles all decoded video stream rendering.
 // There class assume that there is a dedicated rendering thread that recevies frames from
@@ -12,21 +29,56 @@ namespace StreamSim::Render {
 // correct user (in case of multiple users with video call), etc.
 class FrameElementRenderHandler {
 private:
+    static constexpr std::size_t RENDER_BATCH_SIZE = 32;
+    // Decoded frames held for a later vsync, reading stops when this many are waiting.
+    static constexpr std::size_t MAX_PENDING_FRAMES = 128;
+    // A frame due further out than this means the timestamps jumped, the display clock starts over.
+    static constexpr uint32_t MAX_PRESENT_AHEAD_IN_MILISEC = 1000;
+
     // This is non-owning raw pointer.
-    Core::AsyncByteFrameQueue* m_readBuffer;
+    Core::ByteFrameQueue* m_readBuffer;
+    RenderMode m_mode;
+    uint32_t m_refreshRateHz;
+    Core::CpuSet m_cpus;
     std::thread m_renderThread;
     std::atomic_bool m_isRunning;
+
+    std::atomic<uint64_t> m_framesPresented{0};
+    std::atomic<uint64_t> m_framesDropped{0};
+    std::atomic<uint64_t> m_framesExpired{0};
+    std::atomic<uint64_t> m_framesDuplicated{0};
+    std::atomic<uint64_t> m_vsyncs{0};
+    std::atomic<uint64_t> m_totalPresentJitterUs{0};
+    std::atomic<uint64_t> m_maxPresentJitterUs{0};
+    // Only written by the render thread.
+    Core::RenderLatencyHistograms m_latency;
     
-    // For debugging purpose.
-    std::mutex m_printMtx;
-    void PrintByteFrameElement(const StreamSim::Core::ByteFrameElement& frame);
+    // Where presented frames go.  Console unless another sink was given, which is non-owning.
+    std::unique_ptr<RenderSink> m_defaultSink;
+    RenderSink* m_sink;
+
+    void Present(const Core::ByteFrameElement& frame);
+    // True for a frame that shouldn't be shown anymore, either given up on by the decoder or past its deadline.
+    bool Discard(const Core::ByteFrameElement& frame, uint64_t nowNs);
+    void ImmediateRenderLoop();
+    void PacedRenderLoop();
     
 public:
-    FrameElementRenderHandler(Core::AsyncByteFrameQueue* frameReadBuffer);
+    FrameElementRenderHandler(Core::ByteFrameQueue* frameReadBuffer, RenderMode mode = RenderMode::Immediate,
+                              uint32_t refreshRateHz = DEFAULT_REFRESH_RATE_HZ, RenderSink* sink = nullptr,
+                              Core::CpuSet cpus = Core::CpuSet());
     ~FrameElementRenderHandler();
 
     void Run();
+    // The queue belongs to whoever made it, so closing it is up to them.  The render thread shows what is left and
+    // stops once the queue is closed and drained, or once it is empty after Shutdown was called.  The wait for an
+    // open queue to come up empty is the queue's read timeout, so owners close it first to stop right away.
     void Shutdown();
+
+    RenderStats GetStats() const;
+
+    // Decoded-to-presented and ingest-to-presented time of every presented frame.
+    Core::RenderLatencySnapshot GetLatencySnapshot() const;
 };
 
 }
@@ -2,9 +2,14 @@
 #include <cstdint>
 #include <mutex>
 #include <condition_variable>
-#include <queue>
+#include <optional>
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <concepts>
+#include <utility>
+#include <thread>
+#include <vector>
 
 #pragma once
 
@@ -17,50 +22,222 @@ concept Callable = requires(Func f) {
     { f() } -> std::same_as<void>;
 };
 
+// A task that has to run by a certain time, DeadlineNs is on the PipelineNowNs clock and 0 means no deadline.
+template <typename Func>
+concept HasDeadline = requires(const Func& f) {
+    { f.DeadlineNs() } -> std::convertible_to<uint64_t>;
+};
+
+// A task that wants to know when the pool throws it away instead of running it, so whatever waits for its
+// result can stop waiting.  Discard is called without the pool's lock held.
+template <typename Func>
+concept HasDiscard = requires(Func& f) {
+    { f.Discard() } -> std::same_as<void>;
+};
+
+// What Enqueue does once the pool is at capacity.
+enum class AdmissionPolicy {
+    Block,       // Wait until a worker frees up a slot.
+    Reject,      // Refuse the new task and tell the caller.
+    DropOldest,  // Throw away the task that would run next (the oldest, or the earliest deadline) and queue the new one.
+    DropNewest   // Throw away the new task.
+};
+
+enum class EnqueueStatus {
+    Accepted,
+    Rejected,
+    DroppedOldest,
+    DroppedNewest,
+    Stopped
+};
+
+struct AdmissionStats {
+    uint64_t accepted = 0;
+    uint64_t rejected = 0;
+    uint64_t droppedOldest = 0;
+    uint64_t droppedNewest = 0;
+    // Number of Enqueue calls that had to wait for space under AdmissionPolicy::Block.
+    uint64_t blocked = 0;
+    // Tasks waiting for a worker right now, and the most that ever waited.
+    std::size_t queued = 0;
+    std::size_t maxQueued = 0;
+};
+
 // Super simplisitc thread pool class.
 // This doesn't do anything fancy, it's only done this way to demonstrate how thread pool can be used to decode streaming video.
+// At most capacity tasks wait in the queue, what happens past that is decided by the AdmissionPolicy.
+// Tasks with a deadline (see HasDeadline) run earliest deadline first, everything else in the order it
+// was queued, after the tasks that have a deadline.  Note the demo pipelines give every frame the same
+// ingest + frame_deadline_ms budget (see StampIngest), so their decode tasks' deadlines go up in ingest
+// order and EDF comes out as plain FIFO there.  It only reorders tasks whose budgets differ.
+// N is the default for both the number of threads and the capacity.
 template <Callable Func, std::size_t N>
 class SimpleThreadPool {
 private:
-    std::size_t m_numThreads;
-    std::array<std::thread, N> m_workers;
+    std::vector<std::thread> m_workers;
     std::mutex m_mutex;
     std::condition_variable m_cv;
+    std::condition_variable m_spaceCv;
+    std::condition_variable m_parkCv;
 
-    std::queue<Func> m_tasks;
+    // Where a queued task sits in m_tasks, ordered by deadline and then by when it was queued.
+    struct QueuedTask {
+        uint64_t deadlineNs;
+        uint64_t order;
+        std::size_t slot;
+    };
 
-    // If there are more worker tasks than allowed number of tasks, this gets queued up and gets added when it can be added.
-    std::queue<Func> m_tasksToBeAdded;
+    // Fixed slots allocated up front, so queueing a task never allocates and tasks are only ever moved
+    // in and out.  m_queue is a heap over the occupied slots, m_freeSlots holds the others.
+    std::vector<std::optional<Func>> m_tasks;
+    std::vector<std::size_t> m_freeSlots;
+    std::vector<QueuedTask> m_queue;
+    uint64_t m_nextOrder = 0;
+    std::size_t m_numTasks = 0;
 
+    AdmissionPolicy m_admissionPolicy;
     bool m_isRunning;
+    // Workers with a lower index take tasks, the rest are parked.  Written under m_mutex.
+    std::atomic<std::size_t> m_numActive;
+
+    std::atomic<uint64_t> m_numAccepted{0};
+    std::atomic<uint64_t> m_numRejected{0};
+    std::atomic<uint64_t> m_numDroppedOldest{0};
+    std::atomic<uint64_t> m_numDroppedNewest{0};
+    std::atomic<uint64_t> m_numBlocked{0};
+    std::atomic<std::size_t> m_queueDepth{0};
+    std::atomic<std::size_t> m_maxQueueDepth{0};
+
+    static uint64_t TaskDeadline(const Func& function) {
+        if constexpr (HasDeadline<Func>) {
+            const uint64_t deadlineNs = function.DeadlineNs();
+            return deadlineNs != 0 ? deadlineNs : UINT64_MAX;
+        } else {
+            return UINT64_MAX;
+        }
+    }
+
+    static void Discard(Func& function) {
+        if constexpr (HasDiscard<Func>) {
+            function.Discard();
+        }
+    }
+
+    // Heap order, the task on top is the one that runs next.
+    static bool RunsLater(const QueuedTask& a, const QueuedTask& b) {
+        if (a.deadlineNs != b.deadlineNs) {
+            return a.deadlineNs > b.deadlineNs;
+        }
+        return a.order > b.order;
+    }
+
+    // Caller must hold m_mutex.
+    void PushTask(Func&& function) {
+        const std::size_t slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        const uint64_t deadlineNs = TaskDeadline(function);
+        m_tasks[slot].emplace(std::move(function));
+        m_queue.push_back(QueuedTask{deadlineNs, m_nextOrder++, slot});
+        std::push_heap(m_queue.begin(), m_queue.end(), RunsLater);
 
-    void Worker() {
+        ++m_numTasks;
+        m_queueDepth.store(m_numTasks, std::memory_order_relaxed);
+        if (m_numTasks > m_maxQueueDepth.load(std::memory_order_relaxed)) {
+            m_maxQueueDepth.store(m_numTasks, std::memory_order_relaxed);
+        }
+    }
+
+    // Caller must hold m_mutex.
+    Func PopTask() {
+        std::pop_heap(m_queue.begin(), m_queue.end(), RunsLater);
+        const std::size_t slot = m_queue.back().slot;
+        m_queue.pop_back();
+
+        std::optional<Func>& task = m_tasks[slot];
+        Func function = std::move(*task);
+        task.reset();
+        m_freeSlots.push_back(slot);
+        --m_numTasks;
+        m_queueDepth.store(m_numTasks, std::memory_order_relaxed);
+        return function;
+    }
+
+    void Worker(std::size_t index) {
         while (true) {
             std::unique_lock<std::mutex> lock(m_mutex);
-            m_cv.wait(lock, [this] { return !m_tasks.empty() || !m_isRunning; });
+            // Workers past the active count sit this out until they are needed again, away from m_cv
+            // so Enqueue's notify_one always lands on a worker that will take the task.
+            m_parkCv.wait(lock, [this, index] { return index < m_numActive || !m_isRunning; });
+            m_cv.wait(lock, [this, index] { return m_numTasks > 0 || !m_isRunning || index >= m_numActive; });
 
-            if (!m_isRunning && m_tasks.empty())
+            if (!m_isRunning && m_numTasks == 0)
                 return;
 
-            Func task = m_tasks.front();
-            m_tasks.pop();
-
-            while (!m_tasksToBeAdded.empty()) {
-                m_tasks.push(m_tasksToBeAdded.front());
-                m_tasksToBeAdded.pop();
+            if (m_isRunning && index >= m_numActive) {
+                // Might have swallowed a wakeup meant for an active worker.
+                if (m_numTasks > 0) {
+                    m_cv.notify_one();
+                }
+                continue;
             }
+
+            Func task = PopTask();
             lock.unlock();
-            
+
+            // Only Block makes Enqueue wait for a slot, but waking nobody costs next to nothing and this way
+            // a freed slot never depends on the policy to be noticed.
+            m_spaceCv.notify_one();
+
             task();
         }
     }
 
 public:
-    SimpleThreadPool()
-    : m_isRunning(true) {
-        std::for_each(m_workers.begin(), m_workers.end(), [this] (std::thread& th) {
-            th = std::thread([this]() { this->Worker(); });
-        });
+    explicit SimpleThreadPool(AdmissionPolicy admissionPolicy = AdmissionPolicy::Block, std::size_t numThreads = N,
+                              std::size_t capacity = N)
+    : m_workers(std::max<std::size_t>(numThreads, 1))
+    , m_tasks(std::max<std::size_t>(capacity, 1))
+    , m_admissionPolicy(admissionPolicy)
+    , m_isRunning(true)
+    , m_numActive(m_workers.size()) {
+        m_queue.reserve(m_tasks.size());
+        m_freeSlots.reserve(m_tasks.size());
+        for (std::size_t slot = m_tasks.size(); slot > 0; --slot) {
+            m_freeSlots.push_back(slot - 1);
+        }
+        for (std::size_t i = 0; i < m_workers.size(); ++i) {
+            m_workers[i] = std::thread([this, i]() { this->Worker(i); });
+        }
+    }
+
+    // Threads are started in the constructor, this gets at them afterwards to place them on CPUs.
+    template <typename Visitor>
+    void ForEachWorker(Visitor visitor) {
+        std::for_each(m_workers.begin(), m_workers.end(), visitor);
+    }
+
+    std::size_t NumThreads() const {
+        return m_workers.size();
+    }
+
+    // How many of the threads take tasks, between 1 and NumThreads.  The others stay parked until it's
+    // raised again, a worker busy with a task finishes it first.
+    void SetNumActiveThreads(std::size_t numActive) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_numActive.store(std::clamp<std::size_t>(numActive, 1, m_workers.size()), std::memory_order_relaxed);
+        }
+        m_parkCv.notify_all();
+        m_cv.notify_all();
+    }
+
+    std::size_t NumActiveThreads() const {
+        return m_numActive.load(std::memory_order_relaxed);
+    }
+
+    // Tasks that can wait for a worker before the AdmissionPolicy kicks in.
+    std::size_t Capacity() const {
+        return m_tasks.size();
     }
 
     ~SimpleThreadPool() {
@@ -68,17 +245,66 @@ public:
     }
 
     // Add a job to the queue
-    void Enqueue(Func function) {
+    // Tasks the AdmissionPolicy throws away (the new one, or the one that would run next) are discarded,
+    // see HasDiscard.
+    EnqueueStatus Enqueue(Func function) {
+        EnqueueStatus status = EnqueueStatus::Accepted;
+        std::optional<Func> dropped;
         {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            if (m_tasks.size() < N) {
-                m_tasks.push(function);
-            } else {
-                m_tasksToBeAdded.push(function);
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (!m_isRunning) {
+                return EnqueueStatus::Stopped;
             }
+
+            if (m_numTasks >= m_tasks.size()) {
+                switch (m_admissionPolicy) {
+                case AdmissionPolicy::Block:
+                    m_numBlocked.fetch_add(1, std::memory_order_relaxed);
+                    m_spaceCv.wait(lock, [this] { return m_numTasks < m_tasks.size() || !m_isRunning; });
+                    if (!m_isRunning) {
+                        return EnqueueStatus::Stopped;
+                    }
+                    break;
+                case AdmissionPolicy::Reject:
+                    m_numRejected.fetch_add(1, std::memory_order_relaxed);
+                    lock.unlock();
+                    Discard(function);
+                    return EnqueueStatus::Rejected;
+                case AdmissionPolicy::DropNewest:
+                    m_numDroppedNewest.fetch_add(1, std::memory_order_relaxed);
+                    lock.unlock();
+                    Discard(function);
+                    return EnqueueStatus::DroppedNewest;
+                case AdmissionPolicy::DropOldest:
+                    m_numDroppedOldest.fetch_add(1, std::memory_order_relaxed);
+                    dropped.emplace(PopTask());
+                    status = EnqueueStatus::DroppedOldest;
+                    break;
+                }
+            }
+
+            PushTask(std::move(function));
         }
 
+        if (dropped) {
+            Discard(*dropped);
+        }
+
+        m_numAccepted.fetch_add(1, std::memory_order_relaxed);
         m_cv.notify_one();
+        return status;
+    }
+
+    AdmissionStats GetAdmissionStats() const {
+        AdmissionStats stats;
+        stats.accepted = m_numAccepted.load(std::memory_order_relaxed);
+        stats.rejected = m_numRejected.load(std::memory_order_relaxed);
+        stats.droppedOldest = m_numDroppedOldest.load(std::memory_order_relaxed);
+        stats.droppedNewest = m_numDroppedNewest.load(std::memory_order_relaxed);
+        stats.blocked = m_numBlocked.load(std::memory_order_relaxed);
+        stats.queued = m_queueDepth.load(std::memory_order_relaxed);
+        stats.maxQueued = m_maxQueueDepth.load(std::memory_order_relaxed);
+        return stats;
     }
 
     void Stop() {
@@ -87,6 +313,8 @@ public:
             m_isRunning = false;
         }
         m_cv.notify_all();
+        m_spaceCv.notify_all();
+        m_parkCv.notify_all();
         std::for_each(m_workers.begin(), m_workers.end(), [this] (std::thread& th) {
             if (th.joinable()) {
                 th.join();
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "FrameData.hpp"
+#include "NetInputStream.hpp"
+
+namespace StreamSim::Net {
+
+constexpr uint16_t DEFAULT_UDP_PORT = 5004;
+
+// Packets stay under a typical MTU so nothing gets fragmented by IP on the way.
+constexpr std::size_t MAX_PACKET_SIZE = 1400;
+
+// RTP-like header in front of every packet, in network byte order.  Besides the usual stream id,
+// sequence and timestamp it carries what the decode stages need to know about the frame, and where
+// this fragment goes in it.  Every fragment but the last carries exactly MAX_FRAGMENT_PAYLOAD bytes.
+struct PacketHeader {
+    static constexpr uint8_t VERSION = 1;
+
+    uint32_t streamId = 0;
+    uint64_t sequence = 0;
+    uint64_t displayOrder = 0;
+    uint64_t timestampUs = 0;
+    uint32_t frameSize = 0;
+    uint16_t fragmentIndex = 0;
+    uint16_t fragmentCount = 0;
+    uint8_t frameType = 0;
+    uint8_t value = 0;
+    uint8_t numReferences = 0;
+    std::array<uint64_t, Core::MAX_FRAME_REFERENCES> references{};
+};
+
+constexpr std::size_t PACKET_HEADER_SIZE = 1 + 4 + 8 + 8 + 8 + 4 + 2 + 2 + 1 + 1 + 1 + 8 * Core::MAX_FRAME_REFERENCES;
+constexpr std::size_t MAX_FRAGMENT_PAYLOAD = MAX_PACKET_SIZE - PACKET_HEADER_SIZE;
+constexpr std::size_t MAX_FRAGMENTS_PER_FRAME = 4096;
+
+// Writes the header into the first PACKET_HEADER_SIZE bytes of packet.
+void EncodePacketHeader(const PacketHeader& header, std::span<uint8_t> packet);
+
+// Returns false if the packet is too short or not a version we understand.
+bool DecodePacketHeader(std::span<const uint8_t> packet, PacketHeader& header);
+
+// Number of packets a frame of frameSize bytes is sent in.
+inline uint16_t NumFragments(std::size_t frameSize) {
+    return static_cast<uint16_t>(frameSize == 0 ? 1 : (frameSize + MAX_FRAGMENT_PAYLOAD - 1) / MAX_FRAGMENT_PAYLOAD);
+}
+
+struct ReassemblyStats {
+    uint64_t framesCompleted = 0;
+    uint64_t framesDropped = 0;         // evicted before every fragment arrived
+    uint64_t duplicateFragments = 0;
+    uint64_t malformedPackets = 0;
+};
+
+// Puts frames back together from their packets, straight into pooled buffers: the payload buffer is
+// acquired when the first fragment of a frame shows up and every fragment is copied to its offset,
+// so fragments may arrive in any order.  At most MAX_FRAMES_IN_FLIGHT frames are assembled at once,
+// when another one starts the oldest incomplete frame is given up on.
+// The last FINISHED_WINDOW sequences of every stream remember whether their frame was completed or given up
+// on, so a fragment resent or arriving after that is counted as a duplicate and never takes a buffer or a slot.
+// Anything older than that window is taken as a duplicate too.
+// Only used from the receiving thread, so there is no locking.
+class FrameReassembler {
+public:
+    static constexpr std::size_t MAX_FRAMES_IN_FLIGHT = 64;
+    static constexpr std::size_t FINISHED_WINDOW = 256;
+
+private:
+    struct PendingFrame {
+        bool inUse = false;
+        uint64_t startedAt = 0;
+        // From the header of the fragment that started it, every later fragment has to agree.
+        uint32_t frameSize = 0;
+        uint16_t fragmentCount = 0;
+        uint16_t numReceived = 0;
+        std::bitset<MAX_FRAGMENTS_PER_FRAME> received;
+        Core::ByteUndecodedFrame frame;
+    };
+
+    struct StreamHistory {
+        // sequence + 1 of the finished frame at sequence % FINISHED_WINDOW, 0 if there is none.
+        std::array<uint64_t, FINISHED_WINDOW> finished{};
+        uint64_t highestFinished = 0;
+    };
+
+    Core::FrameBufferPool& m_pool;
+    std::array<PendingFrame, MAX_FRAMES_IN_FLIGHT> m_pending;
+    std::unordered_map<uint32_t, StreamHistory> m_streams;
+    uint64_t m_numStarted = 0;
+    ReassemblyStats m_stats;
+
+    PendingFrame* FindOrStart(const PacketHeader& header);
+    bool IsFinished(const PacketHeader& header) const;
+    void Finish(const Core::FrameMetadata& meta);
+
+public:
+    explicit FrameReassembler(Core::FrameBufferPool& pool = Core::FrameBufferPool::Default());
+
+    // Returns true when this packet completed a frame, which is then moved into frame.
+    bool AddPacket(std::span<const uint8_t> packet, Core::ByteUndecodedFrame& frame);
+
+    const ReassemblyStats& GetStats() const {
+        return m_stats;
+    }
+};
+
+// What the receive loop spent its time on.  recvNs and reassemblyNs are the costs the simulated
+// ingest never had to pay, packets / recvCalls shows how much batching recvmmsg actually got.
+struct UdpIngestStats {
+    uint64_t recvCalls = 0;
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    uint64_t recvNs = 0;
+    uint64_t reassemblyNs = 0;
+    ReassemblyStats reassembly;
+};
+
+// NetInputStream reading RTP-like packets from a local UDP socket.
+// A receive thread pulls up to RECV_BATCH_SIZE packets per recvmmsg call, reassembles them into
+// frames and hands every complete frame to the handler, the same callback the simulated ingest uses.
+// Binds to 127.0.0.1 only, it's meant for loopback traffic from LoopbackSender.
+class UdpInputStream {
+public:
+    static constexpr std::size_t RECV_BATCH_SIZE = 32;
+
+private:
+    // This is non-owning raw pointer.
+    NetInputStreamHandler* m_handler;
+    uint16_t m_port;
+    int m_socket = -1;
+
+    FrameReassembler m_reassembler;
+    std::thread m_receiveThread;
+    std::atomic_bool m_isRunning{false};
+
+    std::atomic<uint64_t> m_recvCalls{0};
+    std::atomic<uint64_t> m_packets{0};
+    std::atomic<uint64_t> m_bytes{0};
+    std::atomic<uint64_t> m_recvNs{0};
+    std::atomic<uint64_t> m_reassemblyNs{0};
+    std::atomic<uint64_t> m_framesCompleted{0};
+    std::atomic<uint64_t> m_framesDropped{0};
+    std::atomic<uint64_t> m_duplicateFragments{0};
+    std::atomic<uint64_t> m_malformedPackets{0};
+
+    void ReceiveLoop();
+
+public:
+    // Port 0 picks a free port, see GetPort.
+    UdpInputStream(NetInputStreamHandler* handler, uint16_t port = 0,
+                   Core::FrameBufferPool& pool = Core::FrameBufferPool::Default());
+    ~UdpInputStream();
+
+    UdpInputStream(const UdpInputStream&) = delete;
+    UdpInputStream& operator=(const UdpInputStream&) = delete;
+
+    // Opens the socket and starts receiving.  Returns false if the socket can't be set up.
+    bool Start();
+    void Stop();
+
+    uint16_t GetPort() const {
+        return m_port;
+    }
+
+    UdpIngestStats GetStats() const;
+};
+
+// Sending half, used by the LoopbackSender tool and the tests.  Splits a frame into packets and sends
+// them with one sendmmsg call per batch.
+class UdpFrameSender {
+public:
+    static constexpr std::size_t SEND_BATCH_SIZE = 32;
+
+private:
+    int m_socket = -1;
+    std::vector<std::array<uint8_t, MAX_PACKET_SIZE>> m_packets;
+    uint64_t m_numPacketsSent = 0;
+    uint64_t m_numBytesSent = 0;
+
+public:
+    explicit UdpFrameSender(uint16_t port, const std::string& address = "127.0.0.1");
+    ~UdpFrameSender();
+
+    UdpFrameSender(const UdpFrameSender&) = delete;
+    UdpFrameSender& operator=(const UdpFrameSender&) = delete;
+
+    bool IsOpen() const {
+        return m_socket >= 0;
+    }
+
+    // Returns false if the frame is too big to send or the socket refused a packet.
+    bool SendFrame(const Core::ByteUndecodedFrame& frame);
+
+    uint64_t NumPacketsSent() const {
+        return m_numPacketsSent;
+    }
+
+    uint64_t NumBytesSent() const {
+        return m_numBytesSent;
+    }
+};
+
+}
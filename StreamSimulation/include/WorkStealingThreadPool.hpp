@@ -0,0 +1,330 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "ConcurrentData.hpp"
+#include "EventCount.hpp"
+#include "ThreadPool.hpp"
+
+namespace StreamSim::Core {
+
+// Chase-Lev work-stealing deque (the C11 version from Le, Pop, Cohen and Zappa Nardelli).
+// The owning worker pushes and pops at the bottom without any atomic read-modify-write in the
+// common case, other workers steal from the top with a single CAS.
+// Only pointers are stored so a stealer can never observe a half-copied element.  Arrays that
+// are outgrown are kept until the deque is destroyed because a stealer may still be reading them.
+template <typename T>
+class ChaseLevDeque {
+    static_assert(std::is_pointer_v<T>, "ChaseLevDeque stores pointers");
+
+private:
+    struct Array {
+        std::size_t capacity;
+        std::unique_ptr<std::atomic<T>[]> slots;
+
+        explicit Array(std::size_t size)
+        : capacity(size)
+        , slots(std::make_unique<std::atomic<T>[]>(size)) {}
+
+        T Get(int64_t i) const {
+            return slots[static_cast<std::size_t>(i) & (capacity - 1)].load(std::memory_order_relaxed);
+        }
+
+        void Put(int64_t i, T item) {
+            slots[static_cast<std::size_t>(i) & (capacity - 1)].store(item, std::memory_order_relaxed);
+        }
+    };
+
+    alignas(CACHE_LINE_SIZE) std::atomic<int64_t> m_top{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<int64_t> m_bottom{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<Array*> m_array;
+
+    // Owner only.
+    std::vector<std::unique_ptr<Array>> m_arrays;
+
+    Array* Grow(Array* array, int64_t bottom, int64_t top) {
+        auto grown = std::make_unique<Array>(array->capacity * 2);
+        for (int64_t i = top; i < bottom; ++i) {
+            grown->Put(i, array->Get(i));
+        }
+        Array* result = grown.get();
+        m_arrays.push_back(std::move(grown));
+        m_array.store(result, std::memory_order_release);
+        return result;
+    }
+
+public:
+    explicit ChaseLevDeque(std::size_t initialCapacity = 256) {
+        assert(initialCapacity > 0 && (initialCapacity & (initialCapacity - 1)) == 0);
+        m_arrays.push_back(std::make_unique<Array>(initialCapacity));
+        m_array.store(m_arrays.back().get(), std::memory_order_relaxed);
+    }
+
+    ChaseLevDeque(const ChaseLevDeque&) = delete;
+    ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+    // Owner only.
+    void Push(T item) {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        const int64_t top = m_top.load(std::memory_order_acquire);
+        Array* array = m_array.load(std::memory_order_relaxed);
+        if (bottom - top > static_cast<int64_t>(array->capacity) - 1) {
+            array = Grow(array, bottom, top);
+        }
+        array->Put(bottom, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    // Owner only.  Pops the most recently pushed item.
+    bool Pop(T& item) {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        Array* array = m_array.load(std::memory_order_relaxed);
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = m_top.load(std::memory_order_relaxed);
+
+        if (top > bottom) {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        item = array->Get(bottom);
+        if (top == bottom) {
+            // Last item, race the stealers for it.
+            const bool won = m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                                           std::memory_order_relaxed);
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // Any thread.  Takes the oldest item.
+    bool Steal(T& item) {
+        int64_t top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return false;
+        }
+
+        Array* array = m_array.load(std::memory_order_acquire);
+        item = array->Get(top);
+        return m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    // Snapshot, may be stale by the time it returns.
+    std::size_t Size() const {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        const int64_t top = m_top.load(std::memory_order_relaxed);
+        return bottom > top ? static_cast<std::size_t>(bottom - top) : 0;
+    }
+};
+
+// Thread pool where every worker owns a Chase-Lev deque.
+// Tasks enqueued from a worker (a task spawning follow-up work) go to that worker's own deque,
+// tasks enqueued from any other thread go through a lock-free MPMC injection queue.  A worker
+// that runs out of work first checks the injection queue and then steals from randomly chosen
+// victims, so there is no lock anywhere on the task path.  Idle workers park on an EventCount.
+// Same Enqueue/Stop surface as SimpleThreadPool, but the thread count is picked at runtime.
+// Tasks are kept in slots allocated with the pool, the deques and the injection queue only pass pointers to them
+// around (a stealer may read a deque element that is being replaced, so the elements can't be the tasks themselves).
+// Queueing a task never allocates.  With every slot taken Enqueue waits for one, or runs the task right away when
+// called from a worker, which might be the one that has to free it.
+template <Callable Func>
+class WorkStealingThreadPool {
+private:
+    static constexpr std::size_t INJECTION_QUEUE_SIZE = 1024;
+    static constexpr std::size_t TASK_SLOTS_PER_WORKER = 256;
+
+    using TaskSlot = std::optional<Func>;
+
+    struct Worker {
+        ChaseLevDeque<TaskSlot*> deque;
+        std::thread thread;
+        uint64_t rngState;
+    };
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    MpmcBufferQueue<TaskSlot*, INJECTION_QUEUE_SIZE, 0> m_injectionQueue;
+    std::unique_ptr<TaskSlot[]> m_taskSlots;
+    MpmcBufferQueue<TaskSlot*, INJECTION_QUEUE_SIZE, 0> m_freeSlots;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> m_pendingTasks{0};
+    alignas(CACHE_LINE_SIZE) EventCount m_workAvailable;
+    std::atomic_bool m_isRunning;
+
+    // Lets Enqueue tell whether it is being called from one of this pool's workers.
+    static inline thread_local WorkStealingThreadPool* tl_pool = nullptr;
+    static inline thread_local std::size_t tl_workerIndex = 0;
+
+    // Enough for a full injection queue and a few hundred tasks on every worker's deque.
+    static std::size_t NumTaskSlots(std::size_t numThreads) {
+        return INJECTION_QUEUE_SIZE + std::max<std::size_t>(numThreads, 1) * TASK_SLOTS_PER_WORKER;
+    }
+
+    static uint64_t NextRandom(uint64_t& state) {
+        // xorshift64
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    TaskSlot* FindTask(std::size_t index) {
+        Worker& self = *m_workers[index];
+        TaskSlot* task = nullptr;
+
+        if (self.deque.Pop(task)) {
+            return task;
+        }
+
+        if (m_injectionQueue.ReadAsync(task)) {
+            return task;
+        }
+
+        const std::size_t numWorkers = m_workers.size();
+        const std::size_t start = static_cast<std::size_t>(NextRandom(self.rngState) % numWorkers);
+        for (std::size_t i = 0; i < numWorkers; ++i) {
+            const std::size_t victim = (start + i) % numWorkers;
+            if (victim != index && m_workers[victim]->deque.Steal(task)) {
+                return task;
+            }
+        }
+        return nullptr;
+    }
+
+    void ReleaseSlot(TaskSlot* slot) {
+        slot->reset();
+        // There is room for every slot, so this only fails once Stop closed the free list.
+        m_freeSlots.WriteSync(slot);
+    }
+
+    void WorkerLoop(std::size_t index) {
+        tl_pool = this;
+        tl_workerIndex = index;
+
+        while (true) {
+            if (TaskSlot* task = FindTask(index)) {
+                m_pendingTasks.fetch_sub(1, std::memory_order_relaxed);
+                (**task)();
+                ReleaseSlot(task);
+                continue;
+            }
+
+            const uint32_t key = m_workAvailable.PrepareWait();
+            if (m_pendingTasks.load(std::memory_order_seq_cst) > 0) {
+                m_workAvailable.CancelWait();
+                continue;
+            }
+            // Only leave once everything that was enqueued has run, like SimpleThreadPool.
+            if (!m_isRunning.load(std::memory_order_acquire)) {
+                m_workAvailable.CancelWait();
+                return;
+            }
+            m_workAvailable.Wait(key);
+        }
+    }
+
+public:
+    explicit WorkStealingThreadPool(std::size_t numThreads = std::thread::hardware_concurrency())
+    : m_taskSlots(std::make_unique<TaskSlot[]>(NumTaskSlots(numThreads)))
+    , m_freeSlots(NumTaskSlots(numThreads), { std::chrono::milliseconds(0) })
+    , m_isRunning(true) {
+        if (numThreads == 0) {
+            numThreads = 1;
+        }
+        for (std::size_t i = 0; i < NumTaskSlots(numThreads); ++i) {
+            m_freeSlots.WriteSync(&m_taskSlots[i]);
+        }
+
+        m_workers.reserve(numThreads);
+        for (std::size_t i = 0; i < numThreads; ++i) {
+            auto worker = std::make_unique<Worker>();
+            worker->rngState = 0x9E3779B97F4A7C15ull * (i + 1);
+            m_workers.push_back(std::move(worker));
+        }
+        // Start the threads only once every deque exists, since workers steal from each other.
+        for (std::size_t i = 0; i < numThreads; ++i) {
+            m_workers[i]->thread = std::thread([this, i]() { this->WorkerLoop(i); });
+        }
+    }
+
+    ~WorkStealingThreadPool() {
+        Stop();
+    }
+
+    WorkStealingThreadPool(const WorkStealingThreadPool&) = delete;
+    WorkStealingThreadPool& operator=(const WorkStealingThreadPool&) = delete;
+
+    std::size_t NumThreads() const {
+        return m_workers.size();
+    }
+
+    // Same as SimpleThreadPool::ForEachWorker, visits the thread of every worker.
+    template <typename Visitor>
+    void ForEachWorker(Visitor visitor) {
+        for (auto& worker : m_workers) {
+            visitor(worker->thread);
+        }
+    }
+
+    // Add a job to the pool.  Jobs enqueued after Stop are dropped.
+    void Enqueue(Func function) {
+        if (!m_isRunning.load(std::memory_order_acquire)) {
+            return;
+        }
+
+        TaskSlot* task = nullptr;
+        if (tl_pool == this) {
+            if (!m_freeSlots.ReadAsync(task)) {
+                function();
+                return;
+            }
+        } else if (!m_freeSlots.ReadSync(task)) {
+            return;
+        }
+        task->emplace(std::move(function));
+        m_pendingTasks.fetch_add(1, std::memory_order_seq_cst);
+
+        if (tl_pool == this) {
+            m_workers[tl_workerIndex]->deque.Push(task);
+        } else if (!m_injectionQueue.WriteSync(task)) {
+            m_pendingTasks.fetch_sub(1, std::memory_order_relaxed);
+            task->reset();
+            return;
+        }
+
+        m_workAvailable.NotifyOne();
+    }
+
+    void Stop() {
+        m_isRunning.store(false, std::memory_order_release);
+        m_workAvailable.NotifyAll();
+
+        for (auto& worker : m_workers) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+
+        // Nothing can be taken from the injection queue any more, so fail producers still blocked on it or on a free slot.
+        m_injectionQueue.Close();
+        m_freeSlots.Close();
+        TaskSlot* task = nullptr;
+        while (m_injectionQueue.ReadAsync(task)) {
+            task->reset();
+        }
+    }
+};
+
+}
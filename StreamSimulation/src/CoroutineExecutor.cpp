@@ -0,0 +1,134 @@
+#include "CoroutineExecutor.hpp"
+
+namespace StreamSim::Core {
+
+CoroutineExecutor::CoroutineExecutor(std::size_t numThreads) {
+    numThreads = std::max<std::size_t>(numThreads, 1);
+    m_threads.reserve(numThreads);
+    for (std::size_t i = 0; i < numThreads; ++i) {
+        m_threads.emplace_back(&CoroutineExecutor::WorkerLoop, this);
+    }
+}
+
+CoroutineExecutor::~CoroutineExecutor() {
+    Stop();
+}
+
+void CoroutineExecutor::WorkerLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        const auto now = Clock::now();
+        while (!m_timers.empty() && m_timers.front().due <= now) {
+            std::pop_heap(m_timers.begin(), m_timers.end(), DueLater);
+            m_ready.push_back(m_timers.back().handle);
+            m_timers.pop_back();
+        }
+
+        if (m_ready.empty()) {
+            if (!m_isRunning) {
+                return;
+            }
+            if (m_timers.empty()) {
+                m_cv.wait(lock);
+            } else {
+                m_cv.wait_until(lock, m_timers.front().due);
+            }
+            continue;
+        }
+
+        const std::coroutine_handle<> handle = m_ready.front();
+        m_ready.pop_front();
+        // Several timers may have come due at once, another thread can take the rest.
+        if (!m_ready.empty()) {
+            m_cv.notify_one();
+        }
+        lock.unlock();
+
+        m_numResumes.fetch_add(1, std::memory_order_relaxed);
+        handle.resume();
+        lock.lock();
+    }
+}
+
+bool CoroutineExecutor::Spawn(CoTask task) {
+    const auto handle = std::exchange(task.m_handle, nullptr);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_isRunning) {
+            handle.destroy();
+            return false;
+        }
+        handle.promise().executor = this;
+        ++m_numTasks;
+        m_ready.push_back(handle);
+    }
+    m_cv.notify_one();
+    return true;
+}
+
+void CoroutineExecutor::Schedule(std::coroutine_handle<> handle) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_ready.push_back(handle);
+    }
+    m_cv.notify_one();
+}
+
+void CoroutineExecutor::ScheduleAt(Clock::time_point due, std::coroutine_handle<> handle) {
+    bool isEarliest = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_timers.push_back(Timer{due, m_nextTimerOrder++, handle});
+        std::push_heap(m_timers.begin(), m_timers.end(), DueLater);
+        isEarliest = m_timers.front().handle == handle;
+    }
+    // Only a new earliest timer changes how long the waiting threads have to sleep.
+    if (isEarliest) {
+        m_cv.notify_one();
+    }
+}
+
+void CoroutineExecutor::TaskDone() {
+    bool isIdle = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        isIdle = --m_numTasks == 0;
+    }
+    if (isIdle) {
+        m_idleCv.notify_all();
+    }
+}
+
+void CoroutineExecutor::Join() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idleCv.wait(lock, [this] { return m_numTasks == 0; });
+}
+
+void CoroutineExecutor::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isRunning = false;
+    }
+    m_cv.notify_all();
+    for (auto& thread : m_threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& timer : m_timers) {
+        timer.handle.destroy();
+    }
+    m_timers.clear();
+}
+
+ExecutorStats CoroutineExecutor::GetStats() {
+    ExecutorStats stats;
+    stats.resumes = m_numResumes.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    stats.tasks = m_numTasks;
+    return stats;
+}
+
+}
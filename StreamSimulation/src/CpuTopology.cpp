@@ -0,0 +1,360 @@
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include "CpuTopology.hpp"
+
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // Way past any host we run on, it only keeps a typo from expanding into billions of CPUs.
+    constexpr uint32_t MAX_CPU_ID = 4095;
+    constexpr uint32_t MAX_NODE_ID = 1023;
+
+    std::string Trim(const std::string& text) {
+        const auto begin = text.find_first_not_of(" \t\r\n");
+        if (begin == std::string::npos) {
+            return std::string();
+        }
+        const auto end = text.find_last_not_of(" \t\r\n");
+        return text.substr(begin, end - begin + 1);
+    }
+
+    bool ParseNumber(const std::string& text, uint32_t& value) {
+        const char* end = text.data() + text.size();
+        const auto result = std::from_chars(text.data(), end, value);
+        return result.ec == std::errc() && result.ptr == end;
+    }
+
+    // First line of a sysfs file, empty if it can't be read.
+    std::string ReadLine(const std::string& path) {
+        std::ifstream file(path);
+        std::string line;
+        std::getline(file, line);
+        return Trim(line);
+    }
+
+    // physical_package_id is -1 on some virtual machines, which is as good as not knowing.
+    uint32_t ReadId(const std::string& path, uint32_t fallback) {
+        uint32_t value = 0;
+        return ParseNumber(ReadLine(path), value) ? value : fallback;
+    }
+
+    // CPUs of each node, ordered so the first hardware thread of every core comes before any SMT sibling.
+    std::vector<std::vector<uint32_t>> NodeCpuOrder(const StreamSim::Core::CpuTopology& topology, const StreamSim::Core::CpuSet& allowed) {
+        std::vector<std::vector<uint32_t>> order;
+        for (uint32_t node : topology.Nodes()) {
+            std::vector<const StreamSim::Core::CpuInfo*> cpus;
+            for (uint32_t cpu : allowed) {
+                const StreamSim::Core::CpuInfo* info = topology.FindCpu(cpu);
+                if (info != nullptr && info->node == node) {
+                    cpus.push_back(info);
+                }
+            }
+            if (cpus.empty()) {
+                continue;
+            }
+
+            std::stable_sort(cpus.begin(), cpus.end(), [](const StreamSim::Core::CpuInfo* a, const StreamSim::Core::CpuInfo* b) {
+                return a->smtIndex < b->smtIndex;
+            });
+            order.emplace_back();
+            for (const auto* info : cpus) {
+                order.back().push_back(info->id);
+            }
+        }
+        return order;
+    }
+
+    // Online CPUs the stage may use, narrowed down by its cpus and node.
+    StreamSim::Core::CpuSet AllowedCpus(const StreamSim::Core::CpuTopology& topology, const StreamSim::Core::StagePlacement& placement) {
+        StreamSim::Core::CpuSet allowed;
+        for (const auto& info : topology.Cpus()) {
+            const bool isListed = placement.cpus.empty() ||
+                                  std::binary_search(placement.cpus.begin(), placement.cpus.end(), info.id);
+            const bool isOnNode = !placement.node.has_value() || info.node == *placement.node;
+            if (isListed && isOnNode) {
+                allowed.push_back(info.id);
+            }
+        }
+        return allowed;
+    }
+}
+
+namespace StreamSim::Core {
+
+CpuTopology CpuTopology::Discover(const std::string& systemDir) {
+    CpuTopology topology;
+
+    CpuSet online;
+    if (!ParseCpuSet(ReadLine(systemDir + "/cpu/online"), online) || online.empty()) {
+        online.clear();
+        const uint32_t numCpus = std::max(1u, std::thread::hardware_concurrency());
+        for (uint32_t cpu = 0; cpu < numCpus; ++cpu) {
+            online.push_back(cpu);
+        }
+    }
+
+    // Node of every CPU, from the CPU lists of the nodes.
+    std::map<uint32_t, uint32_t> cpuNodes;
+    CpuSet nodes;
+    if (ParseCpuSet(ReadLine(systemDir + "/node/online"), nodes)) {
+        for (uint32_t node : nodes) {
+            CpuSet cpus;
+            if (node > MAX_NODE_ID || !ParseCpuSet(ReadLine(systemDir + "/node/node" + std::to_string(node) + "/cpulist"), cpus)) {
+                continue;
+            }
+            for (uint32_t cpu : cpus) {
+                cpuNodes.emplace(cpu, node);
+            }
+        }
+    }
+
+    // Hardware threads are grouped into cores by (package, core_id), core_id alone repeats on every socket.
+    std::map<std::pair<uint32_t, uint32_t>, uint32_t> coreIds;
+    std::map<uint32_t, uint32_t> coreThreads;
+    for (uint32_t cpu : online) {
+        const std::string topologyDir = systemDir + "/cpu/cpu" + std::to_string(cpu) + "/topology/";
+        CpuInfo info;
+        info.id = cpu;
+        info.package = ReadId(topologyDir + "physical_package_id", 0);
+        const auto found = cpuNodes.find(cpu);
+        info.node = found != cpuNodes.end() ? found->second : 0;
+
+        const auto key = std::make_pair(info.package, ReadId(topologyDir + "core_id", cpu));
+        info.core = coreIds.emplace(key, static_cast<uint32_t>(coreIds.size())).first->second;
+        info.smtIndex = coreThreads[info.core]++;
+        topology.m_cpus.push_back(info);
+    }
+    topology.m_numCores = coreIds.size();
+
+    topology.m_cpuIndex.assign(online.back() + 1, -1);
+    for (std::size_t i = 0; i < topology.m_cpus.size(); ++i) {
+        const CpuInfo& info = topology.m_cpus[i];
+        topology.m_cpuIndex[info.id] = static_cast<int32_t>(i);
+
+        auto node = std::lower_bound(topology.m_nodes.begin(), topology.m_nodes.end(), info.node);
+        if (node == topology.m_nodes.end() || *node != info.node) {
+            topology.m_nodeCpus.insert(topology.m_nodeCpus.begin() + (node - topology.m_nodes.begin()), CpuSet());
+            node = topology.m_nodes.insert(node, info.node);
+        }
+        topology.m_nodeCpus[node - topology.m_nodes.begin()].push_back(info.id);
+    }
+    return topology;
+}
+
+const CpuTopology& CpuTopology::Host() {
+    static const CpuTopology topology = Discover();
+    return topology;
+}
+
+const CpuInfo* CpuTopology::FindCpu(uint32_t cpu) const {
+    if (cpu >= m_cpuIndex.size() || m_cpuIndex[cpu] < 0) {
+        return nullptr;
+    }
+    return &m_cpus[m_cpuIndex[cpu]];
+}
+
+CpuSet CpuTopology::CpusOfNode(uint32_t node) const {
+    const auto found = std::lower_bound(m_nodes.begin(), m_nodes.end(), node);
+    if (found == m_nodes.end() || *found != node) {
+        return CpuSet();
+    }
+    return m_nodeCpus[found - m_nodes.begin()];
+}
+
+std::optional<uint32_t> CpuTopology::NodeOf(const CpuSet& cpus) const {
+    std::optional<uint32_t> node;
+    for (uint32_t cpu : cpus) {
+        const CpuInfo* info = FindCpu(cpu);
+        if (info == nullptr || (node.has_value() && *node != info->node)) {
+            return std::nullopt;
+        }
+        node = info->node;
+    }
+    return node;
+}
+
+std::string FormatCpuTopology(const CpuTopology& topology) {
+    std::ostringstream out;
+    out << topology.Cpus().size() << " CPUs, " << topology.NumCores() << " cores, " << topology.NumNodes() << " NUMA nodes (";
+    for (std::size_t i = 0; i < topology.NumNodes(); ++i) {
+        const uint32_t node = topology.Nodes()[i];
+        out << (i > 0 ? ", " : "") << "node " << node << ": " << FormatCpuSet(topology.CpusOfNode(node));
+    }
+    out << ")";
+    return out.str();
+}
+
+CpuSet PlaceStageThread(const CpuTopology& topology, const StagePlacement& placement, std::size_t index) {
+    const CpuSet allowed = AllowedCpus(topology, placement);
+    if (allowed.empty()) {
+        return CpuSet();
+    }
+
+    if (placement.policy == PinningPolicy::Shared) {
+        const bool isNarrowed = !placement.cpus.empty() || placement.node.has_value();
+        return isNarrowed ? allowed : CpuSet();
+    }
+
+    const auto nodeOrder = NodeCpuOrder(topology, allowed);
+    CpuSet order;
+    if (placement.policy == PinningPolicy::Compact) {
+        for (const auto& cpus : nodeOrder) {
+            order.insert(order.end(), cpus.begin(), cpus.end());
+        }
+    } else {
+        for (std::size_t i = 0; order.size() < allowed.size(); ++i) {
+            for (const auto& cpus : nodeOrder) {
+                if (i < cpus.size()) {
+                    order.push_back(cpus[i]);
+                }
+            }
+        }
+    }
+    return CpuSet{ order[index % order.size()] };
+}
+
+std::optional<uint32_t> StageNode(const CpuTopology& topology, const StagePlacement& placement) {
+    if (placement.node.has_value()) {
+        return placement.node;
+    }
+    // Only a narrowed down stage can be on one node of a multi node host.
+    if (placement.cpus.empty()) {
+        return topology.NumNodes() == 1 ? std::optional<uint32_t>(topology.Nodes()[0]) : std::nullopt;
+    }
+    return topology.NodeOf(AllowedCpus(topology, placement));
+}
+
+bool ParseCpuSet(const std::string& text, CpuSet& cpus) {
+    CpuSet parsed;
+    std::istringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        item = Trim(item);
+        const auto dash = item.find('-');
+        uint32_t first = 0;
+        uint32_t last = 0;
+        if (dash == std::string::npos) {
+            if (!ParseNumber(item, first)) {
+                return false;
+            }
+            last = first;
+        } else if (!ParseNumber(Trim(item.substr(0, dash)), first) || !ParseNumber(Trim(item.substr(dash + 1)), last) ||
+                   last < first) {
+            return false;
+        }
+        if (last > MAX_CPU_ID) {
+            return false;
+        }
+
+        for (uint32_t cpu = first; cpu <= last; ++cpu) {
+            parsed.push_back(cpu);
+        }
+    }
+
+    std::sort(parsed.begin(), parsed.end());
+    parsed.erase(std::unique(parsed.begin(), parsed.end()), parsed.end());
+    cpus = std::move(parsed);
+    return true;
+}
+
+std::string FormatCpuSet(const CpuSet& cpus) {
+    std::ostringstream out;
+    for (std::size_t i = 0; i < cpus.size();) {
+        // Runs of consecutive CPUs are written as a range.
+        std::size_t end = i + 1;
+        while (end < cpus.size() && cpus[end] == cpus[end - 1] + 1) {
+            ++end;
+        }
+        out << (i > 0 ? "," : "") << cpus[i];
+        if (end - i > 1) {
+            out << "-" << cpus[end - 1];
+        }
+        i = end;
+    }
+    return out.str();
+}
+
+#if defined(__linux__)
+namespace {
+    bool SetAffinity(pthread_t thread, const CpuSet& cpus) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (uint32_t cpu : cpus) {
+            if (cpu >= CPU_SETSIZE) {
+                return false;
+            }
+            CPU_SET(cpu, &set);
+        }
+        return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+    }
+}
+#endif
+
+bool SetThreadAffinity(std::thread& thread, const CpuSet& cpus) {
+    if (cpus.empty()) {
+        return true;
+    }
+#if defined(__linux__)
+    return SetAffinity(thread.native_handle(), cpus);
+#else
+    (void)thread;
+    return false;
+#endif
+}
+
+bool SetCurrentThreadAffinity(const CpuSet& cpus) {
+    if (cpus.empty()) {
+        return true;
+    }
+#if defined(__linux__)
+    return SetAffinity(pthread_self(), cpus);
+#else
+    return false;
+#endif
+}
+
+uint32_t CurrentCpu() {
+#if defined(__linux__)
+    const int cpu = sched_getcpu();
+    return cpu >= 0 ? static_cast<uint32_t>(cpu) : 0;
+#else
+    return 0;
+#endif
+}
+
+bool BindMemoryToNode(void* data, std::size_t bytes, uint32_t node) {
+#if defined(__linux__) && defined(SYS_mbind)
+    if (data == nullptr || bytes == 0 || node > MAX_NODE_ID) {
+        return false;
+    }
+
+    const uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(data) & ~(pageSize - 1);
+    const uintptr_t end = (reinterpret_cast<uintptr_t>(data) + bytes + pageSize - 1) & ~(pageSize - 1);
+
+    constexpr std::size_t BITS_PER_WORD = sizeof(unsigned long) * 8;
+    std::vector<unsigned long> nodeMask(node / BITS_PER_WORD + 1, 0);
+    nodeMask[node / BITS_PER_WORD] = 1ul << (node % BITS_PER_WORD);
+
+    // Preferred rather than bound, so running out of memory on the node falls back to another one instead of failing.
+    return syscall(SYS_mbind, begin, end - begin, MPOL_PREFERRED, nodeMask.data(), nodeMask.size() * BITS_PER_WORD + 1,
+                   MPOL_MF_MOVE) == 0;
+#else
+    (void)data;
+    (void)bytes;
+    (void)node;
+    return false;
+#endif
+}
+
+}
@@ -0,0 +1,87 @@
+#include <algorithm>
+#include "DecodeAutoscaler.hpp"
+
+namespace StreamSim::Core {
+
+DecodeAutoscaler::DecodeAutoscaler(const AutoscaleConfig& config, std::size_t maxWorkers)
+: m_config(config)
+, m_maxWorkers(std::max<std::size_t>(maxWorkers, 1))
+, m_activeWorkers(std::clamp<std::size_t>(config.minWorkers, 1, m_maxWorkers)) {}
+
+DecodeAutoscaler::~DecodeAutoscaler() {
+    Stop();
+}
+
+std::size_t DecodeAutoscaler::Update(const AutoscaleSample& sample) {
+    const std::size_t active = m_activeWorkers.load(std::memory_order_relaxed);
+    const uint64_t waitLimitNs = static_cast<uint64_t>(std::chrono::nanoseconds(m_config.scaleUpWait).count());
+
+    const bool isBehind = sample.isQueueFull || sample.queueDepth > m_config.scaleUpDepth * active ||
+                          (waitLimitNs > 0 && sample.queueWaitP99Ns > waitLimitNs);
+    const bool isIdle = !sample.isQueueFull && sample.queueDepth < active &&
+                        (waitLimitNs == 0 || sample.queueWaitP99Ns < waitLimitNs / 2);
+    m_numBehind = isBehind ? m_numBehind + 1 : 0;
+    m_numIdle = isIdle ? m_numIdle + 1 : 0;
+
+    const std::size_t minWorkers = std::clamp<std::size_t>(m_config.minWorkers, 1, m_maxWorkers);
+    std::size_t target = active;
+    if (m_numBehind >= m_config.scaleUpSamples && active < m_maxWorkers) {
+        target = std::min(m_maxWorkers, active + std::max<std::size_t>(active / 2, 1));
+        m_scaleUps.fetch_add(1, std::memory_order_relaxed);
+    } else if (m_numIdle >= m_config.scaleDownSamples && active > minWorkers) {
+        target = active - 1;
+        m_scaleDowns.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (target != active) {
+        m_numBehind = 0;
+        m_numIdle = 0;
+        m_activeWorkers.store(target, std::memory_order_release);
+    }
+    return target;
+}
+
+AutoscaleStats DecodeAutoscaler::GetStats() const {
+    AutoscaleStats stats;
+    stats.activeWorkers = ActiveWorkers();
+    stats.maxWorkers = m_maxWorkers;
+    stats.scaleUps = m_scaleUps.load(std::memory_order_relaxed);
+    stats.scaleDowns = m_scaleDowns.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void DecodeAutoscaler::Start(std::function<AutoscaleSample()> sample, std::function<void(std::size_t)> apply) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_isRunning) {
+            return;
+        }
+        m_isRunning = true;
+    }
+
+    m_thread = std::thread([this, sample = std::move(sample), apply = std::move(apply)] {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_cv.wait_for(lock, m_config.interval, [this] { return !m_isRunning; })) {
+            lock.unlock();
+            const std::size_t before = ActiveWorkers();
+            const std::size_t after = Update(sample());
+            if (after != before) {
+                apply(after);
+            }
+            lock.lock();
+        }
+    });
+}
+
+void DecodeAutoscaler::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isRunning = false;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+}
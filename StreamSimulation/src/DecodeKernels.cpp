@@ -0,0 +1,454 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "DecodeKernels.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define STREAMSIM_X86_KERNELS 1
+#include <immintrin.h>
+#define SSE42_TARGET __attribute__((target("sse4.2")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+namespace {
+
+// JPEG's luminance table scaled to quality 90, so the coefficients stay small and the picture
+// doesn't just saturate.  Row major, the row is the vertical frequency.
+constexpr std::array<int32_t, StreamSim::Core::DECODE_BLOCK_SIZE> MakeQuantMatrix() {
+    constexpr std::array<int32_t, StreamSim::Core::DECODE_BLOCK_SIZE> JPEG_LUMINANCE = {
+        16, 11, 10, 16,  24,  40,  51,  61,
+        12, 12, 14, 19,  26,  58,  60,  55,
+        14, 13, 16, 24,  40,  57,  69,  56,
+        14, 17, 22, 29,  51,  87,  80,  62,
+        18, 22, 37, 56,  68, 109, 103,  77,
+        24, 35, 55, 64,  81, 104, 113,  92,
+        49, 64, 78, 87, 103, 121, 120, 101,
+        72, 92, 95, 98, 112, 100, 103,  99
+    };
+
+    std::array<int32_t, StreamSim::Core::DECODE_BLOCK_SIZE> matrix{};
+    for (std::size_t i = 0; i < matrix.size(); ++i) {
+        matrix[i] = std::max((JPEG_LUMINANCE[i] * 20 + 50) / 100, 1);
+    }
+    return matrix;
+}
+
+alignas(32) constexpr std::array<int32_t, StreamSim::Core::DECODE_BLOCK_SIZE> QUANT_MATRIX = MakeQuantMatrix();
+
+// BT.601 studio range YUV to RGB in 8.8 fixed point.
+constexpr int32_t Y_SCALE = 298;
+constexpr int32_t V_TO_R = 409;
+constexpr int32_t U_TO_G = 100;
+constexpr int32_t V_TO_G = 208;
+constexpr int32_t U_TO_B = 516;
+
+int32_t ClampSample(int32_t value) {
+    return std::clamp(value, 0, 255);
+}
+
+// The H.264 8x8 inverse transform on d[0], d[stride], ... d[7 * stride], in place.
+// The SIMD versions below are the same butterfly on whole rows, keep them in step.
+void InverseTransform8(int32_t* d, std::size_t stride) {
+    const int32_t d0 = d[0], d1 = d[stride], d2 = d[2 * stride], d3 = d[3 * stride];
+    const int32_t d4 = d[4 * stride], d5 = d[5 * stride], d6 = d[6 * stride], d7 = d[7 * stride];
+
+    const int32_t a0 = d0 + d4;
+    const int32_t a4 = d0 - d4;
+    const int32_t a2 = (d2 >> 1) - d6;
+    const int32_t a6 = d2 + (d6 >> 1);
+    const int32_t b0 = a0 + a6;
+    const int32_t b2 = a4 + a2;
+    const int32_t b4 = a4 - a2;
+    const int32_t b6 = a0 - a6;
+
+    const int32_t a1 = d5 - d3 - d7 - (d7 >> 1);
+    const int32_t a3 = d1 + d7 - d3 - (d3 >> 1);
+    const int32_t a5 = d7 - d1 + d5 + (d5 >> 1);
+    const int32_t a7 = d3 + d5 + d1 + (d1 >> 1);
+    const int32_t b1 = a1 + (a7 >> 2);
+    const int32_t b7 = a7 - (a1 >> 2);
+    const int32_t b3 = a3 + (a5 >> 2);
+    const int32_t b5 = (a3 >> 2) - a5;
+
+    d[0] = b0 + b7;
+    d[stride] = b2 + b5;
+    d[2 * stride] = b4 + b3;
+    d[3 * stride] = b6 + b1;
+    d[4 * stride] = b6 - b1;
+    d[5 * stride] = b4 - b3;
+    d[6 * stride] = b2 - b5;
+    d[7 * stride] = b0 - b7;
+}
+
+// Dequantize, transform columns then rows, round and offset to 8-bit samples.
+void DecodeBlockScalar(const uint8_t* coefficients, int32_t* samples) {
+    for (std::size_t i = 0; i < StreamSim::Core::DECODE_BLOCK_SIZE; ++i) {
+        samples[i] = static_cast<int8_t>(coefficients[i]) * QUANT_MATRIX[i];
+    }
+    for (std::size_t column = 0; column < 8; ++column) {
+        InverseTransform8(samples + column, 8);
+    }
+    for (std::size_t row = 0; row < 8; ++row) {
+        InverseTransform8(samples + row * 8, 1);
+    }
+    for (std::size_t i = 0; i < StreamSim::Core::DECODE_BLOCK_SIZE; ++i) {
+        samples[i] = ClampSample(((samples[i] + 32) >> 6) + 128);
+    }
+}
+
+void DecodeTileScalar(const uint8_t* input, uint8_t* output) {
+    constexpr std::size_t BLOCK = StreamSim::Core::DECODE_BLOCK_SIZE;
+    std::array<int32_t, BLOCK> y, u, v;
+    DecodeBlockScalar(input, y.data());
+    DecodeBlockScalar(input + BLOCK, u.data());
+    DecodeBlockScalar(input + 2 * BLOCK, v.data());
+
+    for (std::size_t i = 0; i < BLOCK; ++i) {
+        const int32_t c = Y_SCALE * (y[i] - 16) + 128;
+        const int32_t d = u[i] - 128;
+        const int32_t e = v[i] - 128;
+        output[i] = static_cast<uint8_t>(ClampSample((c + V_TO_R * e) >> 8));
+        output[BLOCK + i] = static_cast<uint8_t>(ClampSample((c - U_TO_G * d - V_TO_G * e) >> 8));
+        output[2 * BLOCK + i] = static_cast<uint8_t>(ClampSample((c + U_TO_B * d) >> 8));
+    }
+}
+
+#if defined(STREAMSIM_X86_KERNELS)
+
+// SSE4.2: a block row is two vectors, columns 0-3 in lo and 4-7 in hi.
+
+SSE42_TARGET inline void InverseTransform8Sse(__m128i* d) {
+    const __m128i a0 = _mm_add_epi32(d[0], d[4]);
+    const __m128i a4 = _mm_sub_epi32(d[0], d[4]);
+    const __m128i a2 = _mm_sub_epi32(_mm_srai_epi32(d[2], 1), d[6]);
+    const __m128i a6 = _mm_add_epi32(d[2], _mm_srai_epi32(d[6], 1));
+    const __m128i b0 = _mm_add_epi32(a0, a6);
+    const __m128i b2 = _mm_add_epi32(a4, a2);
+    const __m128i b4 = _mm_sub_epi32(a4, a2);
+    const __m128i b6 = _mm_sub_epi32(a0, a6);
+
+    const __m128i a1 = _mm_sub_epi32(_mm_sub_epi32(_mm_sub_epi32(d[5], d[3]), d[7]), _mm_srai_epi32(d[7], 1));
+    const __m128i a3 = _mm_sub_epi32(_mm_sub_epi32(_mm_add_epi32(d[1], d[7]), d[3]), _mm_srai_epi32(d[3], 1));
+    const __m128i a5 = _mm_add_epi32(_mm_add_epi32(_mm_sub_epi32(d[7], d[1]), d[5]), _mm_srai_epi32(d[5], 1));
+    const __m128i a7 = _mm_add_epi32(_mm_add_epi32(_mm_add_epi32(d[3], d[5]), d[1]), _mm_srai_epi32(d[1], 1));
+    const __m128i b1 = _mm_add_epi32(a1, _mm_srai_epi32(a7, 2));
+    const __m128i b7 = _mm_sub_epi32(a7, _mm_srai_epi32(a1, 2));
+    const __m128i b3 = _mm_add_epi32(a3, _mm_srai_epi32(a5, 2));
+    const __m128i b5 = _mm_sub_epi32(_mm_srai_epi32(a3, 2), a5);
+
+    d[0] = _mm_add_epi32(b0, b7);
+    d[1] = _mm_add_epi32(b2, b5);
+    d[2] = _mm_add_epi32(b4, b3);
+    d[3] = _mm_add_epi32(b6, b1);
+    d[4] = _mm_sub_epi32(b6, b1);
+    d[5] = _mm_sub_epi32(b4, b3);
+    d[6] = _mm_sub_epi32(b2, b5);
+    d[7] = _mm_sub_epi32(b0, b7);
+}
+
+SSE42_TARGET inline void Transpose4x4Sse(__m128i& r0, __m128i& r1, __m128i& r2, __m128i& r3) {
+    const __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+    const __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+    const __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+    const __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+    r0 = _mm_unpacklo_epi64(t0, t1);
+    r1 = _mm_unpackhi_epi64(t0, t1);
+    r2 = _mm_unpacklo_epi64(t2, t3);
+    r3 = _mm_unpackhi_epi64(t2, t3);
+}
+
+// Transposes the four 4x4 quarters, then swaps the two off the diagonal.
+SSE42_TARGET inline void Transpose8x8Sse(__m128i* lo, __m128i* hi) {
+    Transpose4x4Sse(lo[0], lo[1], lo[2], lo[3]);
+    Transpose4x4Sse(hi[0], hi[1], hi[2], hi[3]);
+    Transpose4x4Sse(lo[4], lo[5], lo[6], lo[7]);
+    Transpose4x4Sse(hi[4], hi[5], hi[6], hi[7]);
+    for (std::size_t i = 0; i < 4; ++i) {
+        std::swap(hi[i], lo[4 + i]);
+    }
+}
+
+SSE42_TARGET inline __m128i FinishSampleSse(__m128i value) {
+    value = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(value, _mm_set1_epi32(32)), 6), _mm_set1_epi32(128));
+    return _mm_min_epi32(_mm_max_epi32(value, _mm_setzero_si128()), _mm_set1_epi32(255));
+}
+
+SSE42_TARGET inline __m128i LoadCoefficientsSse(const uint8_t* coefficients) {
+    int32_t packed;
+    std::memcpy(&packed, coefficients, sizeof(packed));
+    return _mm_cvtepi8_epi32(_mm_cvtsi32_si128(packed));
+}
+
+SSE42_TARGET void DecodeBlockSse(const uint8_t* coefficients, __m128i* lo, __m128i* hi) {
+    for (std::size_t row = 0; row < 8; ++row) {
+        const int32_t* quant = QUANT_MATRIX.data() + row * 8;
+        lo[row] = _mm_mullo_epi32(LoadCoefficientsSse(coefficients + row * 8),
+                                  _mm_load_si128(reinterpret_cast<const __m128i*>(quant)));
+        hi[row] = _mm_mullo_epi32(LoadCoefficientsSse(coefficients + row * 8 + 4),
+                                  _mm_load_si128(reinterpret_cast<const __m128i*>(quant + 4)));
+    }
+
+    InverseTransform8Sse(lo);
+    InverseTransform8Sse(hi);
+    Transpose8x8Sse(lo, hi);
+    InverseTransform8Sse(lo);
+    InverseTransform8Sse(hi);
+    Transpose8x8Sse(lo, hi);
+
+    for (std::size_t row = 0; row < 8; ++row) {
+        lo[row] = FinishSampleSse(lo[row]);
+        hi[row] = FinishSampleSse(hi[row]);
+    }
+}
+
+SSE42_TARGET inline __m128i ToRgbSse(__m128i value) {
+    value = _mm_srai_epi32(value, 8);
+    return _mm_min_epi32(_mm_max_epi32(value, _mm_setzero_si128()), _mm_set1_epi32(255));
+}
+
+SSE42_TARGET inline void StoreRowSse(uint8_t* output, __m128i lo, __m128i hi) {
+    const __m128i words = _mm_packus_epi32(lo, hi);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(output), _mm_packus_epi16(words, words));
+}
+
+SSE42_TARGET void DecodeTileSse(const uint8_t* input, uint8_t* output) {
+    constexpr std::size_t BLOCK = StreamSim::Core::DECODE_BLOCK_SIZE;
+    __m128i yLo[8], yHi[8], uLo[8], uHi[8], vLo[8], vHi[8];
+    DecodeBlockSse(input, yLo, yHi);
+    DecodeBlockSse(input + BLOCK, uLo, uHi);
+    DecodeBlockSse(input + 2 * BLOCK, vLo, vHi);
+
+    const __m128i yScale = _mm_set1_epi32(Y_SCALE);
+    const __m128i vToR = _mm_set1_epi32(V_TO_R);
+    const __m128i uToG = _mm_set1_epi32(U_TO_G);
+    const __m128i vToG = _mm_set1_epi32(V_TO_G);
+    const __m128i uToB = _mm_set1_epi32(U_TO_B);
+    const __m128i lumaOffset = _mm_set1_epi32(16);
+    const __m128i chromaOffset = _mm_set1_epi32(128);
+    const __m128i rounding = _mm_set1_epi32(128);
+
+    for (std::size_t row = 0; row < 8; ++row) {
+        __m128i r[2], g[2], b[2];
+        const __m128i ys[2] = { yLo[row], yHi[row] };
+        const __m128i us[2] = { uLo[row], uHi[row] };
+        const __m128i vs[2] = { vLo[row], vHi[row] };
+        for (std::size_t half = 0; half < 2; ++half) {
+            const __m128i c = _mm_add_epi32(_mm_mullo_epi32(yScale, _mm_sub_epi32(ys[half], lumaOffset)), rounding);
+            const __m128i d = _mm_sub_epi32(us[half], chromaOffset);
+            const __m128i e = _mm_sub_epi32(vs[half], chromaOffset);
+            r[half] = ToRgbSse(_mm_add_epi32(c, _mm_mullo_epi32(vToR, e)));
+            g[half] = ToRgbSse(_mm_sub_epi32(_mm_sub_epi32(c, _mm_mullo_epi32(uToG, d)), _mm_mullo_epi32(vToG, e)));
+            b[half] = ToRgbSse(_mm_add_epi32(c, _mm_mullo_epi32(uToB, d)));
+        }
+        StoreRowSse(output + row * 8, r[0], r[1]);
+        StoreRowSse(output + BLOCK + row * 8, g[0], g[1]);
+        StoreRowSse(output + 2 * BLOCK + row * 8, b[0], b[1]);
+    }
+}
+
+// AVX2: a block row is one vector.
+
+AVX2_TARGET inline void InverseTransform8Avx2(__m256i* d) {
+    const __m256i a0 = _mm256_add_epi32(d[0], d[4]);
+    const __m256i a4 = _mm256_sub_epi32(d[0], d[4]);
+    const __m256i a2 = _mm256_sub_epi32(_mm256_srai_epi32(d[2], 1), d[6]);
+    const __m256i a6 = _mm256_add_epi32(d[2], _mm256_srai_epi32(d[6], 1));
+    const __m256i b0 = _mm256_add_epi32(a0, a6);
+    const __m256i b2 = _mm256_add_epi32(a4, a2);
+    const __m256i b4 = _mm256_sub_epi32(a4, a2);
+    const __m256i b6 = _mm256_sub_epi32(a0, a6);
+
+    const __m256i a1 = _mm256_sub_epi32(_mm256_sub_epi32(_mm256_sub_epi32(d[5], d[3]), d[7]), _mm256_srai_epi32(d[7], 1));
+    const __m256i a3 = _mm256_sub_epi32(_mm256_sub_epi32(_mm256_add_epi32(d[1], d[7]), d[3]), _mm256_srai_epi32(d[3], 1));
+    const __m256i a5 = _mm256_add_epi32(_mm256_add_epi32(_mm256_sub_epi32(d[7], d[1]), d[5]), _mm256_srai_epi32(d[5], 1));
+    const __m256i a7 = _mm256_add_epi32(_mm256_add_epi32(_mm256_add_epi32(d[3], d[5]), d[1]), _mm256_srai_epi32(d[1], 1));
+    const __m256i b1 = _mm256_add_epi32(a1, _mm256_srai_epi32(a7, 2));
+    const __m256i b7 = _mm256_sub_epi32(a7, _mm256_srai_epi32(a1, 2));
+    const __m256i b3 = _mm256_add_epi32(a3, _mm256_srai_epi32(a5, 2));
+    const __m256i b5 = _mm256_sub_epi32(_mm256_srai_epi32(a3, 2), a5);
+
+    d[0] = _mm256_add_epi32(b0, b7);
+    d[1] = _mm256_add_epi32(b2, b5);
+    d[2] = _mm256_add_epi32(b4, b3);
+    d[3] = _mm256_add_epi32(b6, b1);
+    d[4] = _mm256_sub_epi32(b6, b1);
+    d[5] = _mm256_sub_epi32(b4, b3);
+    d[6] = _mm256_sub_epi32(b2, b5);
+    d[7] = _mm256_sub_epi32(b0, b7);
+}
+
+// Pairs up rows within each 128-bit lane, then swaps lane halves to finish the columns.
+AVX2_TARGET inline void Transpose8x8Avx2(__m256i* r) {
+    const __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+    const __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+    const __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+    const __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+    const __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+    const __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+    const __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+    const __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+
+    const __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    const __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    const __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    const __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    const __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+    const __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+    const __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+    const __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+    r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+    r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+    r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+    r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+    r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+    r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+    r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+    r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+AVX2_TARGET inline __m256i ClampSampleAvx2(__m256i value) {
+    return _mm256_min_epi32(_mm256_max_epi32(value, _mm256_setzero_si256()), _mm256_set1_epi32(255));
+}
+
+AVX2_TARGET void DecodeBlockAvx2(const uint8_t* coefficients, __m256i* rows) {
+    for (std::size_t row = 0; row < 8; ++row) {
+        const __m256i values = _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(coefficients + row * 8)));
+        rows[row] = _mm256_mullo_epi32(values, _mm256_load_si256(reinterpret_cast<const __m256i*>(QUANT_MATRIX.data() + row * 8)));
+    }
+
+    InverseTransform8Avx2(rows);
+    Transpose8x8Avx2(rows);
+    InverseTransform8Avx2(rows);
+    Transpose8x8Avx2(rows);
+
+    const __m256i rounding = _mm256_set1_epi32(32);
+    const __m256i offset = _mm256_set1_epi32(128);
+    for (std::size_t row = 0; row < 8; ++row) {
+        rows[row] = ClampSampleAvx2(_mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(rows[row], rounding), 6), offset));
+    }
+}
+
+// Packs four rows of 0-255 values to 32 bytes.  The packs work per 128-bit lane, the permutes put
+// the 64-bit pieces back in row order.
+AVX2_TARGET inline void StoreRowsAvx2(uint8_t* output, const __m256i* rows) {
+    const __m256i rows01 = _mm256_permute4x64_epi64(_mm256_packus_epi32(rows[0], rows[1]), 0xD8);
+    const __m256i rows23 = _mm256_permute4x64_epi64(_mm256_packus_epi32(rows[2], rows[3]), 0xD8);
+    const __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(rows01, rows23), 0xD8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output), bytes);
+}
+
+AVX2_TARGET void DecodeTileAvx2(const uint8_t* input, uint8_t* output) {
+    constexpr std::size_t BLOCK = StreamSim::Core::DECODE_BLOCK_SIZE;
+    __m256i y[8], u[8], v[8];
+    DecodeBlockAvx2(input, y);
+    DecodeBlockAvx2(input + BLOCK, u);
+    DecodeBlockAvx2(input + 2 * BLOCK, v);
+
+    const __m256i yScale = _mm256_set1_epi32(Y_SCALE);
+    const __m256i vToR = _mm256_set1_epi32(V_TO_R);
+    const __m256i uToG = _mm256_set1_epi32(U_TO_G);
+    const __m256i vToG = _mm256_set1_epi32(V_TO_G);
+    const __m256i uToB = _mm256_set1_epi32(U_TO_B);
+    const __m256i lumaOffset = _mm256_set1_epi32(16);
+    const __m256i chromaOffset = _mm256_set1_epi32(128);
+    const __m256i rounding = _mm256_set1_epi32(128);
+
+    __m256i r[8], g[8], b[8];
+    for (std::size_t row = 0; row < 8; ++row) {
+        const __m256i c = _mm256_add_epi32(_mm256_mullo_epi32(yScale, _mm256_sub_epi32(y[row], lumaOffset)), rounding);
+        const __m256i d = _mm256_sub_epi32(u[row], chromaOffset);
+        const __m256i e = _mm256_sub_epi32(v[row], chromaOffset);
+        r[row] = ClampSampleAvx2(_mm256_srai_epi32(_mm256_add_epi32(c, _mm256_mullo_epi32(vToR, e)), 8));
+        g[row] = ClampSampleAvx2(_mm256_srai_epi32(
+            _mm256_sub_epi32(_mm256_sub_epi32(c, _mm256_mullo_epi32(uToG, d)), _mm256_mullo_epi32(vToG, e)), 8));
+        b[row] = ClampSampleAvx2(_mm256_srai_epi32(_mm256_add_epi32(c, _mm256_mullo_epi32(uToB, d)), 8));
+    }
+
+    for (std::size_t row = 0; row < 8; row += 4) {
+        StoreRowsAvx2(output + row * 8, r + row);
+        StoreRowsAvx2(output + BLOCK + row * 8, g + row);
+        StoreRowsAvx2(output + 2 * BLOCK + row * 8, b + row);
+    }
+}
+
+#endif
+
+using DecodeTileFunc = void (*)(const uint8_t*, uint8_t*);
+
+DecodeTileFunc GetDecodeTile(StreamSim::Core::DecodeKernelType type) {
+#if defined(STREAMSIM_X86_KERNELS)
+    if (StreamSim::Core::IsDecodeKernelSupported(type)) {
+        switch (type) {
+            case StreamSim::Core::DecodeKernelType::Avx2:
+                return DecodeTileAvx2;
+            case StreamSim::Core::DecodeKernelType::Sse42:
+                return DecodeTileSse;
+            default:
+                break;
+        }
+    }
+#endif
+    return DecodeTileScalar;
+}
+
+}
+
+namespace StreamSim::Core {
+
+const char* DecodeKernelName(DecodeKernelType type) {
+    switch (type) {
+        case DecodeKernelType::Sse42:
+            return "SSE4.2";
+        case DecodeKernelType::Avx2:
+            return "AVX2";
+        default:
+            return "Scalar";
+    }
+}
+
+bool IsDecodeKernelSupported(DecodeKernelType type) {
+    if (type == DecodeKernelType::Scalar) {
+        return true;
+    }
+
+#if defined(STREAMSIM_X86_KERNELS)
+    // Checks CPUID, and for AVX2 that the OS saves the wide registers.
+    __builtin_cpu_init();
+    switch (type) {
+        case DecodeKernelType::Sse42:
+            return __builtin_cpu_supports("sse4.2");
+        case DecodeKernelType::Avx2:
+            return __builtin_cpu_supports("avx2");
+        default:
+            break;
+    }
+#endif
+    return false;
+}
+
+DecodeKernelType GetBestDecodeKernel() {
+    static const DecodeKernelType best = [] {
+        for (DecodeKernelType type : { DecodeKernelType::Avx2, DecodeKernelType::Sse42 }) {
+            if (IsDecodeKernelSupported(type)) {
+                return type;
+            }
+        }
+        return DecodeKernelType::Scalar;
+    }();
+    return best;
+}
+
+void DecodePayload(DecodeKernelType type, const uint8_t* input, uint8_t* output, std::size_t size) {
+    const DecodeTileFunc decodeTile = GetDecodeTile(type);
+    std::size_t offset = 0;
+    for (; offset + DECODE_TILE_SIZE <= size; offset += DECODE_TILE_SIZE) {
+        decodeTile(input + offset, output + offset);
+    }
+    if (offset < size) {
+        std::memcpy(output + offset, input + offset, size - offset);
+    }
+}
+
+}
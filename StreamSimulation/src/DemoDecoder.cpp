@@ -1,20 +1,21 @@
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <iostream>
 #include "Decoder.hpp"
 
-namespace {
-    constexpr uint32_t DEFAULT_TIME_TO_DECODE_IN_MILISEC = 4;
-}
-
 namespace StreamSim::Core {
 
-DecoderTask::DecoderTask(const Core::ByteUndecodedFrame& frame,
+DecoderTask::DecoderTask(Core::ByteUndecodedFrame frame,
                          Decoder* decoder,
-                         Core::AsyncByteFrameQueue* renderBufferQueue)
-: m_frame(frame)
+                         Core::ByteFrameQueue* renderBufferQueue,
+                         DecodeLatencyHistograms* latency,
+                         std::atomic<uint64_t>* numExpired)
+: m_frame(std::move(frame))
 , m_decoder(decoder)
-, m_renderBufferQueue(renderBufferQueue) {
+, m_renderBufferQueue(renderBufferQueue)
+, m_latency(latency)
+, m_numExpired(numExpired) {
     assert(decoder != nullptr);
     assert(renderBufferQueue != nullptr);
 }
@@ -23,60 +24,262 @@ DecoderTask::~DecoderTask() {}
 
 void DecoderTask::operator()() {
     Core::ByteFrameElement decoded;
+    const uint64_t decodeStartNs = PipelineNowNs();
+    // A frame dropped before it got here is only passed on, whoever dropped it counted it.
+    const bool isDropped = m_frame.meta.isExpired;
+    if (isDropped || (!IsReferenceFrame(m_frame.meta) && IsPastDeadline(m_frame.meta, decodeStartNs))) {
+        MarkExpired(m_frame, decoded);
+        if (!isDropped && m_numExpired != nullptr) {
+            m_numExpired->fetch_add(1, std::memory_order_relaxed);
+        }
+        m_renderBufferQueue->WriteSync(decoded);
+        return;
+    }
+
     m_decoder->DecodeFrameData(m_frame, decoded);
+    decoded.meta.decodeStartNs = decodeStartNs;
+    decoded.meta.decodeEndNs = PipelineNowNs();
+
+    if (m_latency != nullptr) {
+        m_latency->queueWait.RecordInterval(decoded.meta.ingestNs, decoded.meta.decodeStartNs);
+        m_latency->decode.RecordInterval(decoded.meta.decodeStartNs, decoded.meta.decodeEndNs);
+    }
     m_renderBufferQueue->WriteSync(decoded);
 }
 
-DemoDecoder::DemoDecoder() {}
+void DecoderTask::Discard() {
+    Core::ByteFrameElement expired;
+    MarkExpired(m_frame, expired);
+    m_renderBufferQueue->WriteSync(expired);
+}
+
+DemoDecoder::DemoDecoder(DecodeKernelType kernel)
+: m_kernel(kernel) {}
 
 DemoDecoder::~DemoDecoder() {}
 
 void DemoDecoder::DecodeFrameData(const Core::ByteUndecodedFrame& frame, Core::ByteFrameElement& decoded) {
-    // Let's just assume decoding takes about 5 miliseconds, and decoding is just devide the frame value by 2.
-    std::this_thread::sleep_for(std::chrono::milliseconds(DEFAULT_TIME_TO_DECODE_IN_MILISEC));
+    // The frame value is still just divided by 2, the time goes into decoding the payload.
     decoded.data = frame.data / 2;
+    decoded.meta = frame.meta;
+    decoded.payload = Core::FrameBufferRef();
+
+    if (frame.payload) {
+        // The decoded image goes into a buffer from the same pool, never a fresh allocation.  On a host with
+        // several NUMA nodes it's the pool of the node decoding it instead, so the frame stays on that socket
+        // from here on.  Payloads that aren't pooled (replayed from a capture) decode into the local pool.
+        Core::FrameBufferPool* pool = frame.payload.Pool();
+        if (frame.payload.IsWrapped() || Core::CpuTopology::Host().NumNodes() > 1) {
+            pool = &Core::FrameBufferPool::Local();
+        }
+        // A payload too big for any pool buffer (only a wrapped one can be) goes on without a picture.
+        decoded.payload = pool->Acquire(frame.payload.Size());
+        if (decoded.payload) {
+            DecodePayload(m_kernel, frame.payload.Data(), decoded.payload.Data(), frame.payload.Size());
+        }
+    }
 }
 
-FrameElementQueueDecodeService::FrameElementQueueDecodeService(Core::AsyncByteFrameQueue* decodeQueue, Core::AsyncByteFrameQueue* renderQueue)
-: m_decodeBufferQueue(decodeQueue)
+FrameElementQueueDecodeService::FrameElementQueueDecodeService(Core::ByteFrameQueue* decodeQueue, Core::ByteFrameQueue* renderQueue,
+                                                               const PipelineConfig& config)
+: m_numThreads(std::max<std::size_t>(config.numDecoderThreads, 1))
+, m_placement(config.decodePlacement)
+, m_decodeThreads(m_numThreads)
+, m_workerCounters(std::make_unique<WorkerCounters[]>(m_numThreads))
+, m_decodeBufferQueue(decodeQueue)
 , m_renderBufferQueue(renderQueue)
-, m_isRunning(false) {
+, m_isRunning(false)
+, m_numActiveWorkers(m_numThreads) {
     assert(m_decodeBufferQueue != nullptr);
     assert(m_renderBufferQueue != nullptr);
+    if (config.decodeAutoscale.enabled) {
+        m_autoscaler = std::make_unique<DecodeAutoscaler>(config.decodeAutoscale, m_numThreads);
+    }
+}
+
+FrameElementQueueDecodeService::FrameElementQueueDecodeService(Core::ByteFrameQueue* decodeQueue,
+                                                               std::vector<Core::ByteFrameQueue*> streamRenderQueues,
+                                                               const PipelineConfig& config)
+: m_numThreads(std::max<std::size_t>(config.numDecoderThreads, 1))
+, m_placement(config.decodePlacement)
+, m_decodeThreads(m_numThreads)
+, m_workerCounters(std::make_unique<WorkerCounters[]>(m_numThreads))
+, m_decodeBufferQueue(decodeQueue)
+, m_renderBufferQueue(nullptr)
+, m_streamRenderQueues(std::move(streamRenderQueues))
+, m_isRunning(false)
+, m_numActiveWorkers(m_numThreads) {
+    assert(m_decodeBufferQueue != nullptr);
+    assert(!m_streamRenderQueues.empty());
+    if (config.decodeAutoscale.enabled) {
+        m_autoscaler = std::make_unique<DecodeAutoscaler>(config.decodeAutoscale, m_numThreads);
+    }
 }
 
 FrameElementQueueDecodeService::~FrameElementQueueDecodeService() {
     Shutdown();
 }
 
-void FrameElementQueueDecodeService::Run() {
-    m_isRunning.store(true, std::memory_order_release);
+Core::ByteFrameQueue* FrameElementQueueDecodeService::RenderQueueFor(uint32_t streamId) const {
+    if (m_streamRenderQueues.empty()) {
+        return m_renderBufferQueue;
+    }
+    return streamId < m_streamRenderQueues.size() ? m_streamRenderQueues[streamId] : nullptr;
+}
 
-    for (std::size_t i = 0; i < MAX_NUM_DECODER_THREADS; ++i) {
-        m_decodeThreads[i] = std::thread([this] {
-            Core::ByteUndecodedFrame undecodedFrame;
-            Core::ByteFrameElement decodedFrame;
+void FrameElementQueueDecodeService::WriteDecoded(const Core::ByteFrameElement& frame) {
+    // Frames of a stream nobody renders are dropped.
+    Core::ByteFrameQueue* queue = RenderQueueFor(frame.meta.streamId);
+    if (queue != nullptr) {
+        queue->WriteSync(frame);
+    }
+}
 
-            while (m_isRunning.load(std::memory_order_acquire)) {
-                if (m_decodeBufferQueue->IsEmpty()) {
-                    continue;
+AutoscaleSample FrameElementQueueDecodeService::SampleLoad() {
+    AutoscaleSample sample;
+    // Frames the jitter buffer is still holding back aren't waiting on a decoder.
+    sample.queueDepth = m_decodeBufferQueue->NumReadyElements();
+    sample.isQueueFull = m_decodeBufferQueue->IsFull();
+
+    HistogramSnapshot queueWait = GetLatencySnapshot().queueWait;
+    sample.queueWaitP99Ns = queueWait.Since(m_lastQueueWait).Percentile(99.0);
+    m_lastQueueWait = queueWait;
+    return sample;
+}
+
+void FrameElementQueueDecodeService::SetActiveWorkers(std::size_t numActive) {
+    m_numActiveWorkers.store(std::clamp<std::size_t>(numActive, 1, m_numThreads), std::memory_order_release);
+    m_workerWake.NotifyAll();
+}
+
+void FrameElementQueueDecodeService::DecodeWorker(std::size_t index) {
+    WorkerCounters& counters = m_workerCounters[index];
+    std::array<Core::ByteUndecodedFrame, DECODE_BATCH_SIZE> undecodedFrames;
+    std::array<Core::ByteFrameElement, DECODE_BATCH_SIZE> decodedFrames;
+    uint32_t spinPolls = MIN_SPIN_POLLS;
+    // Sized from what the last read got instead of asking the queue how full it is, which takes its lock.  A full
+    // read means more is waiting, so the next one may take twice as much, a short one means the queue ran dry and
+    // the others get their share of the next burst.
+    std::size_t batchLimit = DECODE_BATCH_SIZE;
+
+    while (true) {
+        // Parked until the autoscaler wants this worker back.  Once the queue is closed everyone helps drain it.
+        if (index >= NumActiveWorkers() && !IsStopping()) {
+            const uint32_t key = m_workerWake.PrepareWait();
+            if (index < NumActiveWorkers() || IsStopping()) {
+                m_workerWake.CancelWait();
+            } else {
+                counters.parks.fetch_add(1, std::memory_order_relaxed);
+                m_workerWake.Wait(key);
+            }
+            continue;
+        }
+
+        // Spin for a little while first.  When frames keep showing up during the spin the budget
+        // grows, and when the spin keeps coming up empty it shrinks back so idle workers park quickly.
+        std::size_t numFrames = 0;
+        for (uint32_t i = 0; i < spinPolls && numFrames == 0; ++i) {
+            numFrames = m_decodeBufferQueue->ReadBatchAsync(undecodedFrames, batchLimit);
+            if (numFrames == 0) {
+                Core::CpuRelax();
+            }
+        }
+
+        if (numFrames > 0) {
+            counters.spinHits.fetch_add(1, std::memory_order_relaxed);
+            spinPolls = std::min(spinPolls * 2, MAX_SPIN_POLLS);
+        } else {
+            spinPolls = std::max(spinPolls / 2, MIN_SPIN_POLLS);
+            counters.blockingReads.fetch_add(1, std::memory_order_relaxed);
+            numFrames = m_decodeBufferQueue->ReadBatch(undecodedFrames, batchLimit);
+            if (numFrames == 0) {
+                if (m_decodeBufferQueue->IsClosed() || (!m_isRunning.load(std::memory_order_acquire) && m_decodeBufferQueue->IsEmpty())) {
+                    return;
                 }
-                m_decodeBufferQueue->ReadSync(undecodedFrame);
-                m_mainDecoder.DecodeFrameData(undecodedFrame, decodedFrame);
-                m_renderBufferQueue->WriteSync(decodedFrame);
+                counters.readTimeouts.fetch_add(1, std::memory_order_relaxed);
+                continue;
             }
+        }
+
+        batchLimit = numFrames == batchLimit ? std::min(batchLimit * 2, DECODE_BATCH_SIZE) : numFrames;
+
+        for (std::size_t i = 0; i < numFrames; ++i) {
+            m_scheduler.Submit(std::move(undecodedFrames[i]));
+        }
 
-            while (!m_decodeBufferQueue->IsEmpty()) {
-                m_decodeBufferQueue->ReadSync(undecodedFrame);
-                m_mainDecoder.DecodeFrameData(undecodedFrame, decodedFrame);
-                m_renderBufferQueue->WriteSync(decodedFrame);
+        // Keep going while anything is ready, frames unlocked by this batch included.  Each frame goes on to the
+        // render queue as soon as it's decoded, so the first of a batch doesn't wait for the last.  A frame is only
+        // completed after it's in the render queue, so its dependents always come out after it.
+        while ((numFrames = m_scheduler.TakeReady(std::span<Core::ByteUndecodedFrame>(undecodedFrames.data(), batchLimit))) > 0) {
+            for (std::size_t i = 0; i < numFrames; ++i) {
+                Core::ByteUndecodedFrame& undecodedFrame = undecodedFrames[i];
+                Core::ByteFrameElement& decodedFrame = decodedFrames[i];
+
+                // Frames dropped upstream or by the scheduler only get passed on, so the queues after this one
+                // don't wait for them.  They were counted where they were dropped and are never completed.
+                if (undecodedFrame.meta.isExpired) {
+                    MarkExpired(undecodedFrame, decodedFrame);
+                    WriteDecoded(decodedFrame);
+                    undecodedFrame.payload = Core::FrameBufferRef();
+                    continue;
+                }
+
+                const uint64_t decodeStartNs = PipelineNowNs();
+                const bool isExpired = !IsReferenceFrame(undecodedFrame.meta) && IsPastDeadline(undecodedFrame.meta, decodeStartNs);
+                if (isExpired) {
+                    MarkExpired(undecodedFrame, decodedFrame);
+                } else {
+                    m_mainDecoder.DecodeFrameData(undecodedFrame, decodedFrame);
+
+                    Core::FrameMetadata& meta = decodedFrame.meta;
+                    meta.decodeStartNs = decodeStartNs;
+                    meta.decodeEndNs = PipelineNowNs();
+                    counters.latency.queueWait.RecordInterval(meta.ingestNs, meta.decodeStartNs);
+                    counters.latency.decode.RecordInterval(meta.decodeStartNs, meta.decodeEndNs);
+                }
+                WriteDecoded(decodedFrame);
+                (isExpired ? counters.framesExpired : counters.framesDecoded).fetch_add(1, std::memory_order_relaxed);
+                m_scheduler.Complete(undecodedFrame.meta);
+
+                // Give the payload buffers back now instead of holding them until the next batch overwrites them.
+                undecodedFrame.payload = Core::FrameBufferRef();
+                decodedFrame.payload = Core::FrameBufferRef();
             }
+        }
+    }
+}
+
+void FrameElementQueueDecodeService::Run() {
+    m_isRunning.store(true, std::memory_order_release);
+    if (m_autoscaler) {
+        m_numActiveWorkers.store(m_autoscaler->ActiveWorkers(), std::memory_order_release);
+    }
+
+    for (std::size_t i = 0; i < m_numThreads; ++i) {
+        m_decodeThreads[i] = std::thread([this, i] {
+            DecodeWorker(i);
         });
+        const CpuSet cpus = PlaceStageThread(CpuTopology::Host(), m_placement, i);
+        if (!SetThreadAffinity(m_decodeThreads[i], cpus)) {
+            std::cerr << "Could not pin decode thread " << i << " to CPUs " << FormatCpuSet(cpus) << std::endl;
+        }
+    }
+
+    if (m_autoscaler) {
+        m_lastQueueWait = GetLatencySnapshot().queueWait;
+        m_autoscaler->Start([this] { return SampleLoad(); },
+                            [this] (std::size_t numActive) { SetActiveWorkers(numActive); });
     }
 }
 
 void FrameElementQueueDecodeService::Shutdown() {
     m_isRunning.store(false, std::memory_order_release);
+    if (m_autoscaler) {
+        m_autoscaler->Stop();
+    }
+
+    // Parked workers come back to help drain what is left in the queue, then everyone exits.
+    m_workerWake.NotifyAll();
     
     for_each(m_decodeThreads.begin(), m_decodeThreads.end(), [] (std::thread& th) {
         if (th.joinable()) {
@@ -85,13 +288,181 @@ void FrameElementQueueDecodeService::Shutdown() {
     });
 }
 
-FrameElementPoolDecoder::FrameElementPoolDecoder(Core::AsyncByteFrameQueue* renderQueue)
-: m_renderBufferQueue(renderQueue) {}
+DecodeWorkerStats FrameElementQueueDecodeService::GetWorkerStats() const {
+    DecodeWorkerStats stats;
+    for (std::size_t i = 0; i < m_numThreads; ++i) {
+        const WorkerCounters& counters = m_workerCounters[i];
+        stats.framesDecoded += counters.framesDecoded.load(std::memory_order_relaxed);
+        stats.framesExpired += counters.framesExpired.load(std::memory_order_relaxed);
+        stats.spinHits += counters.spinHits.load(std::memory_order_relaxed);
+        stats.blockingReads += counters.blockingReads.load(std::memory_order_relaxed);
+        stats.readTimeouts += counters.readTimeouts.load(std::memory_order_relaxed);
+        stats.parks += counters.parks.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+DecodeLatencySnapshot FrameElementQueueDecodeService::GetLatencySnapshot() const {
+    DecodeLatencySnapshot snapshot;
+    for (std::size_t i = 0; i < m_numThreads; ++i) {
+        const WorkerCounters& counters = m_workerCounters[i];
+        snapshot.queueWait.Add(counters.latency.queueWait);
+        snapshot.decode.Add(counters.latency.decode);
+    }
+    return snapshot;
+}
+
+AutoscaleStats FrameElementQueueDecodeService::GetAutoscaleStats() const {
+    return m_autoscaler ? m_autoscaler->GetStats() : AutoscaleStats{};
+}
+
+namespace {
+    using DecodePoolTask = InplaceTask<sizeof(DecoderTask)>;
+
+    class SimpleDecodePool : public DecodePool {
+    private:
+        SimpleThreadPool<DecodePoolTask, DEFAULT_NUM_DECODER_THREADS> m_pool;
+
+    public:
+        SimpleDecodePool(AdmissionPolicy admissionPolicy, std::size_t numThreads, std::size_t capacity)
+        : m_pool(admissionPolicy, numThreads, capacity) {}
+
+        template <typename Visitor>
+        void ForEachWorker(Visitor visitor) {
+            m_pool.ForEachWorker(visitor);
+        }
+
+        void Enqueue(DecoderTask task) override {
+            m_pool.Enqueue(DecodePoolTask(std::move(task)));
+        }
+        void Stop() override {
+            m_pool.Stop();
+        }
+        std::size_t NumThreads() const override {
+            return m_pool.NumThreads();
+        }
+        void SetNumActiveThreads(std::size_t numActive) override {
+            m_pool.SetNumActiveThreads(numActive);
+        }
+        AdmissionStats GetAdmissionStats() const override {
+            return m_pool.GetAdmissionStats();
+        }
+        std::size_t Capacity() const override {
+            return m_pool.Capacity();
+        }
+    };
+
+    class WorkStealingDecodePool : public DecodePool {
+    private:
+        WorkStealingThreadPool<DecodePoolTask> m_pool;
+
+    public:
+        explicit WorkStealingDecodePool(std::size_t numThreads)
+        : m_pool(numThreads) {}
+
+        template <typename Visitor>
+        void ForEachWorker(Visitor visitor) {
+            m_pool.ForEachWorker(visitor);
+        }
+
+        void Enqueue(DecoderTask task) override {
+            m_pool.Enqueue(DecodePoolTask(std::move(task)));
+        }
+        void Stop() override {
+            m_pool.Stop();
+        }
+        std::size_t NumThreads() const override {
+            return m_pool.NumThreads();
+        }
+        void SetNumActiveThreads(std::size_t) override {}
+        AdmissionStats GetAdmissionStats() const override {
+            return AdmissionStats{};
+        }
+        std::size_t Capacity() const override {
+            return 0;
+        }
+    };
+
+    // Creates the pool and places its workers like the decode stage says.
+    template <typename Pool, typename... Args>
+    std::unique_ptr<DecodePool> MakeDecodePool(const PipelineConfig& config, Args&&... args) {
+        auto pool = std::make_unique<Pool>(std::forward<Args>(args)...);
+        std::size_t workerIndex = 0;
+        pool->ForEachWorker([&config, &workerIndex] (std::thread& worker) {
+            const CpuSet cpus = PlaceStageThread(CpuTopology::Host(), config.decodePlacement, workerIndex++);
+            if (!SetThreadAffinity(worker, cpus)) {
+                std::cerr << "Could not pin decode pool worker to CPUs " << FormatCpuSet(cpus) << std::endl;
+            }
+        });
+        return pool;
+    }
+}
+
+FrameElementPoolDecoder::FrameElementPoolDecoder(Core::ByteFrameQueue* renderQueue, DecodePoolType poolType,
+                                                 const PipelineConfig& config)
+: m_renderBufferQueue(renderQueue)
+, m_frameDeadline(config.frameDeadline) {
+    assert(m_renderBufferQueue != nullptr);
+
+    if (poolType == DecodePoolType::WorkStealing) {
+        m_decodePool = MakeDecodePool<WorkStealingDecodePool>(config, config.numDecoderThreads);
+    } else {
+        m_decodePool = MakeDecodePool<SimpleDecodePool>(config, config.decodePoolPolicy, config.numDecoderThreads,
+                                                        config.decodePoolCapacity);
 
-FrameElementPoolDecoder::~FrameElementPoolDecoder() {}
+        if (config.decodeAutoscale.enabled) {
+            m_autoscaler = std::make_unique<DecodeAutoscaler>(config.decodeAutoscale, m_decodePool->NumThreads());
+            m_decodePool->SetNumActiveThreads(m_autoscaler->ActiveWorkers());
+            m_lastQueueWait = GetLatencySnapshot().queueWait;
+            m_autoscaler->Start([this] {
+                const Core::AdmissionStats admission = m_decodePool->GetAdmissionStats();
+                const HistogramSnapshot queueWait = GetLatencySnapshot().queueWait;
+
+                AutoscaleSample sample;
+                sample.queueDepth = admission.queued;
+                sample.isQueueFull = admission.queued >= m_decodePool->Capacity();
+                sample.queueWaitP99Ns = queueWait.Since(m_lastQueueWait).Percentile(99.0);
+                m_lastQueueWait = queueWait;
+                return sample;
+            }, [this] (std::size_t numActive) {
+                m_decodePool->SetNumActiveThreads(numActive);
+            });
+        }
+    }
+}
+
+FrameElementPoolDecoder::~FrameElementPoolDecoder() {
+    Shutdown();
+}
 
 void FrameElementPoolDecoder::OnInputStreamData(const Core::ByteUndecodedFrame& data) {
-    m_decodePool.Enqueue(DecoderTask(data, &m_mainDecoder, m_renderBufferQueue));
+    // This is where frames enter the pipeline, there is no queue in front of the pool.
+    Core::ByteUndecodedFrame frame = data;
+    StampIngest(frame.meta, m_frameDeadline);
+
+    m_decodePool->Enqueue(DecoderTask(std::move(frame), &m_mainDecoder, m_renderBufferQueue, &m_latency, &m_framesExpired));
+}
+
+void FrameElementPoolDecoder::Shutdown() {
+    if (m_autoscaler) {
+        m_autoscaler->Stop();
+    }
+    m_decodePool->Stop();
+}
+
+Core::AdmissionStats FrameElementPoolDecoder::GetAdmissionStats() const {
+    return m_decodePool->GetAdmissionStats();
+}
+
+DecodeLatencySnapshot FrameElementPoolDecoder::GetLatencySnapshot() const {
+    DecodeLatencySnapshot snapshot;
+    snapshot.queueWait.Add(m_latency.queueWait);
+    snapshot.decode.Add(m_latency.decode);
+    return snapshot;
+}
+
+AutoscaleStats FrameElementPoolDecoder::GetAutoscaleStats() const {
+    return m_autoscaler ? m_autoscaler->GetStats() : AutoscaleStats{};
 }
 
 }
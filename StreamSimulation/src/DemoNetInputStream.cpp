@@ -4,16 +4,19 @@
 
 namespace StreamSim::Net {
 
-DemoNetInputStreamHandler::DemoNetInputStreamHandler(Core::AsyncByteFrameQueue* buffer)
-: m_buffer(buffer) {
+DemoNetInputStreamHandler::DemoNetInputStreamHandler(Core::ByteFrameQueue* buffer, std::chrono::milliseconds deadline)
+: m_buffer(buffer)
+, m_deadline(deadline) {
     assert(m_buffer != nullptr);
 }
 
 DemoNetInputStreamHandler::~DemoNetInputStreamHandler() {}
 
 void DemoNetInputStreamHandler::OnInputStreamData(const Core::ByteUndecodedFrame& data) {
-    // Write to async buffer for this to be decoded later.
-    m_buffer->WriteSync(data);
+    // Write to async buffer for this to be decoded later, stamped with when it entered the pipeline and when it has to be shown by.
+    Core::ByteUndecodedFrame frame = data;
+    Core::StampIngest(frame.meta, m_deadline);
+    m_buffer->WriteSync(frame);
 }
 
 }
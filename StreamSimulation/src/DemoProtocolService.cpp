@@ -1,53 +1,169 @@
+#include <algorithm>
 #include <chrono>
-#include <random>
+#include <iostream>
 #include "ProtocolService.hpp"
+#include "ReorderWindow.hpp"
+#include "UdpInputStream.hpp"
 
 namespace {
-    constexpr uint32_t DEFAULT_RECEIVE_DATA_FREQUENCY = 1;
+    StreamSim::Core::PipelineConfig MakeConfig(std::size_t numThreads, uint32_t runTimeSec) {
+        StreamSim::Core::PipelineConfig config;
+        config.numIngestThreads = numThreads;
+        config.runTimeSec = runTimeSec;
+        return config;
+    }
+
+    // The queue in front of a stage goes on the node of that stage, if it has one.
+    std::optional<uint32_t> QueueNode(const StreamSim::Core::StagePlacement& reader) {
+        return StreamSim::Core::StageNode(StreamSim::Core::CpuTopology::Host(), reader);
+    }
+
+    std::unique_ptr<StreamSim::Core::ByteFrameQueue> MakeQueueOnNode(StreamSim::Core::FrameQueueType type,
+                                                                     const StreamSim::Core::QueueConfig& config,
+                                                                     const StreamSim::Core::StagePlacement& reader) {
+        return StreamSim::Core::ConstructOnNode(StreamSim::Core::CpuTopology::Host(), QueueNode(reader), [&] {
+            return StreamSim::Core::MakeByteFrameQueue(type, config.capacity, config.wait);
+        });
+    }
+
+    std::vector<std::unique_ptr<StreamSim::Core::ByteFrameQueue>> MakeStreamQueues(std::size_t numStreams,
+                                                                                   const StreamSim::Core::PipelineConfig& config) {
+        std::vector<std::unique_ptr<StreamSim::Core::ByteFrameQueue>> queues;
+        for (std::size_t i = 0; i < numStreams; ++i) {
+            queues.push_back(MakeQueueOnNode(StreamSim::Core::FrameQueueType::Reordering, config.renderQueue, config.renderPlacement));
+        }
+        return queues;
+    }
+
+    StreamSim::Core::CpuSet RenderCpus(const StreamSim::Core::PipelineConfig& config, std::size_t index) {
+        return StreamSim::Core::PlaceStageThread(StreamSim::Core::CpuTopology::Host(), config.renderPlacement, index);
+    }
+
+    void PinStageThread(std::thread& thread, const StreamSim::Core::StagePlacement& placement, std::size_t index, const char* stage) {
+        const StreamSim::Core::CpuSet cpus = StreamSim::Core::PlaceStageThread(StreamSim::Core::CpuTopology::Host(), placement, index);
+        if (!StreamSim::Core::SetThreadAffinity(thread, cpus)) {
+            std::cerr << "Could not pin " << stage << " thread to CPUs " << StreamSim::Core::FormatCpuSet(cpus) << std::endl;
+        }
+    }
+
+    void PinIngestThread(std::thread& thread, const StreamSim::Core::StagePlacement& placement, std::size_t index) {
+        PinStageThread(thread, placement, index, "ingest");
+    }
+
+    void AddQueueStats(StreamSim::Core::QueueStats& total, const StreamSim::Core::QueueStats& stats) {
+        total.depth += stats.depth;
+        total.maxDepth = std::max(total.maxDepth, stats.maxDepth);
+        total.dropped += stats.dropped;
+    }
+
+    void AddRenderStats(StreamSim::Render::RenderStats& total, const StreamSim::Render::RenderStats& stats) {
+        total.framesPresented += stats.framesPresented;
+        total.framesDropped += stats.framesDropped;
+        total.framesExpired += stats.framesExpired;
+        total.framesDuplicated += stats.framesDuplicated;
+        total.vsyncs += stats.vsyncs;
+        total.meanPresentJitterUs = std::max(total.meanPresentJitterUs, stats.meanPresentJitterUs);
+        total.maxPresentJitterUs = std::max(total.maxPresentJitterUs, stats.maxPresentJitterUs);
+    }
+
+    void SummarizeLatency(StreamSim::Net::PipelineStats& stats, const StreamSim::Core::DecodeLatencySnapshot& decode,
+                          const StreamSim::Core::RenderLatencySnapshot& render) {
+        stats.queueWait = decode.queueWait.Summarize();
+        stats.decode = decode.decode.Summarize();
+        stats.renderWait = render.renderWait.Summarize();
+        stats.endToEnd = render.endToEnd.Summarize();
+    }
+
+    // Everything but decodeExpired comes out of the stats already filled in.
+    void SummarizeDrops(StreamSim::Net::PipelineStats& stats, uint64_t decodeExpired) {
+        stats.drops.decodeQueue = stats.decodeQueue.dropped;
+        stats.drops.decodePool = stats.decodePool.rejected + stats.decodePool.droppedOldest + stats.decodePool.droppedNewest;
+        stats.drops.decodeExpired = decodeExpired;
+        stats.drops.renderQueue = stats.renderQueue.dropped;
+        stats.drops.renderExpired = stats.render.framesExpired;
+        stats.drops.renderSuperseded = stats.render.framesDropped;
+    }
+
+    std::vector<StreamSim::Core::ByteFrameQueue*> GetQueuePointers(const std::vector<std::unique_ptr<StreamSim::Core::ByteFrameQueue>>& queues) {
+        std::vector<StreamSim::Core::ByteFrameQueue*> pointers;
+        for (const auto& queue : queues) {
+            pointers.push_back(queue.get());
+        }
+        return pointers;
+    }
 }
 
 namespace StreamSim::Net {
 
-DemoProtocolServiceQueued::DemoProtocolServiceQueued(std::size_t numThreads, uint32_t runTimeSec)
-: m_decodableBuffer(std::make_unique<Core::AsyncByteFrameQueue>())
-, m_decodedBuffer(std::make_unique<Core::AsyncByteFrameQueue>())
-, m_numIncomingDataThreads(numThreads)
-, m_threadRunTime(runTimeSec)
-, m_inputStreamHandler(m_decodableBuffer.get())
-, m_decodeService(m_decodableBuffer.get(), m_decodedBuffer.get())
-, m_renderer(m_decodedBuffer.get()) {}
+DemoProtocolServiceQueued::DemoProtocolServiceQueued(const Core::PipelineConfig& config,
+                                                     IngestSource ingestSource, uint16_t udpPort,
+                                                     Render::RenderSink* renderSink)
+: m_decodableBuffer(Core::ConstructOnNode(Core::CpuTopology::Host(), QueueNode(config.decodePlacement), [&] {
+    return std::make_unique<Core::JitterByteFrameQueue>(config.decodeQueue.capacity, config.decodeQueue.wait);
+}))
+, m_decodedBuffer(MakeQueueOnNode(Core::FrameQueueType::Reordering, config.renderQueue, config.renderPlacement))
+, m_numIncomingDataThreads(config.numIngestThreads)
+, m_threadRunTime(config.runTimeSec)
+, m_ingestPlacement(config.ingestPlacement)
+, m_inputStreamHandler(m_decodableBuffer.get(), config.frameDeadline)
+, m_ingestSource(ingestSource)
+, m_udpPort(udpPort)
+, m_decodeService(m_decodableBuffer.get(), m_decodedBuffer.get(), config)
+, m_renderer(m_decodedBuffer.get(), config.renderMode, config.renderRefreshRateHz, renderSink, RenderCpus(config, 0)) {
+    if (m_ingestSource == IngestSource::Udp) {
+        m_udpInputStream = std::make_unique<UdpInputStream>(&m_inputStreamHandler, udpPort);
+    }
+}
+
+DemoProtocolServiceQueued::DemoProtocolServiceQueued(std::size_t numThreads, uint32_t runTimeSec,
+                                                     IngestSource ingestSource, uint16_t udpPort,
+                                                     Render::RenderSink* renderSink)
+: DemoProtocolServiceQueued(MakeConfig(numThreads, runTimeSec), ingestSource, udpPort, renderSink) {}
+
+bool DemoProtocolServiceQueued::RecordCapture(const std::string& path) {
+    auto recorder = std::make_unique<CaptureRecorder>(path, &m_inputStreamHandler);
+    if (!recorder->IsOpen()) {
+        return false;
+    }
+
+    m_captureRecorder = std::move(recorder);
+    if (m_udpInputStream) {
+        // The receive thread isn't running yet, so the stream can just be made again in front of the recorder.
+        m_udpInputStream = std::make_unique<UdpInputStream>(m_captureRecorder.get(), m_udpPort);
+    }
+    return true;
+}
 
 DemoProtocolServiceQueued::~DemoProtocolServiceQueued() {
     Shutdown();
 }
 
 bool DemoProtocolServiceQueued::Run() {
-    for (std::size_t i = 0; i < m_numIncomingDataThreads; ++i) {
+    m_startTime = std::chrono::steady_clock::now();
+
+    if (m_udpInputStream) {
+        if (!m_udpInputStream->Start()) {
+            return false;
+        }
+
+        // Listen for the run time, the receive thread hands frames to the same handler the simulated ingest uses.
         m_incomingDataThreads.emplace_back(std::thread([this] {
-            // Initialize random number generator
-            std::random_device rd;
-            std::mt19937 generator(rd());
-            std::uniform_int_distribution<int> distribution(0, 255);
-
-            auto start = std::chrono::high_resolution_clock::now();
-            auto end = start + std::chrono::seconds(m_threadRunTime);
-
-            int count = 0;
-            
-            while (std::chrono::high_resolution_clock::now() < end) {
-                // Just generate random number between 0 - 255 for the sake of simulating
-                // incoming streaming data.  Of course, this isn't really indicative of what real data is going to be like
-                // but for this task, this should be enough.
-                auto randNum = distribution(generator);
-                Core::ByteUndecodedFrame data;
-                data.data = static_cast<uint8_t>(randNum);
-                
-                std::this_thread::sleep_for(std::chrono::milliseconds(DEFAULT_RECEIVE_DATA_FREQUENCY));
-                m_inputStreamHandler.OnInputStreamData(data);
-            }
+            std::this_thread::sleep_for(std::chrono::seconds(m_threadRunTime));
+            m_udpInputStream->Stop();
         }));
     }
 
+    for (std::size_t i = 0; i < m_numIncomingDataThreads && m_ingestSource == IngestSource::Simulated; ++i) {
+        m_incomingDataThreads.emplace_back(std::thread([this, i] {
+            // Seeded generated data (or a replayed capture) for the sake of simulating incoming streaming data.
+            // Of course, this isn't really indicative of what real data is going to be like
+            // but for this task, this should be enough.
+            LoadGenerator generator(m_loadProfile, i, m_numIncomingDataThreads);
+            generator.Run(IngestHandler(), m_startTime, std::chrono::seconds(m_threadRunTime));
+        }));
+        PinIngestThread(m_incomingDataThreads.back(), m_ingestPlacement, i);
+    }
+
     m_decodeService.Run();
     m_renderer.Run();
 
@@ -61,7 +177,14 @@ bool DemoProtocolServiceQueued::Shutdown() {
         }
     });
 
+    if (m_captureRecorder) {
+        m_captureRecorder->Close();
+    }
+
+    // Closed in pipeline order, so every stage drains what the one before it left and stops.
+    m_decodableBuffer->Close();
     m_decodeService.Shutdown();
+    m_decodedBuffer->Close();
     m_renderer.Shutdown();
 
     m_incomingDataThreads.clear();
@@ -69,6 +192,17 @@ bool DemoProtocolServiceQueued::Shutdown() {
     return true;
 }
 
+PipelineStats DemoProtocolServiceQueued::GetStats() const {
+    PipelineStats stats;
+    SummarizeLatency(stats, m_decodeService.GetLatencySnapshot(), m_renderer.GetLatencySnapshot());
+    stats.decodeQueue = m_decodableBuffer->GetQueueStats();
+    stats.renderQueue = m_decodedBuffer->GetQueueStats();
+    stats.decodeAutoscale = m_decodeService.GetAutoscaleStats();
+    stats.render = m_renderer.GetStats();
+    SummarizeDrops(stats, m_decodeService.GetWorkerStats().framesExpired);
+    return stats;
+}
+
 /*
     // Simulated thread with incoming streaming data which gets pushed into decodable buffer.
     std::size_t m_numIncomingDataThreads;
@@ -80,42 +214,45 @@ bool DemoProtocolServiceQueued::Shutdown() {
     // Rendering service.
     Render::FrameElementRenderHandler m_renderer;
 */
-DemoProtocolServicePooled::DemoProtocolServicePooled(std::size_t numThreads, uint32_t runTimeSec)
-: m_decodedBuffer(std::make_unique<Core::AsyncByteFrameQueue>())
-, m_numIncomingDataThreads(numThreads)
-, m_threadRunTime(runTimeSec)
-, m_poolDecoder(m_decodedBuffer.get())
-, m_renderer(m_decodedBuffer.get()) {}
+DemoProtocolServicePooled::DemoProtocolServicePooled(const Core::PipelineConfig& config, Core::DecodePoolType poolType,
+                                                     Render::RenderSink* renderSink)
+: m_decodedBuffer(MakeQueueOnNode(Core::FrameQueueType::Reordering, config.renderQueue, config.renderPlacement))
+, m_numIncomingDataThreads(config.numIngestThreads)
+, m_threadRunTime(config.runTimeSec)
+, m_ingestPlacement(config.ingestPlacement)
+, m_poolDecoder(m_decodedBuffer.get(), poolType, config)
+, m_renderer(m_decodedBuffer.get(), config.renderMode, config.renderRefreshRateHz, renderSink, RenderCpus(config, 0)) {}
+
+DemoProtocolServicePooled::DemoProtocolServicePooled(std::size_t numThreads, uint32_t runTimeSec, Core::DecodePoolType poolType,
+                                                     Render::RenderSink* renderSink)
+: DemoProtocolServicePooled(MakeConfig(numThreads, runTimeSec), poolType, renderSink) {}
 
 DemoProtocolServicePooled::~DemoProtocolServicePooled() {
+    Shutdown();
+}
+
+bool DemoProtocolServicePooled::RecordCapture(const std::string& path) {
+    auto recorder = std::make_unique<CaptureRecorder>(path, &m_poolDecoder);
+    if (!recorder->IsOpen()) {
+        return false;
+    }
 
+    m_captureRecorder = std::move(recorder);
+    return true;
 }
 
 bool DemoProtocolServicePooled::Run() {
+    m_startTime = std::chrono::steady_clock::now();
+
     for (std::size_t i = 0; i < m_numIncomingDataThreads; ++i) {
-        m_incomingDataThreads.emplace_back(std::thread([this] {
-            // Initialize random number generator
-            std::random_device rd;
-            std::mt19937 generator(rd());
-            std::uniform_int_distribution<int> distribution(0, 255);
-
-            auto start = std::chrono::high_resolution_clock::now();
-            auto end = start + std::chrono::seconds(m_threadRunTime);
-
-            int count = 0;
-            
-            while (std::chrono::high_resolution_clock::now() < end) {
-                // Just generate random number between 0 - 255 for the sake of simulating
-                // incoming streaming data.  Of course, this isn't really indicative of what real data is going to be like
-                // but for this task, this should be enough.
-                auto randNum = distribution(generator);
-                Core::ByteUndecodedFrame data;
-                data.data = static_cast<uint8_t>(randNum);
-                
-                std::this_thread::sleep_for(std::chrono::milliseconds(DEFAULT_RECEIVE_DATA_FREQUENCY));
-                m_poolDecoder.OnInputStreamData(data);
-            }
+        m_incomingDataThreads.emplace_back(std::thread([this, i] {
+            // Seeded generated data (or a replayed capture) for the sake of simulating incoming streaming data.
+            // Of course, this isn't really indicative of what real data is going to be like
+            // but for this task, this should be enough.
+            LoadGenerator generator(m_loadProfile, i, m_numIncomingDataThreads);
+            generator.Run(IngestHandler(), m_startTime, std::chrono::seconds(m_threadRunTime));
         }));
+        PinIngestThread(m_incomingDataThreads.back(), m_ingestPlacement, i);
     }
 
     m_renderer.Run();
@@ -130,10 +267,321 @@ bool DemoProtocolServicePooled::Shutdown() {
         }
     });
 
+    if (m_captureRecorder) {
+        m_captureRecorder->Close();
+    }
+
+    m_poolDecoder.Shutdown();
+    m_decodedBuffer->Close();
     m_renderer.Shutdown();
 
     m_incomingDataThreads.clear();
 
     return true;
 }
+
+PipelineStats DemoProtocolServicePooled::GetStats() const {
+    PipelineStats stats;
+    SummarizeLatency(stats, m_poolDecoder.GetLatencySnapshot(), m_renderer.GetLatencySnapshot());
+    stats.renderQueue = m_decodedBuffer->GetQueueStats();
+    stats.decodePool = m_poolDecoder.GetAdmissionStats();
+    stats.decodeAutoscale = m_poolDecoder.GetAutoscaleStats();
+    stats.render = m_renderer.GetStats();
+    SummarizeDrops(stats, m_poolDecoder.GetExpiredFrames());
+    return stats;
+}
+
+DemoProtocolServiceMultiStream::DemoProtocolServiceMultiStream(const Core::PipelineConfig& config,
+                                                               const std::vector<uint32_t>& weights)
+: m_decodableBuffer(Core::ConstructOnNode(Core::CpuTopology::Host(), QueueNode(config.decodePlacement), [&] {
+    return std::make_unique<Core::FairShareByteFrameQueue>(config.decodeQueue.capacity, config.decodeQueue.wait);
+}))
+, m_decodedBuffers(MakeStreamQueues(config.numIngestThreads, config))
+, m_numStreams(config.numIngestThreads)
+, m_threadRunTime(config.runTimeSec)
+, m_ingestPlacement(config.ingestPlacement)
+, m_inputStreamHandler(m_decodableBuffer.get(), config.frameDeadline)
+, m_decodeService(m_decodableBuffer.get(), GetQueuePointers(m_decodedBuffers), config) {
+    for (std::size_t i = 0; i < weights.size() && i < m_numStreams; ++i) {
+        m_decodableBuffer->SetStreamWeight(static_cast<uint32_t>(i), weights[i]);
+    }
+    for (std::size_t i = 0; i < m_decodedBuffers.size(); ++i) {
+        m_renderers.push_back(std::make_unique<Render::FrameElementRenderHandler>(
+            m_decodedBuffers[i].get(), config.renderMode, config.renderRefreshRateHz, nullptr, RenderCpus(config, i)));
+    }
+}
+
+DemoProtocolServiceMultiStream::DemoProtocolServiceMultiStream(std::size_t numStreams, uint32_t runTimeSec,
+                                                               const std::vector<uint32_t>& weights)
+: DemoProtocolServiceMultiStream(MakeConfig(numStreams, runTimeSec), weights) {}
+
+DemoProtocolServiceMultiStream::~DemoProtocolServiceMultiStream() {
+    Shutdown();
+}
+
+bool DemoProtocolServiceMultiStream::Run() {
+    m_startTime = std::chrono::steady_clock::now();
+
+    for (std::size_t i = 0; i < m_numStreams; ++i) {
+        const uint32_t streamId = static_cast<uint32_t>(i);
+        LoadProfile profile = m_loadProfile;
+        profile.streamId = streamId;
+        profile.seed += streamId;
+        if (streamId == 0) {
+            profile.framesPerSec *= HEAVY_STREAM_RATE;
+        }
+
+        // Sequence numbers are per stream.
+        m_incomingDataThreads.emplace_back(std::thread([this, profile] {
+            LoadGenerator generator(profile);
+            generator.Run(m_inputStreamHandler, m_startTime, std::chrono::seconds(m_threadRunTime));
+        }));
+        PinIngestThread(m_incomingDataThreads.back(), m_ingestPlacement, i);
+    }
+
+    m_decodeService.Run();
+    for (auto& renderer : m_renderers) {
+        renderer->Run();
+    }
+
+    return true;
+}
+
+bool DemoProtocolServiceMultiStream::Shutdown() {
+    for_each(m_incomingDataThreads.begin(), m_incomingDataThreads.end(), [](std::thread& th) {
+        if (th.joinable()) {
+            th.join();
+        }
+    });
+
+    m_decodableBuffer->Close();
+    m_decodeService.Shutdown();
+    for (auto& decodedBuffer : m_decodedBuffers) {
+        decodedBuffer->Close();
+    }
+    for (auto& renderer : m_renderers) {
+        renderer->Shutdown();
+    }
+
+    m_incomingDataThreads.clear();
+
+    return true;
+}
+
+PipelineStats DemoProtocolServiceMultiStream::GetStats() const {
+    PipelineStats stats;
+    Core::RenderLatencySnapshot renderLatency;
+    for (const auto& renderer : m_renderers) {
+        const Core::RenderLatencySnapshot snapshot = renderer->GetLatencySnapshot();
+        renderLatency.renderWait.Merge(snapshot.renderWait);
+        renderLatency.endToEnd.Merge(snapshot.endToEnd);
+        AddRenderStats(stats.render, renderer->GetStats());
+    }
+    SummarizeLatency(stats, m_decodeService.GetLatencySnapshot(), renderLatency);
+
+    stats.decodeQueue = m_decodableBuffer->GetQueueStats();
+    stats.decodeAutoscale = m_decodeService.GetAutoscaleStats();
+    for (const auto& queue : m_decodedBuffers) {
+        AddQueueStats(stats.renderQueue, queue->GetQueueStats());
+    }
+    SummarizeDrops(stats, m_decodeService.GetWorkerStats().framesExpired);
+    return stats;
+}
+
+DemoProtocolServiceCoroutine::DemoProtocolServiceCoroutine(const Core::PipelineConfig& config, Render::RenderSink* renderSink)
+: m_numStreams(config.numIngestThreads)
+, m_threadRunTime(config.runTimeSec)
+, m_frameDeadline(config.frameDeadline)
+, m_reorderWindow(config.renderQueue.capacity)
+, m_executor(config.numExecutorThreads)
+, m_defaultSink(renderSink == nullptr ? std::make_unique<Render::ConsoleRenderSink>() : nullptr)
+, m_sink(renderSink != nullptr ? renderSink : m_defaultSink.get())
+, m_presentQueue(std::make_unique<FrameQueue>(m_executor, config.renderQueue.capacity)) {
+    std::size_t index = 0;
+    m_executor.ForEachWorker([&](std::thread& thread) {
+        PinStageThread(thread, config.executorPlacement, index++, "executor");
+    });
+
+    for (std::size_t i = 0; i < m_numStreams; ++i) {
+        m_streams.push_back(StreamQueues{ std::make_unique<FrameQueue>(m_executor, config.decodeQueue.capacity),
+                                          std::make_unique<FrameQueue>(m_executor, config.renderQueue.capacity) });
+    }
+}
+
+DemoProtocolServiceCoroutine::DemoProtocolServiceCoroutine(std::size_t numStreams, uint32_t runTimeSec, Render::RenderSink* renderSink)
+: DemoProtocolServiceCoroutine(MakeConfig(numStreams, runTimeSec), renderSink) {}
+
+DemoProtocolServiceCoroutine::~DemoProtocolServiceCoroutine() {
+    Shutdown();
+}
+
+Core::CoTask DemoProtocolServiceCoroutine::IngestStream(StreamQueues& stream, LoadProfile profile) {
+    // The same seeded frames a LoadGenerator thread sends, waiting for each one's turn on a timer instead.
+    LoadGenerator generator(profile);
+    const uint64_t runTimeUs = static_cast<uint64_t>(m_threadRunTime) * 1000000;
+
+    Core::ByteUndecodedFrame frame;
+    uint64_t arrivalUs = 0;
+    while (generator.Next(frame, arrivalUs) && arrivalUs < runTimeUs) {
+        co_await m_executor.SleepUntil(m_startTime + std::chrono::microseconds(arrivalUs));
+        Core::StampIngest(frame.meta, m_frameDeadline);
+        if (!co_await stream.decodeQueue->Write(frame)) {
+            break;
+        }
+    }
+    stream.decodeQueue->Close();
+}
+
+Core::CoTask DemoProtocolServiceCoroutine::DecodeStream(StreamQueues& stream) {
+    Core::ByteUndecodedFrame frame;
+    Core::ByteFrameElement decoded;
+    while (co_await stream.decodeQueue->Read(frame)) {
+        const uint64_t decodeStartNs = Core::PipelineNowNs();
+        if (!Core::IsReferenceFrame(frame.meta) && Core::IsPastDeadline(frame.meta, decodeStartNs)) {
+            Core::MarkExpired(frame, decoded);
+            m_framesDecodeExpired.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            m_decoder.DecodeFrameData(frame, decoded);
+            decoded.meta.decodeStartNs = decodeStartNs;
+            decoded.meta.decodeEndNs = Core::PipelineNowNs();
+            m_decodeLatency.queueWait.RecordInterval(decoded.meta.ingestNs, decoded.meta.decodeStartNs);
+            m_decodeLatency.decode.RecordInterval(decoded.meta.decodeStartNs, decoded.meta.decodeEndNs);
+        }
+        frame.payload = Core::FrameBufferRef();
+
+        if (!co_await stream.renderQueue->Write(decoded)) {
+            break;
+        }
+        decoded.payload = Core::FrameBufferRef();
+
+        // Reads and writes that don't have to wait don't suspend, so a stream with a backlog would keep
+        // its thread until it caught up.  One frame per turn leaves the other streams their share.
+        co_await m_executor.Yield();
+    }
+    // Either the ingest is done or nobody renders anymore, both ways no more frames get through.
+    stream.decodeQueue->Close();
+    stream.renderQueue->Close();
+}
+
+Core::CoTask DemoProtocolServiceCoroutine::RenderStream(StreamQueues& stream) {
+    using ReorderWindow = Core::ReorderWindow<Core::ByteFrameElement>;
+    // The hold time on a gap is only checked as frames come in, a stream that stalls keeps what it holds
+    // until the next one arrives or the queue is closed.
+    ReorderWindow window(m_reorderWindow);
+
+    Core::ByteFrameElement frame;
+    Core::ByteFrameElement shown;
+    bool isPresenting = true;
+    // Frames the decoder gave up on (and already counted) only hold their display position, they aren't
+    // passed on to the sink.
+    while (isPresenting && co_await stream.renderQueue->Read(frame)) {
+        auto result = window.Add(frame);
+        // Too far ahead for the window, give up on what it's still missing until the frame fits.
+        while (isPresenting && result == ReorderWindow::AddResult::AheadOfWindow) {
+            if (window.Take(shown, true) && !shown.meta.isExpired) {
+                isPresenting = co_await m_presentQueue->Write(shown);
+            }
+            result = window.Add(frame);
+        }
+        if (result != ReorderWindow::AddResult::Stored && !frame.meta.isExpired) {
+            m_framesReorderDropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        frame.payload = Core::FrameBufferRef();
+
+        while (isPresenting && window.Take(shown)) {
+            if (!shown.meta.isExpired) {
+                isPresenting = co_await m_presentQueue->Write(shown);
+            }
+        }
+    }
+
+    // Nothing more is coming, whatever is left goes out in order.
+    while (isPresenting && window.Take(shown, true)) {
+        if (!shown.meta.isExpired) {
+            isPresenting = co_await m_presentQueue->Write(shown);
+        }
+    }
+    shown.payload = Core::FrameBufferRef();
+
+    stream.renderQueue->Close();
+    if (m_numRendering.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        m_presentQueue->Close();
+    }
+}
+
+Core::CoTask DemoProtocolServiceCoroutine::PresentFrames() {
+    Core::ByteFrameElement frame;
+    while (co_await m_presentQueue->Read(frame)) {
+        Present(frame);
+        frame.payload = Core::FrameBufferRef();
+    }
+}
+
+void DemoProtocolServiceCoroutine::Present(const Core::ByteFrameElement& frame) {
+    const uint64_t presentNs = Core::PipelineNowNs();
+    if (Core::IsPastDeadline(frame.meta, presentNs)) {
+        m_framesRenderExpired.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    m_renderLatency.renderWait.RecordInterval(frame.meta.decodeEndNs, presentNs);
+    m_renderLatency.endToEnd.RecordInterval(frame.meta.ingestNs, presentNs);
+    m_sink->Present(frame);
+    m_framesPresented.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool DemoProtocolServiceCoroutine::Run() {
+    m_startTime = std::chrono::steady_clock::now();
+
+    m_numRendering.store(m_numStreams, std::memory_order_release);
+    if (m_numStreams == 0) {
+        m_presentQueue->Close();
+    }
+    if (!m_executor.Spawn(PresentFrames())) {
+        return false;
+    }
+
+    for (std::size_t i = 0; i < m_numStreams; ++i) {
+        LoadProfile profile = m_loadProfile;
+        profile.streamId = static_cast<uint32_t>(i);
+        profile.seed += i;
+
+        if (!m_executor.Spawn(IngestStream(m_streams[i], profile)) ||
+            !m_executor.Spawn(DecodeStream(m_streams[i])) ||
+            !m_executor.Spawn(RenderStream(m_streams[i]))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool DemoProtocolServiceCoroutine::Shutdown() {
+    // Ingest stops after the run time and closes the queues behind it, so every stage finishes on its own.
+    m_executor.Join();
+    m_sink->Flush();
+    return true;
+}
+
+PipelineStats DemoProtocolServiceCoroutine::GetStats() const {
+    PipelineStats stats;
+    Core::DecodeLatencySnapshot decodeLatency;
+    decodeLatency.queueWait.Add(m_decodeLatency.queueWait);
+    decodeLatency.decode.Add(m_decodeLatency.decode);
+    Core::RenderLatencySnapshot renderLatency;
+    renderLatency.renderWait.Add(m_renderLatency.renderWait);
+    renderLatency.endToEnd.Add(m_renderLatency.endToEnd);
+    SummarizeLatency(stats, decodeLatency, renderLatency);
+
+    for (const auto& stream : m_streams) {
+        AddQueueStats(stats.decodeQueue, stream.decodeQueue->GetQueueStats());
+        AddQueueStats(stats.renderQueue, stream.renderQueue->GetQueueStats());
+    }
+    stats.renderQueue.dropped = m_framesReorderDropped.load(std::memory_order_relaxed);
+    stats.render.framesPresented = m_framesPresented.load(std::memory_order_relaxed);
+    stats.render.framesExpired = m_framesRenderExpired.load(std::memory_order_relaxed);
+    SummarizeDrops(stats, m_framesDecodeExpired.load(std::memory_order_relaxed));
+    return stats;
+}
+
 }
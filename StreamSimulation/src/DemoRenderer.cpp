@@ -1,10 +1,17 @@
+#include <algorithm>
 #include <iostream>
 #include "StreamRenderer.hpp"
 
 namespace StreamSim::Render {
-    FrameElementRenderHandler::FrameElementRenderHandler(Core::AsyncByteFrameQueue* frameReadBuffer)
+    FrameElementRenderHandler::FrameElementRenderHandler(Core::ByteFrameQueue* frameReadBuffer, RenderMode mode,
+                                                         uint32_t refreshRateHz, RenderSink* sink, Core::CpuSet cpus)
     : m_readBuffer(frameReadBuffer)
-    , m_isRunning(false) {
+    , m_mode(mode)
+    , m_refreshRateHz(std::max<uint32_t>(refreshRateHz, 1))
+    , m_cpus(std::move(cpus))
+    , m_isRunning(false)
+    , m_defaultSink(sink == nullptr ? std::make_unique<ConsoleRenderSink>() : nullptr)
+    , m_sink(sink != nullptr ? sink : m_defaultSink.get()) {
         assert(m_readBuffer != nullptr);
     }   
 
@@ -12,30 +19,152 @@ namespace StreamSim::Render {
         Shutdown();
     }
 
-    void FrameElementRenderHandler::PrintByteFrameElement(const StreamSim::Core::ByteFrameElement& frame) {
-        std::lock_guard<std::mutex> lock(m_printMtx);
+    void FrameElementRenderHandler::Present(const Core::ByteFrameElement& frame) {
+        const uint64_t presentNs = Core::PipelineNowNs();
+        m_latency.renderWait.RecordInterval(frame.meta.decodeEndNs, presentNs);
+        m_latency.endToEnd.RecordInterval(frame.meta.ingestNs, presentNs);
+        m_sink->Present(frame);
+    }
 
-        std::cout << frame.data << std::endl;
+    bool FrameElementRenderHandler::Discard(const Core::ByteFrameElement& frame, uint64_t nowNs) {
+        // The decoder already counted the frames it gave up on.
+        if (frame.meta.isExpired) {
+            return true;
+        }
+        if (Core::IsPastDeadline(frame.meta, nowNs)) {
+            m_framesExpired.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
     }
 
-    void FrameElementRenderHandler::Run() {
-        m_isRunning = true;
-        m_renderThread = std::thread([this] {
-            while (m_isRunning) {
-                Core::ByteFrameElement data;
-                if (!m_readBuffer->ReadSync(data)) {
-                    continue;
+    void FrameElementRenderHandler::ImmediateRenderLoop() {
+        // ReadBatch keeps returning frames after the buffer is closed until it has been drained.
+        std::array<Core::ByteFrameElement, RENDER_BATCH_SIZE> frames;
+        while (true) {
+            const std::size_t numFrames = m_readBuffer->ReadBatch(frames, frames.size());
+            if (numFrames == 0) {
+                if (m_readBuffer->IsClosed() || (!m_isRunning && m_readBuffer->IsEmpty())) {
+                    break;
                 }
-                PrintByteFrameElement(data);
+                continue;
             }
+            std::size_t numPresented = 0;
+            for (std::size_t i = 0; i < numFrames; ++i) {
+                if (!Discard(frames[i], Core::PipelineNowNs())) {
+                    Present(frames[i]);
+                    ++numPresented;
+                }
+                frames[i].payload = Core::FrameBufferRef();
+            }
+            m_framesPresented.fetch_add(numPresented, std::memory_order_relaxed);
+        }
+    }
+
+    void FrameElementRenderHandler::PacedRenderLoop() {
+        using Clock = std::chrono::steady_clock;
+        const auto period = std::chrono::nanoseconds(1000000000ull / m_refreshRateHz);
 
-            while (!m_readBuffer->IsEmpty()) {
-                Core::ByteFrameElement data;
-                if (m_readBuffer->ReadSync(data)) {
-                    PrintByteFrameElement(data);
+        std::vector<Core::ByteFrameElement> pending;
+        pending.reserve(MAX_PENDING_FRAMES);
+        std::array<Core::ByteFrameElement, RENDER_BATCH_SIZE> frames;
+
+        // Frame timestamps are mapped onto the display clock by pinning one frame to the vsync it was shown at.
+        bool hasAnchor = false;
+        uint64_t anchorTimestampUs = 0;
+        Clock::time_point anchorTime;
+        auto DisplayTime = [&](const Core::ByteFrameElement& frame) {
+            return anchorTime + std::chrono::microseconds(static_cast<int64_t>(frame.meta.timestampUs - anchorTimestampUs));
+        };
+
+        bool hasPresented = false;
+        Clock::time_point lastPresentTime;
+        Clock::time_point vsync = Clock::now();
+
+        while (true) {
+            std::this_thread::sleep_until(vsync);
+            const auto presentTime = Clock::now();
+
+            // Take everything decoded since the last tick, the queue hands frames over in display order.
+            const bool isClosed = m_readBuffer->IsClosed();
+            while (pending.size() < MAX_PENDING_FRAMES) {
+                const std::size_t numFrames = m_readBuffer->ReadBatchAsync(
+                    frames, std::min(frames.size(), MAX_PENDING_FRAMES - pending.size()));
+                if (numFrames == 0) {
+                    break;
                 }
+                std::move(frames.begin(), frames.begin() + numFrames, std::back_inserter(pending));
             }
+
+            const uint64_t nowNs = Core::PipelineNowNs();
+            std::erase_if(pending, [this, nowNs](const Core::ByteFrameElement& frame) { return Discard(frame, nowNs); });
+
+            if (pending.empty() && (isClosed || !m_isRunning) && m_readBuffer->IsEmpty()) {
+                break;
+            }
+
+            if (!pending.empty() &&
+                (!hasAnchor || DisplayTime(pending.front()) > vsync + std::chrono::milliseconds(MAX_PRESENT_AHEAD_IN_MILISEC))) {
+                hasAnchor = true;
+                anchorTimestampUs = pending.front().meta.timestampUs;
+                anchorTime = vsync;
+            }
+
+            // Show the newest frame that is due, everything before it is already out of date.
+            std::size_t numDue = 0;
+            for (std::size_t i = 0; i < pending.size(); ++i) {
+                if (DisplayTime(pending[i]) <= vsync) {
+                    numDue = i + 1;
+                }
+            }
+
+            if (numDue > 0) {
+                Present(pending[numDue - 1]);
+                pending.erase(pending.begin(), pending.begin() + numDue);
+                m_framesPresented.fetch_add(1, std::memory_order_relaxed);
+                m_framesDropped.fetch_add(numDue - 1, std::memory_order_relaxed);
+            } else if (hasPresented) {
+                m_framesDuplicated.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            // Every vsync after the first present puts a frame on screen, new or repeated.
+            if (hasPresented) {
+                const auto interval = presentTime - lastPresentTime;
+                const auto jitterUs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                    interval > period ? interval - period : period - interval).count());
+                m_totalPresentJitterUs.fetch_add(jitterUs, std::memory_order_relaxed);
+                if (jitterUs > m_maxPresentJitterUs.load(std::memory_order_relaxed)) {
+                    m_maxPresentJitterUs.store(jitterUs, std::memory_order_relaxed);
+                }
+                m_vsyncs.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (numDue > 0 || hasPresented) {
+                hasPresented = true;
+                lastPresentTime = presentTime;
+            }
+
+            // A tick that overran skips the vsyncs it missed instead of firing them back to back.
+            vsync += period;
+            const auto now = Clock::now();
+            if (vsync < now) {
+                vsync += ((now - vsync) / period + 1) * period;
+            }
+        }
+    }
+
+    void FrameElementRenderHandler::Run() {
+        m_isRunning = true;
+        m_renderThread = std::thread([this] {
+            if (m_mode == RenderMode::Paced) {
+                PacedRenderLoop();
+            } else {
+                ImmediateRenderLoop();
+            }
+            m_sink->Flush();
         });
+        if (!Core::SetThreadAffinity(m_renderThread, m_cpus)) {
+            std::cerr << "Could not pin render thread to CPUs " << Core::FormatCpuSet(m_cpus) << std::endl;
+        }
     }
 
     void FrameElementRenderHandler::Shutdown() {
@@ -47,4 +176,23 @@ namespace StreamSim::Render {
 
         m_renderThread.join();
     }
+
+    RenderStats FrameElementRenderHandler::GetStats() const {
+        RenderStats stats;
+        stats.framesPresented = m_framesPresented.load(std::memory_order_relaxed);
+        stats.framesDropped = m_framesDropped.load(std::memory_order_relaxed);
+        stats.framesExpired = m_framesExpired.load(std::memory_order_relaxed);
+        stats.framesDuplicated = m_framesDuplicated.load(std::memory_order_relaxed);
+        stats.vsyncs = m_vsyncs.load(std::memory_order_relaxed);
+        stats.meanPresentJitterUs = stats.vsyncs > 0 ? m_totalPresentJitterUs.load(std::memory_order_relaxed) / stats.vsyncs : 0;
+        stats.maxPresentJitterUs = m_maxPresentJitterUs.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    Core::RenderLatencySnapshot FrameElementRenderHandler::GetLatencySnapshot() const {
+        Core::RenderLatencySnapshot snapshot;
+        snapshot.renderWait.Add(m_latency.renderWait);
+        snapshot.endToEnd.Add(m_latency.endToEnd);
+        return snapshot;
+    }
 }
\ No newline at end of file
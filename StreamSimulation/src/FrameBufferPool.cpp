@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include "CpuTopology.hpp"
+#include "FrameBufferPool.hpp"
+
+namespace {
+    constexpr std::size_t SLAB_ALIGNMENT = 4096;
+}
+
+namespace StreamSim::Core {
+
+void FrameBufferRef::Resize(std::size_t size) {
+    assert(m_buffer != nullptr);
+    assert(size <= m_buffer->capacity);
+    m_buffer->size = size;
+}
+
+void FrameBufferPool::SlabDeleter::operator()(uint8_t* slab) const {
+    std::free(slab);
+}
+
+FrameBufferPool& FrameBufferPool::Default() {
+    static FrameBufferPool pool;
+    return pool;
+}
+
+FrameBufferPool& FrameBufferPool::ForNode(uint32_t node) {
+    // Pools are never removed, so a reference stays valid after the lock is released.
+    static std::mutex mutex;
+    static std::map<uint32_t, std::unique_ptr<FrameBufferPool>> pools;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& pool = pools[node];
+    if (!pool) {
+        pool = std::make_unique<FrameBufferPool>(node);
+    }
+    return *pool;
+}
+
+FrameBufferPool& FrameBufferPool::Local() {
+    const CpuTopology& topology = CpuTopology::Host();
+    if (topology.NumNodes() < 2) {
+        return Default();
+    }
+
+    const CpuInfo* cpu = topology.FindCpu(CurrentCpu());
+    return cpu != nullptr ? ForNode(cpu->node) : Default();
+}
+
+void FrameBufferPool::Grow(SizeClass& sizeClass, uint32_t index) {
+    const std::size_t bufferSize = ClassBufferSize(index);
+    const std::size_t numBuffers = std::max<std::size_t>(1, SLAB_SIZE / bufferSize);
+
+    // Every class size is a multiple of the alignment or divides it, and so does the slab.
+    const std::size_t slabSize = std::max(bufferSize * numBuffers, SLAB_ALIGNMENT);
+    Slab slab(static_cast<uint8_t*>(std::aligned_alloc(SLAB_ALIGNMENT, slabSize)));
+    if (!slab) {
+        throw std::bad_alloc();
+    }
+    if (m_node.has_value()) {
+        // Before anything touches it, so no page has to move.
+        BindMemoryToNode(slab.get(), slabSize, *m_node);
+    }
+    auto headers = std::make_unique<FrameBuffer[]>(numBuffers);
+    for (std::size_t i = 0; i < numBuffers; ++i) {
+        FrameBuffer& header = headers[i];
+        header.sizeClass = index;
+        header.capacity = bufferSize;
+        header.bytes = slab.get() + i * bufferSize;
+        header.pool = this;
+        header.nextFree = sizeClass.freeList;
+        sizeClass.freeList = &header;
+    }
+
+    sizeClass.slabs.push_back(std::move(slab));
+    sizeClass.headers.push_back(std::move(headers));
+    sizeClass.numAllocated += numBuffers;
+}
+
+FrameBufferRef FrameBufferPool::Acquire(std::size_t size) {
+    if (size > MAX_BUFFER_SIZE) {
+        return FrameBufferRef();
+    }
+
+    uint32_t index = 0;
+    while (ClassBufferSize(index) < size) {
+        ++index;
+    }
+
+    SizeClass& sizeClass = m_sizeClasses[index];
+    FrameBuffer* buffer = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(sizeClass.mutex);
+        if (sizeClass.freeList == nullptr) {
+            Grow(sizeClass, index);
+        }
+        buffer = sizeClass.freeList;
+        sizeClass.freeList = buffer->nextFree;
+    }
+
+    buffer->nextFree = nullptr;
+    buffer->size = size;
+    buffer->refCount.store(1, std::memory_order_relaxed);
+    m_numInUse.fetch_add(1, std::memory_order_relaxed);
+    return FrameBufferRef(buffer);
+}
+
+void FrameBufferPool::GrowWrapped() {
+    auto headers = std::make_unique<FrameBuffer[]>(WRAPPED_HEADERS_PER_GROW);
+    for (std::size_t i = 0; i < WRAPPED_HEADERS_PER_GROW; ++i) {
+        FrameBuffer& header = headers[i];
+        header.isWrapped = true;
+        header.pool = this;
+        header.nextFree = m_wrapped.freeList;
+        m_wrapped.freeList = &header;
+    }
+
+    m_wrapped.headers.push_back(std::move(headers));
+    m_wrapped.numAllocated += WRAPPED_HEADERS_PER_GROW;
+}
+
+FrameBufferRef FrameBufferPool::Wrap(uint8_t* bytes, std::size_t size) {
+    FrameBuffer* buffer = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_wrapped.mutex);
+        if (m_wrapped.freeList == nullptr) {
+            GrowWrapped();
+        }
+        buffer = m_wrapped.freeList;
+        m_wrapped.freeList = buffer->nextFree;
+    }
+
+    buffer->nextFree = nullptr;
+    buffer->capacity = size;
+    buffer->size = size;
+    buffer->bytes = bytes;
+    buffer->refCount.store(1, std::memory_order_relaxed);
+    m_numInUse.fetch_add(1, std::memory_order_relaxed);
+    return FrameBufferRef(buffer);
+}
+
+void FrameBufferPool::Release(FrameBuffer* buffer) {
+    SizeClass& sizeClass = buffer->isWrapped ? m_wrapped : m_sizeClasses[buffer->sizeClass];
+    {
+        std::lock_guard<std::mutex> lock(sizeClass.mutex);
+        buffer->nextFree = sizeClass.freeList;
+        sizeClass.freeList = buffer;
+    }
+    m_numInUse.fetch_sub(1, std::memory_order_relaxed);
+}
+
+std::size_t FrameBufferPool::NumBuffersAllocated() {
+    std::size_t total = 0;
+    for (auto& sizeClass : m_sizeClasses) {
+        std::lock_guard<std::mutex> lock(sizeClass.mutex);
+        total += sizeClass.numAllocated;
+    }
+    return total;
+}
+
+}
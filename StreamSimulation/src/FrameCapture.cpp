@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "FrameCapture.hpp"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace StreamSim::Net {
+
+FrameCaptureWriter::FrameCaptureWriter(const std::string& path)
+: m_file(std::fopen(path.c_str(), "wb")) {
+    if (m_file == nullptr) {
+        return;
+    }
+    std::setvbuf(m_file, nullptr, _IOFBF, FILE_BUFFER_SIZE);
+
+    FrameCaptureFileHeader header;
+    if (std::fwrite(&header, sizeof(header), 1, m_file) != 1) {
+        std::fclose(m_file);
+        m_file = nullptr;
+        return;
+    }
+    m_offset = sizeof(header);
+}
+
+FrameCaptureWriter::~FrameCaptureWriter() {
+    Close();
+}
+
+bool FrameCaptureWriter::Write(const Core::ByteUndecodedFrame& frame) {
+    FrameCaptureRecord record;
+    record.sequence = frame.meta.sequence;
+    record.displayOrder = frame.meta.displayOrder;
+    record.timestampUs = frame.meta.timestampUs;
+    std::copy(frame.meta.references.begin(), frame.meta.references.end(), record.references);
+    record.streamId = frame.meta.streamId;
+    record.payloadSize = static_cast<uint32_t>(frame.payload.Size());
+    record.type = static_cast<uint8_t>(frame.meta.type);
+    record.numReferences = frame.meta.numReferences;
+    record.data = frame.data;
+
+    static constexpr std::array<uint8_t, 8> PADDING{};
+    const std::size_t paddingSize = CapturePaddedSize(record.payloadSize) - record.payloadSize;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file == nullptr) {
+        return false;
+    }
+
+    if (std::fwrite(&record, sizeof(record), 1, m_file) != 1 ||
+        std::fwrite(frame.payload.Data(), 1, record.payloadSize, m_file) != record.payloadSize ||
+        std::fwrite(PADDING.data(), 1, paddingSize, m_file) != paddingSize) {
+        return false;
+    }
+
+    m_index.push_back(FrameCaptureIndexEntry{m_offset, record.payloadSize});
+    m_offset += sizeof(record) + record.payloadSize + paddingSize;
+    return true;
+}
+
+void FrameCaptureWriter::Close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file == nullptr) {
+        return;
+    }
+
+    FrameCaptureFileHeader header;
+    header.numFrames = m_index.size();
+    header.indexOffset = m_offset;
+    if (std::fwrite(m_index.data(), sizeof(FrameCaptureIndexEntry), m_index.size(), m_file) == m_index.size() &&
+        std::fseek(m_file, 0, SEEK_SET) == 0) {
+        std::fwrite(&header, sizeof(header), 1, m_file);
+    }
+    std::fclose(m_file);
+    m_file = nullptr;
+}
+
+FrameCaptureReader::FrameCaptureReader(const std::string& path) {
+    if (!MapFile(path) || !ReadIndex()) {
+        m_index = nullptr;
+        m_numFrames = 0;
+        UnmapFile();
+    }
+}
+
+FrameCaptureReader::~FrameCaptureReader() {
+    UnmapFile();
+}
+
+#if !defined(_WIN32)
+bool FrameCaptureReader::MapFile(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat status;
+    if (::fstat(fd, &status) != 0 || status.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+
+    // Private and writable: pages are shared with the page cache until someone writes to one.
+    void* data = ::mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    // Replay goes front to back, let the kernel read ahead.
+    ::madvise(data, static_cast<std::size_t>(status.st_size), MADV_SEQUENTIAL);
+    m_data = static_cast<uint8_t*>(data);
+    m_size = static_cast<std::size_t>(status.st_size);
+    return true;
+}
+
+void FrameCaptureReader::UnmapFile() {
+    if (m_data != nullptr) {
+        ::munmap(m_data, m_size);
+        m_data = nullptr;
+        m_size = 0;
+    }
+}
+#else
+bool FrameCaptureReader::MapFile(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    bool isRead = std::fseek(file, 0, SEEK_END) == 0;
+    const long size = isRead ? std::ftell(file) : -1;
+    isRead = size > 0 && std::fseek(file, 0, SEEK_SET) == 0;
+    if (isRead) {
+        m_contents = std::make_unique<uint8_t[]>(static_cast<std::size_t>(size));
+        isRead = std::fread(m_contents.get(), 1, static_cast<std::size_t>(size), file) == static_cast<std::size_t>(size);
+    }
+    std::fclose(file);
+    if (!isRead) {
+        m_contents.reset();
+        return false;
+    }
+
+    m_data = m_contents.get();
+    m_size = static_cast<std::size_t>(size);
+    return true;
+}
+
+void FrameCaptureReader::UnmapFile() {
+    m_contents.reset();
+    m_data = nullptr;
+    m_size = 0;
+}
+#endif
+
+bool FrameCaptureReader::ReadIndex() {
+    FrameCaptureFileHeader header;
+    if (m_size < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, m_data, sizeof(header));
+
+    if (header.magic != FRAME_CAPTURE_MAGIC || header.version != FRAME_CAPTURE_VERSION ||
+        header.indexOffset < sizeof(header) || header.indexOffset % 8 != 0 || header.indexOffset > m_size ||
+        header.numFrames > (m_size - header.indexOffset) / sizeof(FrameCaptureIndexEntry)) {
+        return false;
+    }
+
+    m_numFrames = header.numFrames;
+    m_indexOffset = header.indexOffset;
+    m_index = reinterpret_cast<const FrameCaptureIndexEntry*>(m_data + header.indexOffset);
+    return true;
+}
+
+bool FrameCaptureReader::ReadFrame(std::size_t index, Core::ByteUndecodedFrame& frame) const {
+    if (index >= m_numFrames) {
+        return false;
+    }
+
+    // The record and its payload have to sit between the file header and the index.
+    const FrameCaptureIndexEntry& entry = m_index[index];
+    if (entry.recordOffset < sizeof(FrameCaptureFileHeader) || entry.recordOffset % 8 != 0 ||
+        entry.recordOffset > m_indexOffset || m_indexOffset - entry.recordOffset < sizeof(FrameCaptureRecord) ||
+        entry.payloadSize > m_indexOffset - entry.recordOffset - sizeof(FrameCaptureRecord)) {
+        return false;
+    }
+
+    FrameCaptureRecord record;
+    std::memcpy(&record, m_data + entry.recordOffset, sizeof(record));
+    // Nothing downstream has a buffer to decode a bigger payload into.
+    if (record.payloadSize != entry.payloadSize || record.payloadSize > Core::FrameBufferPool::MAX_BUFFER_SIZE ||
+        record.numReferences > Core::MAX_FRAME_REFERENCES) {
+        return false;
+    }
+
+    frame.data = record.data;
+    frame.meta = Core::FrameMetadata();
+    frame.meta.streamId = record.streamId;
+    frame.meta.sequence = record.sequence;
+    frame.meta.displayOrder = record.displayOrder;
+    frame.meta.timestampUs = record.timestampUs;
+    frame.meta.type = static_cast<Core::FrameType>(record.type);
+    frame.meta.numReferences = record.numReferences;
+    std::copy(std::begin(record.references), std::end(record.references), frame.meta.references.begin());
+
+    frame.payload = Core::FrameBufferRef();
+    if (record.payloadSize > 0) {
+        frame.payload = m_headers.Wrap(m_data + entry.recordOffset + sizeof(FrameCaptureRecord), record.payloadSize);
+    }
+    return true;
+}
+
+CaptureRecorder::CaptureRecorder(const std::string& path, NetInputStreamHandler* next)
+: m_next(next)
+, m_writer(path) {
+    if (!m_writer.IsOpen()) {
+        m_pending.Close();
+        return;
+    }
+
+    m_writerThread = std::thread([this] {
+        WriterLoop();
+    });
+}
+
+CaptureRecorder::~CaptureRecorder() {
+    Close();
+}
+
+void CaptureRecorder::WriterLoop() {
+    std::array<Core::ByteUndecodedFrame, WRITE_BATCH_SIZE> frames;
+    while (true) {
+        const std::size_t numFrames = m_pending.ReadBatch(frames, frames.size());
+        if (numFrames == 0) {
+            if (m_pending.IsClosed()) {
+                break;
+            }
+            continue;
+        }
+
+        for (std::size_t i = 0; i < numFrames; ++i) {
+            if (m_writer.Write(frames[i])) {
+                m_numRecorded.fetch_add(1, std::memory_order_relaxed);
+            }
+            // Hands the payload back to its pool now rather than when the slot is reused.
+            frames[i].payload = Core::FrameBufferRef();
+        }
+    }
+}
+
+void CaptureRecorder::OnInputStreamData(const Core::ByteUndecodedFrame& data) {
+    if (m_next != nullptr) {
+        m_next->OnInputStreamData(data);
+    }
+    m_pending.WriteSync(data);
+}
+
+void CaptureRecorder::Close() {
+    // The writer drains what is left in the queue before it sees the close.
+    m_pending.Close();
+    if (m_writerThread.joinable()) {
+        m_writerThread.join();
+    }
+    m_writer.Close();
+}
+
+}
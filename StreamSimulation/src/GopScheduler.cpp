@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <cassert>
+#include "GopScheduler.hpp"
+
+namespace StreamSim::Core {
+
+void DescribeGopFrame(FrameMetadata& meta, uint32_t numAnchors, uint32_t numBFrames) {
+    assert(numAnchors > 0);
+
+    const uint64_t groupSize = numBFrames + 1;
+    const uint64_t gopSize = 1 + (numAnchors - 1) * groupSize;
+    const uint64_t local = meta.sequence % gopSize;
+    const uint64_t gopStart = meta.sequence - local;
+
+    if (local == 0) {
+        meta.type = FrameType::I;
+        meta.displayOrder = gopStart;
+        meta.numReferences = 0;
+        return;
+    }
+
+    // Every anchor after the I-frame starts a group of one P-frame plus its B-frames.
+    const uint64_t anchor = (local - 1) / groupSize + 1;
+    const uint64_t indexInGroup = (local - 1) % groupSize;
+    const uint64_t anchorSequence = gopStart + 1 + (anchor - 1) * groupSize;
+    const uint64_t previousAnchorSequence = anchor == 1 ? gopStart : anchorSequence - groupSize;
+
+    if (indexInGroup == 0) {
+        meta.type = FrameType::P;
+        meta.displayOrder = gopStart + anchor * groupSize;
+        meta.numReferences = 1;
+        meta.references[0] = previousAnchorSequence;
+    } else {
+        meta.type = FrameType::B;
+        meta.displayOrder = gopStart + (anchor - 1) * groupSize + indexInGroup;
+        meta.numReferences = 2;
+        meta.references[0] = previousAnchorSequence;
+        meta.references[1] = anchorSequence;
+    }
+}
+
+GopScheduler::GopScheduler(std::chrono::milliseconds streamIdleTimeout)
+: m_idleTimeoutNs(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(streamIdleTimeout).count())) {}
+
+bool GopScheduler::IsCompleted(const StreamState& stream, uint64_t sequence) {
+    return stream.outcomes[sequence % COMPLETED_WINDOW] == (sequence + 1) * 2;
+}
+
+bool GopScheduler::IsDropped(const StreamState& stream, uint64_t sequence) {
+    return stream.outcomes[sequence % COMPLETED_WINDOW] == (sequence + 1) * 2 + 1;
+}
+
+bool GopScheduler::IsDecodable(const StreamState& stream, const FrameMetadata& meta) {
+    for (uint8_t i = 0; i < meta.numReferences; ++i) {
+        if (!IsCompleted(stream, meta.references[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool GopScheduler::HasDroppedReference(const StreamState& stream, const FrameMetadata& meta) {
+    for (uint8_t i = 0; i < meta.numReferences; ++i) {
+        if (IsDropped(stream, meta.references[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void GopScheduler::MakeReady(ByteUndecodedFrame&& frame) {
+    auto& ready = m_ready[frame.meta.streamId];
+    if (ready.empty()) {
+        m_readyTurns.push_back(frame.meta.streamId);
+    }
+    ready.push_back(std::move(frame));
+}
+
+void GopScheduler::Drop(StreamState& stream, ByteUndecodedFrame&& frame) {
+    stream.outcomes[frame.meta.sequence % COMPLETED_WINDOW] = (frame.meta.sequence + 1) * 2 + 1;
+    // Whoever dropped it upstream counted it already.
+    if (!frame.meta.isExpired) {
+        ++m_stats.framesOrphaned;
+    }
+
+    frame.meta.isExpired = true;
+    frame.payload = FrameBufferRef();
+    MakeReady(std::move(frame));
+}
+
+void GopScheduler::DropOrphans(StreamState& stream) {
+    // Every frame dropped can orphan the ones referencing it, so go again until a pass drops nothing.
+    bool isAnyDropped = true;
+    while (isAnyDropped && !stream.pending.empty()) {
+        isAnyDropped = false;
+        uint64_t oldest = UINT64_MAX;
+        auto it = stream.pending.begin();
+        while (it != stream.pending.end()) {
+            if (stream.highestSequence - it->meta.sequence > MAX_PENDING_DISTANCE || HasDroppedReference(stream, it->meta)) {
+                Drop(stream, std::move(*it));
+                it = stream.pending.erase(it);
+                isAnyDropped = true;
+            } else {
+                oldest = std::min(oldest, it->meta.sequence);
+                ++it;
+            }
+        }
+        stream.oldestPending = oldest;
+    }
+}
+
+void GopScheduler::EvictIdleStreams(uint64_t nowNs) {
+    for (auto it = m_streams.begin(); it != m_streams.end();) {
+        if (nowNs - it->second.lastActiveNs > m_idleTimeoutNs) {
+            // Whatever it still holds was waiting on frames that aren't coming any more.
+            for (ByteUndecodedFrame& frame : it->second.pending) {
+                Drop(it->second, std::move(frame));
+            }
+            it = m_streams.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void GopScheduler::Submit(ByteUndecodedFrame&& frame) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const uint64_t nowNs = PipelineNowNs();
+    if (nowNs >= m_nextEvictionNs) {
+        EvictIdleStreams(nowNs);
+        m_nextEvictionNs = nowNs + m_idleTimeoutNs;
+    }
+
+    StreamState& stream = m_streams[frame.meta.streamId];
+    stream.lastActiveNs = nowNs;
+    stream.highestSequence = std::max(stream.highestSequence, frame.meta.sequence);
+
+    if (frame.meta.isExpired || HasDroppedReference(stream, frame.meta)) {
+        // Frames that came in before it may be waiting on it.
+        Drop(stream, std::move(frame));
+        DropOrphans(stream);
+        return;
+    }
+
+    if (IsDecodable(stream, frame.meta)) {
+        ++m_stats.framesReady;
+        MakeReady(std::move(frame));
+    } else {
+        ++m_stats.framesDeferred;
+        if (stream.pending.empty() || frame.meta.sequence < stream.oldestPending) {
+            stream.oldestPending = frame.meta.sequence;
+        }
+        stream.pending.push_back(std::move(frame));
+    }
+
+    if (!stream.pending.empty() && stream.highestSequence - stream.oldestPending > MAX_PENDING_DISTANCE) {
+        DropOrphans(stream);
+    }
+}
+
+void GopScheduler::Complete(const FrameMetadata& meta) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    StreamState& stream = m_streams[meta.streamId];
+    stream.lastActiveNs = PipelineNowNs();
+    stream.outcomes[meta.sequence % COMPLETED_WINDOW] = (meta.sequence + 1) * 2;
+
+    // Release in submission order, which is decode order unless the network reordered them.
+    uint64_t oldest = UINT64_MAX;
+    auto it = stream.pending.begin();
+    while (it != stream.pending.end()) {
+        if (IsDecodable(stream, it->meta)) {
+            MakeReady(std::move(*it));
+            it = stream.pending.erase(it);
+        } else {
+            oldest = std::min(oldest, it->meta.sequence);
+            ++it;
+        }
+    }
+    stream.oldestPending = oldest;
+}
+
+std::size_t GopScheduler::TakeReady(std::span<ByteUndecodedFrame> frames) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // One frame per stream per turn.
+    std::size_t numFrames = 0;
+    while (numFrames < frames.size() && !m_readyTurns.empty()) {
+        const uint32_t streamId = m_readyTurns.front();
+        m_readyTurns.pop_front();
+
+        auto it = m_ready.find(streamId);
+        frames[numFrames++] = std::move(it->second.front());
+        it->second.pop_front();
+        if (it->second.empty()) {
+            m_ready.erase(it);
+        } else {
+            m_readyTurns.push_back(streamId);
+        }
+    }
+    return numFrames;
+}
+
+std::size_t GopScheduler::NumPending() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::size_t numPending = 0;
+    for (const auto& [streamId, stream] : m_streams) {
+        numPending += stream.pending.size();
+    }
+    return numPending;
+}
+
+std::size_t GopScheduler::NumStreams() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_streams.size();
+}
+
+GopSchedulerStats GopScheduler::GetStats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+}
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#include "FrameBufferPool.hpp"
+#include "GopScheduler.hpp"
+#include "LoadGenerator.hpp"
+
+namespace StreamSim::Net {
+
+LoadGenerator::LoadGenerator(const LoadProfile& profile, std::size_t index, std::size_t numGenerators)
+: m_profile(profile)
+, m_index(index)
+, m_numGenerators(std::max<std::size_t>(numGenerators, 1))
+, m_generator(profile.seed + 0x9E3779B97F4A7C15ull * index)
+, m_schedule(profile.seed ^ 0xA0761F62D1B1C5A3ull)
+, m_position(index) {
+    if (m_profile.framesPerSec <= 0.0) {
+        m_profile.framesPerSec = DEFAULT_LOAD_FRAMES_PER_SEC;
+    }
+
+    // Generators of one profile take turns, so each one starts a fraction of a period later.
+    if (m_profile.arrival == ArrivalProcess::ConstantRate || m_profile.arrival == ArrivalProcess::OnOff) {
+        m_nextArrivalUs = 1e6 / m_profile.framesPerSec * static_cast<double>(m_index) / static_cast<double>(m_numGenerators);
+    } else if (m_profile.arrival == ArrivalProcess::Poisson) {
+        // The arrivals of the generators before this one come first.
+        for (std::size_t i = 0; i < m_index; ++i) {
+            m_nextArrivalUs += NextStreamInterval();
+        }
+    }
+
+    Core::ByteUndecodedFrame first;
+    if (m_profile.capture && m_profile.capture->ReadFrame(0, first)) {
+        m_replayBaseUs = first.meta.timestampUs;
+    }
+}
+
+double LoadGenerator::NextUniform(std::mt19937_64& generator) {
+    return static_cast<double>(generator() >> 11) * 0x1.0p-53;
+}
+
+// Gap to the next Poisson arrival of the whole stream in microseconds, which runs numGenerators times the
+// profile rate.  The exponential is worked out here rather than with std::exponential_distribution, whose
+// output differs between standard libraries.
+double LoadGenerator::NextStreamInterval() {
+    const double periodUs = 1e6 / m_profile.framesPerSec / static_cast<double>(m_numGenerators);
+    return -std::log1p(-NextUniform(m_schedule)) * periodUs;
+}
+
+// Gap to this generator's next frame in microseconds.
+double LoadGenerator::NextInterval() {
+    if (m_profile.arrival == ArrivalProcess::Poisson) {
+        // Skips over the arrivals the other generators send.
+        double intervalUs = 0.0;
+        for (std::size_t i = 0; i < m_numGenerators; ++i) {
+            intervalUs += NextStreamInterval();
+        }
+        return intervalUs;
+    }
+    return 1e6 / m_profile.framesPerSec;
+}
+
+// A random value, its place in the stream and a payload of random bytes in a pooled buffer, on the NUMA node
+// of the ingest thread making it.
+void LoadGenerator::MakeFrame(Core::ByteUndecodedFrame& frame, uint64_t sequence, uint64_t timestampUs) {
+    frame = Core::ByteUndecodedFrame();
+    frame.data = static_cast<uint8_t>(m_generator() & 0xFF);
+    frame.meta.streamId = m_profile.streamId;
+    frame.meta.sequence = sequence;
+    frame.meta.timestampUs = timestampUs;
+    Core::DescribeGopFrame(frame.meta);
+    frame.payload = Core::FrameBufferPool::Local().Acquire(m_profile.payloadSize);
+
+    uint8_t* bytes = frame.payload.Data();
+    for (std::size_t i = 0; i + sizeof(uint64_t) <= frame.payload.Size(); i += sizeof(uint64_t)) {
+        const uint64_t word = m_generator();
+        std::memcpy(bytes + i, &word, sizeof(word));
+    }
+}
+
+bool LoadGenerator::Next(Core::ByteUndecodedFrame& frame, uint64_t& arrivalUs) {
+    if (m_profile.arrival == ArrivalProcess::Replay) {
+        if (m_profile.capture) {
+            // A damaged record ends the replay like the end of the file does.
+            if (!m_profile.capture->ReadFrame(m_position, frame)) {
+                return false;
+            }
+            arrivalUs = frame.meta.timestampUs > m_replayBaseUs ? frame.meta.timestampUs - m_replayBaseUs : 0;
+        } else {
+            if (m_position >= m_profile.replayTimestampsUs.size()) {
+                return false;
+            }
+            arrivalUs = m_profile.replayTimestampsUs[m_position];
+            MakeFrame(frame, m_position, arrivalUs);
+        }
+        m_position += m_numGenerators;
+        return true;
+    }
+
+    if (m_profile.arrival == ArrivalProcess::OnOff && m_profile.onTimeUs > 0) {
+        // Frames that would fall into the quiet part of a cycle move to the start of the next burst.
+        const double cycleUs = static_cast<double>(m_profile.onTimeUs + m_profile.offTimeUs);
+        const double intoCycleUs = std::fmod(m_nextArrivalUs, cycleUs);
+        if (intoCycleUs >= static_cast<double>(m_profile.onTimeUs)) {
+            m_nextArrivalUs += cycleUs - intoCycleUs;
+        }
+    }
+
+    arrivalUs = static_cast<uint64_t>(m_nextArrivalUs);
+    MakeFrame(frame, m_position, arrivalUs);
+    m_position += m_numGenerators;
+
+    // Each generator runs at the profile rate, taking turns only spreads them out.
+    m_nextArrivalUs += NextInterval();
+    return true;
+}
+
+LoadGeneratorStats LoadGenerator::Run(NetInputStreamHandler& handler, std::chrono::steady_clock::time_point start,
+                                      std::chrono::microseconds duration) {
+    LoadGeneratorStats stats;
+    uint64_t totalLagUs = 0;
+
+    Core::ByteUndecodedFrame frame;
+    uint64_t arrivalUs = 0;
+    // The frame is built before waiting for its turn, so making it doesn't delay it.
+    while (Next(frame, arrivalUs) && arrivalUs < static_cast<uint64_t>(duration.count())) {
+        const auto due = start + std::chrono::microseconds(arrivalUs);
+        if (std::chrono::steady_clock::now() < due) {
+            std::this_thread::sleep_until(due);
+        }
+
+        const uint64_t lagUs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - due).count());
+        stats.maxLagUs = std::max(stats.maxLagUs, lagUs);
+        totalLagUs += lagUs;
+
+        handler.OnInputStreamData(frame);
+        ++stats.framesSent;
+    }
+
+    if (stats.framesSent > 0) {
+        stats.meanLagUs = totalLagUs / stats.framesSent;
+    }
+    return stats;
+}
+
+}
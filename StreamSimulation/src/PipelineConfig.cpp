@@ -0,0 +1,322 @@
+#include <charconv>
+#include <fstream>
+#include <sstream>
+
+#include "PipelineConfig.hpp"
+
+namespace {
+    std::string Trim(const std::string& text) {
+        const auto begin = text.find_first_not_of(" \t\r\n");
+        if (begin == std::string::npos) {
+            return std::string();
+        }
+        const auto end = text.find_last_not_of(" \t\r\n");
+        return text.substr(begin, end - begin + 1);
+    }
+
+    template <typename Number>
+    bool ParseNumber(const std::string& text, Number& value) {
+        const char* end = text.data() + text.size();
+        const auto result = std::from_chars(text.data(), end, value);
+        return result.ec == std::errc() && result.ptr == end;
+    }
+
+    // Thread counts and sizes, which can't be 0.
+    bool ParseCount(const std::string& text, std::size_t& value) {
+        std::size_t parsed = 0;
+        if (!ParseNumber(text, parsed) || parsed == 0) {
+            return false;
+        }
+        value = parsed;
+        return true;
+    }
+
+    // option is capacity, wait_ms or spin.
+    bool ParseQueueOption(StreamSim::Core::QueueConfig& queue, const std::string& option, const std::string& value) {
+        if (option == "capacity") {
+            return ParseCount(value, queue.capacity);
+        }
+        if (option == "wait_ms") {
+            uint32_t waitMs = 0;
+            if (!ParseNumber(value, waitMs)) {
+                return false;
+            }
+            queue.wait.timeout = std::chrono::milliseconds(waitMs);
+            return true;
+        }
+        return ParseNumber(value, queue.wait.spinCount);
+    }
+
+    bool ParseSwitch(const std::string& text, bool& value) {
+        if (text == "on" || text == "true" || text == "1") {
+            value = true;
+        } else if (text == "off" || text == "false" || text == "0") {
+            value = false;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    bool ParseMilliseconds(const std::string& text, std::chrono::milliseconds& value) {
+        uint32_t milliseconds = 0;
+        if (!ParseNumber(text, milliseconds)) {
+            return false;
+        }
+        value = std::chrono::milliseconds(milliseconds);
+        return true;
+    }
+
+    // option is autoscale, min_threads, scale_interval_ms, scale_up_depth or scale_up_wait_ms.
+    bool ParseAutoscaleOption(StreamSim::Core::AutoscaleConfig& autoscale, const std::string& option, const std::string& value) {
+        if (option == "autoscale") {
+            return ParseSwitch(value, autoscale.enabled);
+        }
+        if (option == "min_threads") {
+            return ParseCount(value, autoscale.minWorkers);
+        }
+        if (option == "scale_interval_ms") {
+            return ParseMilliseconds(value, autoscale.interval) && autoscale.interval.count() > 0;
+        }
+        if (option == "scale_up_depth") {
+            return ParseCount(value, autoscale.scaleUpDepth);
+        }
+        return ParseMilliseconds(value, autoscale.scaleUpWait);
+    }
+
+    // option is cpus, node or pinning.
+    bool ParsePlacementOption(StreamSim::Core::StagePlacement& placement, const std::string& option, const std::string& value) {
+        if (option == "cpus") {
+            return StreamSim::Core::ParseCpuSet(value, placement.cpus);
+        }
+        if (option == "node") {
+            uint32_t node = 0;
+            if (value == "any") {
+                placement.node.reset();
+                return true;
+            }
+            if (!ParseNumber(value, node)) {
+                return false;
+            }
+            placement.node = node;
+            return true;
+        }
+
+        if (value == "shared") {
+            placement.policy = StreamSim::Core::PinningPolicy::Shared;
+        } else if (value == "compact") {
+            placement.policy = StreamSim::Core::PinningPolicy::Compact;
+        } else if (value == "spread") {
+            placement.policy = StreamSim::Core::PinningPolicy::Spread;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    bool ParseAdmissionPolicy(const std::string& text, StreamSim::Core::AdmissionPolicy& policy) {
+        if (text == "block") {
+            policy = StreamSim::Core::AdmissionPolicy::Block;
+        } else if (text == "reject") {
+            policy = StreamSim::Core::AdmissionPolicy::Reject;
+        } else if (text == "drop_oldest") {
+            policy = StreamSim::Core::AdmissionPolicy::DropOldest;
+        } else if (text == "drop_newest") {
+            policy = StreamSim::Core::AdmissionPolicy::DropNewest;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    const char* AdmissionPolicyName(StreamSim::Core::AdmissionPolicy policy) {
+        switch (policy) {
+        case StreamSim::Core::AdmissionPolicy::Reject:
+            return "reject";
+        case StreamSim::Core::AdmissionPolicy::DropOldest:
+            return "drop_oldest";
+        case StreamSim::Core::AdmissionPolicy::DropNewest:
+            return "drop_newest";
+        case StreamSim::Core::AdmissionPolicy::Block:
+        default:
+            return "block";
+        }
+    }
+
+    bool ParseRenderMode(const std::string& text, StreamSim::Render::RenderMode& mode) {
+        if (text == "immediate") {
+            mode = StreamSim::Render::RenderMode::Immediate;
+        } else if (text == "paced") {
+            mode = StreamSim::Render::RenderMode::Paced;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    const char* RenderModeName(StreamSim::Render::RenderMode mode) {
+        return mode == StreamSim::Render::RenderMode::Paced ? "paced" : "immediate";
+    }
+
+    const char* PinningPolicyName(StreamSim::Core::PinningPolicy policy) {
+        switch (policy) {
+        case StreamSim::Core::PinningPolicy::Compact:
+            return "compact";
+        case StreamSim::Core::PinningPolicy::Spread:
+            return "spread";
+        case StreamSim::Core::PinningPolicy::Shared:
+        default:
+            return "shared";
+        }
+    }
+
+    void FormatPlacement(std::ostringstream& out, const char* name, const StreamSim::Core::StagePlacement& placement) {
+        out << name << ".cpus = " << StreamSim::Core::FormatCpuSet(placement.cpus) << "\n"
+            << name << ".node = " << (placement.node.has_value() ? std::to_string(*placement.node) : "any") << "\n"
+            << name << ".pinning = " << PinningPolicyName(placement.policy) << "\n";
+    }
+
+    void FormatQueue(std::ostringstream& out, const char* name, const StreamSim::Core::QueueConfig& queue) {
+        out << name << ".capacity = " << queue.capacity << "\n"
+            << name << ".wait_ms = " << queue.wait.timeout.count() << "\n"
+            << name << ".spin = " << queue.wait.spinCount << "\n";
+    }
+}
+
+namespace StreamSim::Core {
+
+bool ApplyPipelineOption(PipelineConfig& config, const std::string& key, const std::string& value, std::string& error) {
+    bool isValid = false;
+    bool isKnown = true;
+
+    if (key == "run_time_sec") {
+        isValid = ParseNumber(value, config.runTimeSec);
+    } else if (key == "frame_deadline_ms") {
+        isValid = ParseMilliseconds(value, config.frameDeadline);
+    } else if (key == "ingest.threads") {
+        isValid = ParseCount(value, config.numIngestThreads);
+    } else if (key == "decode.threads") {
+        isValid = ParseCount(value, config.numDecoderThreads);
+    } else if (key == "decode.pool_capacity") {
+        isValid = ParseCount(value, config.decodePoolCapacity);
+    } else if (key == "decode.pool_policy") {
+        isValid = ParseAdmissionPolicy(value, config.decodePoolPolicy);
+    } else if (key == "decode.autoscale" || key == "decode.min_threads" || key == "decode.scale_interval_ms" ||
+               key == "decode.scale_up_depth" || key == "decode.scale_up_wait_ms") {
+        isValid = ParseAutoscaleOption(config.decodeAutoscale, key.substr(key.find('.') + 1), value);
+    } else if (key == "render.mode") {
+        isValid = ParseRenderMode(value, config.renderMode);
+    } else if (key == "render.refresh_hz") {
+        uint32_t refreshRateHz = 0;
+        isValid = ParseNumber(value, refreshRateHz) && refreshRateHz > 0;
+        if (isValid) {
+            config.renderRefreshRateHz = refreshRateHz;
+        }
+    } else if (key == "executor.threads") {
+        isValid = ParseCount(value, config.numExecutorThreads);
+    } else if (key.starts_with("ingest.") || key.starts_with("decode.") || key.starts_with("render.") || key.starts_with("executor.")) {
+        StagePlacement& placement = key.starts_with("ingest.") ? config.ingestPlacement
+                                  : key.starts_with("decode.") ? config.decodePlacement
+                                  : key.starts_with("render.") ? config.renderPlacement
+                                                               : config.executorPlacement;
+        const std::string option = key.substr(key.find('.') + 1);
+        isKnown = option == "cpus" || option == "node" || option == "pinning";
+        isValid = isKnown && ParsePlacementOption(placement, option, value);
+    } else if (key.starts_with("decode_queue.") || key.starts_with("render_queue.")) {
+        QueueConfig& queue = key.starts_with("decode_queue.") ? config.decodeQueue : config.renderQueue;
+        const std::string option = key.substr(key.find('.') + 1);
+        isKnown = option == "capacity" || option == "wait_ms" || option == "spin";
+        isValid = isKnown && ParseQueueOption(queue, option, value);
+    } else {
+        isKnown = false;
+    }
+
+    if (!isKnown) {
+        error = "unknown option '" + key + "'";
+    } else if (!isValid) {
+        error = "invalid value '" + value + "' for " + key;
+    }
+    return isValid;
+}
+
+bool LoadPipelineConfig(const std::string& path, PipelineConfig& config, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "could not open " + path;
+        return false;
+    }
+
+    std::string line;
+    for (std::size_t lineNumber = 1; std::getline(file, line); ++lineNumber) {
+        line = Trim(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+
+        const auto equals = line.find('=');
+        std::string optionError;
+        if (equals == std::string::npos) {
+            optionError = "expected key = value";
+        } else if (ApplyPipelineOption(config, Trim(line.substr(0, equals)), Trim(line.substr(equals + 1)), optionError)) {
+            continue;
+        }
+        error = path + ":" + std::to_string(lineNumber) + ": " + optionError;
+        return false;
+    }
+    return true;
+}
+
+bool ParsePipelineArgs(int& argc, char** argv, PipelineConfig& config, std::string& error) {
+    int numKept = argc > 0 ? 1 : 0;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (!arg.starts_with("--")) {
+            argv[numKept++] = argv[i];
+            continue;
+        }
+
+        const auto equals = arg.find('=');
+        if (equals == std::string::npos) {
+            error = "expected --key=value, got " + arg;
+            return false;
+        }
+        const std::string key = arg.substr(2, equals - 2);
+        const std::string value = arg.substr(equals + 1);
+        const bool isApplied = key == "config" ? LoadPipelineConfig(value, config, error)
+                                               : ApplyPipelineOption(config, key, value, error);
+        if (!isApplied) {
+            return false;
+        }
+    }
+
+    argc = numKept;
+    argv[argc] = nullptr;
+    return true;
+}
+
+std::string FormatPipelineConfig(const PipelineConfig& config) {
+    std::ostringstream out;
+    out << "run_time_sec = " << config.runTimeSec << "\n"
+        << "frame_deadline_ms = " << config.frameDeadline.count() << "\n"
+        << "ingest.threads = " << config.numIngestThreads << "\n";
+    FormatPlacement(out, "ingest", config.ingestPlacement);
+    out << "decode.threads = " << config.numDecoderThreads << "\n"
+        << "decode.pool_capacity = " << config.decodePoolCapacity << "\n"
+        << "decode.pool_policy = " << AdmissionPolicyName(config.decodePoolPolicy) << "\n"
+        << "decode.autoscale = " << (config.decodeAutoscale.enabled ? "on" : "off") << "\n"
+        << "decode.min_threads = " << config.decodeAutoscale.minWorkers << "\n"
+        << "decode.scale_interval_ms = " << config.decodeAutoscale.interval.count() << "\n"
+        << "decode.scale_up_depth = " << config.decodeAutoscale.scaleUpDepth << "\n"
+        << "decode.scale_up_wait_ms = " << config.decodeAutoscale.scaleUpWait.count() << "\n";
+    FormatPlacement(out, "decode", config.decodePlacement);
+    out << "render.mode = " << RenderModeName(config.renderMode) << "\n"
+        << "render.refresh_hz = " << config.renderRefreshRateHz << "\n";
+    FormatPlacement(out, "render", config.renderPlacement);
+    out << "executor.threads = " << config.numExecutorThreads << "\n";
+    FormatPlacement(out, "executor", config.executorPlacement);
+    FormatQueue(out, "decode_queue", config.decodeQueue);
+    FormatQueue(out, "render_queue", config.renderQueue);
+    return out.str();
+}
+
+}
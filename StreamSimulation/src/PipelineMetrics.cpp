@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#include "PipelineMetrics.hpp"
+
+namespace StreamSim::Core {
+
+std::size_t LatencyHistogram::BucketIndex(uint64_t value) {
+    if (value < SUB_BUCKET_COUNT) {
+        return static_cast<std::size_t>(value);
+    }
+
+    value = std::min<uint64_t>(value, (1ull << MAX_VALUE_BITS) - 1);
+    const uint32_t exponent = static_cast<uint32_t>(std::bit_width(value)) - 1;
+    const uint32_t shift = exponent - SUB_BUCKET_BITS;
+    const std::size_t subBucket = static_cast<std::size_t>((value >> shift) & (SUB_BUCKET_COUNT - 1));
+    return SUB_BUCKET_COUNT + shift * SUB_BUCKET_COUNT + subBucket;
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(std::size_t index) {
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+
+    const uint32_t shift = static_cast<uint32_t>((index - SUB_BUCKET_COUNT) / SUB_BUCKET_COUNT);
+    const uint64_t subBucket = (index - SUB_BUCKET_COUNT) % SUB_BUCKET_COUNT;
+    const uint64_t lowerBound = (SUB_BUCKET_COUNT + subBucket) << shift;
+    return lowerBound + (1ull << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t valueNs) {
+    m_counts[BucketIndex(valueNs)].fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(valueNs, std::memory_order_relaxed);
+
+    uint64_t max = m_max.load(std::memory_order_relaxed);
+    while (valueNs > max && !m_max.compare_exchange_weak(max, valueNs, std::memory_order_relaxed)) {}
+    uint64_t min = m_min.load(std::memory_order_relaxed);
+    while (valueNs < min && !m_min.compare_exchange_weak(min, valueNs, std::memory_order_relaxed)) {}
+}
+
+void HistogramSnapshot::Add(const LatencyHistogram& histogram) {
+    for (std::size_t i = 0; i < LatencyHistogram::NUM_BUCKETS; ++i) {
+        const uint64_t count = histogram.m_counts[i].load(std::memory_order_relaxed);
+        m_counts[i] += count;
+        m_count += count;
+    }
+    m_sum += histogram.m_sum.load(std::memory_order_relaxed);
+    m_max = std::max(m_max, histogram.m_max.load(std::memory_order_relaxed));
+    m_min = std::min(m_min, histogram.m_min.load(std::memory_order_relaxed));
+}
+
+void HistogramSnapshot::Merge(const HistogramSnapshot& other) {
+    for (std::size_t i = 0; i < LatencyHistogram::NUM_BUCKETS; ++i) {
+        m_counts[i] += other.m_counts[i];
+    }
+    m_count += other.m_count;
+    m_sum += other.m_sum;
+    m_max = std::max(m_max, other.m_max);
+    m_min = std::min(m_min, other.m_min);
+}
+
+HistogramSnapshot HistogramSnapshot::Since(const HistogramSnapshot& earlier) const {
+    HistogramSnapshot delta;
+    std::size_t lowest = LatencyHistogram::NUM_BUCKETS;
+    std::size_t highest = 0;
+    for (std::size_t i = 0; i < LatencyHistogram::NUM_BUCKETS; ++i) {
+        delta.m_counts[i] = m_counts[i] - std::min(m_counts[i], earlier.m_counts[i]);
+        delta.m_count += delta.m_counts[i];
+        if (delta.m_counts[i] != 0) {
+            lowest = std::min(lowest, i);
+            highest = i;
+        }
+    }
+    if (delta.m_count == 0) {
+        return HistogramSnapshot();
+    }
+
+    delta.m_sum = m_sum - std::min(m_sum, earlier.m_sum);
+    delta.m_max = std::min(LatencyHistogram::BucketUpperBound(highest), m_max);
+    const uint64_t lowestBound = lowest == 0 ? 0 : LatencyHistogram::BucketUpperBound(lowest - 1) + 1;
+    delta.m_min = std::max(lowestBound, m_min);
+    return delta;
+}
+
+uint64_t HistogramSnapshot::Percentile(double percentile) const {
+    if (m_count == 0) {
+        return 0;
+    }
+
+    const double clamped = std::clamp(percentile, 0.0, 100.0);
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(clamped / 100.0 * static_cast<double>(m_count))));
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < LatencyHistogram::NUM_BUCKETS; ++i) {
+        seen += m_counts[i];
+        if (seen >= rank) {
+            return std::min(LatencyHistogram::BucketUpperBound(i), m_max);
+        }
+    }
+    return m_max;
+}
+
+LatencySummary HistogramSnapshot::Summarize() const {
+    LatencySummary summary;
+    if (m_count == 0) {
+        return summary;
+    }
+
+    summary.count = m_count;
+    summary.minNs = m_min;
+    summary.meanNs = m_sum / m_count;
+    summary.p50Ns = Percentile(50.0);
+    summary.p90Ns = Percentile(90.0);
+    summary.p99Ns = Percentile(99.0);
+    summary.p999Ns = Percentile(99.9);
+    summary.maxNs = m_max;
+    return summary;
+}
+
+}
@@ -0,0 +1,149 @@
+#include <charconv>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+
+#include "RenderSink.hpp"
+
+namespace {
+    constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+    constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+    template <typename T>
+    uint64_t HashValue(uint64_t hash, T value) {
+        for (std::size_t i = 0; i < sizeof(T); ++i) {
+            hash ^= static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i));
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+
+    std::mutex g_consoleMutex;
+}
+
+namespace StreamSim::Render {
+
+void ConsoleRenderSink::Present(const Core::ByteFrameElement& frame) {
+    std::lock_guard<std::mutex> lock(g_consoleMutex);
+    std::cout << frame.data << '\n';
+}
+
+void ConsoleRenderSink::Flush() {
+    std::lock_guard<std::mutex> lock(g_consoleMutex);
+    std::cout.flush();
+}
+
+uint64_t ChecksumFrame(const Core::ByteFrameElement& frame) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    hash = HashValue(hash, frame.meta.streamId);
+    hash = HashValue(hash, frame.meta.displayOrder);
+    hash = HashValue(hash, frame.data);
+    const uint8_t* bytes = frame.payload.Data();
+    for (std::size_t i = 0; i < frame.payload.Size(); ++i) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+AsyncFileRenderSink::AsyncFileRenderSink(const std::string& path) {
+    m_file = std::fopen(path.c_str(), "w");
+    if (m_file == nullptr) {
+        return;
+    }
+    std::setvbuf(m_file, nullptr, _IOFBF, FILE_BUFFER_SIZE);
+
+    m_writerThread = std::thread([this] {
+        WriterLoop();
+    });
+}
+
+AsyncFileRenderSink::~AsyncFileRenderSink() {
+    // The writer drains what is left in the ring before it sees the close.
+    m_ring.Close();
+    if (m_writerThread.joinable()) {
+        m_writerThread.join();
+    }
+    if (m_file != nullptr) {
+        std::fclose(m_file);
+    }
+}
+
+void AsyncFileRenderSink::WriterLoop() {
+    std::array<Record, WRITE_BATCH_SIZE> records;
+    // Longest line is five numbers, separators and a newline.
+    std::array<char, 5 * 20 + 5> line;
+
+    while (true) {
+        const std::size_t numRecords = m_ring.ReadBatch(records, records.size());
+        if (numRecords == 0) {
+            if (m_ring.IsClosed()) {
+                break;
+            }
+            continue;
+        }
+
+        for (std::size_t i = 0; i < numRecords; ++i) {
+            const Record& record = records[i];
+            char* out = line.data();
+            char* end = line.data() + line.size();
+            out = std::to_chars(out, end, record.streamId).ptr;
+            *out++ = ' ';
+            out = std::to_chars(out, end, record.displayOrder).ptr;
+            *out++ = ' ';
+            out = std::to_chars(out, end, record.sequence).ptr;
+            *out++ = ' ';
+            out = std::to_chars(out, end, static_cast<uint32_t>(record.data)).ptr;
+            *out++ = ' ';
+            out = std::to_chars(out, end, record.checksum, 16).ptr;
+            *out++ = '\n';
+            std::fwrite(line.data(), 1, static_cast<std::size_t>(out - line.data()), m_file);
+        }
+        m_numWritten.fetch_add(numRecords, std::memory_order_release);
+    }
+}
+
+void AsyncFileRenderSink::Present(const Core::ByteFrameElement& frame) {
+    if (m_file == nullptr) {
+        return;
+    }
+
+    Record record;
+    record.streamId = frame.meta.streamId;
+    record.displayOrder = frame.meta.displayOrder;
+    record.sequence = frame.meta.sequence;
+    record.data = frame.data;
+    record.checksum = ChecksumFrame(frame);
+    if (m_ring.WriteSync(record)) {
+        ++m_numPresented;
+    }
+}
+
+void AsyncFileRenderSink::Flush() {
+    if (m_file == nullptr) {
+        return;
+    }
+
+    while (m_numWritten.load(std::memory_order_acquire) < m_numPresented) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    std::fflush(m_file);
+}
+
+void ChecksumRenderSink::Present(const Core::ByteFrameElement& frame) {
+    m_digest = HashValue(m_digest, ChecksumFrame(frame));
+    ++m_numFrames;
+
+    if (frame.payload.Size() == 0) {
+        ++m_numEmptyPayloads;
+    }
+
+    StreamState& stream = m_streams[frame.meta.streamId];
+    if (stream.hasFrame && frame.meta.displayOrder <= stream.lastDisplayOrder) {
+        ++m_numOutOfOrder;
+    }
+    stream.hasFrame = true;
+    stream.lastDisplayOrder = frame.meta.displayOrder;
+}
+
+}
@@ -0,0 +1,444 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+
+#include "UdpInputStream.hpp"
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    constexpr int RECEIVE_POLL_TIMEOUT_IN_MILISEC = 50;
+    constexpr int SOCKET_BUFFER_SIZE = 4 * 1024 * 1024;
+
+    template <typename T>
+    void PutBigEndian(uint8_t*& out, T value) {
+        for (std::size_t i = 0; i < sizeof(T); ++i) {
+            out[i] = static_cast<uint8_t>(value >> (8 * (sizeof(T) - 1 - i)));
+        }
+        out += sizeof(T);
+    }
+
+    template <typename T>
+    T GetBigEndian(const uint8_t*& in) {
+        T value = 0;
+        for (std::size_t i = 0; i < sizeof(T); ++i) {
+            value = static_cast<T>((value << 8) | in[i]);
+        }
+        in += sizeof(T);
+        return value;
+    }
+
+    uint64_t NanosecondsSince(std::chrono::steady_clock::time_point start) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+namespace StreamSim::Net {
+
+void EncodePacketHeader(const PacketHeader& header, std::span<uint8_t> packet) {
+    assert(packet.size() >= PACKET_HEADER_SIZE);
+
+    uint8_t* out = packet.data();
+    PutBigEndian<uint8_t>(out, PacketHeader::VERSION);
+    PutBigEndian(out, header.streamId);
+    PutBigEndian(out, header.sequence);
+    PutBigEndian(out, header.displayOrder);
+    PutBigEndian(out, header.timestampUs);
+    PutBigEndian(out, header.frameSize);
+    PutBigEndian(out, header.fragmentIndex);
+    PutBigEndian(out, header.fragmentCount);
+    PutBigEndian(out, header.frameType);
+    PutBigEndian(out, header.value);
+    PutBigEndian(out, header.numReferences);
+    for (uint64_t reference : header.references) {
+        PutBigEndian(out, reference);
+    }
+}
+
+bool DecodePacketHeader(std::span<const uint8_t> packet, PacketHeader& header) {
+    if (packet.size() < PACKET_HEADER_SIZE) {
+        return false;
+    }
+
+    const uint8_t* in = packet.data();
+    if (GetBigEndian<uint8_t>(in) != PacketHeader::VERSION) {
+        return false;
+    }
+    header.streamId = GetBigEndian<uint32_t>(in);
+    header.sequence = GetBigEndian<uint64_t>(in);
+    header.displayOrder = GetBigEndian<uint64_t>(in);
+    header.timestampUs = GetBigEndian<uint64_t>(in);
+    header.frameSize = GetBigEndian<uint32_t>(in);
+    header.fragmentIndex = GetBigEndian<uint16_t>(in);
+    header.fragmentCount = GetBigEndian<uint16_t>(in);
+    header.frameType = GetBigEndian<uint8_t>(in);
+    header.value = GetBigEndian<uint8_t>(in);
+    header.numReferences = GetBigEndian<uint8_t>(in);
+    for (uint64_t& reference : header.references) {
+        reference = GetBigEndian<uint64_t>(in);
+    }
+    return true;
+}
+
+FrameReassembler::FrameReassembler(Core::FrameBufferPool& pool)
+: m_pool(pool) {}
+
+FrameReassembler::PendingFrame* FrameReassembler::FindOrStart(const PacketHeader& header) {
+    PendingFrame* oldest = nullptr;
+    PendingFrame* unused = nullptr;
+    for (auto& pending : m_pending) {
+        if (!pending.inUse) {
+            unused = unused != nullptr ? unused : &pending;
+            continue;
+        }
+        if (pending.frame.meta.streamId == header.streamId && pending.frame.meta.sequence == header.sequence) {
+            return &pending;
+        }
+        if (oldest == nullptr || pending.startedAt < oldest->startedAt) {
+            oldest = &pending;
+        }
+    }
+
+    Core::FrameBufferRef payload = m_pool.Acquire(header.frameSize);
+    if (!payload) {
+        return nullptr;
+    }
+
+    PendingFrame* slot = unused;
+    if (slot == nullptr) {
+        // Everything is in use, the oldest frame has had the most time and is most likely missing a packet.
+        slot = oldest;
+        Finish(slot->frame.meta);
+        ++m_stats.framesDropped;
+    }
+
+    slot->inUse = true;
+    slot->startedAt = m_numStarted++;
+    slot->frameSize = header.frameSize;
+    slot->fragmentCount = header.fragmentCount;
+    slot->numReceived = 0;
+    slot->received.reset();
+
+    Core::FrameMetadata& meta = slot->frame.meta;
+    meta.streamId = header.streamId;
+    meta.sequence = header.sequence;
+    meta.displayOrder = header.displayOrder;
+    meta.timestampUs = header.timestampUs;
+    meta.type = static_cast<Core::FrameType>(header.frameType);
+    meta.numReferences = std::min<uint8_t>(header.numReferences, Core::MAX_FRAME_REFERENCES);
+    meta.references = header.references;
+    slot->frame.data = header.value;
+    slot->frame.payload = std::move(payload);
+    return slot;
+}
+
+bool FrameReassembler::IsFinished(const PacketHeader& header) const {
+    auto it = m_streams.find(header.streamId);
+    if (it == m_streams.end()) {
+        return false;
+    }
+    const StreamHistory& history = it->second;
+    return header.sequence + FINISHED_WINDOW <= history.highestFinished ||
+           history.finished[header.sequence % FINISHED_WINDOW] == header.sequence + 1;
+}
+
+void FrameReassembler::Finish(const Core::FrameMetadata& meta) {
+    StreamHistory& history = m_streams[meta.streamId];
+    history.finished[meta.sequence % FINISHED_WINDOW] = meta.sequence + 1;
+    history.highestFinished = std::max(history.highestFinished, meta.sequence);
+}
+
+bool FrameReassembler::AddPacket(std::span<const uint8_t> packet, Core::ByteUndecodedFrame& frame) {
+    PacketHeader header;
+    if (!DecodePacketHeader(packet, header)) {
+        ++m_stats.malformedPackets;
+        return false;
+    }
+
+    // The fragment has to sit exactly where the sender's fixed fragment size puts it.
+    const std::span<const uint8_t> fragment = packet.subspan(PACKET_HEADER_SIZE);
+    const std::size_t offset = static_cast<std::size_t>(header.fragmentIndex) * MAX_FRAGMENT_PAYLOAD;
+    if (header.fragmentCount != NumFragments(header.frameSize) || header.fragmentIndex >= header.fragmentCount ||
+        header.fragmentCount > MAX_FRAGMENTS_PER_FRAME ||
+        fragment.size() != std::min(MAX_FRAGMENT_PAYLOAD, header.frameSize - std::min<std::size_t>(offset, header.frameSize))) {
+        ++m_stats.malformedPackets;
+        return false;
+    }
+
+    // A frame that's done can't be pending any more, so this is a resend or a straggler.
+    if (IsFinished(header)) {
+        ++m_stats.duplicateFragments;
+        return false;
+    }
+
+    PendingFrame* pending = FindOrStart(header);
+    // The buffer was sized for the frame the first fragment described, one that disagrees doesn't fit it.
+    if (pending == nullptr || pending->frameSize != header.frameSize || pending->fragmentCount != header.fragmentCount) {
+        ++m_stats.malformedPackets;
+        return false;
+    }
+    if (pending->received.test(header.fragmentIndex)) {
+        ++m_stats.duplicateFragments;
+        return false;
+    }
+
+    if (!fragment.empty()) {
+        std::memcpy(pending->frame.payload.Data() + offset, fragment.data(), fragment.size());
+    }
+    pending->received.set(header.fragmentIndex);
+    if (++pending->numReceived < pending->fragmentCount) {
+        return false;
+    }
+
+    Finish(pending->frame.meta);
+    frame = std::move(pending->frame);
+    pending->frame = Core::ByteUndecodedFrame();
+    pending->inUse = false;
+    ++m_stats.framesCompleted;
+    return true;
+}
+
+UdpInputStream::UdpInputStream(NetInputStreamHandler* handler, uint16_t port, Core::FrameBufferPool& pool)
+: m_handler(handler)
+, m_port(port)
+, m_reassembler(pool) {
+    assert(m_handler != nullptr);
+}
+
+UdpInputStream::~UdpInputStream() {
+    Stop();
+}
+
+#if !defined(_WIN32)
+
+bool UdpInputStream::Start() {
+    m_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (m_socket < 0) {
+        return false;
+    }
+
+    // Room for a few bursts, so packets aren't dropped while the receive thread is busy handing frames on.
+    setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, &SOCKET_BUFFER_SIZE, sizeof(SOCKET_BUFFER_SIZE));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(m_port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addressSize = sizeof(address);
+    if (bind(m_socket, reinterpret_cast<sockaddr*>(&address), addressSize) != 0 ||
+        getsockname(m_socket, reinterpret_cast<sockaddr*>(&address), &addressSize) != 0) {
+        close(m_socket);
+        m_socket = -1;
+        return false;
+    }
+    m_port = ntohs(address.sin_port);
+
+    m_isRunning.store(true, std::memory_order_release);
+    m_receiveThread = std::thread([this] {
+        ReceiveLoop();
+    });
+    return true;
+}
+
+void UdpInputStream::Stop() {
+    m_isRunning.store(false, std::memory_order_release);
+    if (m_receiveThread.joinable()) {
+        m_receiveThread.join();
+    }
+    if (m_socket >= 0) {
+        close(m_socket);
+        m_socket = -1;
+    }
+}
+
+void UdpInputStream::ReceiveLoop() {
+    std::vector<std::array<uint8_t, MAX_PACKET_SIZE>> buffers(RECV_BATCH_SIZE);
+    std::array<iovec, RECV_BATCH_SIZE> iovecs;
+    std::array<mmsghdr, RECV_BATCH_SIZE> messages;
+    for (std::size_t i = 0; i < RECV_BATCH_SIZE; ++i) {
+        iovecs[i].iov_base = buffers[i].data();
+        iovecs[i].iov_len = buffers[i].size();
+        messages[i] = {};
+        messages[i].msg_hdr.msg_iov = &iovecs[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    pollfd pollFd{};
+    pollFd.fd = m_socket;
+    pollFd.events = POLLIN;
+
+    Core::ByteUndecodedFrame frame;
+    while (m_isRunning.load(std::memory_order_acquire)) {
+        // Sleep in poll so Stop is noticed, then drain the socket a batch per syscall.
+        if (poll(&pollFd, 1, RECEIVE_POLL_TIMEOUT_IN_MILISEC) <= 0) {
+            continue;
+        }
+
+        while (true) {
+            auto recvStart = std::chrono::steady_clock::now();
+            const int numPackets = recvmmsg(m_socket, messages.data(), RECV_BATCH_SIZE, MSG_DONTWAIT, nullptr);
+            m_recvNs.fetch_add(NanosecondsSince(recvStart), std::memory_order_relaxed);
+            m_recvCalls.fetch_add(1, std::memory_order_relaxed);
+            if (numPackets <= 0) {
+                break;
+            }
+
+            m_packets.fetch_add(static_cast<uint64_t>(numPackets), std::memory_order_relaxed);
+            for (int i = 0; i < numPackets; ++i) {
+                const std::size_t packetSize = messages[i].msg_len;
+                m_bytes.fetch_add(packetSize, std::memory_order_relaxed);
+
+                auto reassemblyStart = std::chrono::steady_clock::now();
+                const bool completed = m_reassembler.AddPacket(std::span<const uint8_t>(buffers[i].data(), packetSize), frame);
+                m_reassemblyNs.fetch_add(NanosecondsSince(reassemblyStart), std::memory_order_relaxed);
+
+                if (completed) {
+                    m_handler->OnInputStreamData(frame);
+                    frame = Core::ByteUndecodedFrame();
+                }
+            }
+
+            const ReassemblyStats& stats = m_reassembler.GetStats();
+            m_framesCompleted.store(stats.framesCompleted, std::memory_order_relaxed);
+            m_framesDropped.store(stats.framesDropped, std::memory_order_relaxed);
+            m_duplicateFragments.store(stats.duplicateFragments, std::memory_order_relaxed);
+            m_malformedPackets.store(stats.malformedPackets, std::memory_order_relaxed);
+
+            if (static_cast<std::size_t>(numPackets) < RECV_BATCH_SIZE) {
+                break;
+            }
+        }
+    }
+}
+
+UdpIngestStats UdpInputStream::GetStats() const {
+    UdpIngestStats stats;
+    stats.recvCalls = m_recvCalls.load(std::memory_order_relaxed);
+    stats.packets = m_packets.load(std::memory_order_relaxed);
+    stats.bytes = m_bytes.load(std::memory_order_relaxed);
+    stats.recvNs = m_recvNs.load(std::memory_order_relaxed);
+    stats.reassemblyNs = m_reassemblyNs.load(std::memory_order_relaxed);
+    stats.reassembly.framesCompleted = m_framesCompleted.load(std::memory_order_relaxed);
+    stats.reassembly.framesDropped = m_framesDropped.load(std::memory_order_relaxed);
+    stats.reassembly.duplicateFragments = m_duplicateFragments.load(std::memory_order_relaxed);
+    stats.reassembly.malformedPackets = m_malformedPackets.load(std::memory_order_relaxed);
+    return stats;
+}
+
+UdpFrameSender::UdpFrameSender(uint16_t port, const std::string& address)
+: m_packets(SEND_BATCH_SIZE) {
+    m_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (m_socket < 0) {
+        return;
+    }
+
+    sockaddr_in destination{};
+    destination.sin_family = AF_INET;
+    destination.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &destination.sin_addr) != 1 ||
+        connect(m_socket, reinterpret_cast<sockaddr*>(&destination), sizeof(destination)) != 0) {
+        close(m_socket);
+        m_socket = -1;
+    }
+}
+
+UdpFrameSender::~UdpFrameSender() {
+    if (m_socket >= 0) {
+        close(m_socket);
+    }
+}
+
+bool UdpFrameSender::SendFrame(const Core::ByteUndecodedFrame& frame) {
+    const std::size_t frameSize = frame.payload.Size();
+    if (m_socket < 0 || NumFragments(frameSize) > MAX_FRAGMENTS_PER_FRAME) {
+        return false;
+    }
+
+    PacketHeader header;
+    header.streamId = frame.meta.streamId;
+    header.sequence = frame.meta.sequence;
+    header.displayOrder = frame.meta.displayOrder;
+    header.timestampUs = frame.meta.timestampUs;
+    header.frameSize = static_cast<uint32_t>(frameSize);
+    header.fragmentCount = NumFragments(frameSize);
+    header.frameType = static_cast<uint8_t>(frame.meta.type);
+    header.value = frame.data;
+    header.numReferences = frame.meta.numReferences;
+    header.references = frame.meta.references;
+
+    std::array<iovec, SEND_BATCH_SIZE> iovecs;
+    std::array<mmsghdr, SEND_BATCH_SIZE> messages;
+
+    uint16_t fragmentIndex = 0;
+    while (fragmentIndex < header.fragmentCount) {
+        const std::size_t numInBatch = std::min<std::size_t>(SEND_BATCH_SIZE, header.fragmentCount - fragmentIndex);
+        for (std::size_t i = 0; i < numInBatch; ++i) {
+            header.fragmentIndex = static_cast<uint16_t>(fragmentIndex + i);
+            const std::size_t offset = static_cast<std::size_t>(header.fragmentIndex) * MAX_FRAGMENT_PAYLOAD;
+            const std::size_t fragmentSize = std::min(MAX_FRAGMENT_PAYLOAD, frameSize - offset);
+
+            auto& packet = m_packets[i];
+            EncodePacketHeader(header, packet);
+            if (fragmentSize > 0) {
+                std::memcpy(packet.data() + PACKET_HEADER_SIZE, frame.payload.Data() + offset, fragmentSize);
+            }
+
+            iovecs[i].iov_base = packet.data();
+            iovecs[i].iov_len = PACKET_HEADER_SIZE + fragmentSize;
+            messages[i] = {};
+            messages[i].msg_hdr.msg_iov = &iovecs[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        std::size_t numSent = 0;
+        while (numSent < numInBatch) {
+            const int sent = sendmmsg(m_socket, messages.data() + numSent, static_cast<unsigned int>(numInBatch - numSent), 0);
+            if (sent <= 0) {
+                return false;
+            }
+            for (int i = 0; i < sent; ++i) {
+                m_numBytesSent += iovecs[numSent + i].iov_len;
+            }
+            numSent += static_cast<std::size_t>(sent);
+        }
+
+        m_numPacketsSent += numInBatch;
+        fragmentIndex = static_cast<uint16_t>(fragmentIndex + numInBatch);
+    }
+    return true;
+}
+
+#else
+
+// recvmmsg/sendmmsg are POSIX only, elsewhere the UDP ingest simply can't be started.
+bool UdpInputStream::Start() {
+    return false;
+}
+
+void UdpInputStream::Stop() {}
+
+void UdpInputStream::ReceiveLoop() {}
+
+UdpIngestStats UdpInputStream::GetStats() const {
+    return {};
+}
+
+UdpFrameSender::UdpFrameSender(uint16_t, const std::string&) {}
+
+UdpFrameSender::~UdpFrameSender() {}
+
+bool UdpFrameSender::SendFrame(const Core::ByteUndecodedFrame&) {
+    return false;
+}
+
+#endif
+
+}
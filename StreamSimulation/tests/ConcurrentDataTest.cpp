@@ -184,3 +184,388 @@ TEST(ConcurrentDataTest, MultiThreadReadBlocksWhenEmpty) {
     EXPECT_EQ(data, 99);
     EXPECT_EQ(buffer.NumElements(), 0);
 }
+
+TEST(ConcurrentDataTest, ConcurrentWriteReadGetsEveryItem) {
+    StreamSim::Core::ConcurrentBufferQueue<int, 16> buffer;
+    const int numItems = 10000;
+    std::vector<int> readValues;
+
+    std::thread writer([&buffer]() {
+        for (int i = 0; i < numItems; ++i) {
+            buffer.WriteSync(i);
+        }
+        buffer.Close();
+    });
+
+    // Reads until closed and drained, however the threads get scheduled.
+    std::thread reader([&buffer, &readValues]() {
+        int value;
+        while (buffer.ReadSync(value)) {
+            readValues.push_back(value);
+        }
+    });
+
+    writer.join();
+    reader.join();
+
+    ASSERT_EQ(readValues.size(), numItems);
+    for (int i = 0; i < numItems; ++i) {
+        ASSERT_EQ(readValues[i], i);
+    }
+}
+
+TEST(ConcurrentDataTest, MultipleReadersWritersGetEveryItem) {
+    StreamSim::Core::ConcurrentBufferQueue<int, 16> buffer;
+    const int itemsPerWrite = 2000;
+    std::atomic<int> readCount{0};
+    std::atomic<long long> readSum{0};
+
+    std::vector<std::thread> writers;
+    for (int i = 0; i < 3; ++i) {
+        writers.emplace_back([&buffer, i]() {
+            for (int j = 0; j < itemsPerWrite; ++j) {
+                buffer.WriteSync(i * itemsPerWrite + j);
+            }
+        });
+    }
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 3; ++i) {
+        readers.emplace_back([&buffer, &readCount, &readSum]() {
+            int value;
+            while (buffer.ReadSync(value)) {
+                readCount++;
+                readSum += value;
+            }
+        });
+    }
+
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    buffer.Close();
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    const long long numItems = 3 * itemsPerWrite;
+    EXPECT_EQ(readCount.load(), numItems);
+    EXPECT_EQ(readSum.load(), numItems * (numItems - 1) / 2);
+}
+
+TEST(ConcurrentDataTest, SpscSingleThreadedWriteRead) {
+    StreamSim::Core::SpscRingBufferQueue<int, 4> buffer;
+    int value;
+
+    EXPECT_TRUE(buffer.WriteSync(10));
+    EXPECT_TRUE(buffer.WriteSync(11));
+    EXPECT_EQ(buffer.NumElements(), 2);
+
+    EXPECT_TRUE(buffer.ReadSync(value));
+    EXPECT_EQ(value, 10);
+    EXPECT_TRUE(buffer.ReadAsync(value));
+    EXPECT_EQ(value, 11);
+    EXPECT_TRUE(buffer.IsEmpty());
+    EXPECT_FALSE(buffer.ReadAsync(value));
+}
+
+TEST(ConcurrentDataTest, SpscWrapAroundAndFull) {
+    StreamSim::Core::SpscRingBufferQueue<int, 4, 1> buffer;
+    int value;
+
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 4; ++i) {
+            EXPECT_TRUE(buffer.WriteSync(round * 4 + i));
+        }
+        EXPECT_TRUE(buffer.IsFull());
+
+        for (int i = 0; i < 4; ++i) {
+            EXPECT_TRUE(buffer.ReadAsync(value));
+            EXPECT_EQ(value, round * 4 + i);
+        }
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        buffer.WriteSync(i);
+    }
+    // Should wait 1 second and fail.
+    EXPECT_FALSE(buffer.WriteSync(4));
+}
+
+TEST(ConcurrentDataTest, SpscReadBlocksUntilWrite) {
+    StreamSim::Core::SpscRingBufferQueue<int, 2, 0> buffer;
+    int data = 0;
+
+    std::thread readerThread([&buffer, &data]() {
+        EXPECT_TRUE(buffer.ReadSync(data));
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    buffer.WriteSync(99);
+
+    readerThread.join();
+    EXPECT_EQ(data, 99);
+}
+
+TEST(ConcurrentDataTest, SpscConcurrentWriteReadKeepsOrder) {
+    StreamSim::Core::SpscRingBufferQueue<int, 64> buffer;
+    const int numItems = 100000;
+    std::vector<int> readValues;
+    readValues.reserve(numItems);
+
+    std::thread writer([&buffer]() {
+        for (int i = 0; i < numItems; ++i) {
+            buffer.WriteSync(i);
+        }
+    });
+
+    std::thread reader([&buffer, &readValues]() {
+        int value;
+        while (readValues.size() < numItems) {
+            if (buffer.ReadSync(value)) {
+                readValues.push_back(value);
+            }
+        }
+    });
+
+    writer.join();
+    reader.join();
+
+    ASSERT_EQ(readValues.size(), numItems);
+    for (int i = 0; i < numItems; ++i) {
+        ASSERT_EQ(readValues[i], i);
+    }
+}
+
+TEST(ConcurrentDataTest, MpmcSingleThreadedWriteRead) {
+    StreamSim::Core::MpmcBufferQueue<int, 4, 1> buffer;
+    int value;
+
+    EXPECT_FALSE(buffer.ReadAsync(value));
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 4; ++i) {
+            EXPECT_TRUE(buffer.WriteSync(round * 4 + i));
+        }
+        EXPECT_TRUE(buffer.IsFull());
+        for (int i = 0; i < 4; ++i) {
+            EXPECT_TRUE(buffer.ReadSync(value));
+            EXPECT_EQ(value, round * 4 + i);
+        }
+        EXPECT_TRUE(buffer.IsEmpty());
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        buffer.WriteSync(i);
+    }
+    // Should wait 1 second and fail.
+    EXPECT_FALSE(buffer.WriteSync(4));
+}
+
+TEST(ConcurrentDataTest, MpmcMultipleReadersWriters) {
+    StreamSim::Core::MpmcBufferQueue<int, 128> buffer;
+
+    const int numThreads = 4;
+    const int itemsPerWrite = 20000;
+    const int totalItems = numThreads * itemsPerWrite;
+    std::atomic<int> readCount{0};
+    std::atomic<long long> readSum{0};
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; ++i) {
+        threads.emplace_back([&buffer, i]() {
+            for (int j = 0; j < itemsPerWrite; ++j) {
+                buffer.WriteSync(i * itemsPerWrite + j);
+            }
+        });
+    }
+    for (int i = 0; i < numThreads; ++i) {
+        threads.emplace_back([&buffer, &readCount, &readSum]() {
+            int value;
+            while (readCount.load() < totalItems) {
+                if (buffer.ReadAsync(value)) {
+                    readSum += value;
+                    readCount++;
+                }
+            }
+        });
+    }
+
+    for (auto& th : threads) {
+        th.join();
+    }
+
+    EXPECT_EQ(readCount.load(), totalItems);
+    EXPECT_EQ(readSum.load(), static_cast<long long>(totalItems) * (totalItems - 1) / 2);
+    EXPECT_TRUE(buffer.IsEmpty());
+}
+
+TEST(ConcurrentDataTest, MpmcReadBlocksUntilWrite) {
+    StreamSim::Core::MpmcBufferQueue<int, 2, 0> buffer;
+    std::atomic<int> readCount{0};
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 2; ++i) {
+        readers.emplace_back([&buffer, &readCount]() {
+            int value;
+            EXPECT_TRUE(buffer.ReadSync(value));
+            readCount++;
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(readCount.load(), 0);
+
+    buffer.WriteSync(1);
+    buffer.WriteSync(2);
+
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(readCount.load(), 2);
+}
+
+TEST(ConcurrentDataTest, CloseWakesBlockedReaders) {
+    StreamSim::Core::ConcurrentBufferQueue<int, 4, 0> lockedBuffer;
+    StreamSim::Core::SpscRingBufferQueue<int, 4, 0> spscBuffer;
+    StreamSim::Core::MpmcBufferQueue<int, 4, 0> mpmcBuffer;
+    std::vector<StreamSim::Core::BufferQueue<int>*> buffers = { &lockedBuffer, &spscBuffer, &mpmcBuffer };
+
+    for (auto* buffer : buffers) {
+        std::thread reader([buffer]() {
+            int value;
+            EXPECT_TRUE(buffer->ReadSync(value));
+            EXPECT_EQ(value, 7);
+            // Without Close this would block forever.
+            EXPECT_FALSE(buffer->ReadSync(value));
+        });
+
+        buffer->WriteSync(7);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        buffer->Close();
+        reader.join();
+
+        EXPECT_TRUE(buffer->IsClosed());
+        EXPECT_FALSE(buffer->WriteSync(8));
+    }
+}
+
+TEST(ConcurrentDataTest, CloseKeepsRemainingElementsReadable) {
+    StreamSim::Core::ConcurrentBufferQueue<int, 4> lockedBuffer;
+    StreamSim::Core::SpscRingBufferQueue<int, 4> spscBuffer;
+    StreamSim::Core::MpmcBufferQueue<int, 4> mpmcBuffer;
+    std::vector<StreamSim::Core::BufferQueue<int>*> buffers = { &lockedBuffer, &spscBuffer, &mpmcBuffer };
+
+    for (auto* buffer : buffers) {
+        buffer->WriteSync(1);
+        buffer->WriteSync(2);
+        buffer->Close();
+
+        int value;
+        EXPECT_TRUE(buffer->ReadSync(value));
+        EXPECT_EQ(value, 1);
+        EXPECT_TRUE(buffer->ReadSync(value));
+        EXPECT_EQ(value, 2);
+        EXPECT_FALSE(buffer->ReadSync(value));
+    }
+}
+
+TEST(ConcurrentDataTest, BatchWriteReadAllQueueTypes) {
+    StreamSim::Core::ConcurrentBufferQueue<int, 8, 1> lockedBuffer;
+    StreamSim::Core::SpscRingBufferQueue<int, 8, 1> spscBuffer;
+    StreamSim::Core::MpmcBufferQueue<int, 8, 1> mpmcBuffer;
+    std::vector<StreamSim::Core::BufferQueue<int>*> buffers = { &lockedBuffer, &spscBuffer, &mpmcBuffer };
+
+    for (auto* buffer : buffers) {
+        std::array<int, 10> input = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+        std::array<int, 10> output = {};
+
+        // Only 8 fit, the rest is left to the caller.
+        EXPECT_EQ(buffer->WriteBatch(input), 8);
+        EXPECT_TRUE(buffer->IsFull());
+
+        EXPECT_EQ(buffer->ReadBatchAsync(output, 3), 3);
+        EXPECT_EQ(output[0], 0);
+        EXPECT_EQ(output[2], 2);
+
+        // Wraps around the end of the ring.
+        EXPECT_EQ(buffer->WriteBatch(std::span<const int>(input).subspan(8)), 2);
+        EXPECT_EQ(buffer->ReadBatch(output, output.size()), 7);
+        for (int i = 0; i < 7; ++i) {
+            EXPECT_EQ(output[i], i + 3);
+        }
+
+        EXPECT_EQ(buffer->ReadBatchAsync(output, output.size()), 0);
+        // Should wait 1 second and fail.
+        EXPECT_EQ(buffer->ReadBatch(output, output.size()), 0);
+    }
+}
+
+TEST(ConcurrentDataTest, RuntimeCapacityAllQueueTypes) {
+    // Same template arguments, sized at construction instead.  The lock-free rings round up to a power of two.
+    StreamSim::Core::QueueWaitPolicy wait{ std::chrono::milliseconds(50) };
+    StreamSim::Core::ConcurrentBufferQueue<int, 1000> lockedBuffer(3, wait);
+    StreamSim::Core::SpscRingBufferQueue<int, 1024> spscBuffer(3, wait);
+    StreamSim::Core::MpmcBufferQueue<int, 1024> mpmcBuffer(3, wait);
+    std::vector<std::pair<StreamSim::Core::BufferQueue<int>*, std::size_t>> buffers = {
+        { &lockedBuffer, 3 }, { &spscBuffer, 4 }, { &mpmcBuffer, 4 } };
+
+    for (auto [buffer, capacity] : buffers) {
+        EXPECT_EQ(buffer->Capacity(), capacity);
+        for (std::size_t i = 0; i < capacity; ++i) {
+            EXPECT_TRUE(buffer->WriteSync(static_cast<int>(i)));
+        }
+        EXPECT_TRUE(buffer->IsFull());
+
+        // Times out after the configured 50 ms instead of the compiled in default.
+        const auto start = std::chrono::steady_clock::now();
+        EXPECT_FALSE(buffer->WriteSync(99));
+        EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+    }
+}
+
+TEST(ConcurrentDataTest, BatchReadWakesOnWrite) {
+    StreamSim::Core::MpmcBufferQueue<int, 64, 0> buffer;
+    const int numItems = 10000;
+    std::atomic<int> readCount{0};
+    std::atomic<long long> readSum{0};
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 2; ++i) {
+        readers.emplace_back([&buffer, &readCount, &readSum]() {
+            std::array<int, 16> values;
+            while (true) {
+                const std::size_t numRead = buffer.ReadBatch(values, values.size());
+                if (numRead == 0) {
+                    break;
+                }
+                for (std::size_t j = 0; j < numRead; ++j) {
+                    readSum += values[j];
+                }
+                readCount += static_cast<int>(numRead);
+            }
+        });
+    }
+
+    std::array<int, 7> chunk;
+    for (int i = 0; i < numItems; i += static_cast<int>(chunk.size())) {
+        std::size_t chunkSize = std::min<std::size_t>(chunk.size(), numItems - i);
+        for (std::size_t j = 0; j < chunkSize; ++j) {
+            chunk[j] = i + static_cast<int>(j);
+        }
+        std::span<const int> pending(chunk.data(), chunkSize);
+        while (!pending.empty()) {
+            pending = pending.subspan(buffer.WriteBatch(pending));
+        }
+    }
+
+    while (readCount.load() < numItems) {
+        std::this_thread::yield();
+    }
+    buffer.Close();
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_EQ(readCount.load(), numItems);
+    EXPECT_EQ(readSum.load(), static_cast<long long>(numItems) * (numItems - 1) / 2);
+}
@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <AwaitableQueue.hpp>
+#include <CoroutineExecutor.hpp>
+
+namespace {
+    using IntQueue = StreamSim::Core::AwaitableQueue<int>;
+
+    // Coroutines take everything by value or pointer, a reference to a caller's temporary wouldn't outlive the first suspension.
+    StreamSim::Core::CoTask CountAfterYield(StreamSim::Core::CoroutineExecutor* executor, std::atomic<int>* count) {
+        co_await executor->Yield();
+        count->fetch_add(1);
+    }
+
+    StreamSim::Core::CoTask SleepThenLog(StreamSim::Core::CoroutineExecutor* executor, int delayMs,
+                                         std::mutex* mutex, std::vector<int>* log) {
+        co_await executor->SleepUntil(std::chrono::steady_clock::now() + std::chrono::milliseconds(delayMs));
+        std::lock_guard<std::mutex> lock(*mutex);
+        log->push_back(delayMs);
+    }
+
+    StreamSim::Core::CoTask Produce(IntQueue* queue, int numValues, std::atomic<int>* numWritten) {
+        for (int i = 0; i < numValues; ++i) {
+            if (!co_await queue->Write(i)) {
+                break;
+            }
+            if (numWritten != nullptr) {
+                numWritten->fetch_add(1);
+            }
+        }
+        queue->Close();
+    }
+
+    StreamSim::Core::CoTask Consume(IntQueue* queue, std::atomic<int>* numRead, std::atomic<int>* numOutOfOrder) {
+        int value = 0;
+        int expected = 0;
+        while (co_await queue->Read(value)) {
+            if (value != expected) {
+                numOutOfOrder->fetch_add(1);
+            }
+            expected = value + 1;
+            numRead->fetch_add(1);
+        }
+    }
+
+    StreamSim::Core::CoTask ReadOnce(IntQueue* queue, std::atomic<int>* result) {
+        int value = 0;
+        const bool isRead = co_await queue->Read(value);
+        result->store(isRead ? 1 : 0);
+    }
+
+    template <typename Condition>
+    bool WaitFor(Condition condition) {
+        for (int i = 0; i < 500 && !condition(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        return condition();
+    }
+}
+
+TEST(CoroutineExecutorTest, SpawnedTasksRunUntilJoin) {
+    StreamSim::Core::CoroutineExecutor executor(2);
+    EXPECT_EQ(executor.NumThreads(), 2);
+
+    std::atomic<int> count{0};
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(executor.Spawn(CountAfterYield(&executor, &count)));
+    }
+    executor.Join();
+
+    EXPECT_EQ(count.load(), 100);
+    auto stats = executor.GetStats();
+    EXPECT_EQ(stats.tasks, 0);
+    // Once to start and once after the yield.
+    EXPECT_EQ(stats.resumes, 200);
+
+    // Nothing runs on a stopped executor.
+    executor.Stop();
+    EXPECT_FALSE(executor.Spawn(CountAfterYield(&executor, &count)));
+    EXPECT_EQ(count.load(), 100);
+}
+
+TEST(CoroutineExecutorTest, SleepersWakeInDueOrder) {
+    StreamSim::Core::CoroutineExecutor executor(1);
+    std::mutex mutex;
+    std::vector<int> log;
+    for (int delayMs : { 30, 10, 20, 0 }) {
+        executor.Spawn(SleepThenLog(&executor, delayMs, &mutex, &log));
+    }
+    executor.Join();
+
+    EXPECT_EQ(log, (std::vector<int>{ 0, 10, 20, 30 }));
+}
+
+TEST(AwaitableQueueTest, ReaderAndWriterTakeTurns) {
+    StreamSim::Core::CoroutineExecutor executor(2);
+    IntQueue queue(executor, 4);
+
+    std::atomic<int> numRead{0};
+    std::atomic<int> numOutOfOrder{0};
+    executor.Spawn(Consume(&queue, &numRead, &numOutOfOrder));
+    executor.Spawn(Produce(&queue, 1000, nullptr));
+    executor.Join();
+
+    EXPECT_EQ(numRead.load(), 1000);
+    EXPECT_EQ(numOutOfOrder.load(), 0);
+    EXPECT_EQ(queue.NumElements(), 0);
+    EXPECT_LE(queue.GetQueueStats().maxDepth, 4);
+}
+
+TEST(AwaitableQueueTest, FullQueueSuspendsWriter) {
+    StreamSim::Core::CoroutineExecutor executor(1);
+    IntQueue queue(executor, 2);
+
+    std::atomic<int> numWritten{0};
+    executor.Spawn(Produce(&queue, 5, &numWritten));
+    ASSERT_TRUE(WaitFor([&] { return numWritten.load() == 2; }));
+
+    // The writer is suspended on the third value, not blocking the only thread.
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(numWritten.load(), 2);
+    EXPECT_EQ(queue.NumElements(), 2);
+    EXPECT_EQ(executor.GetStats().tasks, 1);
+
+    std::atomic<int> numRead{0};
+    std::atomic<int> numOutOfOrder{0};
+    executor.Spawn(Consume(&queue, &numRead, &numOutOfOrder));
+    executor.Join();
+    EXPECT_EQ(numWritten.load(), 5);
+    EXPECT_EQ(numRead.load(), 5);
+    EXPECT_EQ(numOutOfOrder.load(), 0);
+}
+
+TEST(AwaitableQueueTest, CloseWakesWaitingReaders) {
+    StreamSim::Core::CoroutineExecutor executor(1);
+    IntQueue queue(executor, 2);
+
+    std::atomic<int> result{-1};
+    executor.Spawn(ReadOnce(&queue, &result));
+    ASSERT_TRUE(WaitFor([&] { return executor.GetStats().resumes == 1; }));
+    EXPECT_EQ(result.load(), -1);
+
+    queue.Close();
+    executor.Join();
+    EXPECT_EQ(result.load(), 0);
+    EXPECT_TRUE(queue.IsClosed());
+
+    // Writes fail right away once closed.
+    std::atomic<int> numWritten{0};
+    executor.Spawn(Produce(&queue, 3, &numWritten));
+    executor.Join();
+    EXPECT_EQ(numWritten.load(), 0);
+}
+
+TEST(AwaitableQueueTest, ManyStreamsOnFewThreads) {
+    constexpr int NUM_STREAMS = 500;
+    StreamSim::Core::CoroutineExecutor executor(2);
+    std::vector<std::unique_ptr<IntQueue>> queues;
+    std::atomic<int> numRead{0};
+    std::atomic<int> numOutOfOrder{0};
+    for (int i = 0; i < NUM_STREAMS; ++i) {
+        queues.push_back(std::make_unique<IntQueue>(executor, 2));
+        executor.Spawn(Consume(queues.back().get(), &numRead, &numOutOfOrder));
+        executor.Spawn(Produce(queues.back().get(), 20, nullptr));
+    }
+    executor.Join();
+
+    EXPECT_EQ(numRead.load(), NUM_STREAMS * 20);
+    EXPECT_EQ(numOutOfOrder.load(), 0);
+}
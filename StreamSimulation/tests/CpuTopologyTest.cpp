@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <CpuTopology.hpp>
+#include <FrameBufferPool.hpp>
+
+namespace {
+    void WriteFile(const std::filesystem::path& path, const std::string& text) {
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream(path) << text << "\n";
+    }
+
+    // Two sockets with two cores of two hardware threads each, numbered the way Linux does it:
+    // first threads of every core are cpu0-3, their SMT siblings cpu4-7.
+    std::string MakeDualSocketSysfs() {
+        const std::filesystem::path root = std::filesystem::path(::testing::TempDir()) / "cpu_topology_test";
+        std::filesystem::remove_all(root);
+
+        WriteFile(root / "cpu/online", "0-7");
+        for (uint32_t cpu = 0; cpu < 8; ++cpu) {
+            const std::filesystem::path topology = root / ("cpu/cpu" + std::to_string(cpu)) / "topology";
+            WriteFile(topology / "core_id", std::to_string(cpu % 2));
+            WriteFile(topology / "physical_package_id", std::to_string((cpu / 2) % 2));
+        }
+        WriteFile(root / "node/online", "0-1");
+        WriteFile(root / "node/node0/cpulist", "0-1,4-5");
+        WriteFile(root / "node/node1/cpulist", "2-3,6-7");
+        return root.string();
+    }
+
+    std::vector<uint32_t> PlaceThreads(const StreamSim::Core::CpuTopology& topology,
+                                       const StreamSim::Core::StagePlacement& placement, std::size_t numThreads) {
+        std::vector<uint32_t> cpus;
+        for (std::size_t i = 0; i < numThreads; ++i) {
+            const auto placed = StreamSim::Core::PlaceStageThread(topology, placement, i);
+            EXPECT_EQ(placed.size(), 1);
+            cpus.push_back(placed.empty() ? ~0u : placed[0]);
+        }
+        return cpus;
+    }
+}
+
+TEST(CpuTopologyTest, DiscoverDualSocket) {
+    const auto topology = StreamSim::Core::CpuTopology::Discover(MakeDualSocketSysfs());
+    ASSERT_EQ(topology.Cpus().size(), 8);
+    EXPECT_EQ(topology.NumCores(), 4);
+    EXPECT_EQ(topology.Nodes(), (std::vector<uint32_t>{ 0, 1 }));
+    EXPECT_EQ(topology.CpusOfNode(1), (StreamSim::Core::CpuSet{ 2, 3, 6, 7 }));
+    EXPECT_TRUE(topology.CpusOfNode(2).empty());
+
+    // cpu4 is the sibling of cpu0, cpu2 has the same core_id but sits on the other socket.
+    const auto* cpu0 = topology.FindCpu(0);
+    const auto* cpu2 = topology.FindCpu(2);
+    const auto* cpu4 = topology.FindCpu(4);
+    ASSERT_TRUE(cpu0 != nullptr && cpu2 != nullptr && cpu4 != nullptr);
+    EXPECT_EQ(cpu4->core, cpu0->core);
+    EXPECT_EQ(cpu4->smtIndex, 1);
+    EXPECT_NE(cpu2->core, cpu0->core);
+    EXPECT_EQ(cpu2->package, 1);
+    EXPECT_EQ(cpu2->node, 1);
+    EXPECT_EQ(topology.FindCpu(8), nullptr);
+
+    EXPECT_EQ(topology.NodeOf({ 2, 7 }), 1u);
+    EXPECT_FALSE(topology.NodeOf({ 1, 2 }).has_value());
+    EXPECT_EQ(StreamSim::Core::FormatCpuTopology(topology),
+              "8 CPUs, 4 cores, 2 NUMA nodes (node 0: 0-1,4-5, node 1: 2-3,6-7)");
+}
+
+TEST(CpuTopologyTest, DiscoverWithoutSysfs) {
+    // Nothing to read, every CPU the process sees on one node.
+    const auto topology = StreamSim::Core::CpuTopology::Discover(::testing::TempDir() + "no_such_sysfs");
+    EXPECT_GE(topology.Cpus().size(), 1);
+    EXPECT_EQ(topology.NumCores(), topology.Cpus().size());
+    EXPECT_EQ(topology.Nodes(), (std::vector<uint32_t>{ 0 }));
+}
+
+TEST(CpuTopologyTest, PinningPolicies) {
+    const auto topology = StreamSim::Core::CpuTopology::Discover(MakeDualSocketSysfs());
+    StreamSim::Core::StagePlacement placement;
+
+    // Shared and not narrowed down is no pinning at all.
+    EXPECT_TRUE(StreamSim::Core::PlaceStageThread(topology, placement, 0).empty());
+    placement.node = 1;
+    EXPECT_EQ(StreamSim::Core::PlaceStageThread(topology, placement, 3), (StreamSim::Core::CpuSet{ 2, 3, 6, 7 }));
+
+    // Compact fills the cores of node 0, then their siblings, before going to node 1.
+    placement.node.reset();
+    placement.policy = StreamSim::Core::PinningPolicy::Compact;
+    EXPECT_EQ(PlaceThreads(topology, placement, 8), (std::vector<uint32_t>{ 0, 1, 4, 5, 2, 3, 6, 7 }));
+
+    // Spread takes turns between the nodes, siblings last.
+    placement.policy = StreamSim::Core::PinningPolicy::Spread;
+    EXPECT_EQ(PlaceThreads(topology, placement, 8), (std::vector<uint32_t>{ 0, 2, 1, 3, 4, 6, 5, 7 }));
+
+    // Narrowed down to cpus on node 0, and more threads than CPUs wrap around.
+    placement.cpus = { 1, 2, 5 };
+    placement.node = 0;
+    EXPECT_EQ(PlaceThreads(topology, placement, 3), (std::vector<uint32_t>{ 1, 5, 1 }));
+
+    // No CPU left, no pinning.
+    placement.cpus = { 2 };
+    EXPECT_TRUE(StreamSim::Core::PlaceStageThread(topology, placement, 0).empty());
+}
+
+TEST(CpuTopologyTest, StageNode) {
+    const auto topology = StreamSim::Core::CpuTopology::Discover(MakeDualSocketSysfs());
+    StreamSim::Core::StagePlacement placement;
+    EXPECT_FALSE(StreamSim::Core::StageNode(topology, placement).has_value());
+
+    placement.cpus = { 3, 6 };
+    EXPECT_EQ(StreamSim::Core::StageNode(topology, placement), 1u);
+    placement.cpus = { 0, 3 };
+    EXPECT_FALSE(StreamSim::Core::StageNode(topology, placement).has_value());
+    placement.node = 0;
+    EXPECT_EQ(StreamSim::Core::StageNode(topology, placement), 0u);
+
+    // On a single node host everything is on that node.
+    const auto singleNode = StreamSim::Core::CpuTopology::Discover(::testing::TempDir() + "no_such_sysfs");
+    EXPECT_EQ(StreamSim::Core::StageNode(singleNode, StreamSim::Core::StagePlacement()), 0u);
+}
+
+TEST(CpuTopologyTest, ConstructOnNode) {
+    const auto topology = StreamSim::Core::CpuTopology::Discover(MakeDualSocketSysfs());
+    const auto caller = std::this_thread::get_id();
+
+    // Runs on another thread when there is a node to go to, the result is handed back either way.
+    auto made = StreamSim::Core::ConstructOnNode(topology, 1u, [&] {
+        return std::make_unique<bool>(std::this_thread::get_id() != caller);
+    });
+    ASSERT_TRUE(made);
+    EXPECT_TRUE(*made);
+
+    made = StreamSim::Core::ConstructOnNode(topology, std::nullopt, [&] {
+        return std::make_unique<bool>(std::this_thread::get_id() != caller);
+    });
+    ASSERT_TRUE(made);
+    EXPECT_FALSE(*made);
+}
+
+TEST(CpuTopologyTest, CpuSets) {
+    StreamSim::Core::CpuSet cpus;
+    ASSERT_TRUE(StreamSim::Core::ParseCpuSet("8, 0-3,2", cpus));
+    EXPECT_EQ(cpus, (StreamSim::Core::CpuSet{ 0, 1, 2, 3, 8 }));
+    EXPECT_EQ(StreamSim::Core::FormatCpuSet(cpus), "0-3,8");
+
+    ASSERT_TRUE(StreamSim::Core::ParseCpuSet("", cpus));
+    EXPECT_TRUE(cpus.empty());
+    EXPECT_FALSE(StreamSim::Core::ParseCpuSet("1-", cpus));
+    EXPECT_FALSE(StreamSim::Core::ParseCpuSet("0-100000", cpus));
+}
+
+TEST(CpuTopologyTest, SetThreadAffinity) {
+    std::atomic_bool done{false};
+    std::thread thread([&done] {
+        while (!done.load()) {
+            std::this_thread::yield();
+        }
+    });
+
+    // An empty set leaves the thread alone.
+    EXPECT_TRUE(StreamSim::Core::SetThreadAffinity(thread, {}));
+#if defined(__linux__)
+    // The CPU this test runs on is one the process is allowed to use.
+    const uint32_t cpu = StreamSim::Core::CurrentCpu();
+    EXPECT_TRUE(StreamSim::Core::SetThreadAffinity(thread, { cpu }));
+    EXPECT_NE(StreamSim::Core::CpuTopology::Host().FindCpu(cpu), nullptr);
+#endif
+    done.store(true);
+    thread.join();
+}
+
+TEST(CpuTopologyTest, NodeFrameBufferPools) {
+    auto& pool = StreamSim::Core::FrameBufferPool::ForNode(0);
+    EXPECT_EQ(&StreamSim::Core::FrameBufferPool::ForNode(0), &pool);
+    EXPECT_EQ(pool.Node(), 0u);
+    EXPECT_FALSE(StreamSim::Core::FrameBufferPool::Default().Node().has_value());
+
+    auto buffer = pool.Acquire(5000);
+    ASSERT_TRUE(buffer);
+    EXPECT_EQ(buffer.Pool(), &pool);
+    buffer.Data()[4999] = 1;
+
+    if (StreamSim::Core::CpuTopology::Host().NumNodes() == 1) {
+        EXPECT_EQ(&StreamSim::Core::FrameBufferPool::Local(), &StreamSim::Core::FrameBufferPool::Default());
+    }
+}
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <DecodeAutoscaler.hpp>
+
+namespace {
+    StreamSim::Core::AutoscaleSample MakeSample(std::size_t queueDepth, uint64_t queueWaitP99Ms = 0, bool isQueueFull = false) {
+        StreamSim::Core::AutoscaleSample sample;
+        sample.queueDepth = queueDepth;
+        sample.isQueueFull = isQueueFull;
+        sample.queueWaitP99Ns = queueWaitP99Ms * 1000000;
+        return sample;
+    }
+}
+
+TEST(DecodeAutoscalerTest, StartsAtMinimum) {
+    StreamSim::Core::AutoscaleConfig config;
+    config.minWorkers = 2;
+    StreamSim::Core::DecodeAutoscaler autoscaler(config, 8);
+    EXPECT_EQ(autoscaler.ActiveWorkers(), 2);
+
+    // A minimum above the maximum is the maximum.
+    config.minWorkers = 16;
+    StreamSim::Core::DecodeAutoscaler capped(config, 8);
+    EXPECT_EQ(capped.ActiveWorkers(), 8);
+}
+
+TEST(DecodeAutoscalerTest, GrowsWhileBehindUpToMaximum) {
+    StreamSim::Core::AutoscaleConfig config;
+    StreamSim::Core::DecodeAutoscaler autoscaler(config, 8);
+
+    // Takes two samples in a row each time, then grows by half: 1, 2, 3, 4, 6, 8.
+    std::vector<std::size_t> steps;
+    for (int i = 0; i < 14; ++i) {
+        const std::size_t before = autoscaler.ActiveWorkers();
+        const std::size_t after = autoscaler.Update(MakeSample(1000));
+        if (after != before) {
+            steps.push_back(after);
+        }
+    }
+    EXPECT_EQ(steps, (std::vector<std::size_t>{ 2, 3, 4, 6, 8 }));
+    EXPECT_EQ(autoscaler.ActiveWorkers(), 8);
+
+    auto stats = autoscaler.GetStats();
+    EXPECT_EQ(stats.maxWorkers, 8);
+    EXPECT_EQ(stats.scaleUps, 5);
+    EXPECT_EQ(stats.scaleDowns, 0);
+}
+
+TEST(DecodeAutoscalerTest, LatencyAndFullQueueCountAsBehind) {
+    StreamSim::Core::AutoscaleConfig config;
+    StreamSim::Core::DecodeAutoscaler autoscaler(config, 4);
+
+    // Nothing queued, but frames waited longer than scaleUpWait.
+    autoscaler.Update(MakeSample(0, 300));
+    EXPECT_EQ(autoscaler.Update(MakeSample(0, 300)), 2);
+
+    // A full queue is behind no matter how deep it is.
+    autoscaler.Update(MakeSample(1, 0, true));
+    EXPECT_EQ(autoscaler.Update(MakeSample(1, 0, true)), 3);
+
+    // Without a wait limit only the queue counts.
+    config.scaleUpWait = std::chrono::milliseconds(0);
+    StreamSim::Core::DecodeAutoscaler depthOnly(config, 4);
+    for (int i = 0; i < 4; ++i) {
+        depthOnly.Update(MakeSample(0, 10000));
+    }
+    EXPECT_EQ(depthOnly.ActiveWorkers(), 1);
+}
+
+TEST(DecodeAutoscalerTest, ShrinksSlowlyDownToMinimum) {
+    StreamSim::Core::AutoscaleConfig config;
+    config.minWorkers = 2;
+    StreamSim::Core::DecodeAutoscaler autoscaler(config, 4);
+    for (int i = 0; i < 4; ++i) {
+        autoscaler.Update(MakeSample(1000));
+    }
+    ASSERT_EQ(autoscaler.ActiveWorkers(), 4);
+
+    // One worker at a time, after scaleDownSamples idle samples each.
+    for (uint32_t i = 1; i < config.scaleDownSamples; ++i) {
+        EXPECT_EQ(autoscaler.Update(MakeSample(0)), 4);
+    }
+    EXPECT_EQ(autoscaler.Update(MakeSample(0)), 3);
+    for (uint32_t i = 0; i < config.scaleDownSamples * 3; ++i) {
+        autoscaler.Update(MakeSample(0));
+    }
+    EXPECT_EQ(autoscaler.ActiveWorkers(), 2);
+    EXPECT_EQ(autoscaler.GetStats().scaleDowns, 2);
+}
+
+TEST(DecodeAutoscalerTest, HysteresisKeepsItSteady) {
+    StreamSim::Core::AutoscaleConfig config;
+    StreamSim::Core::DecodeAutoscaler autoscaler(config, 4);
+    for (int i = 0; i < 2; ++i) {
+        autoscaler.Update(MakeSample(1000));
+    }
+    ASSERT_EQ(autoscaler.ActiveWorkers(), 2);
+
+    // Load swinging around the threshold never gets two behind samples in a row, and a depth between
+    // idle and behind doesn't count toward shrinking either.
+    for (int i = 0; i < 100; ++i) {
+        autoscaler.Update(MakeSample(i % 2 == 0 ? 17 : 10));
+    }
+    EXPECT_EQ(autoscaler.ActiveWorkers(), 2);
+
+    // Waits between half of scaleUpWait and scaleUpWait aren't idle.
+    for (int i = 0; i < 100; ++i) {
+        autoscaler.Update(MakeSample(0, 200));
+    }
+    EXPECT_EQ(autoscaler.ActiveWorkers(), 2);
+
+    auto stats = autoscaler.GetStats();
+    EXPECT_EQ(stats.scaleUps, 1);
+    EXPECT_EQ(stats.scaleDowns, 0);
+}
+
+TEST(DecodeAutoscalerTest, SamplesOnItsOwnThread) {
+    StreamSim::Core::AutoscaleConfig config;
+    config.interval = std::chrono::milliseconds(1);
+    StreamSim::Core::DecodeAutoscaler autoscaler(config, 3);
+
+    std::atomic<std::size_t> applied{0};
+    std::atomic<int> numApplied{0};
+    autoscaler.Start([] { return MakeSample(1000); }, [&](std::size_t numActive) {
+        applied.store(numActive);
+        ++numApplied;
+    });
+    for (int i = 0; i < 500 && applied.load() < 3; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    autoscaler.Stop();
+
+    // Only told about changes: 1 to 2 and 2 to 3.
+    EXPECT_EQ(applied.load(), 3);
+    EXPECT_EQ(numApplied.load(), 2);
+    EXPECT_EQ(autoscaler.ActiveWorkers(), 3);
+}
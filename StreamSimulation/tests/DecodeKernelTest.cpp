@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <DecodeKernels.hpp>
+
+namespace {
+    const StreamSim::Core::DecodeKernelType ALL_KERNELS[] = {
+        StreamSim::Core::DecodeKernelType::Scalar,
+        StreamSim::Core::DecodeKernelType::Sse42,
+        StreamSim::Core::DecodeKernelType::Avx2
+    };
+
+    std::vector<uint8_t> Decode(StreamSim::Core::DecodeKernelType type, const std::vector<uint8_t>& input) {
+        std::vector<uint8_t> output(input.size());
+        StreamSim::Core::DecodePayload(type, input.data(), output.data(), input.size());
+        return output;
+    }
+}
+
+TEST(DecodeKernelTest, KernelsProduceIdenticalOutput) {
+    EXPECT_TRUE(StreamSim::Core::IsDecodeKernelSupported(StreamSim::Core::DecodeKernelType::Scalar));
+    EXPECT_TRUE(StreamSim::Core::IsDecodeKernelSupported(StreamSim::Core::GetBestDecodeKernel()));
+
+    std::mt19937 generator(20);
+    for (std::size_t size : { 0, 1, 191, 192, 300, 4096, 65536 }) {
+        std::vector<uint8_t> input(size);
+        for (uint8_t& byte : input) {
+            byte = static_cast<uint8_t>(generator());
+        }
+
+        const std::vector<uint8_t> expected = Decode(StreamSim::Core::DecodeKernelType::Scalar, input);
+        for (StreamSim::Core::DecodeKernelType type : ALL_KERNELS) {
+            if (!StreamSim::Core::IsDecodeKernelSupported(type)) {
+                continue;
+            }
+            EXPECT_EQ(Decode(type, input), expected) << StreamSim::Core::DecodeKernelName(type) << ", " << size << " bytes";
+        }
+    }
+}
+
+TEST(DecodeKernelTest, ExtremeCoefficientsMatch) {
+    // Largest coefficients of both signs push every stage to its limits and the clamps hard.
+    for (uint8_t value : { 0x7F, 0x80, 0x81 }) {
+        std::vector<uint8_t> input(StreamSim::Core::DECODE_TILE_SIZE * 2, value);
+        // Alternate signs in the second tile.
+        for (std::size_t i = StreamSim::Core::DECODE_TILE_SIZE; i < input.size(); i += 2) {
+            input[i] = static_cast<uint8_t>(0x100 - value);
+        }
+
+        const std::vector<uint8_t> expected = Decode(StreamSim::Core::DecodeKernelType::Scalar, input);
+        for (StreamSim::Core::DecodeKernelType type : ALL_KERNELS) {
+            if (StreamSim::Core::IsDecodeKernelSupported(type)) {
+                EXPECT_EQ(Decode(type, input), expected) << StreamSim::Core::DecodeKernelName(type);
+            }
+        }
+    }
+}
+
+TEST(DecodeKernelTest, FlatBlocksDecodeToFlatColor) {
+    constexpr std::size_t BLOCK = StreamSim::Core::DECODE_BLOCK_SIZE;
+
+    for (StreamSim::Core::DecodeKernelType type : ALL_KERNELS) {
+        if (!StreamSim::Core::IsDecodeKernelSupported(type)) {
+            continue;
+        }
+
+        // No coefficients at all is mid grey, which studio range maps a little above 128.
+        std::vector<uint8_t> input(StreamSim::Core::DECODE_TILE_SIZE, 0);
+        std::vector<uint8_t> output = Decode(type, input);
+        EXPECT_TRUE(std::all_of(output.begin(), output.end(), [](uint8_t value) { return value == 130; }))
+            << StreamSim::Core::DecodeKernelName(type);
+
+        // Only a DC coefficient in Y: 64 * 3 dequantized is +3 on every luma sample.
+        input[0] = 64;
+        output = Decode(type, input);
+        EXPECT_TRUE(std::all_of(output.begin(), output.end(), [](uint8_t value) { return value == 134; }))
+            << StreamSim::Core::DecodeKernelName(type);
+
+        // A horizontal AC coefficient makes the red plane vary across a row but not down a column.
+        input[0] = 0;
+        input[2 * BLOCK + 1] = 40;
+        output = Decode(type, input);
+        EXPECT_NE(output[0], output[7]);
+        for (std::size_t row = 1; row < 8; ++row) {
+            EXPECT_EQ(output[row * 8], output[0]);
+            EXPECT_EQ(output[row * 8 + 7], output[7]);
+        }
+    }
+}
+
+TEST(DecodeKernelTest, TailIsCopied) {
+    std::vector<uint8_t> input(StreamSim::Core::DECODE_TILE_SIZE + 17);
+    for (std::size_t i = 0; i < input.size(); ++i) {
+        input[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    for (StreamSim::Core::DecodeKernelType type : ALL_KERNELS) {
+        const std::vector<uint8_t> output = Decode(type, input);
+        EXPECT_TRUE(std::equal(input.begin() + StreamSim::Core::DECODE_TILE_SIZE, input.end(),
+                               output.begin() + StreamSim::Core::DECODE_TILE_SIZE));
+    }
+}
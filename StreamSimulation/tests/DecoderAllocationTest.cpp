@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <Decoder.hpp>
+
+// This binary replaces the global operator new to count allocations, so it only holds tests that need that.
+
+namespace {
+    std::atomic<std::size_t> g_numAllocations{0};
+
+    // Frames sent through the pool decoder after a warm-up frame, and how many allocations that took.
+    std::size_t CountDecodeAllocations(StreamSim::Core::DecodePoolType poolType) {
+        StreamSim::Core::AsyncByteFrameQueue renderQueue;
+        StreamSim::Core::FrameElementPoolDecoder poolDecoder(&renderQueue, poolType);
+        StreamSim::Core::ByteUndecodedFrame undecodedFrame;
+        undecodedFrame.data = 6;
+
+        auto waitForFrames = [&](std::size_t numFrames) {
+            while (renderQueue.NumElements() < numFrames) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        };
+
+        // The first frame pays for whatever the workers set up lazily.
+        poolDecoder.OnInputStreamData(undecodedFrame);
+        waitForFrames(1);
+
+        const std::size_t numFrames = 64;
+        const std::size_t allocationsBefore = g_numAllocations.load();
+        for (std::size_t i = 0; i < numFrames; ++i) {
+            poolDecoder.OnInputStreamData(undecodedFrame);
+        }
+        waitForFrames(numFrames + 1);
+        const std::size_t allocationsAfter = g_numAllocations.load();
+
+        poolDecoder.Shutdown();
+        return allocationsAfter - allocationsBefore;
+    }
+}
+
+void* operator new(std::size_t size) {
+    g_numAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+// Tasks are moved into the pool's fixed slots and then into the worker, nothing touches the heap.
+TEST(DecoderAllocationTest, PoolDecodeDoesNotAllocate) {
+    EXPECT_EQ(CountDecodeAllocations(StreamSim::Core::DecodePoolType::Simple), 0);
+}
+
+TEST(DecoderAllocationTest, WorkStealingPoolDecodeDoesNotAllocate) {
+    EXPECT_EQ(CountDecodeAllocations(StreamSim::Core::DecodePoolType::WorkStealing), 0);
+}
@@ -1,4 +1,7 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
 #include <Decoder.hpp>
 
 TEST(DecoderTest, DemoDecodeTest) {
@@ -14,18 +17,64 @@ TEST(DecoderTest, DemoDecodeTest) {
     EXPECT_EQ(decodedFrame.data, 1);
 }
 
+TEST(DecoderTest, DemoDecodePayloadTest) {
+    StreamSim::Core::FrameBufferPool pool;
+    StreamSim::Core::DemoDecoder decoder;
+    StreamSim::Core::ByteUndecodedFrame undecodedFrame;
+    undecodedFrame.meta.sequence = 7;
+    undecodedFrame.meta.type = StreamSim::Core::FrameType::P;
+    undecodedFrame.payload = pool.Acquire(300);
+    for (std::size_t i = 0; i < undecodedFrame.payload.Size(); ++i) {
+        undecodedFrame.payload.Data()[i] = static_cast<uint8_t>(i);
+    }
+
+    StreamSim::Core::ByteFrameElement decodedFrame;
+    decoder.DecodeFrameData(undecodedFrame, decodedFrame);
+
+    EXPECT_EQ(decodedFrame.meta.sequence, 7);
+    EXPECT_EQ(decodedFrame.meta.type, StreamSim::Core::FrameType::P);
+    ASSERT_EQ(decodedFrame.payload.Size(), 300);
+    EXPECT_EQ(decodedFrame.payload.Pool(), &pool);
+    EXPECT_NE(decodedFrame.payload.Data(), undecodedFrame.payload.Data());
+
+    // One whole tile through the kernels, the rest copied over.
+    std::vector<uint8_t> expected(300);
+    StreamSim::Core::DecodePayload(StreamSim::Core::DecodeKernelType::Scalar, undecodedFrame.payload.Data(), expected.data(), expected.size());
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), decodedFrame.payload.Data()));
+    EXPECT_EQ(decodedFrame.payload.Data()[299], static_cast<uint8_t>(299));
+}
+
+TEST(DecoderTest, PayloadTooBigForThePoolIsNotDecoded) {
+    StreamSim::Core::FrameBufferPool pool;
+    std::vector<uint8_t> bytes(StreamSim::Core::FrameBufferPool::MAX_BUFFER_SIZE + 1);
+    StreamSim::Core::DemoDecoder decoder;
+    StreamSim::Core::ByteUndecodedFrame undecodedFrame;
+    undecodedFrame.data = 4;
+    undecodedFrame.payload = pool.Wrap(bytes.data(), bytes.size());
+
+    // There's no buffer to decode it into, the frame goes on without a picture.
+    StreamSim::Core::ByteFrameElement decodedFrame;
+    decoder.DecodeFrameData(undecodedFrame, decodedFrame);
+    EXPECT_EQ(decodedFrame.data, 2);
+    EXPECT_FALSE(decodedFrame.payload);
+}
+
 TEST(DecoderTest, FrameElementDecodeServiceTest) {
     StreamSim::Core::AsyncByteFrameQueue decodeQueue;
-    StreamSim::Core::AsyncByteFrameQueue renderQueue;
+    StreamSim::Core::ReorderByteFrameQueue renderQueue;
     StreamSim::Core::FrameElementQueueDecodeService decodeService(&decodeQueue, &renderQueue);
     StreamSim::Core::ByteUndecodedFrame undecodedFrame;
     undecodedFrame.data = 4;
+    undecodedFrame.meta.displayOrder = 0;
     decodeQueue.WriteSync(undecodedFrame);
     undecodedFrame.data = 6;
+    undecodedFrame.meta.displayOrder = 1;
     decodeQueue.WriteSync(undecodedFrame);
     undecodedFrame.data = 8;
+    undecodedFrame.meta.displayOrder = 2;
     decodeQueue.WriteSync(undecodedFrame);
     undecodedFrame.data = 10;
+    undecodedFrame.meta.displayOrder = 3;
     decodeQueue.WriteSync(undecodedFrame);
 
     decodeService.Run();
@@ -34,6 +83,7 @@ TEST(DecoderTest, FrameElementDecodeServiceTest) {
     EXPECT_TRUE(decodeQueue.IsEmpty());
     EXPECT_TRUE(renderQueue.NumElements() == 4);
 
+    // Four workers finish in any order, the reorder queue puts them back in display order.
     StreamSim::Core::ByteFrameElement decodedFrame;
     EXPECT_TRUE(renderQueue.ReadSync(decodedFrame));
     EXPECT_EQ(decodedFrame.data, 2);
@@ -43,4 +93,133 @@ TEST(DecoderTest, FrameElementDecodeServiceTest) {
     EXPECT_EQ(decodedFrame.data, 4);
     EXPECT_TRUE(renderQueue.ReadSync(decodedFrame));
     EXPECT_EQ(decodedFrame.data, 5);
-}
\ No newline at end of file
+}
+
+TEST(DecoderTest, IdleDecodeServiceParksWorkers) {
+    StreamSim::Core::AsyncByteFrameQueue decodeQueue;
+    StreamSim::Core::AsyncByteFrameQueue renderQueue;
+    StreamSim::Core::FrameElementQueueDecodeService decodeService(&decodeQueue, &renderQueue);
+
+    decodeService.Run();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    // Every worker goes into one blocking read and then sleeps until data shows up; nothing polls the queue.
+    auto stats = decodeService.GetWorkerStats();
+    EXPECT_EQ(stats.blockingReads, StreamSim::Core::DEFAULT_NUM_DECODER_THREADS);
+    EXPECT_EQ(stats.readTimeouts, 0);
+    EXPECT_EQ(stats.parks, 0);
+
+    StreamSim::Core::ByteUndecodedFrame undecodedFrame;
+    undecodedFrame.data = 8;
+    decodeQueue.WriteSync(undecodedFrame);
+
+    StreamSim::Core::ByteFrameElement decodedFrame;
+    EXPECT_TRUE(renderQueue.ReadSync(decodedFrame));
+    EXPECT_EQ(decodedFrame.data, 4);
+
+    // Closing the queue wakes the parked workers, Shutdown must not wait for its 2 second read timeout.
+    auto start = std::chrono::steady_clock::now();
+    decodeQueue.Close();
+    decodeService.Shutdown();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+
+    EXPECT_EQ(decodeService.GetWorkerStats().framesDecoded, 1);
+}
+
+TEST(DecoderTest, ExpiredBFramesAreNotDecoded) {
+    StreamSim::Core::AsyncByteFrameQueue decodeQueue;
+    StreamSim::Core::ReorderByteFrameQueue renderQueue;
+    StreamSim::Core::FrameElementQueueDecodeService decodeService(&decodeQueue, &renderQueue);
+
+    // I0 P3 B1 B2, all of them long past their deadline.
+    const uint64_t expiredNs = StreamSim::Core::PipelineNowNs() - 1000000;
+    for (uint64_t sequence = 0; sequence < 4; ++sequence) {
+        StreamSim::Core::ByteUndecodedFrame frame;
+        frame.data = 8;
+        frame.meta.sequence = sequence;
+        StreamSim::Core::DescribeGopFrame(frame.meta);
+        frame.meta.deadlineNs = expiredNs;
+        decodeQueue.WriteSync(frame);
+    }
+
+    decodeService.Run();
+    decodeQueue.Close();
+    decodeService.Shutdown();
+
+    // The anchors are still decoded since later frames need them, the B-frames go on without a picture
+    // so the reorder queue doesn't wait for them.
+    StreamSim::Core::ByteFrameElement frame;
+    for (uint64_t displayOrder = 0; displayOrder < 4; ++displayOrder) {
+        ASSERT_TRUE(renderQueue.ReadSync(frame));
+        EXPECT_EQ(frame.meta.displayOrder, displayOrder);
+        EXPECT_EQ(frame.meta.isExpired, frame.meta.type == StreamSim::Core::FrameType::B);
+        EXPECT_EQ(frame.data, frame.meta.isExpired ? 0 : 4);
+    }
+
+    auto stats = decodeService.GetWorkerStats();
+    EXPECT_EQ(stats.framesDecoded, 2);
+    EXPECT_EQ(stats.framesExpired, 2);
+}
+
+TEST(DecoderTest, DecoderTaskSkipsExpiredBFrame) {
+    StreamSim::Core::DemoDecoder decoder;
+    StreamSim::Core::AsyncByteFrameQueue renderQueue;
+    std::atomic<uint64_t> numExpired{0};
+
+    StreamSim::Core::ByteUndecodedFrame frame;
+    frame.data = 8;
+    frame.meta.type = StreamSim::Core::FrameType::B;
+    frame.meta.deadlineNs = StreamSim::Core::PipelineNowNs() - 1000000;
+    StreamSim::Core::DecoderTask expired(frame, &decoder, &renderQueue, nullptr, &numExpired);
+    EXPECT_EQ(expired.DeadlineNs(), frame.meta.deadlineNs);
+    expired();
+
+    // Still in time.
+    frame.meta.deadlineNs = StreamSim::Core::PipelineNowNs() + 60000000000ull;
+    StreamSim::Core::DecoderTask inTime(frame, &decoder, &renderQueue, nullptr, &numExpired);
+    inTime();
+
+    StreamSim::Core::ByteFrameElement decoded;
+    ASSERT_TRUE(renderQueue.ReadAsync(decoded));
+    EXPECT_TRUE(decoded.meta.isExpired);
+    ASSERT_TRUE(renderQueue.ReadAsync(decoded));
+    EXPECT_FALSE(decoded.meta.isExpired);
+    EXPECT_EQ(decoded.data, 4);
+    EXPECT_EQ(numExpired.load(), 1);
+}
+
+TEST(DecoderTest, AutoscaledDecodeServiceParksExtraWorkers) {
+    StreamSim::Core::AsyncByteFrameQueue decodeQueue;
+    StreamSim::Core::AsyncByteFrameQueue renderQueue;
+    StreamSim::Core::PipelineConfig config;
+    config.decodeAutoscale.enabled = true;
+    config.decodeAutoscale.interval = std::chrono::milliseconds(10);
+    StreamSim::Core::FrameElementQueueDecodeService decodeService(&decodeQueue, &renderQueue, config);
+
+    decodeService.Run();
+    EXPECT_EQ(decodeService.NumActiveWorkers(), 1);
+
+    // A single active worker still decodes everything.
+    StreamSim::Core::ByteUndecodedFrame undecodedFrame;
+    for (uint8_t i = 0; i < 20; ++i) {
+        undecodedFrame.data = static_cast<uint8_t>(i * 2);
+        decodeQueue.WriteSync(undecodedFrame);
+    }
+    StreamSim::Core::ByteFrameElement decodedFrame;
+    for (int i = 0; i < 20; ++i) {
+        EXPECT_TRUE(renderQueue.ReadSync(decodedFrame));
+    }
+
+    // An idle stream never wakes more workers, and shutdown wakes the parked ones right away.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(decodeService.NumActiveWorkers(), 1);
+    auto start = std::chrono::steady_clock::now();
+    decodeQueue.Close();
+    decodeService.Shutdown();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+
+    EXPECT_EQ(decodeService.GetWorkerStats().framesDecoded, 20);
+    auto stats = decodeService.GetAutoscaleStats();
+    EXPECT_EQ(stats.maxWorkers, StreamSim::Core::DEFAULT_NUM_DECODER_THREADS);
+    EXPECT_EQ(stats.scaleUps, 0);
+}
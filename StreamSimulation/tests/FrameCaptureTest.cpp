@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <FrameBufferPool.hpp>
+#include <FrameCapture.hpp>
+
+namespace {
+    StreamSim::Core::ByteUndecodedFrame MakeFrame(uint64_t sequence, std::size_t payloadSize) {
+        StreamSim::Core::ByteUndecodedFrame frame;
+        frame.data = static_cast<uint8_t>(sequence * 3);
+        frame.meta.streamId = static_cast<uint32_t>(sequence % 2);
+        frame.meta.sequence = sequence;
+        frame.meta.displayOrder = sequence + 1;
+        frame.meta.timestampUs = 1000 + sequence * 33;
+        frame.meta.type = sequence == 0 ? StreamSim::Core::FrameType::I : StreamSim::Core::FrameType::P;
+        frame.meta.numReferences = sequence == 0 ? 0 : 1;
+        frame.meta.references[0] = sequence == 0 ? 0 : sequence - 1;
+        if (payloadSize > 0) {
+            frame.payload = StreamSim::Core::FrameBufferPool::Default().Acquire(payloadSize);
+            for (std::size_t i = 0; i < payloadSize; ++i) {
+                frame.payload.Data()[i] = static_cast<uint8_t>(i + sequence);
+            }
+        }
+        return frame;
+    }
+
+    // Counts what it is handed.
+    class CountingHandler : public StreamSim::Net::NetInputStreamHandler {
+    public:
+        std::size_t numFrames = 0;
+
+        using StreamSim::Net::NetInputStreamHandler::OnInputStreamData;
+
+        void OnInputStreamData(const StreamSim::Core::ByteUndecodedFrame&) override {
+            ++numFrames;
+        }
+    };
+}
+
+TEST(FrameCaptureTest, MappedRoundTrip) {
+    const std::string path = testing::TempDir() + "frame_capture_round_trip.bin";
+
+    // Payload sizes that aren't a multiple of 8, and one frame without a payload.
+    const std::vector<std::size_t> payloadSizes = { 1, 0, 4096, 13, 1500 };
+    {
+        StreamSim::Net::FrameCaptureWriter writer(path);
+        ASSERT_TRUE(writer.IsOpen());
+        for (std::size_t i = 0; i < payloadSizes.size(); ++i) {
+            ASSERT_TRUE(writer.Write(MakeFrame(i, payloadSizes[i])));
+        }
+        EXPECT_EQ(writer.NumFrames(), payloadSizes.size());
+    }
+
+    {
+        StreamSim::Net::FrameCaptureReader reader(path);
+        ASSERT_TRUE(reader.IsOpen());
+        ASSERT_EQ(reader.NumFrames(), payloadSizes.size());
+
+        // Read back to front, the index makes every frame directly reachable.
+        for (std::size_t i = payloadSizes.size(); i-- > 0;) {
+            const auto expected = MakeFrame(i, payloadSizes[i]);
+            StreamSim::Core::ByteUndecodedFrame frame;
+            ASSERT_TRUE(reader.ReadFrame(i, frame));
+
+            EXPECT_EQ(frame.data, expected.data);
+            EXPECT_EQ(frame.meta.streamId, expected.meta.streamId);
+            EXPECT_EQ(frame.meta.sequence, expected.meta.sequence);
+            EXPECT_EQ(frame.meta.displayOrder, expected.meta.displayOrder);
+            EXPECT_EQ(frame.meta.timestampUs, expected.meta.timestampUs);
+            EXPECT_EQ(frame.meta.type, expected.meta.type);
+            EXPECT_EQ(frame.meta.numReferences, expected.meta.numReferences);
+            EXPECT_EQ(frame.meta.references, expected.meta.references);
+            ASSERT_EQ(frame.payload.Size(), payloadSizes[i]);
+            EXPECT_TRUE(std::equal(frame.payload.Data(), frame.payload.Data() + frame.payload.Size(), expected.payload.Data()));
+
+            if (frame.payload) {
+                // Straight from the mapping: not from the payload pools and 8 byte aligned.
+                EXPECT_TRUE(frame.payload.IsWrapped());
+                EXPECT_EQ(reinterpret_cast<std::uintptr_t>(frame.payload.Data()) % 8, 0u);
+            }
+        }
+
+        StreamSim::Core::ByteUndecodedFrame frame;
+        EXPECT_FALSE(reader.ReadFrame(payloadSizes.size(), frame));
+
+        // Headers only exist while frames hold on to them.
+        EXPECT_EQ(reader.NumFramesInUse(), 0);
+        std::vector<StreamSim::Core::ByteUndecodedFrame> frames(payloadSizes.size());
+        for (std::size_t i = 0; i < frames.size(); ++i) {
+            ASSERT_TRUE(reader.ReadFrame(i, frames[i]));
+        }
+        auto copy = frames[2];
+        EXPECT_EQ(reader.NumFramesInUse(), payloadSizes.size() - 1);
+        frames.clear();
+        EXPECT_EQ(reader.NumFramesInUse(), 1);
+        copy = StreamSim::Core::ByteUndecodedFrame();
+        EXPECT_EQ(reader.NumFramesInUse(), 0);
+    }
+
+    std::remove(path.c_str());
+}
+
+TEST(FrameCaptureTest, RejectsInvalidCapture) {
+    const std::string path = testing::TempDir() + "frame_capture_invalid.bin";
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    std::fputs("definitely not a capture file", file);
+    std::fclose(file);
+    EXPECT_FALSE(StreamSim::Net::FrameCaptureReader(path).IsOpen());
+    EXPECT_FALSE(StreamSim::Net::FrameCaptureReader(path + ".missing").IsOpen());
+
+    // Cut off in the middle of the index.
+    {
+        StreamSim::Net::FrameCaptureWriter writer(path);
+        for (uint64_t i = 0; i < 4; ++i) {
+            writer.Write(MakeFrame(i, 100));
+        }
+    }
+    file = std::fopen(path.c_str(), "rb");
+    ASSERT_NE(file, nullptr);
+    std::vector<char> contents(1 << 16);
+    contents.resize(std::fread(contents.data(), 1, contents.size(), file));
+    std::fclose(file);
+
+    file = std::fopen(path.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    std::fwrite(contents.data(), 1, contents.size() - 8, file);
+    std::fclose(file);
+    EXPECT_FALSE(StreamSim::Net::FrameCaptureReader(path).IsOpen());
+
+    std::remove(path.c_str());
+}
+
+TEST(FrameCaptureTest, RejectsPayloadTooBigForThePool) {
+    const std::string path = testing::TempDir() + "frame_capture_oversized.bin";
+
+    StreamSim::Core::FrameBufferPool pool;
+    std::vector<uint8_t> bytes(StreamSim::Core::FrameBufferPool::MAX_BUFFER_SIZE + 1);
+    {
+        StreamSim::Net::FrameCaptureWriter writer(path);
+        ASSERT_TRUE(writer.Write(MakeFrame(0, 100)));
+        auto frame = MakeFrame(1, 0);
+        frame.payload = pool.Wrap(bytes.data(), bytes.size());
+        ASSERT_TRUE(writer.Write(frame));
+    }
+
+    // The file itself is fine, only the frame nothing could decode is turned down.
+    StreamSim::Net::FrameCaptureReader reader(path);
+    ASSERT_TRUE(reader.IsOpen());
+    StreamSim::Core::ByteUndecodedFrame frame;
+    EXPECT_TRUE(reader.ReadFrame(0, frame));
+    EXPECT_FALSE(reader.ReadFrame(1, frame));
+    frame = StreamSim::Core::ByteUndecodedFrame();
+
+    std::remove(path.c_str());
+}
+
+TEST(FrameCaptureTest, RecorderPassesFramesOnAndRecordsThem) {
+    const std::string path = testing::TempDir() + "frame_capture_recorder.bin";
+
+    CountingHandler handler;
+    {
+        StreamSim::Net::CaptureRecorder recorder(path, &handler);
+        ASSERT_TRUE(recorder.IsOpen());
+        for (uint64_t i = 0; i < 1000; ++i) {
+            recorder.OnInputStreamData(MakeFrame(i, 256));
+        }
+        recorder.Close();
+        EXPECT_EQ(recorder.NumFramesRecorded(), 1000u);
+
+        // Only passed on once closed.
+        recorder.OnInputStreamData(MakeFrame(1000, 256));
+    }
+    EXPECT_EQ(handler.numFrames, 1001u);
+
+    StreamSim::Net::FrameCaptureReader reader(path);
+    ASSERT_TRUE(reader.IsOpen());
+    ASSERT_EQ(reader.NumFrames(), 1000u);
+    StreamSim::Core::ByteUndecodedFrame frame;
+    ASSERT_TRUE(reader.ReadFrame(999, frame));
+    EXPECT_EQ(frame.meta.sequence, 999u);
+    EXPECT_EQ(frame.payload.Data()[0], static_cast<uint8_t>(999));
+
+    std::remove(path.c_str());
+}
@@ -0,0 +1,593 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <chrono>
+#include <set>
+#include <thread>
+#include <vector>
+#include "ConcurrentData.hpp"
+#include "FrameData.hpp"
+#include "FrameBufferPool.hpp"
+#include "TestFrames.hpp"
+
+using StreamSim::Test::MakeTestFrame;
+
+TEST(FrameBufferPoolTest, AcquireAndReuse) {
+    StreamSim::Core::FrameBufferPool pool;
+
+    uint8_t* bytes = nullptr;
+    {
+        auto buffer = pool.Acquire(1000);
+        ASSERT_TRUE(buffer);
+        EXPECT_EQ(buffer.Size(), 1000);
+        EXPECT_GE(buffer.Capacity(), 1000);
+        EXPECT_EQ(pool.NumBuffersInUse(), 1);
+        bytes = buffer.Data();
+    }
+    EXPECT_EQ(pool.NumBuffersInUse(), 0);
+
+    // A released buffer is handed out again instead of growing the pool.
+    const std::size_t numAllocated = pool.NumBuffersAllocated();
+    auto buffer = pool.Acquire(1000);
+    EXPECT_EQ(buffer.Data(), bytes);
+    EXPECT_EQ(pool.NumBuffersAllocated(), numAllocated);
+}
+
+TEST(FrameBufferPoolTest, SizeClasses) {
+    StreamSim::Core::FrameBufferPool pool;
+
+    auto small = pool.Acquire(1);
+    EXPECT_EQ(small.Capacity(), StreamSim::Core::FrameBufferPool::MIN_BUFFER_SIZE);
+
+    auto medium = pool.Acquire(StreamSim::Core::FrameBufferPool::MIN_BUFFER_SIZE + 1);
+    EXPECT_EQ(medium.Capacity(), StreamSim::Core::FrameBufferPool::MIN_BUFFER_SIZE * 4);
+
+    auto large = pool.Acquire(StreamSim::Core::FrameBufferPool::MAX_BUFFER_SIZE);
+    EXPECT_EQ(large.Capacity(), StreamSim::Core::FrameBufferPool::MAX_BUFFER_SIZE);
+
+    auto tooLarge = pool.Acquire(StreamSim::Core::FrameBufferPool::MAX_BUFFER_SIZE + 1);
+    EXPECT_FALSE(tooLarge);
+    EXPECT_EQ(pool.NumBuffersInUse(), 3);
+
+    medium.Resize(10);
+    EXPECT_EQ(medium.Size(), 10);
+}
+
+TEST(FrameBufferPoolTest, CopiesShareBuffer) {
+    StreamSim::Core::FrameBufferPool pool;
+
+    auto buffer = pool.Acquire(64);
+    buffer.Data()[0] = 42;
+    {
+        StreamSim::Core::FrameBufferRef copy = buffer;
+        EXPECT_EQ(copy.Data(), buffer.Data());
+        EXPECT_EQ(buffer.UseCount(), 2);
+        EXPECT_EQ(copy.Data()[0], 42);
+    }
+    EXPECT_EQ(buffer.UseCount(), 1);
+
+    StreamSim::Core::FrameBufferRef moved = std::move(buffer);
+    EXPECT_FALSE(buffer);
+    EXPECT_EQ(moved.UseCount(), 1);
+
+    moved = StreamSim::Core::FrameBufferRef();
+    EXPECT_EQ(pool.NumBuffersInUse(), 0);
+}
+
+TEST(FrameBufferPoolTest, ConcurrentAcquireRelease) {
+    StreamSim::Core::FrameBufferPool pool;
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&pool, t]() {
+            for (int i = 0; i < 1000; ++i) {
+                auto buffer = pool.Acquire(static_cast<std::size_t>(100 + (i % 3) * 1000));
+                buffer.Data()[0] = static_cast<uint8_t>(t);
+                StreamSim::Core::FrameBufferRef copy = buffer;
+                EXPECT_EQ(copy.Data()[0], static_cast<uint8_t>(t));
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(pool.NumBuffersInUse(), 0);
+}
+
+TEST(FrameBufferPoolTest, QueuesReleasePayloads) {
+    StreamSim::Core::FrameBufferPool pool;
+    StreamSim::Core::ConcurrentBufferQueue<StreamSim::Core::ByteFrameElement, 8> queue;
+
+    for (uint64_t i = 0; i < 4; ++i) {
+        StreamSim::Core::ByteFrameElement frame;
+        frame.meta.sequence = i;
+        frame.payload = pool.Acquire(512);
+        queue.WriteSync(frame);
+    }
+    EXPECT_EQ(pool.NumBuffersInUse(), 4);
+
+    std::set<uint64_t> sequences;
+    StreamSim::Core::ByteFrameElement frame;
+    while (queue.ReadAsync(frame)) {
+        EXPECT_EQ(frame.payload.UseCount(), 1);
+        sequences.insert(frame.meta.sequence);
+    }
+    frame = StreamSim::Core::ByteFrameElement();
+
+    // Reading moves the payload out of the queue, nothing is left holding a reference.
+    EXPECT_EQ(sequences.size(), 4);
+    EXPECT_EQ(pool.NumBuffersInUse(), 0);
+}
+
+TEST(SequenceReorderQueueTest, OutOfOrderWritesComeOutInOrder) {
+    StreamSim::Core::SequenceReorderQueue<StreamSim::Core::ByteFrameElement, 8> queue;
+
+    for (uint64_t position : { 3, 1, 0, 2 }) {
+        EXPECT_TRUE(queue.WriteSync(MakeTestFrame(position)));
+    }
+    EXPECT_EQ(queue.NumElements(), 4);
+
+    StreamSim::Core::ByteFrameElement frame;
+    for (uint64_t position = 0; position < 4; ++position) {
+        ASSERT_TRUE(queue.ReadAsync(frame));
+        EXPECT_EQ(frame.meta.displayOrder, position);
+    }
+    EXPECT_FALSE(queue.ReadAsync(frame));
+    EXPECT_TRUE(queue.IsEmpty());
+}
+
+TEST(SequenceReorderQueueTest, GapIsSkippedAfterHoldTime) {
+    StreamSim::Core::SequenceReorderQueue<StreamSim::Core::ByteFrameElement, 8> queue(std::chrono::milliseconds(20));
+
+    queue.WriteSync(MakeTestFrame(0));
+    queue.WriteSync(MakeTestFrame(2));
+    queue.WriteSync(MakeTestFrame(3));
+
+    StreamSim::Core::ByteFrameElement frame;
+    ASSERT_TRUE(queue.ReadSync(frame));
+    EXPECT_EQ(frame.meta.displayOrder, 0);
+
+    // 1 is missing, so 2 is held back until the hold time runs out.
+    EXPECT_FALSE(queue.ReadAsync(frame));
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(queue.ReadSync(frame));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(15));
+    EXPECT_EQ(frame.meta.displayOrder, 2);
+
+    // Showing up now is too late.
+    queue.WriteSync(MakeTestFrame(1));
+    ASSERT_TRUE(queue.ReadAsync(frame));
+    EXPECT_EQ(frame.meta.displayOrder, 3);
+
+    queue.WriteSync(MakeTestFrame(4));
+    queue.WriteSync(MakeTestFrame(4));
+
+    auto stats = queue.GetStats();
+    EXPECT_EQ(stats.skipped, 1);
+    EXPECT_EQ(stats.late, 1);
+    EXPECT_EQ(stats.duplicates, 1);
+}
+
+TEST(SequenceReorderQueueTest, CloseSkipsGapsRightAway) {
+    StreamSim::Core::SequenceReorderQueue<StreamSim::Core::ByteFrameElement, 8> queue(std::chrono::seconds(10));
+
+    queue.WriteSync(MakeTestFrame(0));
+    queue.WriteSync(MakeTestFrame(5));
+    queue.Close();
+
+    StreamSim::Core::ByteFrameElement frame;
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(queue.ReadSync(frame));
+    EXPECT_EQ(frame.meta.displayOrder, 0);
+    ASSERT_TRUE(queue.ReadSync(frame));
+    EXPECT_EQ(frame.meta.displayOrder, 5);
+    EXPECT_FALSE(queue.ReadSync(frame));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+}
+
+TEST(SequenceReorderQueueTest, ConcurrentWritersSingleReader) {
+    constexpr uint64_t NUM_FRAMES = 5000;
+    constexpr uint64_t NUM_WRITERS = 4;
+    // Long hold time so a writer that gets descheduled on a busy machine doesn't cause a skip.
+    StreamSim::Core::SequenceReorderQueue<StreamSim::Core::ByteFrameElement, 64> queue(std::chrono::seconds(5));
+
+    // Each writer owns every 4th position, so the window is filled from all sides at once and
+    // writers that get too far ahead have to wait for the reader.
+    std::vector<std::thread> writers;
+    for (uint64_t w = 0; w < NUM_WRITERS; ++w) {
+        writers.emplace_back([&queue, w]() {
+            for (uint64_t position = w; position < NUM_FRAMES; position += NUM_WRITERS) {
+                EXPECT_TRUE(queue.WriteSync(MakeTestFrame(position)));
+            }
+        });
+    }
+
+    StreamSim::Core::ByteFrameElement frame;
+    for (uint64_t position = 0; position < NUM_FRAMES; ++position) {
+        ASSERT_TRUE(queue.ReadSync(frame));
+        EXPECT_EQ(frame.meta.displayOrder, position);
+    }
+
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    EXPECT_EQ(queue.GetStats().skipped, 0);
+}
+
+TEST(ReorderWindowTest, GapIsSkippedAfterHoldTime) {
+    using AddResult = StreamSim::Core::ReorderWindow<StreamSim::Core::ByteFrameElement>::AddResult;
+    StreamSim::Core::ReorderWindow<StreamSim::Core::ByteFrameElement> window(8, std::chrono::milliseconds(20));
+
+    for (uint64_t position : { 2, 0, 3 }) {
+        EXPECT_EQ(window.Add(MakeTestFrame(position)), AddResult::Stored);
+    }
+
+    StreamSim::Core::ByteFrameElement frame;
+    ASSERT_TRUE(window.Take(frame));
+    EXPECT_EQ(frame.meta.displayOrder, 0);
+
+    // 1 is missing, so 2 is held back until the hold time runs out.
+    EXPECT_FALSE(window.Take(frame));
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    ASSERT_TRUE(window.Take(frame));
+    EXPECT_EQ(frame.meta.displayOrder, 2);
+
+    EXPECT_EQ(window.Add(MakeTestFrame(1)), AddResult::Late);
+    EXPECT_EQ(window.Add(MakeTestFrame(4)), AddResult::Stored);
+    EXPECT_EQ(window.Add(MakeTestFrame(4)), AddResult::Duplicate);
+
+    auto stats = window.GetStats();
+    EXPECT_EQ(stats.skipped, 1);
+    EXPECT_EQ(stats.late, 1);
+    EXPECT_EQ(stats.duplicates, 1);
+}
+
+TEST(ReorderWindowTest, FrameAheadOfWindowFitsOnceGapsAreSkipped) {
+    using AddResult = StreamSim::Core::ReorderWindow<StreamSim::Core::ByteFrameElement>::AddResult;
+    StreamSim::Core::ReorderWindow<StreamSim::Core::ByteFrameElement> window(4, std::chrono::seconds(10));
+
+    window.Add(MakeTestFrame(1));
+    window.Add(MakeTestFrame(3));
+    auto ahead = MakeTestFrame(100);
+    ASSERT_EQ(window.Add(ahead), AddResult::AheadOfWindow);
+
+    // Skipping gaps right away hands out what the window holds, then jumps to the frame ahead.
+    std::vector<uint64_t> positions;
+    StreamSim::Core::ByteFrameElement frame;
+    while (window.Add(ahead) == AddResult::AheadOfWindow) {
+        if (window.Take(frame, true)) {
+            positions.push_back(frame.meta.displayOrder);
+        }
+    }
+    EXPECT_EQ(positions, (std::vector<uint64_t>{1, 3}));
+    EXPECT_EQ(window.NextPosition(), 100);
+
+    ASSERT_TRUE(window.Take(frame));
+    EXPECT_EQ(frame.meta.displayOrder, 100);
+    EXPECT_TRUE(window.IsEmpty());
+    EXPECT_EQ(window.GetStats().skipped, 98);
+}
+
+TEST(FairShareQueueTest, HeavyStreamDoesNotStarveOthers) {
+    StreamSim::Core::FairShareQueue<StreamSim::Core::ByteFrameElement, 128> queue;
+
+    // Stream 0 dumps 100 frames before the two light streams send anything.
+    for (uint64_t i = 0; i < 100; ++i) {
+        queue.WriteSync(MakeTestFrame(i, { .streamId = 0 }));
+    }
+    for (uint64_t i = 0; i < 5; ++i) {
+        queue.WriteSync(MakeTestFrame(i, { .streamId = 1 }));
+        queue.WriteSync(MakeTestFrame(i, { .streamId = 2 }));
+    }
+
+    // Round robin: the light streams are done within the first 15 frames read.
+    std::array<StreamSim::Core::ByteFrameElement, 15> frames;
+    ASSERT_EQ(queue.ReadBatch(frames, frames.size()), frames.size());
+    std::array<int, 3> perStream{};
+    for (const auto& frame : frames) {
+        ++perStream[frame.meta.streamId];
+    }
+    EXPECT_EQ(perStream, (std::array<int, 3>{5, 5, 5}));
+
+    // Order within a stream is kept.
+    StreamSim::Core::ByteFrameElement frame;
+    ASSERT_TRUE(queue.ReadAsync(frame));
+    EXPECT_EQ(frame.meta.streamId, 0);
+    EXPECT_EQ(frame.meta.sequence, 5);
+    EXPECT_EQ(queue.NumElements(), 94);
+}
+
+TEST(FairShareQueueTest, WeightsSetShare) {
+    StreamSim::Core::FairShareQueue<StreamSim::Core::ByteFrameElement, 128> queue;
+    queue.SetStreamWeight(0, 3);
+
+    for (uint64_t i = 0; i < 60; ++i) {
+        queue.WriteSync(MakeTestFrame(i, { .streamId = 0 }));
+        queue.WriteSync(MakeTestFrame(i, { .streamId = 1 }));
+    }
+
+    std::array<StreamSim::Core::ByteFrameElement, 40> frames;
+    ASSERT_EQ(queue.ReadBatchAsync(frames, frames.size()), frames.size());
+    std::array<int, 2> perStream{};
+    for (const auto& frame : frames) {
+        ++perStream[frame.meta.streamId];
+    }
+    EXPECT_EQ(perStream, (std::array<int, 2>{30, 10}));
+}
+
+TEST(FairShareQueueTest, RingsGrowInOrder) {
+    StreamSim::Core::FairShareQueue<StreamSim::Core::ByteFrameElement, 1000> queue;
+
+    // Wrap the small ring first, then grow it a few times with frames still queued.
+    for (uint64_t i = 0; i < 10; ++i) {
+        EXPECT_TRUE(queue.WriteSync(MakeTestFrame(i)));
+    }
+    StreamSim::Core::ByteFrameElement frame;
+    for (uint64_t i = 0; i < 5; ++i) {
+        ASSERT_TRUE(queue.ReadAsync(frame));
+    }
+    for (uint64_t i = 10; i < 200; ++i) {
+        EXPECT_TRUE(queue.WriteSync(MakeTestFrame(i)));
+    }
+
+    for (uint64_t i = 5; i < 200; ++i) {
+        ASSERT_TRUE(queue.ReadAsync(frame));
+        EXPECT_EQ(frame.meta.sequence, i);
+    }
+    EXPECT_TRUE(queue.IsEmpty());
+}
+
+TEST(FairShareQueueTest, FullStreamOnlyBlocksItself) {
+    StreamSim::Core::FairShareQueue<StreamSim::Core::ByteFrameElement, 4, 0> queue;
+
+    for (uint64_t i = 0; i < 4; ++i) {
+        EXPECT_TRUE(queue.WriteSync(MakeTestFrame(i, { .streamId = 0 })));
+    }
+    EXPECT_EQ(queue.NumStreamElements(0), 4);
+
+    // Stream 0 is full, stream 1 still gets in right away.
+    EXPECT_TRUE(queue.WriteSync(MakeTestFrame(0, { .streamId = 1 })));
+
+    std::thread writer([&queue]() {
+        EXPECT_TRUE(queue.WriteSync(MakeTestFrame(4, { .streamId = 0 })));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(queue.NumStreamElements(0), 4);
+
+    StreamSim::Core::ByteFrameElement frame;
+    ASSERT_TRUE(queue.ReadSync(frame));
+    writer.join();
+    EXPECT_EQ(queue.NumElements(), 5);
+
+    queue.Close();
+    EXPECT_FALSE(queue.WriteSync(MakeTestFrame(1, { .streamId = 1 })));
+}
+
+namespace {
+    using TestJitterQueue = StreamSim::Core::JitterBufferQueue<StreamSim::Core::ByteFrameElement, 256, 1>;
+
+    uint64_t JitterTestNowUs() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+}
+
+TEST(JitterBufferQueueTest, HoldsFramesUntilPlayout) {
+    TestJitterQueue queue;
+    StreamSim::Core::ByteFrameElement frame;
+
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(queue.WriteSync(MakeTestFrame(0, { .timestampUs = JitterTestNowUs() })));
+    EXPECT_FALSE(queue.ReadAsync(frame));
+    EXPECT_EQ(queue.NumElements(), 1);
+
+    EXPECT_TRUE(queue.ReadSync(frame));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(StreamSim::Core::MIN_JITTER_DELAY_IN_MILISEC));
+    EXPECT_EQ(frame.meta.sequence, 0);
+    EXPECT_EQ(queue.GetStats().framesReleased, 1);
+}
+
+TEST(JitterBufferQueueTest, PlaysOutInTimestampOrder) {
+    TestJitterQueue queue;
+    const uint64_t now = JitterTestNowUs();
+
+    // Frame 1 overtook frame 0 on the way, but not by more than the delay.
+    EXPECT_TRUE(queue.WriteSync(MakeTestFrame(1, { .timestampUs = now })));
+    EXPECT_TRUE(queue.WriteSync(MakeTestFrame(0, { .timestampUs = now - 1000 })));
+
+    StreamSim::Core::ByteFrameElement frame;
+    EXPECT_TRUE(queue.ReadSync(frame));
+    EXPECT_EQ(frame.meta.sequence, 0);
+    EXPECT_TRUE(queue.ReadSync(frame));
+    EXPECT_EQ(frame.meta.sequence, 1);
+    EXPECT_EQ(queue.GetStats().framesLate, 0);
+}
+
+TEST(JitterBufferQueueTest, DiscardsLateFrames) {
+    TestJitterQueue queue;
+    const uint64_t now = JitterTestNowUs();
+
+    EXPECT_TRUE(queue.WriteSync(MakeTestFrame(2, { .timestampUs = now })));
+    // Took 100ms longer than frame 2 to get here, its playout time is long gone.
+    EXPECT_FALSE(queue.WriteSync(MakeTestFrame(3, { .timestampUs = now - 100000 })));
+
+    // What's left of frame 3 goes out right away, so nothing after the queue waits for it.
+    StreamSim::Core::ByteFrameElement frame;
+    EXPECT_TRUE(queue.ReadAsync(frame));
+    EXPECT_EQ(frame.meta.sequence, 3);
+    EXPECT_TRUE(frame.meta.isExpired);
+    EXPECT_TRUE(queue.ReadSync(frame));
+    EXPECT_EQ(frame.meta.sequence, 2);
+    EXPECT_FALSE(frame.meta.isExpired);
+
+    // Within the delay, but sent before frame 2, which was already played out.
+    EXPECT_FALSE(queue.WriteSync(MakeTestFrame(1, { .timestampUs = now - 1000 })));
+    EXPECT_TRUE(queue.ReadAsync(frame));
+    EXPECT_EQ(frame.meta.sequence, 1);
+    EXPECT_TRUE(frame.meta.isExpired);
+    EXPECT_TRUE(queue.IsEmpty());
+    EXPECT_EQ(queue.GetStats().framesLate, 2);
+}
+
+TEST(JitterBufferQueueTest, LaterTimestampIsntLateBehindHigherSequence) {
+    TestJitterQueue queue;
+    const uint64_t now = JitterTestNowUs();
+
+    EXPECT_TRUE(queue.WriteSync(MakeTestFrame(2, { .timestampUs = now })));
+    StreamSim::Core::ByteFrameElement frame;
+    ASSERT_TRUE(queue.ReadSync(frame));
+    EXPECT_EQ(frame.meta.sequence, 2);
+
+    // Frame 1 of the same stream was sent after frame 2, it plays out after it instead of being thrown away.
+    EXPECT_TRUE(queue.WriteSync(MakeTestFrame(1, { .timestampUs = now + 20000 })));
+    ASSERT_TRUE(queue.ReadSync(frame));
+    EXPECT_EQ(frame.meta.sequence, 1);
+    EXPECT_FALSE(frame.meta.isExpired);
+    EXPECT_EQ(queue.GetStats().framesLate, 0);
+}
+
+TEST(JitterBufferQueueTest, DelayFollowsJitter) {
+    TestJitterQueue steadyQueue;
+    TestJitterQueue jitteryQueue;
+
+    // Same transit time for every frame versus one that swings by 20ms from frame to frame.
+    for (uint64_t sequence = 0; sequence < 100; ++sequence) {
+        const uint64_t now = JitterTestNowUs();
+        steadyQueue.WriteSync(MakeTestFrame(sequence, { .timestampUs = now }));
+        jitteryQueue.WriteSync(MakeTestFrame(sequence, { .timestampUs = sequence % 2 == 0 ? now : now - 20000 }));
+    }
+
+    auto steadyStats = steadyQueue.GetStats();
+    auto jitteryStats = jitteryQueue.GetStats();
+    EXPECT_LT(steadyStats.currentDelayUs, 10000);
+    EXPECT_GT(jitteryStats.jitterUs, 10000);
+    EXPECT_GT(jitteryStats.currentDelayUs, 40000);
+    EXPECT_LE(jitteryStats.currentDelayUs, StreamSim::Core::MAX_JITTER_DELAY_IN_MILISEC * 1000);
+    EXPECT_EQ(jitteryQueue.GetCurrentDelay(), std::chrono::microseconds(jitteryStats.currentDelayUs));
+
+    // Once the delay has caught up, the slow frames are held long enough to make it.
+    EXPECT_GT(jitteryQueue.NumElements(), 40);
+}
+
+TEST(JitterBufferQueueTest, CloseReleasesEverything) {
+    TestJitterQueue queue;
+    const uint64_t now = JitterTestNowUs();
+    for (uint64_t sequence = 0; sequence < 4; ++sequence) {
+        EXPECT_TRUE(queue.WriteSync(MakeTestFrame(sequence, { .timestampUs = now + sequence * 1000000 })));
+    }
+    queue.Close();
+
+    std::array<StreamSim::Core::ByteFrameElement, 8> frames;
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(queue.ReadBatch(frames, frames.size()), 4);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(100));
+    EXPECT_EQ(frames[3].meta.sequence, 3);
+    EXPECT_EQ(queue.ReadBatch(frames, frames.size()), 0);
+}
+
+TEST(JitterBufferQueueTest, OnlyDueFramesAreReady) {
+    TestJitterQueue queue;
+    // Jittery enough that the delay grows well past the time it takes to write the frames.
+    for (uint64_t sequence = 0; sequence < 100; ++sequence) {
+        const uint64_t now = JitterTestNowUs();
+        queue.WriteSync(MakeTestFrame(sequence, { .timestampUs = sequence % 2 == 0 ? now : now - 20000 }));
+    }
+
+    // The frames that just came in are still held back.
+    const std::size_t numHeld = queue.NumElements();
+    EXPECT_GT(numHeld, 0);
+    EXPECT_LT(queue.NumReadyElements(), numHeld);
+
+    // Closing makes everything due.
+    queue.Close();
+    EXPECT_EQ(queue.NumReadyElements(), numHeld);
+}
+
+TEST(LatencyHistogramTest, BucketsStayWithinPrecision) {
+    for (uint64_t value : {0ull, 1ull, 15ull, 16ull, 17ull, 100ull, 4096ull, 123456ull, 987654321ull, 1ull << 39}) {
+        const std::size_t index = StreamSim::Core::LatencyHistogram::BucketIndex(value);
+        ASSERT_LT(index, StreamSim::Core::LatencyHistogram::NUM_BUCKETS);
+        const uint64_t upper = StreamSim::Core::LatencyHistogram::BucketUpperBound(index);
+        EXPECT_GE(upper, value);
+        EXPECT_LE(upper - value, value / 16);
+        if (index > 0) {
+            EXPECT_LT(StreamSim::Core::LatencyHistogram::BucketUpperBound(index - 1), value);
+        }
+    }
+}
+
+TEST(LatencyHistogramTest, PercentilesOfMergedHistograms) {
+    StreamSim::Core::LatencyHistogram first;
+    StreamSim::Core::LatencyHistogram second;
+    // Two threads' worth of 1..10000us, split by odd and even.
+    for (uint64_t i = 1; i <= 10000; ++i) {
+        (i % 2 == 0 ? first : second).Record(i * 1000);
+    }
+
+    StreamSim::Core::HistogramSnapshot snapshot;
+    snapshot.Add(first);
+    snapshot.Add(second);
+    auto summary = snapshot.Summarize();
+
+    EXPECT_EQ(summary.count, 10000);
+    EXPECT_EQ(summary.minNs, 1000);
+    EXPECT_EQ(summary.maxNs, 10000000);
+    EXPECT_EQ(summary.meanNs, 5000500);
+    EXPECT_NEAR(static_cast<double>(summary.p50Ns), 5000000.0, 5000000.0 / 16);
+    EXPECT_NEAR(static_cast<double>(summary.p99Ns), 9900000.0, 9900000.0 / 16);
+    EXPECT_LE(summary.p50Ns, summary.p90Ns);
+    EXPECT_LE(summary.p90Ns, summary.p99Ns);
+    EXPECT_LE(summary.p99Ns, summary.p999Ns);
+    EXPECT_LE(summary.p999Ns, summary.maxNs);
+
+    StreamSim::Core::HistogramSnapshot merged;
+    merged.Merge(snapshot);
+    merged.Merge(snapshot);
+    EXPECT_EQ(merged.Count(), 20000);
+    EXPECT_EQ(merged.Percentile(50.0), summary.p50Ns);
+
+    EXPECT_EQ(StreamSim::Core::HistogramSnapshot().Summarize().count, 0);
+}
+
+TEST(LatencyHistogramTest, SnapshotSince) {
+    StreamSim::Core::LatencyHistogram histogram;
+    for (uint64_t i = 1; i <= 100; ++i) {
+        histogram.Record(i * 1000);
+    }
+    StreamSim::Core::HistogramSnapshot earlier;
+    earlier.Add(histogram);
+
+    // Only the slow frames since the earlier snapshot count.
+    for (uint64_t i = 0; i < 10; ++i) {
+        histogram.Record(50000000);
+    }
+    StreamSim::Core::HistogramSnapshot later;
+    later.Add(histogram);
+
+    auto delta = later.Since(earlier).Summarize();
+    EXPECT_EQ(delta.count, 10);
+    EXPECT_EQ(delta.meanNs, 50000000);
+    EXPECT_NEAR(static_cast<double>(delta.minNs), 50000000.0, 50000000.0 / 16);
+    EXPECT_EQ(delta.maxNs, 50000000);
+    EXPECT_EQ(later.Since(later).Count(), 0);
+}
+
+TEST(ConcurrentDataTest, QueueGauges) {
+    StreamSim::Core::ConcurrentBufferQueue<StreamSim::Core::ByteFrameElement, 4, 1> queue;
+    StreamSim::Core::ByteFrameElement frame;
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(queue.WriteSync(frame));
+    }
+    EXPECT_TRUE(queue.ReadSync(frame));
+
+    queue.Close();
+    EXPECT_FALSE(queue.WriteSync(frame));
+    std::array<StreamSim::Core::ByteFrameElement, 2> frames;
+    EXPECT_EQ(queue.WriteBatch(frames), 0);
+
+    auto stats = queue.GetQueueStats();
+    EXPECT_EQ(stats.depth, 2);
+    EXPECT_EQ(stats.maxDepth, 3);
+    EXPECT_EQ(stats.dropped, 3);
+}
@@ -0,0 +1,243 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <chrono>
+#include <map>
+#include <thread>
+#include <vector>
+#include "Decoder.hpp"
+#include "GopScheduler.hpp"
+#include "TestFrames.hpp"
+
+using StreamSim::Test::MakeTestFrame;
+
+namespace {
+    std::vector<uint64_t> TakeAllReady(StreamSim::Core::GopScheduler& scheduler) {
+        std::vector<uint64_t> sequences;
+        std::array<StreamSim::Core::ByteUndecodedFrame, 4> frames;
+        std::size_t numFrames = 0;
+        while ((numFrames = scheduler.TakeReady(frames)) > 0) {
+            for (std::size_t i = 0; i < numFrames; ++i) {
+                sequences.push_back(frames[i].meta.sequence);
+            }
+        }
+        return sequences;
+    }
+}
+
+TEST(GopSchedulerTest, DescribeGopFrame) {
+    // I0 P3 B1 B2 P6 B4 B5 P9 B7 B8 | I10
+    StreamSim::Core::FrameMetadata meta;
+
+    meta.sequence = 0;
+    StreamSim::Core::DescribeGopFrame(meta);
+    EXPECT_EQ(meta.type, StreamSim::Core::FrameType::I);
+    EXPECT_EQ(meta.numReferences, 0);
+    EXPECT_EQ(meta.displayOrder, 0);
+
+    meta.sequence = 1;
+    StreamSim::Core::DescribeGopFrame(meta);
+    EXPECT_EQ(meta.type, StreamSim::Core::FrameType::P);
+    EXPECT_EQ(meta.numReferences, 1);
+    EXPECT_EQ(meta.references[0], 0);
+    EXPECT_EQ(meta.displayOrder, 3);
+
+    meta.sequence = 3;
+    StreamSim::Core::DescribeGopFrame(meta);
+    EXPECT_EQ(meta.type, StreamSim::Core::FrameType::B);
+    EXPECT_EQ(meta.numReferences, 2);
+    EXPECT_EQ(meta.references[0], 0);
+    EXPECT_EQ(meta.references[1], 1);
+    EXPECT_EQ(meta.displayOrder, 2);
+
+    meta.sequence = 4;
+    StreamSim::Core::DescribeGopFrame(meta);
+    EXPECT_EQ(meta.type, StreamSim::Core::FrameType::P);
+    EXPECT_EQ(meta.references[0], 1);
+    EXPECT_EQ(meta.displayOrder, 6);
+
+    meta.sequence = 11;
+    StreamSim::Core::DescribeGopFrame(meta);
+    EXPECT_EQ(meta.type, StreamSim::Core::FrameType::P);
+    EXPECT_EQ(meta.references[0], 10);
+    EXPECT_EQ(meta.displayOrder, 13);
+}
+
+TEST(GopSchedulerTest, ReferencesHoldFrames) {
+    StreamSim::Core::GopScheduler scheduler;
+
+    // B1 and P3 (sequences 2 and 1) arrive before the anchors they need.
+    scheduler.Submit(MakeTestFrame(2, { .isGopFrame = true }));
+    scheduler.Submit(MakeTestFrame(1, { .isGopFrame = true }));
+    EXPECT_TRUE(TakeAllReady(scheduler).empty());
+    EXPECT_EQ(scheduler.NumPending(), 2);
+
+    scheduler.Submit(MakeTestFrame(0, { .isGopFrame = true }));
+    EXPECT_EQ(TakeAllReady(scheduler), (std::vector<uint64_t>{0}));
+
+    // I0 done releases P3 but not B1, which also needs P3.
+    StreamSim::Core::FrameMetadata meta;
+    meta.sequence = 0;
+    scheduler.Complete(meta);
+    EXPECT_EQ(TakeAllReady(scheduler), (std::vector<uint64_t>{1}));
+
+    meta.sequence = 1;
+    scheduler.Complete(meta);
+    EXPECT_EQ(TakeAllReady(scheduler), (std::vector<uint64_t>{2}));
+    EXPECT_EQ(scheduler.NumPending(), 0);
+
+    auto stats = scheduler.GetStats();
+    EXPECT_EQ(stats.framesReady, 1);
+    EXPECT_EQ(stats.framesDeferred, 2);
+}
+
+TEST(GopSchedulerTest, IndependentGopsAreReadyTogether) {
+    StreamSim::Core::GopScheduler scheduler;
+
+    scheduler.Submit(MakeTestFrame(0, { .isGopFrame = true }));
+    scheduler.Submit(MakeTestFrame(1, { .isGopFrame = true }));
+    scheduler.Submit(MakeTestFrame(10, { .isGopFrame = true }));
+    scheduler.Submit(MakeTestFrame(20, { .isGopFrame = true }));
+
+    EXPECT_EQ(TakeAllReady(scheduler), (std::vector<uint64_t>{0, 10, 20}));
+}
+
+TEST(GopSchedulerTest, ReadyFramesTakeTurnsAcrossStreams) {
+    StreamSim::Core::GopScheduler scheduler;
+
+    // Stream 1 has four I-frames ready before stream 2 gets its two in.
+    for (uint64_t sequence : { 0, 10, 20, 30 }) {
+        scheduler.Submit(MakeTestFrame(sequence, { .streamId = 1, .isGopFrame = true }));
+    }
+    for (uint64_t sequence : { 0, 10 }) {
+        scheduler.Submit(MakeTestFrame(sequence, { .streamId = 2, .isGopFrame = true }));
+    }
+
+    std::array<StreamSim::Core::ByteUndecodedFrame, 6> frames;
+    ASSERT_EQ(scheduler.TakeReady(frames), 6);
+    std::vector<uint32_t> streams;
+    for (const auto& frame : frames) {
+        streams.push_back(frame.meta.streamId);
+    }
+    EXPECT_EQ(streams, (std::vector<uint32_t>{1, 2, 1, 2, 1, 1}));
+}
+
+TEST(GopSchedulerTest, StreamsAreIndependent) {
+    StreamSim::Core::GopScheduler scheduler;
+
+    auto frame = MakeTestFrame(1, { .isGopFrame = true });
+    frame.meta.streamId = 1;
+    scheduler.Submit(std::move(frame));
+
+    // Sequence 0 of another stream doesn't satisfy stream 1's reference.
+    StreamSim::Core::FrameMetadata meta;
+    meta.streamId = 2;
+    meta.sequence = 0;
+    scheduler.Complete(meta);
+    EXPECT_TRUE(TakeAllReady(scheduler).empty());
+
+    meta.streamId = 1;
+    scheduler.Complete(meta);
+    EXPECT_EQ(TakeAllReady(scheduler), (std::vector<uint64_t>{1}));
+}
+
+TEST(GopSchedulerTest, LostReferenceDropsFrame) {
+    StreamSim::Core::GopScheduler scheduler;
+
+    // I0 never arrives, so P3 can't ever be decoded.
+    scheduler.Submit(MakeTestFrame(1, { .isGopFrame = true }));
+    EXPECT_EQ(scheduler.NumPending(), 1);
+
+    // I300, far enough ahead that I0 is not coming any more.
+    scheduler.Submit(MakeTestFrame(300, { .isGopFrame = true }));
+    EXPECT_EQ(scheduler.NumPending(), 0);
+    EXPECT_EQ(scheduler.GetStats().framesOrphaned, 1);
+}
+
+TEST(GopSchedulerTest, DroppedReferenceDropsDependentsRightAway) {
+    StreamSim::Core::GopScheduler scheduler;
+
+    // P3 and B1 wait on I0, P6 and B4 on P3.  I0 never arrives.
+    for (uint64_t sequence : { 1, 2, 4, 5 }) {
+        scheduler.Submit(MakeTestFrame(sequence, { .isGopFrame = true }));
+    }
+    EXPECT_EQ(scheduler.NumPending(), 4);
+
+    // Once P3 goes, everything that needs it goes with it instead of waiting for its own distance.
+    auto late = MakeTestFrame(258, { .isGopFrame = true });
+    late.meta.type = StreamSim::Core::FrameType::I;
+    late.meta.numReferences = 0;
+    scheduler.Submit(std::move(late));
+    EXPECT_EQ(scheduler.NumPending(), 0);
+    EXPECT_EQ(scheduler.GetStats().framesOrphaned, 4);
+
+    // They still come out, marked expired, so the queues after decode don't wait for them.
+    std::array<StreamSim::Core::ByteUndecodedFrame, 8> frames;
+    ASSERT_EQ(scheduler.TakeReady(frames), 5);
+    EXPECT_FALSE(frames[0].meta.isExpired);
+    for (std::size_t i = 1; i < 5; ++i) {
+        EXPECT_TRUE(frames[i].meta.isExpired);
+    }
+
+    // And a frame that shows up after its reference was dropped never waits at all.
+    scheduler.Submit(MakeTestFrame(6, { .isGopFrame = true }));
+    EXPECT_EQ(scheduler.NumPending(), 0);
+    EXPECT_EQ(scheduler.GetStats().framesOrphaned, 5);
+}
+
+TEST(GopSchedulerTest, IdleStreamsAreForgotten) {
+    StreamSim::Core::GopScheduler scheduler(std::chrono::milliseconds(10));
+
+    auto frame = MakeTestFrame(0, { .isGopFrame = true });
+    frame.meta.streamId = 1;
+    scheduler.Submit(std::move(frame));
+    ASSERT_EQ(TakeAllReady(scheduler), (std::vector<uint64_t>{0}));
+    StreamSim::Core::FrameMetadata meta;
+    meta.streamId = 1;
+    scheduler.Complete(meta);
+
+    // Stream 2 holds a frame it will never get the reference for.
+    frame = MakeTestFrame(1, { .isGopFrame = true });
+    frame.meta.streamId = 2;
+    scheduler.Submit(std::move(frame));
+    EXPECT_EQ(scheduler.NumStreams(), 2);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    frame = MakeTestFrame(0, { .isGopFrame = true });
+    frame.meta.streamId = 3;
+    scheduler.Submit(std::move(frame));
+    EXPECT_EQ(scheduler.NumStreams(), 1);
+    EXPECT_EQ(scheduler.NumPending(), 0);
+    EXPECT_EQ(scheduler.GetStats().framesOrphaned, 1);
+}
+
+TEST(GopSchedulerTest, DecodeServiceRespectsReferences) {
+    constexpr uint64_t NUM_FRAMES = 40;
+
+    StreamSim::Core::AsyncByteFrameQueue decodeQueue;
+    StreamSim::Core::AsyncByteFrameQueue renderQueue;
+    StreamSim::Core::FrameElementQueueDecodeService decodeService(&decodeQueue, &renderQueue);
+
+    // Sent backwards, so nearly every P/B-frame is read before its references.
+    for (uint64_t i = NUM_FRAMES; i > 0; --i) {
+        decodeQueue.WriteSync(MakeTestFrame(i - 1, { .isGopFrame = true }));
+    }
+
+    decodeService.Run();
+    decodeService.Shutdown();
+
+    std::map<uint64_t, std::size_t> positions;
+    std::vector<StreamSim::Core::FrameMetadata> decoded;
+    StreamSim::Core::ByteFrameElement frame;
+    while (renderQueue.ReadAsync(frame)) {
+        positions[frame.meta.sequence] = decoded.size();
+        decoded.push_back(frame.meta);
+    }
+
+    ASSERT_EQ(decoded.size(), NUM_FRAMES);
+    for (const auto& meta : decoded) {
+        for (uint8_t i = 0; i < meta.numReferences; ++i) {
+            EXPECT_LT(positions[meta.references[i]], positions[meta.sequence]);
+        }
+    }
+    EXPECT_EQ(decodeService.GetSchedulerStats().framesOrphaned, 0);
+}
@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include <FrameCapture.hpp>
+#include <LoadGenerator.hpp>
+
+namespace {
+    // Keeps everything it is handed.
+    class RecordingHandler : public StreamSim::Net::NetInputStreamHandler {
+    public:
+        std::vector<StreamSim::Core::ByteUndecodedFrame> frames;
+
+        using StreamSim::Net::NetInputStreamHandler::OnInputStreamData;
+
+        void OnInputStreamData(const StreamSim::Core::ByteUndecodedFrame& data) override {
+            frames.push_back(data);
+        }
+    };
+
+    bool SameFrame(const StreamSim::Core::ByteUndecodedFrame& a, const StreamSim::Core::ByteUndecodedFrame& b) {
+        return a.data == b.data && a.meta.streamId == b.meta.streamId && a.meta.sequence == b.meta.sequence &&
+               a.meta.displayOrder == b.meta.displayOrder && a.meta.timestampUs == b.meta.timestampUs &&
+               a.meta.type == b.meta.type && a.meta.numReferences == b.meta.numReferences &&
+               a.meta.references == b.meta.references && a.payload.Size() == b.payload.Size() &&
+               std::equal(a.payload.Data(), a.payload.Data() + a.payload.Size(), b.payload.Data());
+    }
+}
+
+TEST(LoadGeneratorTest, SameSeedSendsSameFrames) {
+    StreamSim::Net::LoadProfile profile;
+    profile.arrival = StreamSim::Net::ArrivalProcess::Poisson;
+    profile.seed = 1234;
+
+    StreamSim::Net::LoadGenerator first(profile);
+    StreamSim::Net::LoadGenerator second(profile);
+    profile.seed = 4321;
+    StreamSim::Net::LoadGenerator other(profile);
+
+    bool differs = false;
+    for (int i = 0; i < 100; ++i) {
+        StreamSim::Core::ByteUndecodedFrame a, b, c;
+        uint64_t arrivalA = 0, arrivalB = 0, arrivalC = 0;
+        ASSERT_TRUE(first.Next(a, arrivalA));
+        ASSERT_TRUE(second.Next(b, arrivalB));
+        ASSERT_TRUE(other.Next(c, arrivalC));
+
+        EXPECT_EQ(arrivalA, arrivalB);
+        EXPECT_TRUE(SameFrame(a, b));
+        EXPECT_EQ(a.meta.sequence, static_cast<uint64_t>(i));
+        differs = differs || arrivalA != arrivalC || !SameFrame(a, c);
+    }
+    EXPECT_TRUE(differs);
+}
+
+TEST(LoadGeneratorTest, ArrivalProcessesKeepTheirRate) {
+    StreamSim::Net::LoadProfile profile;
+    profile.framesPerSec = 10000.0;
+    profile.payloadSize = 256;
+
+    // Constant rate: exactly 100 us apart.
+    StreamSim::Net::LoadGenerator constant(profile);
+    StreamSim::Core::ByteUndecodedFrame frame;
+    uint64_t arrivalUs = 0;
+    for (uint64_t i = 0; i < 10; ++i) {
+        ASSERT_TRUE(constant.Next(frame, arrivalUs));
+        EXPECT_EQ(arrivalUs, i * 100);
+    }
+
+    // Poisson: 10000 frames take about a second.
+    profile.arrival = StreamSim::Net::ArrivalProcess::Poisson;
+    StreamSim::Net::LoadGenerator poisson(profile);
+    for (int i = 0; i < 10000; ++i) {
+        ASSERT_TRUE(poisson.Next(frame, arrivalUs));
+    }
+    EXPECT_NEAR(static_cast<double>(arrivalUs), 1e6, 5e4);
+
+    // On/off: nothing during the quiet half of each cycle.
+    profile.arrival = StreamSim::Net::ArrivalProcess::OnOff;
+    profile.onTimeUs = 1000;
+    profile.offTimeUs = 1000;
+    StreamSim::Net::LoadGenerator onOff(profile);
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(onOff.Next(frame, arrivalUs));
+        EXPECT_LT(arrivalUs % 2000, 1000u);
+    }
+    EXPECT_GE(arrivalUs, 18000u);
+}
+
+TEST(LoadGeneratorTest, GeneratorsSplitOneStream) {
+    StreamSim::Net::LoadProfile profile;
+    profile.payloadSize = 256;
+
+    std::vector<std::unique_ptr<StreamSim::Net::LoadGenerator>> generators;
+    for (std::size_t i = 0; i < 4; ++i) {
+        generators.push_back(std::make_unique<StreamSim::Net::LoadGenerator>(profile, i, 4));
+    }
+
+    // Taking turns they send sequences 0, 1, 2, ... in arrival order.
+    uint64_t lastArrivalUs = 0;
+    for (uint64_t sequence = 0; sequence < 40; ++sequence) {
+        StreamSim::Core::ByteUndecodedFrame frame;
+        uint64_t arrivalUs = 0;
+        ASSERT_TRUE(generators[sequence % 4]->Next(frame, arrivalUs));
+        EXPECT_EQ(frame.meta.sequence, sequence);
+        EXPECT_GE(arrivalUs, lastArrivalUs);
+        lastArrivalUs = arrivalUs;
+    }
+}
+
+TEST(LoadGeneratorTest, PoissonGeneratorsSplitOneSchedule) {
+    StreamSim::Net::LoadProfile profile;
+    profile.arrival = StreamSim::Net::ArrivalProcess::Poisson;
+    profile.framesPerSec = 10000.0;
+    profile.payloadSize = 64;
+
+    std::vector<std::unique_ptr<StreamSim::Net::LoadGenerator>> generators;
+    for (std::size_t i = 0; i < 4; ++i) {
+        generators.push_back(std::make_unique<StreamSim::Net::LoadGenerator>(profile, i, 4));
+    }
+
+    // Random gaps, but timestamps still go up with the sequence across all four.
+    uint64_t lastArrivalUs = 0;
+    for (uint64_t sequence = 0; sequence < 4000; ++sequence) {
+        StreamSim::Core::ByteUndecodedFrame frame;
+        uint64_t arrivalUs = 0;
+        ASSERT_TRUE(generators[sequence % 4]->Next(frame, arrivalUs));
+        ASSERT_EQ(frame.meta.sequence, sequence);
+        ASSERT_GE(frame.meta.timestampUs, lastArrivalUs) << "sequence " << sequence;
+        lastArrivalUs = frame.meta.timestampUs;
+    }
+
+    // Each one still sends at the profile rate, 1000 frames take about 100ms.
+    EXPECT_NEAR(static_cast<double>(lastArrivalUs), 1e5, 1e4);
+}
+
+TEST(LoadGeneratorTest, ReplaysCaptureByteForByte) {
+    const std::string path = testing::TempDir() + "load_generator_capture.bin";
+
+    StreamSim::Net::LoadProfile profile;
+    profile.arrival = StreamSim::Net::ArrivalProcess::Poisson;
+    profile.payloadSize = 1000;
+    StreamSim::Net::LoadGenerator generator(profile);
+
+    std::vector<StreamSim::Core::ByteUndecodedFrame> recorded(50);
+    {
+        StreamSim::Net::FrameCaptureWriter writer(path);
+        ASSERT_TRUE(writer.IsOpen());
+        for (auto& frame : recorded) {
+            uint64_t arrivalUs = 0;
+            ASSERT_TRUE(generator.Next(frame, arrivalUs));
+            frame.meta.timestampUs += 5000;
+            ASSERT_TRUE(writer.Write(frame));
+        }
+    }
+
+    auto capture = std::make_shared<StreamSim::Net::FrameCaptureReader>(path);
+    ASSERT_TRUE(capture->IsOpen());
+    ASSERT_EQ(capture->NumFrames(), recorded.size());
+
+    profile.arrival = StreamSim::Net::ArrivalProcess::Replay;
+    profile.capture = capture;
+    StreamSim::Net::LoadGenerator replay(profile);
+    for (const auto& expected : recorded) {
+        StreamSim::Core::ByteUndecodedFrame frame;
+        uint64_t arrivalUs = 0;
+        ASSERT_TRUE(replay.Next(frame, arrivalUs));
+        EXPECT_TRUE(SameFrame(frame, expected));
+        // Arrival times are relative to the first recorded frame.
+        EXPECT_EQ(arrivalUs, expected.meta.timestampUs - recorded.front().meta.timestampUs);
+    }
+
+    StreamSim::Core::ByteUndecodedFrame frame;
+    uint64_t arrivalUs = 0;
+    EXPECT_FALSE(replay.Next(frame, arrivalUs));
+
+    std::remove(path.c_str());
+}
+
+TEST(LoadGeneratorTest, RunsOpenLoopPastOneKilohertz) {
+    StreamSim::Net::LoadProfile profile;
+    profile.framesPerSec = 5000.0;
+    profile.payloadSize = 256;
+
+    RecordingHandler handler;
+    StreamSim::Net::LoadGenerator generator(profile);
+    auto stats = generator.Run(handler, std::chrono::steady_clock::now(), std::chrono::milliseconds(200));
+
+    // Every frame due in the window goes out, late ones included.
+    EXPECT_EQ(stats.framesSent, 1000u);
+    ASSERT_EQ(handler.frames.size(), 1000u);
+    EXPECT_EQ(handler.frames.back().meta.sequence, 999u);
+}
@@ -1,5 +1,43 @@
 #include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <GopScheduler.hpp>
 #include <NetInputStream.hpp>
+#include <UdpInputStream.hpp>
+#include "TestFrames.hpp"
+
+using StreamSim::Test::MakeTestFrame;
+
+namespace {
+    // Builds the packets UdpFrameSender would send for a frame of frameSize bytes, byte i of the frame is i.
+    std::vector<std::vector<uint8_t>> MakePackets(uint64_t sequence, std::size_t frameSize) {
+        const auto frame = MakeTestFrame(sequence, { .streamId = 1, .isGopFrame = true });
+        StreamSim::Net::PacketHeader header;
+        header.streamId = frame.meta.streamId;
+        header.sequence = frame.meta.sequence;
+        header.displayOrder = frame.meta.displayOrder;
+        header.frameSize = static_cast<uint32_t>(frameSize);
+        header.fragmentCount = StreamSim::Net::NumFragments(frameSize);
+        header.frameType = static_cast<uint8_t>(frame.meta.type);
+        header.value = frame.data;
+
+        std::vector<std::vector<uint8_t>> packets;
+        for (uint16_t index = 0; index < header.fragmentCount; ++index) {
+            header.fragmentIndex = index;
+            const std::size_t offset = index * StreamSim::Net::MAX_FRAGMENT_PAYLOAD;
+            const std::size_t fragmentSize = std::min(StreamSim::Net::MAX_FRAGMENT_PAYLOAD, frameSize - offset);
+
+            std::vector<uint8_t> packet(StreamSim::Net::PACKET_HEADER_SIZE + fragmentSize);
+            StreamSim::Net::EncodePacketHeader(header, packet);
+            for (std::size_t i = 0; i < fragmentSize; ++i) {
+                packet[StreamSim::Net::PACKET_HEADER_SIZE + i] = static_cast<uint8_t>(offset + i);
+            }
+            packets.push_back(std::move(packet));
+        }
+        return packets;
+    }
+}
 
 TEST(NetInputStreamTest, DemoNetInputStreamHandlerTest) {
     StreamSim::Core::AsyncByteFrameQueue bufferQueue;
@@ -29,3 +67,233 @@ TEST(NetInputStreamTest, DemoNetInputStreamHandlerTest) {
     EXPECT_TRUE(bufferQueue.ReadSync(data));
     EXPECT_EQ(data.data, static_cast<uint8_t>(10));
 }
+
+TEST(NetInputStreamTest, StreamIdIsTagged) {
+    StreamSim::Core::AsyncByteFrameQueue bufferQueue;
+    StreamSim::Net::DemoNetInputStreamHandler handler(&bufferQueue);
+    StreamSim::Core::ByteFrameElement data;
+    data.data = 2;
+    handler.OnInputStreamData(3, data);
+
+    EXPECT_TRUE(bufferQueue.ReadSync(data));
+    EXPECT_EQ(data.data, static_cast<uint8_t>(2));
+    EXPECT_EQ(data.meta.streamId, 3);
+}
+
+TEST(NetInputStreamTest, PacketHeaderRoundTrip) {
+    StreamSim::Net::PacketHeader header;
+    header.streamId = 7;
+    header.sequence = 0x0102030405060708;
+    header.displayOrder = 12;
+    header.timestampUs = 123456789;
+    header.frameSize = 5000;
+    header.fragmentIndex = 2;
+    header.fragmentCount = 4;
+    header.frameType = static_cast<uint8_t>(StreamSim::Core::FrameType::B);
+    header.value = 9;
+    header.numReferences = 2;
+    header.references = {10, 13};
+
+    std::array<uint8_t, StreamSim::Net::PACKET_HEADER_SIZE> packet{};
+    StreamSim::Net::EncodePacketHeader(header, packet);
+    // Network byte order.
+    EXPECT_EQ(packet[0], StreamSim::Net::PacketHeader::VERSION);
+    EXPECT_EQ(packet[4], 7);
+    EXPECT_EQ(packet[5], 0x01);
+
+    StreamSim::Net::PacketHeader decoded;
+    ASSERT_TRUE(StreamSim::Net::DecodePacketHeader(packet, decoded));
+    EXPECT_EQ(decoded.streamId, header.streamId);
+    EXPECT_EQ(decoded.sequence, header.sequence);
+    EXPECT_EQ(decoded.displayOrder, header.displayOrder);
+    EXPECT_EQ(decoded.timestampUs, header.timestampUs);
+    EXPECT_EQ(decoded.frameSize, header.frameSize);
+    EXPECT_EQ(decoded.fragmentIndex, header.fragmentIndex);
+    EXPECT_EQ(decoded.fragmentCount, header.fragmentCount);
+    EXPECT_EQ(decoded.frameType, header.frameType);
+    EXPECT_EQ(decoded.value, header.value);
+    EXPECT_EQ(decoded.numReferences, header.numReferences);
+    EXPECT_EQ(decoded.references, header.references);
+
+    EXPECT_FALSE(StreamSim::Net::DecodePacketHeader(std::span<const uint8_t>(packet.data(), 10), decoded));
+    packet[0] = 99;
+    EXPECT_FALSE(StreamSim::Net::DecodePacketHeader(packet, decoded));
+}
+
+TEST(NetInputStreamTest, ReassemblesOutOfOrderFragments) {
+    StreamSim::Core::FrameBufferPool pool;
+    StreamSim::Net::FrameReassembler reassembler(pool);
+    StreamSim::Core::ByteUndecodedFrame frame;
+
+    auto packets = MakePackets(5, 3000);
+    ASSERT_EQ(packets.size(), 3);
+
+    EXPECT_FALSE(reassembler.AddPacket(packets[2], frame));
+    EXPECT_FALSE(reassembler.AddPacket(packets[0], frame));
+    EXPECT_FALSE(reassembler.AddPacket(packets[0], frame));
+    EXPECT_TRUE(reassembler.AddPacket(packets[1], frame));
+
+    EXPECT_EQ(frame.data, 5);
+    EXPECT_EQ(frame.meta.streamId, 1);
+    EXPECT_EQ(frame.meta.sequence, 5);
+    EXPECT_EQ(frame.meta.type, StreamSim::Core::FrameType::B);
+    ASSERT_EQ(frame.payload.Size(), 3000);
+    EXPECT_EQ(frame.payload.Pool(), &pool);
+    for (std::size_t i = 0; i < frame.payload.Size(); ++i) {
+        ASSERT_EQ(frame.payload.Data()[i], static_cast<uint8_t>(i));
+    }
+
+    // A truncated fragment doesn't fit where its index says it goes.
+    auto truncated = MakePackets(6, 3000)[0];
+    truncated.pop_back();
+    EXPECT_FALSE(reassembler.AddPacket(truncated, frame));
+
+    const auto& stats = reassembler.GetStats();
+    EXPECT_EQ(stats.framesCompleted, 1);
+    EXPECT_EQ(stats.duplicateFragments, 1);
+    EXPECT_EQ(stats.malformedPackets, 1);
+    EXPECT_EQ(stats.framesDropped, 0);
+}
+
+TEST(NetInputStreamTest, ReassemblerGivesUpOnOldestFrame) {
+    StreamSim::Net::FrameReassembler reassembler;
+    StreamSim::Core::ByteUndecodedFrame frame;
+
+    // First fragment of one frame too many, the first frame never completes.
+    for (uint64_t sequence = 0; sequence <= StreamSim::Net::FrameReassembler::MAX_FRAMES_IN_FLIGHT; ++sequence) {
+        EXPECT_FALSE(reassembler.AddPacket(MakePackets(sequence, 2000)[0], frame));
+    }
+    EXPECT_EQ(reassembler.GetStats().framesDropped, 1);
+
+    EXPECT_TRUE(reassembler.AddPacket(MakePackets(1, 2000)[1], frame));
+    EXPECT_EQ(frame.meta.sequence, 1);
+}
+
+TEST(NetInputStreamTest, ReassemblerRejectsFragmentsOfFinishedFrames) {
+    StreamSim::Core::FrameBufferPool pool;
+    StreamSim::Net::FrameReassembler reassembler(pool);
+    StreamSim::Core::ByteUndecodedFrame frame;
+
+    const auto packets = MakePackets(5, 3000);
+    for (const auto& packet : packets) {
+        reassembler.AddPacket(packet, frame);
+    }
+    ASSERT_EQ(frame.meta.sequence, 5);
+    frame = StreamSim::Core::ByteUndecodedFrame();
+
+    // A resent fragment of the completed frame doesn't start it over.
+    EXPECT_FALSE(reassembler.AddPacket(packets[1], frame));
+    EXPECT_EQ(pool.NumBuffersInUse(), 0);
+
+    // Frames still on their way from before it are fine, and so are new ones.
+    EXPECT_FALSE(reassembler.AddPacket(MakePackets(4, 3000)[0], frame));
+    EXPECT_FALSE(reassembler.AddPacket(MakePackets(6, 3000)[0], frame));
+    EXPECT_EQ(pool.NumBuffersInUse(), 2);
+
+    // Neither is a straggler from further back than the reassembler remembers.
+    const uint64_t sequence = 6 + StreamSim::Net::FrameReassembler::FINISHED_WINDOW;
+    for (const auto& packet : MakePackets(sequence, 2000)) {
+        reassembler.AddPacket(packet, frame);
+    }
+    ASSERT_EQ(frame.meta.sequence, sequence);
+    frame = StreamSim::Core::ByteUndecodedFrame();
+    EXPECT_FALSE(reassembler.AddPacket(MakePackets(5, 3000)[0], frame));
+    EXPECT_FALSE(reassembler.AddPacket(MakePackets(1, 3000)[0], frame));
+    EXPECT_EQ(pool.NumBuffersInUse(), 2);
+
+    const auto& stats = reassembler.GetStats();
+    EXPECT_EQ(stats.framesCompleted, 2);
+    EXPECT_EQ(stats.duplicateFragments, 3);
+    EXPECT_EQ(stats.framesDropped, 0);
+}
+
+TEST(NetInputStreamTest, ReassemblerRejectsFragmentsOfDroppedFrames) {
+    StreamSim::Net::FrameReassembler reassembler;
+    StreamSim::Core::ByteUndecodedFrame frame;
+
+    for (uint64_t sequence = 0; sequence <= StreamSim::Net::FrameReassembler::MAX_FRAMES_IN_FLIGHT; ++sequence) {
+        reassembler.AddPacket(MakePackets(sequence, 2000)[0], frame);
+    }
+    ASSERT_EQ(reassembler.GetStats().framesDropped, 1);
+
+    // Frame 0 was given up on, its last fragment doesn't bring it back and push out another frame.
+    EXPECT_FALSE(reassembler.AddPacket(MakePackets(0, 2000)[1], frame));
+    EXPECT_EQ(reassembler.GetStats().duplicateFragments, 1);
+    EXPECT_EQ(reassembler.GetStats().framesDropped, 1);
+}
+
+TEST(NetInputStreamTest, ReassemblerRejectsFragmentsDisagreeingOnFrameSize) {
+    StreamSim::Core::FrameBufferPool pool;
+    StreamSim::Net::FrameReassembler reassembler(pool);
+    StreamSim::Core::ByteUndecodedFrame frame;
+
+    // Frame 5 starts out as 2000 bytes, then a fragment claims it's 100000 and sits far past its buffer.
+    const auto packets = MakePackets(5, 2000);
+    EXPECT_FALSE(reassembler.AddPacket(packets[0], frame));
+    EXPECT_FALSE(reassembler.AddPacket(MakePackets(5, 100000)[50], frame));
+    EXPECT_EQ(reassembler.GetStats().malformedPackets, 1);
+
+    // The frame it started as still completes.
+    EXPECT_TRUE(reassembler.AddPacket(packets[1], frame));
+    ASSERT_EQ(frame.payload.Size(), 2000);
+    for (std::size_t i = 0; i < frame.payload.Size(); ++i) {
+        ASSERT_EQ(frame.payload.Data()[i], static_cast<uint8_t>(i));
+    }
+}
+
+#if !defined(_WIN32)
+TEST(NetInputStreamTest, UdpLoopbackIngest) {
+    StreamSim::Core::AsyncByteFrameQueue bufferQueue;
+    StreamSim::Net::DemoNetInputStreamHandler handler(&bufferQueue);
+    StreamSim::Net::UdpInputStream inputStream(&handler);
+    ASSERT_TRUE(inputStream.Start());
+    ASSERT_NE(inputStream.GetPort(), 0);
+
+    StreamSim::Net::UdpFrameSender sender(inputStream.GetPort());
+    ASSERT_TRUE(sender.IsOpen());
+
+    const std::size_t numFrames = 20;
+    const std::size_t frameSize = 5000;
+    for (std::size_t sequence = 0; sequence < numFrames; ++sequence) {
+        auto frame = MakeTestFrame(sequence, { .isGopFrame = true });
+        frame.payload = StreamSim::Core::FrameBufferPool::Default().Acquire(frameSize);
+        for (std::size_t i = 0; i < frameSize; ++i) {
+            frame.payload.Data()[i] = static_cast<uint8_t>(i + sequence);
+        }
+        ASSERT_TRUE(sender.SendFrame(frame));
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (bufferQueue.NumElements() < numFrames && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    inputStream.Stop();
+    ASSERT_EQ(bufferQueue.NumElements(), numFrames);
+
+    StreamSim::Core::ByteFrameElement frame;
+    for (std::size_t sequence = 0; sequence < numFrames; ++sequence) {
+        ASSERT_TRUE(bufferQueue.ReadSync(frame));
+        EXPECT_EQ(frame.data, static_cast<uint8_t>(sequence));
+        EXPECT_EQ(frame.meta.sequence, sequence);
+
+        StreamSim::Core::FrameMetadata expected;
+        expected.sequence = sequence;
+        StreamSim::Core::DescribeGopFrame(expected);
+        EXPECT_EQ(frame.meta.type, expected.type);
+        EXPECT_EQ(frame.meta.displayOrder, expected.displayOrder);
+        EXPECT_EQ(frame.meta.numReferences, expected.numReferences);
+
+        ASSERT_EQ(frame.payload.Size(), frameSize);
+        for (std::size_t i = 0; i < frameSize; ++i) {
+            ASSERT_EQ(frame.payload.Data()[i], static_cast<uint8_t>(i + sequence));
+        }
+    }
+
+    auto stats = inputStream.GetStats();
+    EXPECT_EQ(stats.packets, numFrames * StreamSim::Net::NumFragments(frameSize));
+    EXPECT_EQ(stats.packets, sender.NumPacketsSent());
+    EXPECT_EQ(stats.bytes, sender.NumBytesSent());
+    EXPECT_EQ(stats.reassembly.framesCompleted, numFrames);
+    EXPECT_GT(stats.recvCalls, 0);
+}
+#endif
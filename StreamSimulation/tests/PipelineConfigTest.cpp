@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <PipelineConfig.hpp>
+
+namespace {
+    std::string WriteConfigFile(const std::string& name, const std::string& text) {
+        const std::string path = ::testing::TempDir() + name;
+        std::ofstream(path) << text;
+        return path;
+    }
+}
+
+TEST(PipelineConfigTest, DefaultsMatchTheOldConstants) {
+    StreamSim::Core::PipelineConfig config;
+    EXPECT_EQ(config.runTimeSec, 6);
+    EXPECT_EQ(config.numIngestThreads, 4);
+    EXPECT_EQ(config.numDecoderThreads, 4);
+    EXPECT_EQ(config.decodeQueue.capacity, StreamSim::Core::DEFULT_FRAME_BUFFER_SIZE);
+    EXPECT_EQ(config.renderQueue.wait.timeout, std::chrono::seconds(2));
+    EXPECT_TRUE(config.decodePlacement.cpus.empty());
+    EXPECT_FALSE(config.decodePlacement.node.has_value());
+    EXPECT_EQ(config.decodePlacement.policy, StreamSim::Core::PinningPolicy::Shared);
+    EXPECT_EQ(config.frameDeadline, std::chrono::milliseconds(StreamSim::Core::DEFAULT_FRAME_DEADLINE_IN_MILISEC));
+    EXPECT_EQ(config.numExecutorThreads, StreamSim::Core::DEFAULT_NUM_EXECUTOR_THREADS);
+    EXPECT_EQ(config.decodePoolPolicy, StreamSim::Core::AdmissionPolicy::Block);
+    EXPECT_EQ(config.renderMode, StreamSim::Render::RenderMode::Immediate);
+    EXPECT_EQ(config.renderRefreshRateHz, StreamSim::Render::DEFAULT_REFRESH_RATE_HZ);
+}
+
+TEST(PipelineConfigTest, LoadFile) {
+    const std::string path = WriteConfigFile("pipeline_config_test.conf",
+        "# small box\n"
+        "run_time_sec = 2\n"
+        "\n"
+        "decode.threads = 2    # one per core\n"
+        "decode.cpus = 0-1\n"
+        "decode.pinning = spread\n"
+        "render.node = 1\n"
+        "render.mode = paced\n"
+        "render.refresh_hz = 144\n"
+        "decode_queue.capacity = 64\n"
+        "render_queue.wait_ms = 0\n"
+        "render_queue.spin = 8\n");
+
+    StreamSim::Core::PipelineConfig config;
+    std::string error;
+    ASSERT_TRUE(StreamSim::Core::LoadPipelineConfig(path, config, error)) << error;
+    EXPECT_EQ(config.runTimeSec, 2);
+    EXPECT_EQ(config.numDecoderThreads, 2);
+    EXPECT_EQ(config.decodePlacement.cpus, (StreamSim::Core::CpuSet{ 0, 1 }));
+    EXPECT_EQ(config.decodePlacement.policy, StreamSim::Core::PinningPolicy::Spread);
+    EXPECT_EQ(config.renderPlacement.node, 1u);
+    EXPECT_EQ(config.renderMode, StreamSim::Render::RenderMode::Paced);
+    EXPECT_EQ(config.renderRefreshRateHz, 144);
+    EXPECT_EQ(config.decodeQueue.capacity, 64);
+    EXPECT_EQ(config.renderQueue.wait.timeout.count(), 0);
+    EXPECT_EQ(config.renderQueue.wait.spinCount, 8);
+    // Untouched options keep their defaults.
+    EXPECT_EQ(config.numIngestThreads, 4);
+    std::remove(path.c_str());
+}
+
+TEST(PipelineConfigTest, DecodeAutoscaleAndDeadlineOptions) {
+    StreamSim::Core::PipelineConfig config;
+    EXPECT_FALSE(config.decodeAutoscale.enabled);
+
+    std::string error;
+    ASSERT_TRUE(StreamSim::Core::ApplyPipelineOption(config, "decode.autoscale", "on", error)) << error;
+    ASSERT_TRUE(StreamSim::Core::ApplyPipelineOption(config, "decode.min_threads", "2", error)) << error;
+    ASSERT_TRUE(StreamSim::Core::ApplyPipelineOption(config, "decode.scale_interval_ms", "50", error)) << error;
+    ASSERT_TRUE(StreamSim::Core::ApplyPipelineOption(config, "decode.scale_up_depth", "4", error)) << error;
+    ASSERT_TRUE(StreamSim::Core::ApplyPipelineOption(config, "decode.scale_up_wait_ms", "0", error)) << error;
+    EXPECT_TRUE(config.decodeAutoscale.enabled);
+    EXPECT_EQ(config.decodeAutoscale.minWorkers, 2);
+    EXPECT_EQ(config.decodeAutoscale.interval, std::chrono::milliseconds(50));
+    EXPECT_EQ(config.decodeAutoscale.scaleUpDepth, 4);
+    EXPECT_EQ(config.decodeAutoscale.scaleUpWait.count(), 0);
+
+    EXPECT_FALSE(StreamSim::Core::ApplyPipelineOption(config, "decode.autoscale", "maybe", error));
+    EXPECT_FALSE(StreamSim::Core::ApplyPipelineOption(config, "decode.min_threads", "0", error));
+    EXPECT_FALSE(StreamSim::Core::ApplyPipelineOption(config, "decode.scale_interval_ms", "0", error));
+
+    ASSERT_TRUE(StreamSim::Core::ApplyPipelineOption(config, "frame_deadline_ms", "0", error)) << error;
+    EXPECT_EQ(config.frameDeadline.count(), 0);
+
+    ASSERT_TRUE(StreamSim::Core::ApplyPipelineOption(config, "decode.pool_policy", "drop_oldest", error)) << error;
+    EXPECT_EQ(config.decodePoolPolicy, StreamSim::Core::AdmissionPolicy::DropOldest);
+    EXPECT_FALSE(StreamSim::Core::ApplyPipelineOption(config, "decode.pool_policy", "drop", error));
+
+    const std::string text = StreamSim::Core::FormatPipelineConfig(config);
+    EXPECT_NE(text.find("frame_deadline_ms = 0\n"), std::string::npos);
+    EXPECT_NE(text.find("decode.autoscale = on\n"), std::string::npos);
+    EXPECT_NE(text.find("decode.min_threads = 2\n"), std::string::npos);
+    EXPECT_NE(text.find("decode.pool_policy = drop_oldest\n"), std::string::npos);
+}
+
+TEST(PipelineConfigTest, LoadFileReportsBadLine) {
+    const std::string path = WriteConfigFile("pipeline_config_bad.conf", "decode.threads = 2\ndecode.thread = 3\n");
+
+    StreamSim::Core::PipelineConfig config;
+    std::string error;
+    EXPECT_FALSE(StreamSim::Core::LoadPipelineConfig(path, config, error));
+    EXPECT_NE(error.find(":2: unknown option 'decode.thread'"), std::string::npos) << error;
+    std::remove(path.c_str());
+
+    EXPECT_FALSE(StreamSim::Core::LoadPipelineConfig(::testing::TempDir() + "no_such_config.conf", config, error));
+}
+
+TEST(PipelineConfigTest, RejectsBadValues) {
+    StreamSim::Core::PipelineConfig config;
+    std::string error;
+    EXPECT_FALSE(StreamSim::Core::ApplyPipelineOption(config, "decode.threads", "0", error));
+    EXPECT_FALSE(StreamSim::Core::ApplyPipelineOption(config, "decode.threads", "four", error));
+    EXPECT_FALSE(StreamSim::Core::ApplyPipelineOption(config, "decode_queue.capacity", "-1", error));
+    EXPECT_FALSE(StreamSim::Core::ApplyPipelineOption(config, "render.cpus", "3-1", error));
+    EXPECT_FALSE(StreamSim::Core::ApplyPipelineOption(config, "decode.pinning", "tight", error));
+    EXPECT_FALSE(StreamSim::Core::ApplyPipelineOption(config, "render.node", "-1", error));
+    EXPECT_FALSE(StreamSim::Core::ApplyPipelineOption(config, "render.mode", "vsync", error));
+    EXPECT_FALSE(StreamSim::Core::ApplyPipelineOption(config, "render.refresh_hz", "0", error));
+    EXPECT_FALSE(StreamSim::Core::ApplyPipelineOption(config, "executor.threads", "0", error));
+    EXPECT_FALSE(StreamSim::Core::ApplyPipelineOption(config, "executor.capacity", "8", error));
+    EXPECT_FALSE(StreamSim::Core::ApplyPipelineOption(config, "decode_queue.size", "8", error));
+    EXPECT_EQ(error, "unknown option 'decode_queue.size'");
+    EXPECT_EQ(config.numDecoderThreads, 4);
+}
+
+TEST(PipelineConfigTest, ParseArgsKeepsOtherArguments) {
+    std::vector<std::string> args = { "demo", "--decode.threads=3", "replay", "--ingest.cpus=2,4-5", "capture.bin" };
+    std::vector<char*> argv;
+    for (auto& arg : args) {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+    int argc = static_cast<int>(args.size());
+
+    StreamSim::Core::PipelineConfig config;
+    std::string error;
+    ASSERT_TRUE(StreamSim::Core::ParsePipelineArgs(argc, argv.data(), config, error)) << error;
+    EXPECT_EQ(config.numDecoderThreads, 3);
+    EXPECT_EQ(config.ingestPlacement.cpus, (StreamSim::Core::CpuSet{ 2, 4, 5 }));
+
+    ASSERT_EQ(argc, 3);
+    EXPECT_STREQ(argv[1], "replay");
+    EXPECT_STREQ(argv[2], "capture.bin");
+    EXPECT_EQ(argv[3], nullptr);
+}
+
+TEST(PipelineConfigTest, FormatLoadsBackTheSameConfig) {
+    StreamSim::Core::PipelineConfig config;
+    config.numIngestThreads = 1;
+    config.decodePlacement.cpus = { 0, 1, 2, 7 };
+    config.decodePlacement.policy = StreamSim::Core::PinningPolicy::Compact;
+    config.ingestPlacement.node = 0;
+    config.renderQueue.capacity = 16;
+    config.decodeQueue.wait.spinCount = 0;
+    config.numExecutorThreads = 3;
+    config.renderMode = StreamSim::Render::RenderMode::Paced;
+    config.renderRefreshRateHz = 30;
+    config.executorPlacement.cpus = { 4, 5 };
+
+    const std::string path = WriteConfigFile("pipeline_config_roundtrip.conf", StreamSim::Core::FormatPipelineConfig(config));
+    StreamSim::Core::PipelineConfig loaded;
+    std::string error;
+    ASSERT_TRUE(StreamSim::Core::LoadPipelineConfig(path, loaded, error)) << error;
+    EXPECT_EQ(StreamSim::Core::FormatPipelineConfig(loaded), StreamSim::Core::FormatPipelineConfig(config));
+    std::remove(path.c_str());
+}
@@ -17,3 +17,164 @@ TEST(ProtocolServiceTest, DemoPooledProtocolServiceTest) {
 
     EXPECT_EQ(service.GetNumDecodedBufferElements(), 0);
 }
+
+TEST(ProtocolServiceTest, DemoPooledWorkStealingProtocolServiceTest) {
+    StreamSim::Net::DemoProtocolServicePooled service(4, 1, StreamSim::Core::DecodePoolType::WorkStealing);
+    service.Run();
+    service.Shutdown();
+
+    EXPECT_EQ(service.GetNumDecodedBufferElements(), 0);
+}
+
+TEST(ProtocolServiceTest, DemoMultiStreamProtocolServiceTest) {
+    StreamSim::Net::DemoProtocolServiceMultiStream service(3, 1, { 1, 2, 1 });
+    service.Run();
+    service.Shutdown();
+
+    EXPECT_EQ(service.GetNumDecodeBufferElements(), 0);
+    for (uint32_t streamId = 0; streamId < 3; ++streamId) {
+        EXPECT_EQ(service.GetNumDecodedBufferElements(streamId), 0);
+    }
+}
+
+TEST(ProtocolServiceTest, CoroutineServiceRunsManyStreamsOnFewThreads) {
+    StreamSim::Core::PipelineConfig config;
+    config.runTimeSec = 1;
+    config.numIngestThreads = 64;
+    config.numExecutorThreads = 2;
+    config.decodeQueue.capacity = 8;
+    config.renderQueue.capacity = 8;
+    // Nothing is dropped, so every frame sent has to come out.
+    config.frameDeadline = std::chrono::milliseconds(0);
+    StreamSim::Net::LoadProfile profile;
+    profile.framesPerSec = 50;
+
+    StreamSim::Render::ChecksumRenderSink sink;
+    StreamSim::Net::DemoProtocolServiceCoroutine service(config, &sink);
+    service.SetLoadProfile(profile);
+    ASSERT_TRUE(service.Run());
+    service.Shutdown();
+
+    // 50 frames from each stream in the second, in display order and with their payload.
+    EXPECT_EQ(sink.NumFrames(), 64 * 50);
+    EXPECT_EQ(sink.NumOutOfOrder(), 0);
+    EXPECT_EQ(sink.NumEmptyPayloads(), 0);
+    for (uint32_t streamId = 0; streamId < 64; ++streamId) {
+        EXPECT_EQ(service.GetNumDecodeBufferElements(streamId), 0);
+        EXPECT_EQ(service.GetNumDecodedBufferElements(streamId), 0);
+    }
+
+    auto stats = service.GetStats();
+    EXPECT_EQ(stats.render.framesPresented, sink.NumFrames());
+    EXPECT_EQ(stats.endToEnd.count, sink.NumFrames());
+    EXPECT_EQ(stats.decode.count, sink.NumFrames());
+    EXPECT_EQ(stats.drops.Total(), 0);
+    EXPECT_LE(stats.decodeQueue.maxDepth, 8);
+
+    // Every stage of every stream ran to its end.
+    auto executorStats = service.GetExecutorStats();
+    EXPECT_EQ(executorStats.tasks, 0);
+    EXPECT_GT(executorStats.resumes, 3 * 64);
+}
+
+TEST(ProtocolServiceTest, ServicesTakePipelineConfig) {
+    StreamSim::Core::PipelineConfig config;
+    config.runTimeSec = 1;
+    config.numIngestThreads = 2;
+    config.numDecoderThreads = 2;
+    config.decodeQueue.capacity = 64;
+    config.renderQueue.capacity = 64;
+
+    StreamSim::Render::ChecksumRenderSink sink;
+    StreamSim::Net::DemoProtocolServiceQueued queued(config, StreamSim::Net::IngestSource::Simulated,
+                                                     StreamSim::Net::DEFAULT_UDP_PORT, &sink);
+    queued.Run();
+    queued.Shutdown();
+    EXPECT_GT(sink.NumFrames(), 0);
+    EXPECT_EQ(sink.NumOutOfOrder(), 0);
+    EXPECT_EQ(queued.GetNumDecodeBufferElements(), 0);
+
+    config.decodePoolCapacity = 16;
+    config.renderMode = StreamSim::Render::RenderMode::Paced;
+    config.renderRefreshRateHz = 120;
+    StreamSim::Render::NullRenderSink nullSink;
+    StreamSim::Net::DemoProtocolServicePooled pooled(config, StreamSim::Core::DecodePoolType::Simple, &nullSink);
+    pooled.Run();
+    pooled.Shutdown();
+    EXPECT_GT(pooled.GetStats().decode.count, 0);
+    // Paced, so the renderer ticked at the refresh rate instead of showing frames as they came.
+    EXPECT_GT(pooled.GetStats().render.vsyncs, 0);
+    EXPECT_GT(nullSink.NumFrames(), 0);
+}
+
+TEST(ProtocolServiceTest, QueuedServiceRendersIntactFrames) {
+    StreamSim::Render::ChecksumRenderSink sink;
+    StreamSim::Net::DemoProtocolServiceQueued service(4, 1, StreamSim::Net::IngestSource::Simulated,
+                                                      StreamSim::Net::DEFAULT_UDP_PORT, &sink);
+    service.Run();
+    service.Shutdown();
+
+    // Every frame came out in display order with its payload.
+    EXPECT_GT(sink.NumFrames(), 0);
+    EXPECT_EQ(sink.NumOutOfOrder(), 0);
+    EXPECT_EQ(sink.NumEmptyPayloads(), 0);
+}
+
+TEST(ProtocolServiceTest, QueuedServiceReportsStageLatencies) {
+    StreamSim::Render::NullRenderSink sink;
+    StreamSim::Net::DemoProtocolServiceQueued service(4, 1, StreamSim::Net::IngestSource::Simulated,
+                                                      StreamSim::Net::DEFAULT_UDP_PORT, &sink);
+    service.Run();
+    service.Shutdown();
+
+    auto stats = service.GetStats();
+    EXPECT_GT(stats.endToEnd.count, 0);
+    EXPECT_EQ(stats.endToEnd.count, sink.NumFrames());
+    EXPECT_EQ(stats.render.framesPresented, sink.NumFrames());
+    EXPECT_GE(stats.decode.count, stats.endToEnd.count);
+    EXPECT_EQ(stats.queueWait.count, stats.decode.count);
+
+    // Every frame spends some time in the decode kernels, and no stage can take longer than the whole pipeline.
+    EXPECT_GT(stats.decode.minNs, 0);
+    EXPECT_LE(stats.decode.minNs, stats.endToEnd.maxNs);
+    EXPECT_LE(stats.endToEnd.p50Ns, stats.endToEnd.p99Ns);
+    EXPECT_GE(stats.endToEnd.maxNs, stats.decode.minNs);
+    EXPECT_GT(stats.decodeQueue.maxDepth, 0);
+    EXPECT_EQ(stats.decodeQueue.depth, 0);
+}
+
+TEST(ProtocolServiceTest, QueuedServiceReplaysRecordedCapture) {
+    const std::string path = testing::TempDir() + "protocol_service_capture.bin";
+    {
+        StreamSim::Render::NullRenderSink sink;
+        StreamSim::Net::DemoProtocolServiceQueued service(2, 1, StreamSim::Net::IngestSource::Simulated,
+                                                          StreamSim::Net::DEFAULT_UDP_PORT, &sink);
+        ASSERT_TRUE(service.RecordCapture(path));
+        service.Run();
+        service.Shutdown();
+    }
+
+    auto capture = std::make_shared<StreamSim::Net::FrameCaptureReader>(path);
+    ASSERT_TRUE(capture->IsOpen());
+    EXPECT_GT(capture->NumFrames(), 0);
+
+    StreamSim::Net::LoadProfile profile;
+    profile.arrival = StreamSim::Net::ArrivalProcess::Replay;
+    profile.capture = capture;
+
+    // Payloads straight from the capture's mapping make it all the way through.
+    StreamSim::Render::ChecksumRenderSink sink;
+    {
+        StreamSim::Net::DemoProtocolServiceQueued service(2, 2, StreamSim::Net::IngestSource::Simulated,
+                                                          StreamSim::Net::DEFAULT_UDP_PORT, &sink);
+        service.SetLoadProfile(profile);
+        service.Run();
+        service.Shutdown();
+    }
+    EXPECT_GT(sink.NumFrames(), 0);
+    EXPECT_EQ(sink.NumOutOfOrder(), 0);
+    EXPECT_EQ(sink.NumEmptyPayloads(), 0);
+
+    capture.reset();
+    std::remove(path.c_str());
+}
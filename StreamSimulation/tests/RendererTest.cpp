@@ -1,4 +1,8 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
 #include <StreamRenderer.hpp>
 
 TEST(ProtocolServiceTest, DemoProtocolServiceTest) {
@@ -25,4 +29,218 @@ TEST(ProtocolServiceTest, DemoProtocolServiceTest) {
     std::string output = testing::internal::GetCapturedStdout();
 
     EXPECT_EQ("a\nb\nc\nd\n", output);
-}
\ No newline at end of file
+}
+
+TEST(ProtocolServiceTest, SpscQueueRenderTest) {
+    testing::internal::CaptureStdout();
+    auto bufferQueue = StreamSim::Core::MakeByteFrameQueue(StreamSim::Core::FrameQueueType::SingleProducerSingleConsumer);
+    StreamSim::Render::FrameElementRenderHandler renderHandler(bufferQueue.get());
+
+    StreamSim::Core::ByteFrameElement frame;
+    renderHandler.Run();
+
+    frame.data = 'a';
+    bufferQueue->WriteSync(frame);
+    frame.data = 'b';
+    bufferQueue->WriteSync(frame);
+    frame.data = 'c';
+    bufferQueue->WriteSync(frame);
+
+    bufferQueue->Close();
+    renderHandler.Shutdown();
+
+    std::string output = testing::internal::GetCapturedStdout();
+
+    EXPECT_EQ("a\nb\nc\n", output);
+}
+
+TEST(ProtocolServiceTest, PacedRenderPresentsNewestDueFrame) {
+    testing::internal::CaptureStdout();
+    StreamSim::Core::AsyncByteFrameQueue bufferQueue;
+    // 20ms per refresh.
+    StreamSim::Render::FrameElementRenderHandler renderHandler(&bufferQueue, StreamSim::Render::RenderMode::Paced, 50);
+
+    // 'a' is shown on the first vsync, 'b' to 'd' are all due by the second one and only 'd' is worth showing.
+    StreamSim::Core::ByteFrameElement frame;
+    const char values[] = {'a', 'b', 'c', 'd'};
+    for (uint64_t i = 0; i < 4; ++i) {
+        frame.data = values[i];
+        frame.meta.displayOrder = i;
+        frame.meta.timestampUs = 1000000 + i * 5000;
+        bufferQueue.WriteSync(frame);
+    }
+
+    renderHandler.Run();
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    bufferQueue.Close();
+    renderHandler.Shutdown();
+
+    std::string output = testing::internal::GetCapturedStdout();
+    EXPECT_EQ("a\nd\n", output);
+
+    auto stats = renderHandler.GetStats();
+    EXPECT_EQ(stats.framesPresented, 2);
+    EXPECT_EQ(stats.framesDropped, 2);
+    // Nothing new after 'd', the screen keeps showing it.
+    EXPECT_GE(stats.framesDuplicated, 2);
+    EXPECT_EQ(stats.vsyncs, stats.framesPresented - 1 + stats.framesDuplicated);
+    EXPECT_LT(stats.meanPresentJitterUs, 20000);
+}
+
+TEST(ProtocolServiceTest, PacedRenderKeepsFramesUntilDue) {
+    testing::internal::CaptureStdout();
+    StreamSim::Core::AsyncByteFrameQueue bufferQueue;
+    StreamSim::Render::FrameElementRenderHandler renderHandler(&bufferQueue, StreamSim::Render::RenderMode::Paced, 100);
+
+    // One frame per 30ms at 100Hz, each one is shown on its own vsync and none is dropped.
+    StreamSim::Core::ByteFrameElement frame;
+    for (uint64_t i = 0; i < 3; ++i) {
+        frame.data = static_cast<uint8_t>('a' + i);
+        frame.meta.timestampUs = i * 30000;
+        bufferQueue.WriteSync(frame);
+    }
+
+    renderHandler.Run();
+    bufferQueue.Close();
+    renderHandler.Shutdown();
+
+    std::string output = testing::internal::GetCapturedStdout();
+    EXPECT_EQ("a\nb\nc\n", output);
+
+    auto stats = renderHandler.GetStats();
+    EXPECT_EQ(stats.framesPresented, 3);
+    EXPECT_EQ(stats.framesDropped, 0);
+    EXPECT_GE(stats.framesDuplicated, 4);
+}
+
+TEST(ProtocolServiceTest, RenderDiscardsExpiredFrames) {
+    testing::internal::CaptureStdout();
+    StreamSim::Core::AsyncByteFrameQueue bufferQueue;
+    StreamSim::Render::FrameElementRenderHandler renderHandler(&bufferQueue);
+
+    // 'a' has no deadline, 'b' missed it, 'c' has plenty of time left and 'd' was given up on by the decoder.
+    const uint64_t nowNs = StreamSim::Core::PipelineNowNs();
+    StreamSim::Core::ByteFrameElement frame;
+    frame.data = 'a';
+    bufferQueue.WriteSync(frame);
+    frame.data = 'b';
+    frame.meta.deadlineNs = nowNs - 1000000;
+    bufferQueue.WriteSync(frame);
+    frame.data = 'c';
+    frame.meta.deadlineNs = nowNs + 60000000000ull;
+    bufferQueue.WriteSync(frame);
+    frame.data = 'd';
+    frame.meta.isExpired = true;
+    bufferQueue.WriteSync(frame);
+
+    renderHandler.Run();
+    bufferQueue.Close();
+    renderHandler.Shutdown();
+
+    EXPECT_EQ("a\nc\n", testing::internal::GetCapturedStdout());
+    auto stats = renderHandler.GetStats();
+    EXPECT_EQ(stats.framesPresented, 2);
+    // The decoder counts the frames it gave up on, only 'b' is on the renderer.
+    EXPECT_EQ(stats.framesExpired, 1);
+}
+
+TEST(RenderSinkTest, NullSinkCountsFrames) {
+    StreamSim::Core::AsyncByteFrameQueue bufferQueue;
+    StreamSim::Render::NullRenderSink sink;
+    StreamSim::Render::FrameElementRenderHandler renderHandler(&bufferQueue, StreamSim::Render::RenderMode::Immediate,
+                                                               StreamSim::Render::DEFAULT_REFRESH_RATE_HZ, &sink);
+
+    testing::internal::CaptureStdout();
+    renderHandler.Run();
+    StreamSim::Core::ByteFrameElement frame;
+    for (int i = 0; i < 100; ++i) {
+        frame.data = 'x';
+        bufferQueue.WriteSync(frame);
+    }
+    bufferQueue.Close();
+    renderHandler.Shutdown();
+
+    EXPECT_EQ(sink.NumFrames(), 100);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "");
+}
+
+TEST(RenderSinkTest, ChecksumSinkVerifiesFrames) {
+    StreamSim::Core::FrameBufferPool pool;
+    auto makeFrame = [&](uint64_t displayOrder, uint8_t fill) {
+        StreamSim::Core::ByteFrameElement frame;
+        frame.data = fill;
+        frame.meta.displayOrder = displayOrder;
+        frame.payload = pool.Acquire(64);
+        std::fill(frame.payload.Data(), frame.payload.Data() + frame.payload.Size(), fill);
+        return frame;
+    };
+
+    StreamSim::Render::ChecksumRenderSink first;
+    StreamSim::Render::ChecksumRenderSink second;
+    StreamSim::Render::ChecksumRenderSink corrupted;
+    for (uint64_t i = 0; i < 4; ++i) {
+        auto frame = makeFrame(i, static_cast<uint8_t>(i));
+        first.Present(frame);
+        second.Present(frame);
+        if (i == 2) {
+            frame.payload.Data()[10] ^= 1;
+        }
+        corrupted.Present(frame);
+    }
+
+    EXPECT_EQ(first.NumFrames(), 4);
+    EXPECT_EQ(first.GetDigest(), second.GetDigest());
+    EXPECT_NE(first.GetDigest(), corrupted.GetDigest());
+    EXPECT_EQ(first.NumOutOfOrder(), 0);
+    EXPECT_EQ(first.NumEmptyPayloads(), 0);
+
+    // Going back in display order or losing the payload is caught.
+    first.Present(makeFrame(1, 1));
+    StreamSim::Core::ByteFrameElement empty;
+    empty.meta.displayOrder = 9;
+    first.Present(empty);
+    EXPECT_EQ(first.NumOutOfOrder(), 1);
+    EXPECT_EQ(first.NumEmptyPayloads(), 1);
+}
+
+TEST(RenderSinkTest, AsyncFileSinkWritesEveryFrame) {
+    const std::string path = testing::TempDir() + "async_file_render_sink.txt";
+    StreamSim::Core::SpscByteFrameQueue bufferQueue;
+    const std::size_t numFrames = 10000;
+    {
+        StreamSim::Render::AsyncFileRenderSink sink(path);
+        ASSERT_TRUE(sink.IsOpen());
+        StreamSim::Render::FrameElementRenderHandler renderHandler(&bufferQueue, StreamSim::Render::RenderMode::Immediate,
+                                                                   StreamSim::Render::DEFAULT_REFRESH_RATE_HZ, &sink);
+        renderHandler.Run();
+
+        StreamSim::Core::ByteFrameElement frame;
+        for (std::size_t i = 0; i < numFrames; ++i) {
+            frame.data = static_cast<uint8_t>(i);
+            frame.meta.displayOrder = i;
+            bufferQueue.WriteSync(frame);
+        }
+        bufferQueue.Close();
+        renderHandler.Shutdown();
+
+        // The renderer flushed the sink on its way out.
+        EXPECT_EQ(sink.NumFramesWritten(), numFrames);
+    }
+
+    std::ifstream file(path);
+    std::string line;
+    std::size_t numLines = 0;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        uint32_t streamId = 0;
+        uint64_t displayOrder = 0;
+        uint64_t sequence = 0;
+        uint32_t value = 0;
+        fields >> streamId >> displayOrder >> sequence >> value;
+        EXPECT_EQ(displayOrder, numLines);
+        EXPECT_EQ(value, numLines % 256);
+        ++numLines;
+    }
+    EXPECT_EQ(numLines, numFrames);
+    std::remove(path.c_str());
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <FrameData.hpp>
+#include <GopScheduler.hpp>
+
+namespace StreamSim::Test {
+
+// What a test frame looks like apart from its sequence, anything not set stays at its default.
+struct TestFrameOptions {
+    uint32_t streamId = 0;
+    uint64_t timestampUs = 0;
+    // Type, references and display order of that sequence in a default DescribeGopFrame GOP.
+    bool isGopFrame = false;
+};
+
+// The frame every test builds its input from.  data is the low byte of the sequence, and unless it's a GOP
+// frame it's displayed in sequence order.
+inline Core::ByteFrameElement MakeTestFrame(uint64_t sequence, TestFrameOptions options = {}) {
+    Core::ByteFrameElement frame;
+    frame.data = static_cast<uint8_t>(sequence);
+    frame.meta.streamId = options.streamId;
+    frame.meta.sequence = sequence;
+    frame.meta.displayOrder = sequence;
+    frame.meta.timestampUs = options.timestampUs;
+    if (options.isGopFrame) {
+        Core::DescribeGopFrame(frame.meta);
+    }
+    return frame;
+}
+
+}
@@ -1,6 +1,14 @@
 #include <gtest/gtest.h>
 #include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+#include "InplaceTask.hpp"
 #include "ThreadPool.hpp" 
+#include "WorkStealingThreadPool.hpp"
 
 void SomeWorkTask(int& counter) {
     std::this_thread::sleep_for(std::chrono::milliseconds(50));
@@ -51,3 +59,443 @@ TEST(SimpleThreadPoolTest, StopPool) {
 
     EXPECT_EQ(counter, 2);
 }
+
+// Occupies the single worker of a pool until the returned promise is set.
+static std::promise<void> BlockWorker(StreamSim::Core::SimpleThreadPool<std::function<void()>, 1>& pool) {
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    auto started = std::make_shared<std::promise<void>>();
+    auto isStarted = started->get_future();
+    pool.Enqueue([released, started]() {
+        started->set_value();
+        released.wait();
+    });
+    isStarted.wait();
+    return release;
+}
+
+TEST(SimpleThreadPoolTest, RejectWhenFull) {
+    StreamSim::Core::SimpleThreadPool<std::function<void()>, 1> pool(StreamSim::Core::AdmissionPolicy::Reject);
+    auto release = BlockWorker(pool);
+
+    int counter = 0;
+    EXPECT_EQ(pool.Enqueue([&counter]() { counter += 1; }), StreamSim::Core::EnqueueStatus::Accepted);
+    EXPECT_EQ(pool.Enqueue([&counter]() { counter += 10; }), StreamSim::Core::EnqueueStatus::Rejected);
+
+    release.set_value();
+    pool.Stop();
+
+    EXPECT_EQ(counter, 1);
+    auto stats = pool.GetAdmissionStats();
+    EXPECT_EQ(stats.accepted, 2);
+    EXPECT_EQ(stats.rejected, 1);
+}
+
+TEST(SimpleThreadPoolTest, DropOldestWhenFull) {
+    StreamSim::Core::SimpleThreadPool<std::function<void()>, 1> pool(StreamSim::Core::AdmissionPolicy::DropOldest);
+    auto release = BlockWorker(pool);
+
+    int counter = 0;
+    EXPECT_EQ(pool.Enqueue([&counter]() { counter += 1; }), StreamSim::Core::EnqueueStatus::Accepted);
+    EXPECT_EQ(pool.Enqueue([&counter]() { counter += 10; }), StreamSim::Core::EnqueueStatus::DroppedOldest);
+    EXPECT_EQ(pool.GetAdmissionStats().queued, 1);
+
+    release.set_value();
+    pool.Stop();
+
+    EXPECT_EQ(counter, 10);
+    auto stats = pool.GetAdmissionStats();
+    EXPECT_EQ(stats.droppedOldest, 1);
+    EXPECT_EQ(stats.queued, 0);
+    EXPECT_EQ(stats.maxQueued, 1);
+}
+
+TEST(SimpleThreadPoolTest, DropNewestWhenFull) {
+    StreamSim::Core::SimpleThreadPool<std::function<void()>, 1> pool(StreamSim::Core::AdmissionPolicy::DropNewest);
+    auto release = BlockWorker(pool);
+
+    int counter = 0;
+    EXPECT_EQ(pool.Enqueue([&counter]() { counter += 1; }), StreamSim::Core::EnqueueStatus::Accepted);
+    EXPECT_EQ(pool.Enqueue([&counter]() { counter += 10; }), StreamSim::Core::EnqueueStatus::DroppedNewest);
+
+    release.set_value();
+    pool.Stop();
+
+    EXPECT_EQ(counter, 1);
+    EXPECT_EQ(pool.GetAdmissionStats().droppedNewest, 1);
+}
+
+namespace {
+    struct DeadlineTask {
+        uint64_t deadlineNs;
+        std::function<void()> function;
+
+        void operator()() {
+            function();
+        }
+
+        uint64_t DeadlineNs() const {
+            return deadlineNs;
+        }
+    };
+}
+
+TEST(SimpleThreadPoolTest, DroppedTasksAreDiscarded) {
+    struct DiscardableTask {
+        std::atomic<int>* numRun;
+        std::atomic<int>* numDiscarded;
+        std::shared_future<void> released;
+
+        void operator()() {
+            released.wait();
+            numRun->fetch_add(1);
+        }
+        void Discard() {
+            numDiscarded->fetch_add(1);
+        }
+    };
+
+    for (auto policy : { StreamSim::Core::AdmissionPolicy::DropOldest, StreamSim::Core::AdmissionPolicy::DropNewest,
+                         StreamSim::Core::AdmissionPolicy::Reject }) {
+        std::atomic<int> numRun{0};
+        std::atomic<int> numDiscarded{0};
+        std::promise<void> release;
+        std::shared_future<void> released = release.get_future().share();
+        {
+            StreamSim::Core::SimpleThreadPool<DiscardableTask, 1> pool(policy, 1, 1);
+            // One running, one waiting, and the third doesn't fit.
+            pool.Enqueue(DiscardableTask{ &numRun, &numDiscarded, released });
+            while (pool.GetAdmissionStats().queued != 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            pool.Enqueue(DiscardableTask{ &numRun, &numDiscarded, released });
+            pool.Enqueue(DiscardableTask{ &numRun, &numDiscarded, released });
+            EXPECT_EQ(numDiscarded.load(), 1);
+
+            release.set_value();
+            pool.Stop();
+        }
+        EXPECT_EQ(numRun.load(), 2);
+        EXPECT_EQ(numDiscarded.load(), 1);
+    }
+}
+
+TEST(SimpleThreadPoolTest, EarliestDeadlineFirst) {
+    StreamSim::Core::SimpleThreadPool<DeadlineTask, 1> pool(StreamSim::Core::AdmissionPolicy::Block, 1, 8);
+
+    // Hold the only worker so the queue fills up in an order different from the deadlines.
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::promise<void> started;
+    pool.Enqueue(DeadlineTask{0, [&started, released]() {
+        started.set_value();
+        released.wait();
+    }});
+    started.get_future().wait();
+
+    std::vector<int> order;
+    for (auto [deadlineNs, id] : { std::pair<uint64_t, int>{300, 3}, {0, 5}, {100, 1}, {300, 4}, {200, 2} }) {
+        pool.Enqueue(DeadlineTask{deadlineNs, [&order, id = id]() { order.push_back(id); }});
+    }
+
+    release.set_value();
+    pool.Stop();
+
+    // Equal deadlines keep their order, and no deadline goes last.
+    EXPECT_EQ(order, (std::vector<int>{ 1, 2, 3, 4, 5 }));
+}
+
+TEST(SimpleThreadPoolTest, DropOldestDropsEarliestDeadline) {
+    StreamSim::Core::SimpleThreadPool<DeadlineTask, 1> pool(StreamSim::Core::AdmissionPolicy::DropOldest, 1, 2);
+
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::promise<void> started;
+    pool.Enqueue(DeadlineTask{0, [&started, released]() {
+        started.set_value();
+        released.wait();
+    }});
+    started.get_future().wait();
+
+    std::vector<int> order;
+    pool.Enqueue(DeadlineTask{200, [&order]() { order.push_back(2); }});
+    pool.Enqueue(DeadlineTask{100, [&order]() { order.push_back(1); }});
+    // Full, the task closest to its deadline goes.
+    EXPECT_EQ(pool.Enqueue(DeadlineTask{300, [&order]() { order.push_back(3); }}), StreamSim::Core::EnqueueStatus::DroppedOldest);
+
+    release.set_value();
+    pool.Stop();
+    EXPECT_EQ(order, (std::vector<int>{ 2, 3 }));
+}
+
+TEST(SimpleThreadPoolTest, BlockUntilSpaceOrStop) {
+    StreamSim::Core::SimpleThreadPool<std::function<void()>, 1> pool(StreamSim::Core::AdmissionPolicy::Block);
+    auto release = BlockWorker(pool);
+
+    std::atomic<int> counter = 0;
+    EXPECT_EQ(pool.Enqueue([&counter]() { counter += 1; }), StreamSim::Core::EnqueueStatus::Accepted);
+
+    std::thread producer([&pool, &counter]() {
+        EXPECT_EQ(pool.Enqueue([&counter]() { counter += 10; }), StreamSim::Core::EnqueueStatus::Accepted);
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(pool.GetAdmissionStats().blocked, 1);
+
+    release.set_value();
+    producer.join();
+    pool.Stop();
+
+    EXPECT_EQ(counter.load(), 11);
+    EXPECT_EQ(pool.Enqueue([&counter]() { counter += 100; }), StreamSim::Core::EnqueueStatus::Stopped);
+}
+
+TEST(SimpleThreadPoolTest, RuntimeThreadsAndCapacity) {
+    StreamSim::Core::SimpleThreadPool<std::function<void()>, 1> pool(StreamSim::Core::AdmissionPolicy::Reject, 3, 8);
+    EXPECT_EQ(pool.NumThreads(), 3);
+    EXPECT_EQ(pool.Capacity(), 8);
+
+    std::size_t numWorkers = 0;
+    pool.ForEachWorker([&numWorkers](std::thread& worker) {
+        EXPECT_TRUE(worker.joinable());
+        ++numWorkers;
+    });
+    EXPECT_EQ(numWorkers, 3);
+
+    // All three workers run at the same time, which a single threaded pool couldn't do.
+    std::atomic<int> running = 0;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    for (int i = 0; i < 3; ++i) {
+        pool.Enqueue([&running, released]() {
+            ++running;
+            released.wait();
+        });
+    }
+    for (int i = 0; i < 100 && running.load() < 3; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(running.load(), 3);
+
+    release.set_value();
+    pool.Stop();
+}
+
+TEST(SimpleThreadPoolTest, ParkedThreadsTakeNoTasks) {
+    StreamSim::Core::SimpleThreadPool<std::function<void()>, 1> pool(StreamSim::Core::AdmissionPolicy::Block, 3, 16);
+    pool.SetNumActiveThreads(1);
+    EXPECT_EQ(pool.NumActiveThreads(), 1);
+
+    // With one active worker, no two tasks ever run at once.
+    std::atomic<int> running = 0;
+    std::atomic<int> maxRunning = 0;
+    std::atomic<int> done = 0;
+    auto task = [&]() {
+        const int now = ++running;
+        maxRunning.store(std::max(maxRunning.load(), now));
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        --running;
+        ++done;
+    };
+    for (int i = 0; i < 10; ++i) {
+        pool.Enqueue(task);
+    }
+    for (int i = 0; i < 200 && done.load() < 10; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(done.load(), 10);
+    EXPECT_EQ(maxRunning.load(), 1);
+
+    // Activated again, all three run side by side.
+    pool.SetNumActiveThreads(5);
+    EXPECT_EQ(pool.NumActiveThreads(), 3);
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic<int> blocked = 0;
+    for (int i = 0; i < 3; ++i) {
+        pool.Enqueue([&blocked, released]() {
+            ++blocked;
+            released.wait();
+        });
+    }
+    for (int i = 0; i < 100 && blocked.load() < 3; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(blocked.load(), 3);
+
+    release.set_value();
+    pool.SetNumActiveThreads(0);
+    EXPECT_EQ(pool.NumActiveThreads(), 1);
+    pool.Stop();
+}
+
+TEST(InplaceTaskTest, InvokeMoveAndDestroy) {
+    auto destroyed = std::make_shared<int>(0);
+    struct Tracker {
+        std::shared_ptr<int> destroyed;
+        int* counter;
+        Tracker(std::shared_ptr<int> d, int* c) : destroyed(std::move(d)), counter(c) {}
+        Tracker(Tracker&& other) noexcept = default;
+        ~Tracker() {
+            if (destroyed) {
+                ++*destroyed;
+            }
+        }
+        void operator()() { ++*counter; }
+    };
+
+    int counter = 0;
+    {
+        StreamSim::Core::InplaceTask<64> task(Tracker(destroyed, &counter));
+        EXPECT_TRUE(static_cast<bool>(task));
+        task();
+
+        StreamSim::Core::InplaceTask<64> moved(std::move(task));
+        EXPECT_FALSE(static_cast<bool>(task));
+        moved();
+
+        StreamSim::Core::InplaceTask<64> assigned;
+        assigned = std::move(moved);
+        assigned();
+        EXPECT_EQ(*destroyed, 0);
+    }
+
+    EXPECT_EQ(counter, 3);
+    EXPECT_EQ(*destroyed, 1);
+}
+
+TEST(InplaceTaskTest, PoolMovesInplaceTasks) {
+    StreamSim::Core::SimpleThreadPool<StreamSim::Core::InplaceTask<32>, 4> pool;
+
+    std::atomic<int> counter = 0;
+    auto moveOnly = std::make_unique<int>(5);
+    pool.Enqueue([&counter, value = std::move(moveOnly)]() { counter += *value; });
+    for (int i = 0; i < 8; ++i) {
+        pool.Enqueue([&counter]() { counter++; });
+    }
+    pool.Stop();
+
+    EXPECT_EQ(counter.load(), 13);
+}
+
+TEST(InplaceTaskTest, PoolRunsInplaceTasksByDeadline) {
+    // One worker held up so the rest queue behind it and get picked by deadline.
+    StreamSim::Core::SimpleThreadPool<StreamSim::Core::InplaceTask<64>, 1> pool(StreamSim::Core::AdmissionPolicy::Block, 1, 4);
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    pool.Enqueue([released] { released.wait(); });
+
+    std::mutex orderMutex;
+    std::vector<uint64_t> order;
+    for (uint64_t deadlineNs : { 300, 100, 200 }) {
+        pool.Enqueue(StreamSim::Core::InplaceTask<64>(DeadlineTask{ deadlineNs, [&, deadlineNs] {
+            std::lock_guard<std::mutex> lock(orderMutex);
+            order.push_back(deadlineNs);
+        } }));
+    }
+    EXPECT_EQ(StreamSim::Core::InplaceTask<64>([] {}).DeadlineNs(), 0);
+
+    release.set_value();
+    pool.Stop();
+    EXPECT_EQ(order, (std::vector<uint64_t>{ 100, 200, 300 }));
+}
+
+TEST(WorkStealingThreadPoolTest, ProcessTasks) {
+    StreamSim::Core::WorkStealingThreadPool<std::function<void()>> pool(4);
+    EXPECT_EQ(pool.NumThreads(), 4);
+
+    std::atomic<int> counter = 0;
+
+    for (int i = 0; i < 1000; ++i) {
+        pool.Enqueue([&counter]() { counter++; });
+    }
+
+    // Stop runs everything that was enqueued before returning.
+    pool.Stop();
+
+    EXPECT_EQ(counter.load(), 1000);
+}
+
+TEST(WorkStealingThreadPoolTest, NestedTasksAreStolen) {
+    StreamSim::Core::WorkStealingThreadPool<std::function<void()>> pool(4);
+
+    std::mutex threadIdsMutex;
+    std::set<std::thread::id> threadIds;
+    std::atomic<int> counter = 0;
+
+    // One task fans out into many from inside a worker, so they all land on that worker's deque
+    // and the other workers can only get to them by stealing.
+    pool.Enqueue([&]() {
+        for (int i = 0; i < 64; ++i) {
+            pool.Enqueue([&]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                {
+                    std::lock_guard<std::mutex> lock(threadIdsMutex);
+                    threadIds.insert(std::this_thread::get_id());
+                }
+                counter++;
+            });
+        }
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    pool.Stop();
+
+    EXPECT_EQ(counter.load(), 64);
+    EXPECT_GT(threadIds.size(), 1);
+}
+
+TEST(WorkStealingThreadPoolTest, ManyProducers) {
+    StreamSim::Core::WorkStealingThreadPool<std::function<void()>> pool(3);
+    std::atomic<int> counter = 0;
+
+    std::vector<std::thread> producers;
+    for (int i = 0; i < 4; ++i) {
+        producers.emplace_back([&pool, &counter]() {
+            for (int j = 0; j < 5000; ++j) {
+                pool.Enqueue([&counter]() { counter++; });
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    pool.Stop();
+
+    EXPECT_EQ(counter.load(), 20000);
+}
+
+TEST(WorkStealingThreadPoolTest, WorkerRunsTasksPastTheSlotsItself) {
+    StreamSim::Core::WorkStealingThreadPool<std::function<void()>> pool(1);
+    std::atomic<int> counter = 0;
+
+    // More than the pool has slots for, the worker can't wait for one to free up since only it would free it.
+    pool.Enqueue([&]() {
+        for (int i = 0; i < 5000; ++i) {
+            pool.Enqueue([&counter]() { counter++; });
+        }
+    });
+    // Tasks enqueued after Stop are dropped, so wait for them to get in first.
+    for (int i = 0; i < 500 && counter.load() < 5000; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    pool.Stop();
+
+    EXPECT_EQ(counter.load(), 5000);
+}
+
+TEST(ChaseLevDequeTest, OwnerIsLifoStealerIsFifo) {
+    StreamSim::Core::ChaseLevDeque<int*> deque(2);
+    int values[5] = { 0, 1, 2, 3, 4 };
+    for (auto& value : values) {
+        deque.Push(&value);
+    }
+    EXPECT_EQ(deque.Size(), 5);
+
+    int* item = nullptr;
+    EXPECT_TRUE(deque.Steal(item));
+    EXPECT_EQ(*item, 0);
+    EXPECT_TRUE(deque.Pop(item));
+    EXPECT_EQ(*item, 4);
+    EXPECT_EQ(deque.Size(), 3);
+}
@@ -0,0 +1,102 @@
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <random>
+#include <vector>
+
+#include "DecodeKernels.hpp"
+#include "Decoder.hpp"
+#include "FrameData.hpp"
+#include "PipelineMetrics.hpp"
+#include "ThreadPool.hpp"
+
+namespace {
+
+using namespace StreamSim::Core;
+
+// Copies the frame over without DemoDecoder's pixel work, so all that's left is what DecoderTask adds.
+class CopyDecoder : public Decoder {
+public:
+    void DecodeFrameData(const ByteUndecodedFrame& frame, ByteFrameElement& decoded) override {
+        decoded = frame;
+    }
+};
+
+// Counts frames instead of keeping them, so the queue never fills up.
+class CountingFrameQueue : public ConcurrentBufferQueue<ByteFrameElement, 1> {
+public:
+    std::atomic<uint64_t> numWritten{0};
+
+    bool WriteSync(const ByteFrameElement&) override {
+        numWritten.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+};
+
+ByteUndecodedFrame MakeFrame(uint64_t sequence) {
+    ByteUndecodedFrame frame;
+    frame.data = static_cast<uint8_t>(sequence);
+    frame.meta.sequence = sequence;
+    frame.meta.type = FrameType::I;
+    frame.meta.ingestNs = PipelineNowNs();
+    return frame;
+}
+
+// Building and running a DecoderTask on the calling thread.
+void BM_DecoderTaskInline(benchmark::State& state) {
+    CopyDecoder decoder;
+    CountingFrameQueue queue;
+    DecodeLatencyHistograms latency;
+    const bool withLatency = state.range(0) != 0;
+
+    uint64_t sequence = 0;
+    for (auto _ : state) {
+        DecoderTask task(MakeFrame(sequence++), &decoder, &queue, withLatency ? &latency : nullptr);
+        task();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// The same task handed to the decode pool, timed until the decoded frame is written.
+void BM_DecoderTaskPooled(benchmark::State& state) {
+    CopyDecoder decoder;
+    CountingFrameQueue queue;
+    DecodeLatencyHistograms latency;
+    SimpleThreadPool<DecoderTask, DEFAULT_NUM_DECODER_THREADS> pool;
+
+    uint64_t sequence = 0;
+    for (auto _ : state) {
+        pool.Enqueue(DecoderTask(MakeFrame(sequence++), &decoder, &queue, &latency));
+        while (queue.numWritten.load(std::memory_order_acquire) < sequence) {}
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// One 4 KB payload, the load generator's default, through each decode kernel.
+void BM_DecodeKernel(benchmark::State& state) {
+    const auto type = static_cast<DecodeKernelType>(state.range(0));
+    state.SetLabel(DecodeKernelName(type));
+    if (!IsDecodeKernelSupported(type)) {
+        state.SkipWithError("not supported on this CPU");
+        return;
+    }
+
+    std::vector<uint8_t> input(4096);
+    std::vector<uint8_t> output(input.size());
+    std::mt19937 generator(0);
+    for (uint8_t& byte : input) {
+        byte = static_cast<uint8_t>(generator());
+    }
+
+    for (auto _ : state) {
+        DecodePayload(type, input.data(), output.data(), input.size());
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input.size()));
+}
+
+}
+
+BENCHMARK(BM_DecodeKernel)->ArgName("kernel")->DenseRange(0, static_cast<int>(DecodeKernelType::Avx2));
+BENCHMARK(BM_DecoderTaskInline)->ArgName("latency")->Arg(0)->Arg(1);
+BENCHMARK(BM_DecoderTaskPooled)->UseRealTime()->Unit(benchmark::kMicrosecond);
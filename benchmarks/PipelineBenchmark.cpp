@@ -0,0 +1,62 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+
+#include "ProtocolService.hpp"
+#include "RenderSink.hpp"
+
+namespace {
+
+using namespace StreamSim::Net;
+namespace Render = StreamSim::Render;
+
+constexpr std::size_t NUM_INGEST_THREADS = 4;
+constexpr uint32_t RUN_TIME_IN_SEC = 1;
+
+// Runs a whole service for RUN_TIME_IN_SEC with its output going nowhere and reports what came out
+// of the renderer: rendered frames per second, end-to-end latency and how many frames were lost
+// along the way.  One run per benchmark, the service's own stats are what's being measured.
+template <typename MakeService>
+void RunPipeline(benchmark::State& state, MakeService makeService) {
+    Render::NullRenderSink sink;
+    PipelineStats stats;
+
+    for (auto _ : state) {
+        std::unique_ptr<ProtocolService> service = makeService(&sink);
+        service->Run();
+        service->Shutdown();
+        stats = service->GetStats();
+    }
+
+    const uint64_t dropped = stats.decodeQueue.dropped + stats.renderQueue.dropped +
+                             stats.decodePool.rejected + stats.decodePool.droppedOldest +
+                             stats.decodePool.droppedNewest + stats.render.framesDropped;
+
+    state.SetItemsProcessed(static_cast<int64_t>(sink.NumFrames()));
+    state.counters["fps"] = benchmark::Counter(static_cast<double>(sink.NumFrames()), benchmark::Counter::kIsRate);
+    state.counters["e2e_p50_us"] = static_cast<double>(stats.endToEnd.p50Ns) / 1e3;
+    state.counters["e2e_p99_us"] = static_cast<double>(stats.endToEnd.p99Ns) / 1e3;
+    state.counters["decode_p99_us"] = static_cast<double>(stats.decode.p99Ns) / 1e3;
+    state.counters["dropped"] = static_cast<double>(dropped);
+}
+
+void BM_PipelineQueued(benchmark::State& state) {
+    RunPipeline(state, [](Render::RenderSink* sink) {
+        return std::make_unique<DemoProtocolServiceQueued>(NUM_INGEST_THREADS, RUN_TIME_IN_SEC, IngestSource::Simulated,
+                                                           DEFAULT_UDP_PORT, sink);
+    });
+}
+
+void BM_PipelinePooled(benchmark::State& state) {
+    const auto poolType = static_cast<StreamSim::Core::DecodePoolType>(state.range(0));
+    RunPipeline(state, [poolType](Render::RenderSink* sink) {
+        return std::make_unique<DemoProtocolServicePooled>(NUM_INGEST_THREADS, RUN_TIME_IN_SEC, poolType, sink);
+    });
+}
+
+}
+
+BENCHMARK(BM_PipelineQueued)->Iterations(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_PipelinePooled)->ArgName("pool")
+    ->Arg(static_cast<int64_t>(StreamSim::Core::DecodePoolType::Simple))
+    ->Arg(static_cast<int64_t>(StreamSim::Core::DecodePoolType::WorkStealing))
+    ->Iterations(1)->UseRealTime()->Unit(benchmark::kMillisecond);
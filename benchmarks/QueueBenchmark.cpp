@@ -0,0 +1,84 @@
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "FrameData.hpp"
+
+namespace {
+
+using namespace StreamSim::Core;
+
+constexpr std::size_t FRAMES_PER_ITERATION = 100000;
+
+// Moves FRAMES_PER_ITERATION frames from range(0) producers to range(1) consumers through one queue.
+// Consumers keep reading until the queue is closed and drained, so every frame is counted once.
+template <typename Queue>
+void BM_QueueThroughput(benchmark::State& state) {
+    const std::size_t numProducers = static_cast<std::size_t>(state.range(0));
+    const std::size_t numConsumers = static_cast<std::size_t>(state.range(1));
+
+    for (auto _ : state) {
+        Queue queue;
+        std::atomic<std::size_t> numRead{0};
+
+        std::vector<std::thread> consumers;
+        for (std::size_t i = 0; i < numConsumers; ++i) {
+            consumers.emplace_back([&queue, &numRead] {
+                ByteFrameElement frame;
+                while (true) {
+                    if (queue.ReadSync(frame)) {
+                        numRead.fetch_add(1, std::memory_order_relaxed);
+                    } else if (queue.IsClosed() && queue.IsEmpty()) {
+                        return;
+                    }
+                }
+            });
+        }
+
+        std::vector<std::thread> producers;
+        for (std::size_t i = 0; i < numProducers; ++i) {
+            const std::size_t count = FRAMES_PER_ITERATION / numProducers + (i < FRAMES_PER_ITERATION % numProducers ? 1 : 0);
+            producers.emplace_back([&queue, count, i] {
+                ByteFrameElement frame;
+                frame.meta.streamId = static_cast<uint32_t>(i);
+                for (std::size_t n = 0; n < count; ++n) {
+                    frame.meta.sequence = n;
+                    frame.data = static_cast<uint8_t>(n);
+                    while (!queue.WriteSync(frame)) {}
+                }
+            });
+        }
+
+        for (auto& producer : producers) {
+            producer.join();
+        }
+        queue.Close();
+        for (auto& consumer : consumers) {
+            consumer.join();
+        }
+
+        if (numRead.load() != FRAMES_PER_ITERATION) {
+            state.SkipWithError("queue lost frames");
+            break;
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * FRAMES_PER_ITERATION));
+}
+
+void ProducerConsumerArgs(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({"producers", "consumers"});
+    for (int64_t producers : {1, 2, 4}) {
+        for (int64_t consumers : {1, 2, 4}) {
+            benchmark->Args({producers, consumers});
+        }
+    }
+}
+
+}
+
+BENCHMARK_TEMPLATE(BM_QueueThroughput, AsyncByteFrameQueue)->Apply(ProducerConsumerArgs)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_QueueThroughput, MpmcByteFrameQueue)->Apply(ProducerConsumerArgs)->UseRealTime()->Unit(benchmark::kMillisecond);
+// Only valid with one thread on each side.
+BENCHMARK_TEMPLATE(BM_QueueThroughput, SpscByteFrameQueue)->ArgNames({"producers", "consumers"})->Args({1, 1})->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,69 @@
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+#include "InplaceTask.hpp"
+#include "PipelineMetrics.hpp"
+#include "ThreadPool.hpp"
+#include "WorkStealingThreadPool.hpp"
+
+namespace {
+
+using namespace StreamSim::Core;
+
+constexpr std::size_t POOL_SIZE = 4;
+constexpr std::size_t TASKS_PER_ITERATION = 10000;
+
+// Time from Enqueue until the task starts running on a worker, one task in flight at a time so
+// it's the wakeup and handoff being measured, not queueing behind other tasks.
+template <typename Task>
+void BM_SimplePoolEnqueueToRun(benchmark::State& state) {
+    SimpleThreadPool<Task, POOL_SIZE> pool;
+    std::atomic<uint64_t> startedNs{0};
+
+    for (auto _ : state) {
+        startedNs.store(0, std::memory_order_relaxed);
+        const uint64_t enqueuedNs = PipelineNowNs();
+        pool.Enqueue(Task([&startedNs] {
+            startedNs.store(PipelineNowNs(), std::memory_order_release);
+        }));
+
+        uint64_t runNs = 0;
+        while ((runNs = startedNs.load(std::memory_order_acquire)) == 0) {}
+        state.SetIterationTime(static_cast<double>(runNs - enqueuedNs) / 1e9);
+    }
+}
+
+// Tasks per second through the pool when it is kept full.
+template <typename Pool>
+void BM_PoolThroughput(benchmark::State& state, Pool& pool) {
+    std::atomic<std::size_t> numDone{0};
+    for (auto _ : state) {
+        numDone.store(0, std::memory_order_relaxed);
+        for (std::size_t i = 0; i < TASKS_PER_ITERATION; ++i) {
+            pool.Enqueue([&numDone] {
+                numDone.fetch_add(1, std::memory_order_relaxed);
+            });
+        }
+        while (numDone.load(std::memory_order_acquire) < TASKS_PER_ITERATION) {}
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * TASKS_PER_ITERATION));
+}
+
+void BM_SimplePoolThroughput(benchmark::State& state) {
+    SimpleThreadPool<InplaceTask<>, POOL_SIZE> pool;
+    BM_PoolThroughput(state, pool);
+}
+
+void BM_WorkStealingPoolThroughput(benchmark::State& state) {
+    WorkStealingThreadPool<InplaceTask<>> pool(POOL_SIZE);
+    BM_PoolThroughput(state, pool);
+}
+
+}
+
+BENCHMARK_TEMPLATE(BM_SimplePoolEnqueueToRun, InplaceTask<>)->UseManualTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_SimplePoolEnqueueToRun, std::function<void()>)->UseManualTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_SimplePoolThroughput)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_WorkStealingPoolThroughput)->UseRealTime()->Unit(benchmark::kMillisecond);